@@ -4,6 +4,8 @@
 #include "uart_link.h"
 #include "net_mgr.h"
 #include "valve_ctrl.h"
+#include "sensor_table.h"
+#include "telemetry_rx.h"
 #include "lcd_ui.h"
 #include "buttons.h"
 #include "cli_commands.h"
@@ -16,12 +18,6 @@
 static uint32_t s_lastDataReport = 0;
 static uint32_t s_lastForceReport = 0;
 
-// Track last sent values to detect changes
-static uint16_t s_lastSentFlow = 0xFFFF;
-static uint8_t  s_lastSentBattery = 0xFF;
-static bool     s_lastSentValve = false;
-static app_mode_t s_lastSentMode = MODE_AUTO;
-
 void emberAfMainInitCallback(void)
 {
   // === CRITICAL: Set Trust Center Link Key Request Policy ===
@@ -37,12 +33,18 @@ void emberAfMainInitCallback(void)
   emberAfCorePrintln("APP: lcdUiInit() returned %d", lcdOk);
 
   appStateInit();
+  valveCtrlInit();
+  sensorTableInit();
+  historyInit();
+  totalizerInit();
+  leakInit();
+  staleInit();
   appStateNotifyChanged();
 
   // Set initial LCD values
   lcd_ui_set_flow(g_flow);
   lcd_ui_set_battery(g_batteryPercent);
-  lcd_ui_set_valve(valveCtrlIsOpen());
+  lcd_ui_set_valve(valveCtrlIsOpen(VALVE_DEFAULT));
   lcd_ui_set_network("STARTING");
 
   emberAfCorePrintln("Coordinator init, netState=%d", emberAfNetworkState());
@@ -79,39 +81,41 @@ void emberAfMainTickCallback(void)
   // 3) Network manager
   netMgrTick();
 
-  // 4) HEARTBEAT: Periodic @INFO (every 30 seconds for Dashboard)
+  // 4) Telemetry received since the last pass: control + one @DATA,
+  //    then volume checkpoints (NVM3), leak alarms and sensor deadlines,
+  //    then valve commands waiting for a TX slot
+  telemetryRxProcess();
+  totalizerTick();
+  leakProcess();
+  staleTick();
+  valveCtrlTick();
+
+  // 5) HEARTBEAT: Periodic @INFO (every 30 seconds for Dashboard)
   appLogHeartbeatTick();
 
-  // 5) Periodic @DATA output for Dashboard
+  // 6) Periodic @DATA output for Dashboard
   //    - Only send if data changed OR force interval passed
   //    - Reduces UART spam when data is static (e.g., no sensor connected)
   if (g_uartGatewayEnabled && (now - s_lastDataReport) >= DATA_REPORT_INTERVAL_MS) {
     s_lastDataReport = now;
     
-    // Check if any value changed
-    bool valveNow = valveCtrlIsOpen();
-    bool dataChanged = (g_flow != s_lastSentFlow) ||
-                       (g_batteryPercent != s_lastSentBattery) ||
-                       (valveNow != s_lastSentValve) ||
-                       (g_mode != s_lastSentMode);
-    
-    // Force send periodically even if unchanged (heartbeat)
+    // Change detection against the last @DATA frame lives in app_log
+    bool dataChanged = appLogDataChanged();
+
+    // Force a full snapshot periodically even if unchanged (heartbeat)
     bool forceReport = (now - s_lastForceReport) >= DATA_FORCE_INTERVAL_MS;
-    
+
     if (dataChanged || forceReport) {
-      appLogData();
-      
-      // Update last sent values
-      s_lastSentFlow = g_flow;
-      s_lastSentBattery = g_batteryPercent;
-      s_lastSentValve = valveNow;
-      s_lastSentMode = g_mode;
-      
       if (forceReport) {
         s_lastForceReport = now;
+        appLogDataRequestFull();
       }
+      appLogData();
     }
   }
+
+  // 7) Flush queued protocol output (bounded per tick)
+  uartLinkTxDrain();
 }
 
 void emberAfRadioNeedsCalibratingCallback(void)
@@ -14,9 +14,74 @@
 #define DEFAULT_CHANNEL      11u
 #define DEFAULT_TX_POWER_DBM 8
 
-#define UART_LINE_MAX        220u
+#define UART_LINE_MAX        512u   // room for batched @CMD lines
+#define UART_RX_BUF_SIZE     (2u * UART_LINE_MAX)  // must be > UART_LINE_MAX
+#define UART_RX_MAX_READS_PER_POLL 4u
+#define UART_TX_RING_ACK     768u   // queued protocol output per class (bytes)
+#define UART_TX_RING_ALRM    1024u  // an @ALRM burst; what does not fit stays pending
+#define UART_TX_RING_DATA    1024u  // >= 2 worst-case per-sensor frames (sensor_get page)
+#define UART_TX_RING_INFO    1024u  // > APP_LOG_LINE_MAX: a whole @INFO fits
+#define UART_TX_RING_LOG     1024u
+#define UART_TX_BUDGET_PER_TICK 128u // ~11 ms of UART time at 115200
+#define APP_LOG_LINE_MAX     864u   // longest formatted text frame (@INFO worst case)
+#define DATA_FULL_EVERY_DEFAULT 10u // delta @DATA: full snapshot every N frames
+#define TELEMETRY_COALESCE_MS 50u   // reports merged into one pass (0 = next tick)
+#define FLOW_FILTER_MEDIAN_DEFAULT 3u  // median-of-N ahead of AUTO control (1 = off)
+#define FLOW_FILTER_SHIFT_DEFAULT  0u  // EWMA alpha = 1/2^shift (0 = off)
 #define PB0_LONG_PRESS_MS    1500u
 
+// Valve table (valve_ctrl.c)
+#define VALVE_TABLE_MAX       32u    // valves per coordinator
+#define VALVE_TX_MAX_INFLIGHT 8u     // On/Off frames in flight at once, all valves
+#define VALVE_TX_DEADLINE_MS  8000u  // per attempt; beyond the stack's own APS retries
+#define VALVE_TX_RETRIES      3u     // retries after the first attempt
+#define VALVE_RETRY_BASE_MS   500u   // backoff before retry n: BASE << n (with jitter)
+#define VALVE_RETRY_MAX_MS    4000u
+// Longest a valve_set runs before its final @ACK: every attempt to its
+// deadline plus the longest backoffs (44 s), after at most one attempt of
+// the command it replaces (52 s). Mirrored in wfms/common/proto.py; the
+// gateway's CMD_DEADLINE_S must cover VALVE_CMD_BUDGET_MS. Time queued
+// behind VALVE_TX_MAX_INFLIGHT under load comes on top.
+#define VALVE_TX_BUDGET_MS    ((VALVE_TX_RETRIES + 1u) * VALVE_TX_DEADLINE_MS + VALVE_TX_RETRIES * VALVE_RETRY_MAX_MS)
+#define VALVE_CMD_BUDGET_MS   (VALVE_TX_DEADLINE_MS + VALVE_TX_BUDGET_MS)
+#define VALVE_PATH_LAT_SHIFT  3u     // AUTO path latency EWMAs, alpha 1/8
+#define VALVE_PATH_OK_SHIFT   5u     // AUTO path delivery ratio EWMA, alpha 1/32
+#define VALVE_PROBE_EVERY     32u    // AUTO: every n-th command tries the other path
+#define VALVE_CONFIRM_MS      5000u  // command done -> OnOff report; valve min report interval is 1 s
+
+// Flow history (history.c): per-sensor raw ring + 24 h of 1-minute buckets
+#define HIST_SENSORS         2u     // sensors with history (first to report flow); not
+                                    // per table entry: ~10.6 KiB each, 256 would need ~2.7 MiB
+#define HIST_RAW_SAMPLES     128u
+#define HIST_RAW_WINDOW_S    600u   // raw samples are served for 10 min
+#define HIST_BUCKETS         1440u  // 1-minute buckets, 24 h
+#define HIST_RAM_BUDGET      (24u * 1024u)  // compile-time cap for all slots (~10% of 256 KiB)
+
+// Volume totalizer (totalizer.c): NVM3 checkpoint policy
+#define TOTAL_CKPT_INTERVAL_S 3600u  // checkpoint at least this often while flowing
+#define TOTAL_CKPT_DELTA_L    1000u  // ... or after this much volume
+#define TOTAL_CKPT_MIN_S      300u   // but volume-triggered no more than this often
+#define TOTAL_MAX_GAP_MS      (15u * 60u * 1000u)  // longer report gaps add nothing
+
+// Leak detection (leak.c): per-hour-of-day baseline + sustained-flow windows
+#define LEAK_SENSORS          8u     // sensors checked (first to report flow)
+#define LEAK_LEARN_SHIFT      2u     // baseline EWMA alpha 1/4 per day
+#define LEAK_LEARN_DAYS       3u     // days an hour needs before it is checked
+#define LEAK_HOUR_MIN_SAMPLES 6u     // reports an hour needs to be learned
+#define LEAK_DEV_K            3u     // limit = mean + K x deviation + margin
+#define LEAK_DEV_MARGIN       5u
+#define LEAK_DEV_WINDOW_S     1800u  // above the limit this long: "deviation"
+#define LEAK_MIN_WINDOW_S     (3u * 3600u)  // never back to zero: "min_flow"
+#define LEAK_ZERO_FLOW        0u     // flow at or below this counts as none
+#define LEAK_MAX_GAP_S        900u   // longer report gaps restart the windows
+#define LEAK_CLOSE_DEFAULT    0      // close the valve on a leak (AUTO mode)
+
+// Stale sensors (stale.c): last-seen deadlines in a hashed timer wheel
+#define STALE_TIMEOUT_S_DEFAULT 300u // no report this long: sensor is stale
+#define STALE_ACTION_DEFAULT  0      // stale_action_t: 0 none, 1 close, 2 open
+#define STALE_WHEEL_SLOTS     256u   // power of 2; one turn = 256 ticks
+#define STALE_TICK_MS         1000u
+
 // ===== APS option naming compatibility (OK to keep) =====
 #ifndef EMBER_APS_OPTION_ACK_REQUEST
   #ifdef EMBER_OPTIONS_ACK_REQUESTED
@@ -4,6 +4,12 @@
 #include "app_utils.h"
 #include "net_mgr.h"
 #include "valve_ctrl.h"
+#include "bin_proto.h"
+#include "cmd_handler.h"
+#include "uart_link.h"
+#include "lat_stats.h"
+#include "sensor_table.h"
+#include "telemetry_rx.h"
 
 #include "app/framework/include/af.h"
 #include "stack/include/ember.h"
@@ -32,6 +38,22 @@ uint32_t appLogGetUptimeSec(void)
   return (msTick() - s_bootTick) / 1000u;
 }
 
+static uint32_t s_localOffsetS = 0;   // local time - uptime
+static bool     s_localSet = false;
+
+void appLogSetLocalTime(uint32_t localS)
+{
+  s_localOffsetS = localS - appLogGetUptimeSec();
+  s_localSet = true;
+}
+
+bool appLogLocalTime(uint32_t *localS)
+{
+  if (!s_localSet) return false;
+  *localS = appLogGetUptimeSec() + s_localOffsetS;
+  return true;
+}
+
 // ===== HEARTBEAT TICK =====
 void appLogHeartbeatTick(void)
 {
@@ -50,6 +72,28 @@ void appLogEmitHeartbeat(void)
   appLogInfo();
 }
 
+// Binary frames are built here, not on the stack (main-loop context only)
+static BinFrame_t s_binFrame;
+
+// ===== TEXT OUTPUT =====
+// Lines are formatted into RAM and queued on the UART TX ring; the actual
+// UART write happens later from uartLinkTxDrain() in the main tick.
+static char s_line[APP_LOG_LINE_MAX];
+
+static bool emitLine(uart_tx_class_t cls, const char *fmt, ...)
+{
+  va_list args;
+  va_start(args, fmt);
+  int n = vsnprintf(s_line, sizeof(s_line) - 2u, fmt, args);
+  va_end(args);
+  if (n < 0) return false;
+  if ((size_t)n > sizeof(s_line) - 3u) n = (int)(sizeof(s_line) - 3u);  // truncated
+
+  s_line[n++] = '\r';
+  s_line[n++] = '\n';
+  return uartLinkTxWrite(cls, s_line, (uint16_t)n);
+}
+
 // ===== HELPER: EUI64 -> hex string =====
 static void eui64ToHexStr(const uint8_t eui[8], char out[17])
 {
@@ -67,42 +111,374 @@ void printInfoToPC(void)
 
 static const char *modeStr(void) { return (g_mode == MODE_AUTO) ? "auto" : "manual"; }
 
+// ===== @DATA SNAPSHOT / DELTA =====
+// Every @DATA frame carries "ver", incremented once per frame, so the
+// gateway can spot lost frames from a gap. In delta mode a frame only
+// carries the fields that changed since the previous frame ("delta":true);
+// a full snapshot (no "delta" key) goes out every s_dataFullEvery frames,
+// on request, and after the TX ring had to coalesce queued @DATA frames.
+typedef struct {
+  uint64_t volMl;
+  uint16_t flow;
+  uint16_t flowF;
+  uint16_t valveNodeId;
+  uint8_t  valveOpen;
+  uint8_t  battery;
+  uint8_t  mode;
+  uint8_t  txPending;
+  uint8_t  path;
+  uint8_t  known;
+} DataSnap_t;
+
+#define DF_FLOW        0x01u
+#define DF_VALVE       0x02u
+#define DF_BATTERY     0x04u
+#define DF_MODE        0x08u
+#define DF_TX_PENDING  0x10u
+#define DF_PATH        0x20u
+#define DF_NODE_ID     0x40u
+#define DF_KNOWN       0x80u
+#define DF_FLOW_F      0x100u
+#define DF_VOL         0x200u
+#define DF_ALL         0x3FFu
+
+static DataSnap_t s_dataLast;
+static uint32_t s_dataVer = 0;
+static bool     s_dataDelta = false;
+static uint8_t  s_dataFullEvery = DATA_FULL_EVERY_DEFAULT;
+static uint8_t  s_dataSinceFull = 0;
+static bool     s_dataFullPending = true;
+static uint32_t s_dataDropSeen = 0;
+
+static void dataSnapTake(DataSnap_t *d)
+{
+  d->flow = g_flow;
+  d->flowF = g_flowFiltered;
+  d->volMl = totalizerVolumeMl(sensorTablePrimary());
+  d->valveNodeId = (uint16_t)valveCtrlGetNodeId(VALVE_DEFAULT);
+  d->valveOpen = valveCtrlIsOpen(VALVE_DEFAULT) ? 1u : 0u;
+  d->battery = g_batteryPercent;
+  d->mode = (uint8_t)g_mode;
+  d->txPending = valveCtrlTxActive(VALVE_DEFAULT) ? 1u : 0u;
+  d->path = (uint8_t)valveCtrlGetPath(VALVE_DEFAULT);
+  d->known = valveCtrlIsKnown(VALVE_DEFAULT) ? 1u : 0u;
+}
+
+static uint16_t dataSnapDiff(const DataSnap_t *a, const DataSnap_t *b)
+{
+  uint16_t m = 0;
+  if (a->flow != b->flow)               m |= DF_FLOW;
+  if (a->flowF != b->flowF)             m |= DF_FLOW_F;
+  if (a->volMl != b->volMl)             m |= DF_VOL;
+  if (a->valveOpen != b->valveOpen)     m |= DF_VALVE;
+  if (a->battery != b->battery)         m |= DF_BATTERY;
+  if (a->mode != b->mode)               m |= DF_MODE;
+  if (a->txPending != b->txPending)     m |= DF_TX_PENDING;
+  if (a->path != b->path)               m |= DF_PATH;
+  if (a->valveNodeId != b->valveNodeId) m |= DF_NODE_ID;
+  if (a->known != b->known)             m |= DF_KNOWN;
+  return m;
+}
+
+bool appLogDataChanged(void)
+{
+  DataSnap_t cur;
+  dataSnapTake(&cur);
+  return dataSnapDiff(&cur, &s_dataLast) != 0;
+}
+
+void appLogDataRequestFull(void) { s_dataFullPending = true; }
+
+void appLogDataConfig(bool delta, uint8_t fullEvery)
+{
+  s_dataDelta = delta;
+  s_dataFullEvery = (fullEvery == 0) ? 1u : fullEvery;
+  s_dataFullPending = true;
+}
+
+bool appLogDataDeltaEnabled(void) { return s_dataDelta; }
+uint8_t appLogDataFullEvery(void) { return s_dataFullEvery; }
+
+// newlib-nano printf has no %llu
+static const char *u64Str(char *buf, uint8_t size, uint64_t v)
+{
+  char *p = &buf[size - 1u];
+  *p = '\0';
+  do {
+    *--p = (char)('0' + (v % 10u));
+    v /= 10u;
+  } while (v != 0 && p > buf);
+  return p;
+}
+
+static void putU64(BinFrame_t *f, uint8_t tag, uint64_t v)
+{
+  uint8_t b[8];
+  for (uint8_t i = 0; i < sizeof(b); i++) b[i] = (uint8_t)(v >> (8u * i));
+  binFramePutBytes(f, tag, b, sizeof(b));
+}
+
+// snprintf append, clamped to the buffer
+static uint16_t catf(char *buf, uint16_t n, uint16_t max, const char *fmt, ...)
+{
+  if (n >= max) return n;
+  va_list args;
+  va_start(args, fmt);
+  int w = vsnprintf(&buf[n], (size_t)(max - n), fmt, args);
+  va_end(args);
+  if (w < 0) return n;
+  return ((uint32_t)n + (uint32_t)w >= max) ? (uint16_t)(max - 1u) : (uint16_t)(n + w);
+}
+
 void appLogData(void)
 {
-  emberAfCorePrintln(
-    "@DATA {\"flow\":%u,\"valve\":\"%s\",\"battery\":%u,\"mode\":\"%s\""
-    ",\"tx_pending\":%s,\"valve_path\":\"%s\""
-    ",\"valve_node_id\":\"0x%04X\",\"valve_known\":%s}",
-    g_flow,
-    valveCtrlIsOpen() ? "open" : "closed",
-    g_batteryPercent,
-    modeStr(),
-    valveCtrlTxActive() ? "true" : "false",
-    valveCtrlPathStr(),
-    (uint16_t)valveCtrlGetNodeId(),
-    valveCtrlIsKnown() ? "true" : "false"
+  DataSnap_t cur;
+  dataSnapTake(&cur);
+  uint16_t changed = dataSnapDiff(&cur, &s_dataLast);
+
+  uint32_t drops = uartLinkTxDropped(UART_TX_DATA);
+  if (drops != s_dataDropSeen) {
+    s_dataDropSeen = drops;
+    s_dataFullPending = true;
+  }
+
+  bool full = !s_dataDelta || s_dataFullPending ||
+              ((uint16_t)s_dataSinceFull + 1u >= s_dataFullEvery);
+  if (!full && changed == 0) return;
+  if (full) changed = DF_ALL;
+
+  s_dataVer++;
+  s_dataLast = cur;
+  if (full) {
+    s_dataSinceFull = 0;
+    s_dataFullPending = false;
+  } else {
+    s_dataSinceFull++;
+  }
+
+  if (binProtoEnabled()) {
+    BinFrame_t *f = &s_binFrame;
+    binFrameBegin(f, BIN_T_DATA);
+    binFramePutU32(f, BIN_TAG_VER, s_dataVer);
+    if (!full) binFramePutU8(f, BIN_TAG_DELTA, 1u);
+    if (changed & DF_FLOW)       binFramePutU16(f, BIN_TAG_FLOW, cur.flow);
+    if (changed & DF_FLOW_F)     binFramePutU16(f, BIN_TAG_FLOW_F, cur.flowF);
+    if (changed & DF_VOL)        putU64(f, BIN_TAG_VOL_ML, cur.volMl);
+    if (changed & DF_VALVE)      binFramePutU8(f, BIN_TAG_VALVE, cur.valveOpen);
+    if (changed & DF_BATTERY)    binFramePutU8(f, BIN_TAG_BATTERY, cur.battery);
+    if (changed & DF_MODE)       binFramePutU8(f, BIN_TAG_MODE, cur.mode);
+    if (changed & DF_TX_PENDING) binFramePutU8(f, BIN_TAG_TX_PENDING, cur.txPending);
+    if (changed & DF_PATH)       binFramePutU8(f, BIN_TAG_VALVE_PATH, cur.path);
+    if (changed & DF_NODE_ID)    binFramePutU16(f, BIN_TAG_VALVE_NODE_ID, cur.valveNodeId);
+    if (changed & DF_KNOWN)      binFramePutU8(f, BIN_TAG_VALVE_KNOWN, cur.known);
+    binFrameSend(f);
+    return;
+  }
+
+  char body[224];
+  uint16_t n = 0;
+  n = catf(body, n, sizeof(body), "\"ver\":%lu", (unsigned long)s_dataVer);
+  if (!full) n = catf(body, n, sizeof(body), ",\"delta\":true");
+  if (changed & DF_FLOW)    n = catf(body, n, sizeof(body), ",\"flow\":%u", cur.flow);
+  if (changed & DF_FLOW_F)  n = catf(body, n, sizeof(body), ",\"flow_f\":%u", cur.flowF);
+  if (changed & DF_VOL) {
+    char v[21];
+    n = catf(body, n, sizeof(body), ",\"vol_ml\":%s", u64Str(v, sizeof(v), cur.volMl));
+  }
+  if (changed & DF_VALVE)   n = catf(body, n, sizeof(body), ",\"valve\":\"%s\"", cur.valveOpen ? "open" : "closed");
+  if (changed & DF_BATTERY) n = catf(body, n, sizeof(body), ",\"battery\":%u", cur.battery);
+  if (changed & DF_MODE)    n = catf(body, n, sizeof(body), ",\"mode\":\"%s\"", modeStr());
+  if (changed & DF_TX_PENDING) {
+    n = catf(body, n, sizeof(body), ",\"tx_pending\":%s", cur.txPending ? "true" : "false");
+  }
+  if (changed & DF_PATH)    n = catf(body, n, sizeof(body), ",\"valve_path\":\"%s\"", valveCtrlPathStr(VALVE_DEFAULT));
+  if (changed & DF_NODE_ID) n = catf(body, n, sizeof(body), ",\"valve_node_id\":\"0x%04X\"", cur.valveNodeId);
+  if (changed & DF_KNOWN)   n = catf(body, n, sizeof(body), ",\"valve_known\":%s", cur.known ? "true" : "false");
+
+  emitLine(UART_TX_DATA, "@DATA {%s}", body);
+}
+
+static void putSeqStats(BinFrame_t *f, const SeqStats_t *q)
+{
+  uint32_t v[4] = { q->rx, q->lost, q->dup, q->reord };
+  uint8_t b[sizeof(v)];
+  for (uint8_t i = 0; i < sizeof(b); i++) b[i] = (uint8_t)(v[i / 4u] >> (8u * (i % 4u)));
+  binFramePutBytes(f, BIN_TAG_SEQ, b, sizeof(b));
+}
+
+// AUTO path statistics of a valve:
+// [direct lat_ms, ok_pct, n, binding lat_ms, ok_pct, n]
+static void valvePathStats(uint8_t v, uint16_t out[6])
+{
+  for (uint8_t p = 0; p < 2u; p++) {
+    uint8_t okPct;
+    valveCtrlPathStats(v, p == 0u, &out[p * 3u], &okPct, &out[p * 3u + 2u]);
+    out[p * 3u + 1u] = okPct;
+  }
+}
+
+static void putValvePath(BinFrame_t *f, uint8_t v)
+{
+  uint16_t ps[6];
+  valvePathStats(v, ps);
+  uint8_t b[sizeof(ps)];
+  for (uint8_t i = 0; i < sizeof(b); i++) b[i] = (uint8_t)(ps[i / 2u] >> (8u * (i % 2u)));
+  binFramePutBytes(f, BIN_TAG_VPATH, b, sizeof(b));
+}
+
+// Per-sensor telemetry: @DATA {"sensor":"0x1234",...}. Not versioned and
+// not part of the delta stream; the plain @DATA stays the primary sensor.
+void appLogSensorData(const Sensor_t *s)
+{
+  if (!s || s->nodeId == EMBER_NULL_NODE_ID) return;
+
+  uint32_t ageS = (msTick() - s->lastSeenMs) / 1000u;
+
+  if (binProtoEnabled()) {
+    BinFrame_t *f = &s_binFrame;
+    binFrameBegin(f, BIN_T_DATA);
+    binFramePutU16(f, BIN_TAG_SENSOR, s->nodeId);
+    if (s->flags & SENSOR_F_EUI) binFramePutBytes(f, BIN_TAG_EUI64, s->eui, EUI64_SIZE);
+    for (uint8_t id = 0; id < MEAS_COUNT; id++) {
+      if (!(s->measMask & (1u << id))) continue;
+      const AttrDef_t *def = attrRegistryGet(id);
+      uint32_t v = (uint32_t)s->meas[id];
+      if (def->binWidth == 1u)      binFramePutU8(f, def->binTag, (uint8_t)v);
+      else if (def->binWidth == 2u) binFramePutU16(f, def->binTag, (uint16_t)v);
+      else                          binFramePutU32(f, def->binTag, v);
+    }
+    if (s->measMask & (1u << MEAS_FLOW)) {
+      binFramePutU16(f, BIN_TAG_FLOW_F, s->flowF);
+      putU64(f, BIN_TAG_VOL_ML, totalizerVolumeMl(s));
+    }
+    binFramePutU8(f, BIN_TAG_LQI, s->lqi);
+    putSeqStats(f, &s->seq);
+    binFramePutU32(f, BIN_TAG_AGE_S, ageS);
+    binFramePutU8(f, BIN_TAG_PRIMARY, sensorTableIsPrimary(s) ? 1u : 0u);
+    binFrameSend(f);
+    return;
+  }
+
+  char body[APP_LOG_SENSOR_BODY_MAX];
+  uint16_t n = 0;
+  n = catf(body, n, sizeof(body), "\"sensor\":\"0x%04X\"", s->nodeId);
+  if (s->flags & SENSOR_F_EUI) {
+    char euiStr[17];
+    eui64ToStringBigEndian(euiStr, sizeof(euiStr), s->eui);
+    n = catf(body, n, sizeof(body), ",\"eui64\":\"%s\"", euiStr);
+  }
+  for (uint8_t id = 0; id < MEAS_COUNT; id++) {
+    if (!(s->measMask & (1u << id))) continue;
+    n = catf(body, n, sizeof(body), ",\"%s\":%ld", attrRegistryGet(id)->key, (long)s->meas[id]);
+  }
+  if (s->measMask & (1u << MEAS_FLOW)) {
+    char v[21];
+    n = catf(body, n, sizeof(body), ",\"flow_f\":%u,\"vol_ml\":%s",
+             s->flowF, u64Str(v, sizeof(v), totalizerVolumeMl(s)));
+  }
+  n = catf(body, n, sizeof(body), ",\"lqi\":%u,\"seq\":[%lu,%lu,%lu,%lu],\"age_s\":%lu,\"primary\":%s",
+           s->lqi, (unsigned long)s->seq.rx, (unsigned long)s->seq.lost,
+           (unsigned long)s->seq.dup, (unsigned long)s->seq.reord,
+           (unsigned long)ageS, sensorTableIsPrimary(s) ? "true" : "false");
+
+  emitLine(UART_TX_DATA, "@DATA {%s}", body);
+}
+
+void appLogValveData(uint8_t v)
+{
+  if (binProtoEnabled()) {
+    BinFrame_t *f = &s_binFrame;
+    binFrameBegin(f, BIN_T_DATA);
+    binFramePutU8(f, BIN_TAG_VALVE_IDX, v);
+    binFramePutU8(f, BIN_TAG_VALVE, valveCtrlIsOpen(v) ? 1u : 0u);
+    binFramePutU8(f, BIN_TAG_VALVE_KNOWN, valveCtrlIsKnown(v) ? 1u : 0u);
+    binFramePutU16(f, BIN_TAG_VALVE_NODE_ID, (uint16_t)valveCtrlGetNodeId(v));
+    binFramePutU8(f, BIN_TAG_VALVE_PATH, (uint8_t)valveCtrlGetPath(v));
+    binFramePutU8(f, BIN_TAG_TX_PENDING, valveCtrlTxActive(v) ? 1u : 0u);
+    putValvePath(f, v);
+    binFramePutU8(f, BIN_TAG_CONF, (uint8_t)valveCtrlConf(v));
+    binFramePutU16(f, BIN_TAG_CONF_MS, valveCtrlConfirmMs(v));
+    binFrameSend(f);
+    return;
+  }
+
+  uint16_t ps[6];
+  valvePathStats(v, ps);
+  emitLine(UART_TX_DATA,
+    "@DATA {\"valve_idx\":%u,\"valve\":\"%s\",\"valve_known\":%s,\"valve_node_id\":\"0x%04X\","
+    "\"valve_path\":\"%s\",\"tx_pending\":%s,\"vpath\":[%u,%u,%u,%u,%u,%u],"
+    "\"conf\":\"%s\",\"conf_ms\":%u}",
+    (unsigned)v,
+    valveCtrlIsOpen(v) ? "open" : "closed",
+    valveCtrlIsKnown(v) ? "true" : "false",
+    (uint16_t)valveCtrlGetNodeId(v),
+    valveCtrlPathStr(v),
+    valveCtrlTxActive(v) ? "true" : "false",
+    ps[0], ps[1], ps[2], ps[3], ps[4], ps[5],
+    valveCtrlConfStr(v),
+    (unsigned)valveCtrlConfirmMs(v)
   );
 }
 
-void appLogAck(uint32_t id, bool ok, const char *msg)
+static void sendBinAck(uint32_t id, bool ok, const char *msg, bool hasZb, uint8_t zstatus, const char *stage)
 {
-  if (!msg) msg = "";
-  emberAfCorePrintln(
+  BinFrame_t *f = &s_binFrame;
+  binFrameBegin(f, BIN_T_ACK);
+  binFramePutU32(f, BIN_TAG_ID, id);
+  binFramePutU8(f, BIN_TAG_OK, ok ? 1u : 0u);
+  binFramePutStr(f, BIN_TAG_MSG, msg);
+  if (hasZb) {
+    binFramePutU8(f, BIN_TAG_ZSTATUS, zstatus);
+    binFramePutStr(f, BIN_TAG_STAGE, stage);
+  }
+  binFramePutU8(f, BIN_TAG_MODE, (uint8_t)g_mode);
+  binFramePutU8(f, BIN_TAG_VALVE, valveCtrlIsOpen(VALVE_DEFAULT) ? 1u : 0u);
+  binFrameSend(f);
+}
+
+static void emitAck(uint32_t id, bool ok, const char *msg)
+{
+  if (binProtoEnabled()) {
+    sendBinAck(id, ok, msg, false, 0, NULL);
+    return;
+  }
+  emitLine(UART_TX_ACK,
     "@ACK {\"id\":%lu,\"ok\":%s,\"msg\":\"%s\",\"mode\":\"%s\",\"valve\":\"%s\"}",
     (unsigned long)id,
     ok ? "true" : "false",
     msg,
     modeStr(),
-    valveCtrlIsOpen() ? "open" : "closed"
+    valveCtrlIsOpen(VALVE_DEFAULT) ? "open" : "closed"
   );
 }
 
+void appLogAck(uint32_t id, bool ok, const char *msg)
+{
+  if (!msg) msg = "";
+  if (cmdCaptureAck(id, ok, msg)) return;
+  cmdNoteAck(id, ok, msg, false, 0, NULL);
+  latStatsMark(id, LAT_PT_ACK);
+  emitAck(id, ok, msg);
+}
+
+void appLogAckInterim(uint32_t id, const char *msg)
+{
+  emitAck(id, false, msg ? msg : "");
+}
+
 // Extended ACK with Zigbee status code
 void appLogAckZb(uint32_t id, bool ok, const char *msg, uint8_t zstatus, const char *stage)
 {
   if (!msg) msg = "";
   if (!stage) stage = "";
-  emberAfCorePrintln(
+  if (cmdCaptureAck(id, ok, msg)) return;
+  cmdNoteAck(id, ok, msg, true, zstatus, stage);
+  latStatsMark(id, LAT_PT_ACK);
+  if (binProtoEnabled()) {
+    sendBinAck(id, ok, msg, true, zstatus, stage);
+    return;
+  }
+  emitLine(UART_TX_ACK,
     "@ACK {\"id\":%lu,\"ok\":%s,\"msg\":\"%s\",\"zstatus\":\"0x%02X\",\"stage\":\"%s\","
     "\"mode\":\"%s\",\"valve\":\"%s\"}",
     (unsigned long)id,
@@ -111,7 +487,41 @@ void appLogAckZb(uint32_t id, bool ok, const char *msg, uint8_t zstatus, const c
     (unsigned)zstatus,
     stage,
     modeStr(),
-    valveCtrlIsOpen() ? "open" : "closed"
+    valveCtrlIsOpen(VALVE_DEFAULT) ? "open" : "closed"
+  );
+}
+
+// Aggregated ACK for a @CMD batch; results = JSON array members, no brackets
+void appLogAckBatch(uint32_t id, bool ok, const char *msg, const char *results, bool truncated)
+{
+  if (!msg) msg = "";
+  if (!results) results = "";
+  cmdNoteAck(id, ok, msg, false, 0, NULL);
+  latStatsMark(id, LAT_PT_ACK);
+
+  if (binProtoEnabled()) {
+    BinFrame_t *f = &s_binFrame;
+    binFrameBegin(f, BIN_T_ACK);
+    binFramePutU32(f, BIN_TAG_ID, id);
+    binFramePutU8(f, BIN_TAG_OK, ok ? 1u : 0u);
+    binFramePutStr(f, BIN_TAG_MSG, msg);
+    binFramePutStr(f, BIN_TAG_RESULTS, results);
+    if (truncated) binFramePutU8(f, BIN_TAG_TRUNCATED, 1u);
+    binFramePutU8(f, BIN_TAG_MODE, (uint8_t)g_mode);
+    binFramePutU8(f, BIN_TAG_VALVE, valveCtrlIsOpen(VALVE_DEFAULT) ? 1u : 0u);
+    binFrameSend(f);
+    return;
+  }
+
+  emitLine(UART_TX_ACK,
+    "@ACK {\"id\":%lu,\"ok\":%s,\"msg\":\"%s\",\"results\":[%s]%s,\"mode\":\"%s\",\"valve\":\"%s\"}",
+    (unsigned long)id,
+    ok ? "true" : "false",
+    msg,
+    results,
+    truncated ? ",\"truncated\":true" : "",
+    modeStr(),
+    valveCtrlIsOpen(VALVE_DEFAULT) ? "open" : "closed"
   );
 }
 
@@ -126,9 +536,20 @@ void appLogLog(const char *tag, const char *event, const char *fmt, ...)
     va_end(args);
   }
 
+  if (binProtoEnabled()) {
+    BinFrame_t *f = &s_binFrame;
+    binFrameBegin(f, BIN_T_LOG);
+    binFramePutStr(f, BIN_TAG_TAG, tag ? tag : "");
+    binFramePutStr(f, BIN_TAG_EVENT, event ? event : "");
+    if (extra[0] != '\0') binFramePutStr(f, BIN_TAG_EXTRA, extra);
+    binFramePutU32(f, BIN_TAG_UPTIME, appLogGetUptimeSec());
+    binFrameSend(f);
+    return;
+  }
+
   // Build JSON - if extra is non-empty, append it
   if (extra[0] != '\0') {
-    emberAfCorePrintln(
+    emitLine(UART_TX_LOG,
       "@LOG {\"tag\":\"%s\",\"event\":\"%s\",%s,\"uptime\":%lu}",
       tag ? tag : "",
       event ? event : "",
@@ -136,7 +557,7 @@ void appLogLog(const char *tag, const char *event, const char *fmt, ...)
       (unsigned long)appLogGetUptimeSec()
     );
   } else {
-    emberAfCorePrintln(
+    emitLine(UART_TX_LOG,
       "@LOG {\"tag\":\"%s\",\"event\":\"%s\",\"uptime\":%lu}",
       tag ? tag : "",
       event ? event : "",
@@ -145,6 +566,162 @@ void appLogLog(const char *tag, const char *event, const char *fmt, ...)
   }
 }
 
+// One @STAT line per latency stage (see lat_stats.h for the buckets)
+void appLogStats(uint32_t id)
+{
+  for (uint8_t st = 0; st < LAT_ST_COUNT; st++) {
+    const LatHist_t *h = latStatsGet((lat_stage_t)st);
+
+    if (binProtoEnabled()) {
+      uint8_t hb[2 * LAT_BUCKETS];
+      for (uint8_t b = 0; b < LAT_BUCKETS; b++) {
+        hb[2u * b] = (uint8_t)h->h[b];
+        hb[2u * b + 1u] = (uint8_t)(h->h[b] >> 8);
+      }
+      BinFrame_t *f = &s_binFrame;
+      binFrameBegin(f, BIN_T_STAT);
+      binFramePutU32(f, BIN_TAG_ID, id);
+      binFramePutStr(f, BIN_TAG_STAT_STAGE, latStatsStageName((lat_stage_t)st));
+      binFramePutU32(f, BIN_TAG_STAT_N, h->n);
+      binFramePutU32(f, BIN_TAG_STAT_AVG_US, latStatsAvgUs(h));
+      binFramePutU32(f, BIN_TAG_STAT_MAX_US, h->maxUs);
+      binFramePutBytes(f, BIN_TAG_STAT_HIST, hb, sizeof(hb));
+      binFrameSend(f);
+      continue;
+    }
+
+    char hist[6 * LAT_BUCKETS + 1];
+    uint16_t n = 0;
+    for (uint8_t b = 0; b < LAT_BUCKETS; b++) {
+      n = catf(hist, n, sizeof(hist), b ? ",%u" : "%u", (unsigned)h->h[b]);
+    }
+    emitLine(UART_TX_LOG,
+      "@STAT {\"id\":%lu,\"stage\":\"%s\",\"n\":%lu,\"avg_us\":%lu,\"max_us\":%lu,"
+      "\"base_us\":%u,\"h\":[%s]}",
+      (unsigned long)id,
+      latStatsStageName((lat_stage_t)st),
+      (unsigned long)h->n,
+      (unsigned long)latStatsAvgUs(h),
+      (unsigned long)h->maxUs,
+      (unsigned)LAT_BUCKET0_US,
+      hist
+    );
+  }
+}
+
+#define HIST_PAGE_RAW  24u   // worst case fits APP_LOG_LINE_MAX / a 255-byte TLV
+#define HIST_PAGE_MIN  14u
+
+uint16_t appLogHistory(uint32_t id, const Sensor_t *s, uint8_t kind,
+                       uint16_t offset, uint8_t *sent)
+{
+  bool raw = (kind == HIST_KIND_RAW);
+  uint8_t pageMax = raw ? HIST_PAGE_RAW : HIST_PAGE_MIN;
+  uint16_t total = historyCount(s, (hist_kind_t)kind);
+  bool bin = binProtoEnabled();
+
+  static char s_hist[APP_LOG_LINE_MAX - 96u];
+  uint8_t hb[HIST_PAGE_MIN * 11u];
+  _Static_assert(HIST_PAGE_RAW * 6u <= sizeof(hb), "raw page exceeds TLV buffer");
+  uint16_t n = 0;
+  uint8_t cnt = 0;
+  uint16_t pos = offset;
+
+  for (; pos < total && cnt < pageMax; pos++) {
+    if (raw) {
+      HistRaw_t r;
+      if (!historyRawAt(s, pos, &r)) break;
+      if (bin) {
+        memcpy(&hb[n], &r, sizeof(r));   // packed, little-endian
+        n = (uint16_t)(n + sizeof(r));
+      } else {
+        n = catf(s_hist, n, sizeof(s_hist), cnt ? ",[%lu,%u]" : "[%lu,%u]",
+                 (unsigned long)r.tS, (unsigned)r.v);
+      }
+    } else {
+      uint32_t minute;
+      HistBucket_t b;
+      if (!historyBucketAt(s, pos, &minute, &b)) break;
+      if (b.n == 0) continue;
+      uint32_t t = minute * 60u;
+      if (bin) {
+        memcpy(&hb[n], &t, sizeof(t));
+        memcpy(&hb[n + 4u], &b, sizeof(b));
+        n = (uint16_t)(n + 4u + sizeof(b));
+      } else {
+        n = catf(s_hist, n, sizeof(s_hist), cnt ? ",[%lu,%u,%u,%u,%u]" : "[%lu,%u,%u,%u,%u]",
+                 (unsigned long)t, (unsigned)b.min, (unsigned)b.max, (unsigned)b.avg, (unsigned)b.n);
+      }
+    }
+    cnt++;
+  }
+
+  // @HIST rides the LOG class, which drops the new frame when full: report
+  // a page that was not queued as "0 sent, next = offset" so the ACK never
+  // claims data the gateway will not see, and it simply asks again.
+  bool queued;
+  if (bin) {
+    BinFrame_t *f = &s_binFrame;
+    binFrameBegin(f, BIN_T_HIST);
+    binFramePutU32(f, BIN_TAG_ID, id);
+    binFramePutU16(f, BIN_TAG_SENSOR, s->nodeId);
+    binFramePutU8(f, BIN_TAG_HIST_KIND, kind);
+    binFramePutU32(f, BIN_TAG_UPTIME, appLogGetUptimeSec());
+    binFramePutU16(f, BIN_TAG_HIST_OFFSET, offset);
+    binFramePutBytes(f, raw ? BIN_TAG_HIST_RAW : BIN_TAG_HIST_MIN, hb, (uint8_t)n);
+    queued = binFrameSend(f);
+  } else {
+    if (cnt == 0) s_hist[0] = '\0';
+    queued = emitLine(UART_TX_LOG,
+      "@HIST {\"id\":%lu,\"sensor\":\"0x%04X\",\"kind\":\"%s\",\"uptime\":%lu,\"offset\":%u,\"%s\":[%s]}",
+      (unsigned long)id, s->nodeId, raw ? "raw" : "min",
+      (unsigned long)appLogGetUptimeSec(), (unsigned)offset, raw ? "s" : "b", s_hist);
+  }
+  if (!queued) {
+    *sent = 0;
+    return offset;
+  }
+  *sent = cnt;
+  return pos;
+}
+
+static const char *const s_alrmKind[ALRM_KIND_COUNT] = { "deviation", "min_flow", "stale" };
+static const char *const s_alrmValue[ALRM_KIND_COUNT] = { "limit", "min", "timeout_s" };
+static const uint8_t s_alrmTag[ALRM_KIND_COUNT] = {
+  BIN_TAG_ALRM_LIMIT, BIN_TAG_ALRM_MIN, BIN_TAG_ALRM_TIMEOUT_S
+};
+
+bool appLogAlarm(const Sensor_t *s, alrm_kind_t kind, bool raised, uint32_t value, uint32_t forS)
+{
+  if (!s || kind >= ALRM_KIND_COUNT) return true;
+
+  if (binProtoEnabled()) {
+    BinFrame_t *f = &s_binFrame;
+    binFrameBegin(f, BIN_T_ALRM);
+    binFramePutU16(f, BIN_TAG_SENSOR, s->nodeId);
+    binFramePutU8(f, BIN_TAG_ALRM_KIND, (uint8_t)kind);
+    binFramePutU8(f, BIN_TAG_ALRM_RAISED, raised ? 1u : 0u);
+    binFramePutU16(f, BIN_TAG_FLOW, s->flowF);
+    if (kind == ALRM_STALE) binFramePutU32(f, s_alrmTag[kind], value);
+    else                    binFramePutU16(f, s_alrmTag[kind], (uint16_t)value);
+    binFramePutU32(f, BIN_TAG_ALRM_FOR_S, forS);
+    binFramePutU32(f, BIN_TAG_UPTIME, appLogGetUptimeSec());
+    return binFrameSend(f);
+  }
+
+  return emitLine(UART_TX_ALRM,
+    "@ALRM {\"sensor\":\"0x%04X\",\"kind\":\"%s\",\"state\":\"%s\",\"flow\":%u,"
+    "\"%s\":%lu,\"for_s\":%lu,\"uptime\":%lu}",
+    s->nodeId, s_alrmKind[kind], raised ? "raised" : "cleared", (unsigned)s->flowF,
+    s_alrmValue[kind], (unsigned long)value, (unsigned long)forS,
+    (unsigned long)appLogGetUptimeSec());
+}
+
+// "tx_drop" order: classes added later go at the end
+static const uart_tx_class_t s_txDropOrder[UART_TX_CLASS_COUNT] = {
+  UART_TX_ACK, UART_TX_DATA, UART_TX_INFO, UART_TX_LOG, UART_TX_ALRM
+};
+
 void appLogInfo(void)
 {
   ensureInit();
@@ -168,25 +745,142 @@ void appLogInfo(void)
     ch = params.radioChannel;
   }
 
+  // command latency, @CMD line -> final @ACK: [n, avg_us, max_us]
+  const LatHist_t *lat = latStatsGet(LAT_ST_TOTAL);
+  // valve commands: [ok, failed, retries, timeouts]
+  const ValveTxStats_t *vtx = valveCtrlTxStats();
+  // valve state reports: [reports, confirmed, unconfirmed, diverged]
+  const ValveConfStats_t *vconf = valveCtrlConfStats();
+  // default valve AUTO path statistics
+  uint16_t ps[6];
+  valvePathStats(VALVE_DEFAULT, ps);
+  // ZCL report sequence totals: [rx, lost, dup, reord]
+  const SeqStats_t *seq = telemetryRxSeqTotals();
+  char volStr[21];   // site volume, mL
+  uint32_t localS = 0;   // 0 = local time not set
+  (void)appLogLocalTime(&localS);
+
   char valveEuiStr[17] = "0000000000000000";
-  if (valveCtrlIsKnown()) {
-    const EmberEUI64 *ve = valveCtrlGetEuiLe();
+  if (valveCtrlIsKnown(VALVE_DEFAULT)) {
+    const EmberEUI64 *ve = valveCtrlGetEuiLe(VALVE_DEFAULT);
     if (ve) eui64ToStringBigEndian(valveEuiStr, sizeof(valveEuiStr), *ve);
   }
 
-  emberAfCorePrintln(
+  if (binProtoEnabled()) {
+    static const EmberEUI64 noEui = {0};
+    const EmberEUI64 *ve = valveCtrlIsKnown(VALVE_DEFAULT) ? valveCtrlGetEuiLe(VALVE_DEFAULT) : &noEui;
+
+    BinFrame_t *f = &s_binFrame;
+    binFrameBegin(f, BIN_T_INFO);
+    binFramePutU16(f, BIN_TAG_NODE_ID, nodeId);
+    binFramePutBytes(f, BIN_TAG_EUI64, eui, EUI64_SIZE);
+    binFramePutU16(f, BIN_TAG_PAN_ID, panId);
+    binFramePutU8(f, BIN_TAG_CH, ch);
+    binFramePutU8(f, BIN_TAG_TX_POWER, (uint8_t)pwr);
+    binFramePutU8(f, BIN_TAG_NET_STATE, (uint8_t)st);
+    binFramePutU8(f, BIN_TAG_UART_GATEWAY, g_uartGatewayEnabled ? 1u : 0u);
+    binFramePutU8(f, BIN_TAG_MODE, (uint8_t)g_mode);
+    binFramePutU8(f, BIN_TAG_VALVE_PATH, (uint8_t)valveCtrlGetPath(VALVE_DEFAULT));
+    binFramePutU8(f, BIN_TAG_VALVE_KNOWN, valveCtrlIsKnown(VALVE_DEFAULT) ? 1u : 0u);
+    binFramePutBytes(f, BIN_TAG_VALVE_EUI64, ve ? *ve : noEui, EUI64_SIZE);
+    binFramePutU16(f, BIN_TAG_VALVE_NODE_ID, (uint16_t)valveCtrlGetNodeId(VALVE_DEFAULT));
+    binFramePutU8(f, BIN_TAG_BIND_INDEX, valveCtrlGetBindIndex(VALVE_DEFAULT));
+    binFramePutU32(f, BIN_TAG_UPTIME, appLogGetUptimeSec());
+    binFramePutU16(f, BIN_TAG_TX_HWM, uartLinkTxHighWater());
+    uint8_t drops[4 * UART_TX_CLASS_COUNT];
+    for (uint8_t c = 0; c < UART_TX_CLASS_COUNT; c++) {
+      uint32_t d = uartLinkTxDropped(s_txDropOrder[c]);
+      drops[c * 4u + 0u] = (uint8_t)d;
+      drops[c * 4u + 1u] = (uint8_t)(d >> 8);
+      drops[c * 4u + 2u] = (uint8_t)(d >> 16);
+      drops[c * 4u + 3u] = (uint8_t)(d >> 24);
+    }
+    binFramePutBytes(f, BIN_TAG_TX_DROP, drops, sizeof(drops));
+    uint32_t latv[3] = { lat->n, latStatsAvgUs(lat), lat->maxUs };
+    uint8_t latb[sizeof(latv)];
+    for (uint8_t i = 0; i < sizeof(latb); i++) latb[i] = (uint8_t)(latv[i / 4u] >> (8u * (i % 4u)));
+    binFramePutBytes(f, BIN_TAG_LAT, latb, sizeof(latb));
+    putSeqStats(f, seq);
+    uint8_t filt[2] = { flowFilterMedianN(), flowFilterEwmaShift() };
+    binFramePutBytes(f, BIN_TAG_FILTER, filt, sizeof(filt));
+    putU64(f, BIN_TAG_VOL_ML, totalizerSiteMl());
+    binFramePutU32(f, BIN_TAG_CKPT_WRITES, totalizerCkptWrites());
+    binFramePutU16(f, BIN_TAG_TOT_UNSAVED, totalizerUnsaved());
+    uint8_t leak[2] = { leakActiveCount(), leakValveLock() ? 1u : 0u };
+    binFramePutBytes(f, BIN_TAG_LEAK, leak, sizeof(leak));
+    binFramePutU32(f, BIN_TAG_LOCAL_S, localS);
+    uint16_t nStale = staleCount();
+    uint8_t stale[2] = { (nStale > 0xFFu) ? 0xFFu : (uint8_t)nStale, staleFailSafe() ? 1u : 0u };
+    binFramePutBytes(f, BIN_TAG_STALE, stale, sizeof(stale));
+    uint8_t valves[2] = { valveCtrlKnownCount(), valveCtrlTxInFlight() };
+    binFramePutBytes(f, BIN_TAG_VALVES, valves, sizeof(valves));
+    uint32_t vtxv[4] = { vtx->ok, vtx->fail, vtx->retries, vtx->timeouts };
+    uint8_t vtxb[sizeof(vtxv)];
+    for (uint8_t i = 0; i < sizeof(vtxb); i++) vtxb[i] = (uint8_t)(vtxv[i / 4u] >> (8u * (i % 4u)));
+    binFramePutBytes(f, BIN_TAG_VTX, vtxb, sizeof(vtxb));
+    putValvePath(f, VALVE_DEFAULT);
+    binFramePutU8(f, BIN_TAG_CONF, (uint8_t)valveCtrlConf(VALVE_DEFAULT));
+    uint32_t vconfv[4] = { vconf->reports, vconf->confirmed, vconf->unconfirmed, vconf->diverged };
+    uint8_t vconfb[sizeof(vconfv)];
+    for (uint8_t i = 0; i < sizeof(vconfb); i++) vconfb[i] = (uint8_t)(vconfv[i / 4u] >> (8u * (i % 4u)));
+    binFramePutBytes(f, BIN_TAG_VCONF, vconfb, sizeof(vconfb));
+    binFrameSend(f);
+    return;
+  }
+
+  emitLine(UART_TX_INFO,
     "@INFO {\"node_id\":\"0x%04X\",\"eui64\":\"%s\",\"pan_id\":\"0x%04X\",\"ch\":%u,"
     "\"tx_power\":%d,\"net_state\":%d,\"uart_gateway\":%s,\"mode\":\"%s\","
     "\"valve_path\":\"%s\",\"valve_known\":%s,\"valve_eui64\":\"%s\","
-    "\"valve_node_id\":\"0x%04X\",\"bind_index\":%u,\"uptime\":%lu}",
+    "\"valve_node_id\":\"0x%04X\",\"bind_index\":%u,\"uptime\":%lu,"
+    "\"tx_hwm\":%u,\"tx_drop\":[%lu,%lu,%lu,%lu,%lu],\"lat\":[%lu,%lu,%lu],"
+    "\"seq\":[%lu,%lu,%lu,%lu],\"filter\":[%u,%u],"
+    "\"vol_ml\":%s,\"ckpt_writes\":%lu,\"tot_unsaved\":%u,\"leak\":[%u,%u],\"local_s\":%lu,"
+    "\"stale\":[%u,%u],\"valves\":[%u,%u],\"vtx\":[%lu,%lu,%lu,%lu],"
+    "\"vpath\":[%u,%u,%u,%u,%u,%u],\"conf\":\"%s\",\"vconf\":[%lu,%lu,%lu,%lu]}",
     nodeId, euiStr, panId, ch, (int)pwr, st,
     g_uartGatewayEnabled ? "true" : "false",
     modeStr(),
-    valveCtrlPathStr(),
-    valveCtrlIsKnown() ? "true" : "false",
+    valveCtrlPathStr(VALVE_DEFAULT),
+    valveCtrlIsKnown(VALVE_DEFAULT) ? "true" : "false",
     valveEuiStr,
-    (uint16_t)valveCtrlGetNodeId(),
-    (unsigned)valveCtrlGetBindIndex(),
-    (unsigned long)appLogGetUptimeSec()
+    (uint16_t)valveCtrlGetNodeId(VALVE_DEFAULT),
+    (unsigned)valveCtrlGetBindIndex(VALVE_DEFAULT),
+    (unsigned long)appLogGetUptimeSec(),
+    (unsigned)uartLinkTxHighWater(),
+    (unsigned long)uartLinkTxDropped(UART_TX_ACK),
+    (unsigned long)uartLinkTxDropped(UART_TX_DATA),
+    (unsigned long)uartLinkTxDropped(UART_TX_INFO),
+    (unsigned long)uartLinkTxDropped(UART_TX_LOG),
+    (unsigned long)uartLinkTxDropped(UART_TX_ALRM),
+    (unsigned long)lat->n,
+    (unsigned long)latStatsAvgUs(lat),
+    (unsigned long)lat->maxUs,
+    (unsigned long)seq->rx,
+    (unsigned long)seq->lost,
+    (unsigned long)seq->dup,
+    (unsigned long)seq->reord,
+    (unsigned)flowFilterMedianN(),
+    (unsigned)flowFilterEwmaShift(),
+    u64Str(volStr, sizeof(volStr), totalizerSiteMl()),
+    (unsigned long)totalizerCkptWrites(),
+    (unsigned)totalizerUnsaved(),
+    (unsigned)leakActiveCount(),
+    leakValveLock() ? 1u : 0u,
+    (unsigned long)localS,
+    (unsigned)staleCount(),
+    staleFailSafe() ? 1u : 0u,
+    (unsigned)valveCtrlKnownCount(),
+    (unsigned)valveCtrlTxInFlight(),
+    (unsigned long)vtx->ok,
+    (unsigned long)vtx->fail,
+    (unsigned long)vtx->retries,
+    (unsigned long)vtx->timeouts,
+    ps[0], ps[1], ps[2], ps[3], ps[4], ps[5],
+    valveCtrlConfStr(VALVE_DEFAULT),
+    (unsigned long)vconf->reports,
+    (unsigned long)vconf->confirmed,
+    (unsigned long)vconf->unconfirmed,
+    (unsigned long)vconf->diverged
   );
 }
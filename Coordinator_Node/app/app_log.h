@@ -10,13 +10,34 @@ extern "C" {
 
 // ===== STABLE UART LINE PROTOCOL =====
 // All output follows: "@PREFIX <compact JSON>\r\n"
-// Prefixes: @INFO, @DATA, @LOG, @ACK
+// Prefixes: @INFO, @DATA, @LOG, @ACK, @STAT, @HIST, @ALRM
 
 // === INFO: System/network status (periodic heartbeat + on-demand) ===
 void appLogInfo(void);
 
 // === DATA: Telemetry (periodic + on-change) ===
+// Always carries "ver" (+1 per frame). In delta mode only changed fields
+// are sent ("delta":true) and nothing is sent if nothing changed; a full
+// snapshot goes out every fullEvery frames or after appLogDataRequestFull().
 void appLogData(void);
+bool appLogDataChanged(void);          // state differs from the last @DATA
+void appLogDataRequestFull(void);      // next appLogData() is a snapshot
+void appLogDataConfig(bool delta, uint8_t fullEvery);
+bool appLogDataDeltaEnabled(void);
+uint8_t appLogDataFullEvery(void);
+
+// Per-sensor frame: @DATA {"sensor":"0x1234","eui64":..,"flow":..,"battery":..,
+// "lqi":..,"seq":[rx,lost,dup,reord],"age_s":..,"primary":..}
+// Longest frame: the text body plus "@DATA {" .. "}\r\n" (binary is smaller).
+#define APP_LOG_SENSOR_BODY_MAX   320u
+#define APP_LOG_SENSOR_FRAME_MAX  (APP_LOG_SENSOR_BODY_MAX + 10u)
+struct Sensor_s;
+void appLogSensorData(const struct Sensor_s *s);
+
+// Per-valve frame (valve table, valve_ctrl.h): @DATA {"valve_idx":3,"valve":"open",
+// "valve_known":..,"valve_node_id":..,"valve_path":..,"tx_pending":..}.
+// Sent on each tx_done of valves other than VALVE_DEFAULT and on valve_get.
+void appLogValveData(uint8_t v);
 
 // === LOG: Events and debug (structured logging) ===
 // tag: short category (NET, ZB, CMD, SYS)
@@ -30,9 +51,42 @@ void appLogLog(const char *tag, const char *event, const char *fmt, ...);
 // msg: short status message
 void appLogAck(uint32_t id, bool ok, const char *msg);
 
+// Non-final ACK ("ok":false, msg "in_flight"): the command is still
+// running and its final ACK follows. Not cached for replay, not a latency
+// point, never taken by a batch.
+void appLogAckInterim(uint32_t id, const char *msg);
+
 // Extended ACK with Zigbee status
 void appLogAckZb(uint32_t id, bool ok, const char *msg, uint8_t zstatus, const char *stage);
 
+// One ACK for a @CMD batch: msg = summary ("batch 3/4"),
+// results = per-op objects joined by ',' (emitted as "results":[...]),
+// truncated = results left out for lack of room ("truncated":true)
+void appLogAckBatch(uint32_t id, bool ok, const char *msg, const char *results, bool truncated);
+
+// === STAT: Command latency histograms (one @STAT line per stage) ===
+void appLogStats(uint32_t id);
+
+// === HIST: One page of flow history (history.h) ===
+// @HIST {"id":..,"sensor":"0x1234","kind":"raw"|"min","uptime":..,"offset":N,
+//        "s":[[t,v],..] | "b":[[t,min,max,avg,n],..]}   (t = uptime seconds)
+// Empty minutes are skipped. Returns the position to continue from
+// (== historyCount() when done); *sent = entries in the page. A page the
+// TX ring did not accept returns offset with *sent = 0 (retry later).
+uint16_t appLogHistory(uint32_t id, const struct Sensor_s *s, uint8_t kind,
+                       uint16_t offset, uint8_t *sent);
+
+// === ALRM: Sensor alarm raised / cleared (leak.h, stale.h) ===
+// @ALRM {"sensor":"0x1234","kind":"deviation"|"min_flow"|"stale","state":"raised"|"cleared",
+//        "flow":..,"limit"|"min"|"timeout_s":..,"for_s":..,"uptime":..}
+// value: "limit" = deviation limit of the hour, "min" = lowest flow in the
+// window, "timeout_s" = stale deadline. "for_s" = how long the condition
+// has held (stale: seconds since the last report). Queued on its own
+// UART_TX_ALRM ring; false if it had no room (the caller keeps it pending).
+typedef enum { ALRM_DEVIATION = 0, ALRM_MIN_FLOW, ALRM_STALE, ALRM_KIND_COUNT } alrm_kind_t;
+bool appLogAlarm(const struct Sensor_s *s, alrm_kind_t kind, bool raised,
+                 uint32_t value, uint32_t forS);
+
 // === HEARTBEAT: Periodic @INFO emission ===
 #define HEARTBEAT_INTERVAL_MS  30000u   // 30 seconds
 void appLogHeartbeatTick(void);         // Call from main tick
@@ -41,6 +95,12 @@ void appLogEmitHeartbeat(void);         // Force emit @INFO now
 // === UPTIME tracking ===
 uint32_t appLogGetUptimeSec(void);
 
+// === LOCAL TIME (time_set op) ===
+// Seconds since the epoch in local time (UTC + zone offset), kept as an
+// offset to the uptime; unknown after a reset until the gateway sets it.
+void appLogSetLocalTime(uint32_t localS);
+bool appLogLocalTime(uint32_t *localS);
+
 // === LEGACY (deprecated, use appLogInfo) ===
 void printInfoToPC(void);
 
@@ -5,6 +5,7 @@
 AppState g_state;
 
 uint16_t   g_flow = 0;
+uint16_t   g_flowFiltered = 0;
 uint8_t    g_batteryPercent = 0;
 
 app_mode_t g_mode = MODE_MANUAL;
@@ -27,6 +27,7 @@ void appStateSetJoined(bool joined);
 void appStateNotifyChanged(void);
 // telemetry
 extern uint16_t   g_flow;
+extern uint16_t   g_flowFiltered;   // g_flow through flow_filter, drives AUTO control
 extern uint8_t    g_batteryPercent;
 
 // mode
@@ -3,7 +3,6 @@
 
 #include <string.h>
 #include <ctype.h>
-#include <stdlib.h>
 
 uint32_t msTick(void) { return halCommonGetInt32uMillisecondTick(); }
 
@@ -64,76 +63,3 @@ void eui64ToStringBigEndian(char *outStr, uint32_t outSize, const EmberEUI64 eui
   }
   outStr[16] = 0;
 }
-
-bool parseUintField(const char *json, const char *key, uint32_t *out)
-{
-  if (!json || !key || !out) return false;
-
-  const char *p = strstr(json, key);
-  if (!p) return false;
-
-  p = strchr(p, ':');
-  if (!p) return false;
-  p++;
-  p = skipSpaces(p);
-
-  uint32_t v = 0;
-  bool any = false;
-  while (*p && isdigit((unsigned char)*p)) {
-    any = true;
-    v = (v * 10u) + (uint32_t)(*p - '0');
-    p++;
-  }
-  if (!any) return false;
-
-  *out = v;
-  return true;
-}
-
-bool parseStringField(const char *json, const char *key, char *out, uint32_t outSize)
-{
-  if (!json || !key || !out || outSize == 0) return false;
-
-  const char *p = strstr(json, key);
-  if (!p) return false;
-
-  p = strchr(p, ':');
-  if (!p) return false;
-  p++;
-  p = skipSpaces(p);
-
-  if (*p == '\"') {
-    p++;
-    uint32_t i = 0;
-    while (*p && *p != '\"' && i + 1 < outSize) out[i++] = *p++;
-    out[i] = 0;
-    return (*p == '\"');
-  } else {
-    uint32_t i = 0;
-    while (*p && *p != ',' && *p != '}' && !isspace((unsigned char)*p) && i + 1 < outSize) {
-      out[i++] = *p++;
-    }
-    out[i] = 0;
-    return (i > 0);
-  }
-}
-
-// supports "0xbeef" OR "48879"
-bool parseU32FieldAutoBase(const char *json, const char *key, uint32_t *out)
-{
-  char tmp[24] = {0};
-  if (!parseStringField(json, key, tmp, sizeof(tmp))) return false;
-
-  char *endp = NULL;
-  unsigned long v = strtoul(tmp, &endp, 0);
-  if (endp == tmp) return false;
-
-  *out = (uint32_t)v;
-  return true;
-}
-
-bool parseU32FieldAny(const char *json, const char *key, uint32_t *out)
-{
-  if (parseU32FieldAutoBase(json, key, out)) return true;
-  return parseUintField(json, key, out);
-}
@@ -14,6 +14,26 @@
 #define ZCL_FLOW_MEASUREMENT_CLUSTER_ID 0x0404u
 #endif
 
+#ifndef ZCL_TEMP_MEASUREMENT_CLUSTER_ID
+#define ZCL_TEMP_MEASUREMENT_CLUSTER_ID 0x0402u
+#endif
+
+#ifndef ZCL_PRESSURE_MEASUREMENT_CLUSTER_ID
+#define ZCL_PRESSURE_MEASUREMENT_CLUSTER_ID 0x0403u
+#endif
+
+#ifndef ZCL_LEVEL_CONTROL_CLUSTER_ID
+#define ZCL_LEVEL_CONTROL_CLUSTER_ID 0x0008u
+#endif
+
+#ifndef ZCL_ON_OFF_ATTRIBUTE_ID
+#define ZCL_ON_OFF_ATTRIBUTE_ID 0x0000u
+#endif
+
+#ifndef ZCL_INT16S_ATTRIBUTE_TYPE
+#define ZCL_INT16S_ATTRIBUTE_TYPE 0x29u
+#endif
+
 #ifndef ZCL_REPORT_ATTRIBUTES_COMMAND_ID
 #define ZCL_REPORT_ATTRIBUTES_COMMAND_ID 0x0Au
 #endif
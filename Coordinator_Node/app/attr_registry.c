@@ -0,0 +1,100 @@
+#include "attr_registry.h"
+#include "app_state.h"
+#include "bin_proto.h"
+#include "lcd_ui.h"
+#include "app/framework/include/af.h"
+#include "app_zcl_fallback.h"
+
+#include <stddef.h>
+
+#define ATTR_SLOTS  16u   // power of 2, > MEAS_COUNT
+
+#define ATTR_DEF_ENTRY(id, key, cl, at, ty, dec, tag, width, prim) \
+  [MEAS_##id] = { key, cl, at, ty, tag, width, dec, prim },
+static const AttrDef_t s_attrDefs[MEAS_COUNT] = {
+  ATTR_REGISTRY(ATTR_DEF_ENTRY)
+};
+#undef ATTR_DEF_ENTRY
+
+_Static_assert(MEAS_COUNT < ATTR_SLOTS, "ATTR_SLOTS must exceed the registry size");
+
+static uint8_t s_attrSlot[ATTR_SLOTS];   // meas id + 1, 0 = empty
+static bool    s_attrIndexReady = false;
+
+static uint8_t attrHash(uint16_t cluster, uint16_t attrId)
+{
+  uint32_t k = ((uint32_t)cluster << 16) | attrId;
+  return (uint8_t)((k * 2654435761u) >> 28) & (ATTR_SLOTS - 1u);
+}
+
+static void buildAttrIndex(void)
+{
+  for (uint8_t i = 0; i < MEAS_COUNT; i++) {
+    uint8_t h = attrHash(s_attrDefs[i].cluster, s_attrDefs[i].attrId);
+    while (s_attrSlot[h] != 0) h = (uint8_t)((h + 1u) & (ATTR_SLOTS - 1u));
+    s_attrSlot[h] = (uint8_t)(i + 1u);
+  }
+  s_attrIndexReady = true;
+}
+
+int attrRegistryFind(uint16_t cluster, uint16_t attrId)
+{
+  if (!s_attrIndexReady) buildAttrIndex();
+
+  uint8_t h = attrHash(cluster, attrId);
+  for (uint8_t probes = 0; probes < ATTR_SLOTS; probes++) {
+    uint8_t s = s_attrSlot[h];
+    if (s == 0) return -1;
+    const AttrDef_t *d = &s_attrDefs[s - 1u];
+    if (d->cluster == cluster && d->attrId == attrId) return (int)(s - 1u);
+    h = (uint8_t)((h + 1u) & (ATTR_SLOTS - 1u));
+  }
+  return -1;
+}
+
+const AttrDef_t *attrRegistryGet(uint8_t measId)
+{
+  return (measId < MEAS_COUNT) ? &s_attrDefs[measId] : NULL;
+}
+
+// ===== DECODERS =====
+
+bool attrDecodeUint(const ZclAttr_t *attr, int32_t *out)
+{
+  uint32_t v;
+  if (!zclAttrU32(attr, &v)) return false;
+  *out = (int32_t)v;
+  return true;
+}
+
+bool attrDecodeInt(const ZclAttr_t *attr, int32_t *out)
+{
+  return zclAttrS32(attr, out);
+}
+
+// BatteryPercentageRemaining is in half-percent units
+bool attrDecodeHalfPct(const ZclAttr_t *attr, int32_t *out)
+{
+  uint32_t half;
+  if (!zclAttrU32(attr, &half)) return false;
+  *out = (int32_t)(half / 2u);
+  return true;
+}
+
+// ===== PRIMARY HOOKS =====
+
+void attrPrimaryFlow(int32_t v)
+{
+  if (g_flow != (uint16_t)v) {
+    g_flow = (uint16_t)v;
+    lcd_ui_set_flow(g_flow);
+  }
+}
+
+void attrPrimaryBattery(int32_t v)
+{
+  if (g_batteryPercent != (uint8_t)v) {
+    g_batteryPercent = (uint8_t)v;
+    lcd_ui_set_battery(g_batteryPercent);
+  }
+}
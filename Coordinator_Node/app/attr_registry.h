@@ -0,0 +1,68 @@
+#ifndef ATTR_REGISTRY_H
+#define ATTR_REGISTRY_H
+
+#include "zcl_report.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ===== REPORTED ATTRIBUTE REGISTRY =====
+// One line per measurement a sensor can report. Adding a line is all it
+// takes to support a new cluster: telemetry_rx stores the decoded value in
+// the sensor table, per-sensor @DATA prints it under "key", and, for the
+// primary sensor, the optional onPrimary hook mirrors it (app state, LCD).
+//
+//   X(ID, "key", cluster, attrId, zclType, decode, binTag, binWidth, onPrimary)
+//
+// decode   : bool fn(const ZclAttr_t *, int32_t *out) - converts to app units
+// binTag   : TLV tag in binary @DATA (bin_proto.h), binWidth 1/2/4 bytes LE
+// onPrimary: void fn(int32_t v) or NULL
+// (IDs expand where the table is instantiated: af.h + app_zcl_fallback.h)
+
+#define ATTR_REGISTRY(X) \
+  X(FLOW,     "flow",     ZCL_FLOW_MEASUREMENT_CLUSTER_ID,     0x0000u, ZCL_INT16U_ATTRIBUTE_TYPE, \
+    attrDecodeUint,    BIN_TAG_FLOW,     2u, attrPrimaryFlow) \
+  X(BATTERY,  "battery",  ZCL_POWER_CONFIGURATION_CLUSTER_ID,  ZCL_BATTERY_PERCENTAGE_REMAINING_ATTRIBUTE_ID, \
+    ZCL_INT8U_ATTRIBUTE_TYPE, attrDecodeHalfPct, BIN_TAG_BATTERY, 1u, attrPrimaryBattery) \
+  X(TEMP,     "temp",     ZCL_TEMP_MEASUREMENT_CLUSTER_ID,     0x0000u, ZCL_INT16S_ATTRIBUTE_TYPE, \
+    attrDecodeInt,     BIN_TAG_TEMP,     2u, NULL) \
+  X(PRESSURE, "pressure", ZCL_PRESSURE_MEASUREMENT_CLUSTER_ID, 0x0000u, ZCL_INT16S_ATTRIBUTE_TYPE, \
+    attrDecodeInt,     BIN_TAG_PRESSURE, 2u, NULL) \
+  X(LEVEL,    "level",    ZCL_LEVEL_CONTROL_CLUSTER_ID,        0x0000u, ZCL_INT8U_ATTRIBUTE_TYPE, \
+    attrDecodeUint,    BIN_TAG_LEVEL,    1u, NULL)
+
+#define ATTR_ENUM_ENTRY(id, ...)  MEAS_##id,
+typedef enum {
+  ATTR_REGISTRY(ATTR_ENUM_ENTRY)
+  MEAS_COUNT
+} meas_id_t;
+#undef ATTR_ENUM_ENTRY
+
+typedef bool (*AttrDecodeFn)(const ZclAttr_t *attr, int32_t *out);
+typedef void (*AttrPrimaryFn)(int32_t v);
+
+typedef struct {
+  const char   *key;
+  uint16_t      cluster;
+  uint16_t      attrId;
+  uint8_t       type;
+  uint8_t       binTag;
+  uint8_t       binWidth;
+  AttrDecodeFn  decode;
+  AttrPrimaryFn onPrimary;
+} AttrDef_t;
+
+// O(1): hashed on (cluster, attrId). Returns the measurement id or -1.
+int attrRegistryFind(uint16_t cluster, uint16_t attrId);
+const AttrDef_t *attrRegistryGet(uint8_t measId);
+
+// Decoders usable in ATTR_REGISTRY
+bool attrDecodeUint(const ZclAttr_t *attr, int32_t *out);
+bool attrDecodeInt(const ZclAttr_t *attr, int32_t *out);
+bool attrDecodeHalfPct(const ZclAttr_t *attr, int32_t *out);   // 0..200 -> 0..100 %
+
+// Primary-sensor hooks usable in ATTR_REGISTRY
+void attrPrimaryFlow(int32_t v);
+void attrPrimaryBattery(int32_t v);
+
+#endif
@@ -0,0 +1,208 @@
+#include "bin_proto.h"
+
+#include "uart_link.h"
+
+#include <string.h>
+
+static bool s_binary = false;
+static bool s_pendingBinary = false;
+static uint8_t s_txSeq = 0;
+
+bool binProtoEnabled(void) { return s_binary; }
+
+void binProtoRequestMode(bool binary) { s_pendingBinary = binary; }
+
+void binProtoApplyMode(void) { s_binary = s_pendingBinary; }
+
+void binProtoTextFallback(void) { s_binary = s_pendingBinary = false; }
+
+// ===== CODEC =====
+
+// CRC-16/CCITT-FALSE: poly 0x1021, init 0xFFFF
+uint16_t binCrc16(const uint8_t *p, uint16_t n)
+{
+  uint16_t crc = 0xFFFFu;
+  while (n--) {
+    crc ^= (uint16_t)(*p++) << 8;
+    for (uint8_t b = 0; b < 8; b++) {
+      crc = (crc & 0x8000u) ? (uint16_t)((crc << 1) ^ 0x1021u) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+uint16_t cobsEncode(const uint8_t *in, uint16_t n, uint8_t *out, uint16_t outMax)
+{
+  if (outMax == 0) return 0;
+
+  uint16_t codeIdx = 0;
+  uint16_t o = 1;
+  uint8_t code = 1;
+
+  for (uint16_t i = 0; i < n; i++) {
+    if (o >= outMax) return 0;
+    if (in[i] == 0) {
+      out[codeIdx] = code;
+      codeIdx = o++;
+      code = 1;
+    } else {
+      out[o++] = in[i];
+      if (++code == 0xFFu) {
+        if (o >= outMax) return 0;
+        out[codeIdx] = code;
+        codeIdx = o++;
+        code = 1;
+      }
+    }
+  }
+  out[codeIdx] = code;
+  return o;
+}
+
+// in and out may be the same buffer (output never runs ahead of input)
+uint16_t cobsDecode(const uint8_t *in, uint16_t n, uint8_t *out, uint16_t outMax)
+{
+  uint16_t i = 0;
+  uint16_t o = 0;
+
+  while (i < n) {
+    uint8_t code = in[i++];
+    if (code == 0) return 0;
+    for (uint8_t k = 1; k < code; k++) {
+      if (i >= n || o >= outMax) return 0;
+      out[o++] = in[i++];
+    }
+    if (code != 0xFFu && i < n) {
+      if (o >= outMax) return 0;
+      out[o++] = 0;
+    }
+  }
+  return o;
+}
+
+// ===== FRAME BUILDING =====
+
+static void putRaw(BinFrame_t *f, const void *p, uint16_t n)
+{
+  // keep 2 bytes for the CRC
+  if (f->overflow || (uint32_t)f->len + n + 2u > BIN_FRAME_MAX) {
+    f->overflow = true;
+    return;
+  }
+  memcpy(&f->buf[f->len], p, n);
+  f->len = (uint16_t)(f->len + n);
+}
+
+static void putTlv(BinFrame_t *f, uint8_t tag, const void *p, uint8_t n)
+{
+  uint8_t hdr[2] = { tag, n };
+  putRaw(f, hdr, 2);
+  putRaw(f, p, n);
+}
+
+void binFrameBegin(BinFrame_t *f, uint8_t type)
+{
+  f->len = 0;
+  f->overflow = false;
+  uint8_t hdr[2] = { type, s_txSeq++ };
+  putRaw(f, hdr, 2);
+}
+
+void binFramePutU8(BinFrame_t *f, uint8_t tag, uint8_t v) { putTlv(f, tag, &v, 1); }
+
+void binFramePutU16(BinFrame_t *f, uint8_t tag, uint16_t v)
+{
+  uint8_t b[2] = { (uint8_t)v, (uint8_t)(v >> 8) };
+  putTlv(f, tag, b, 2);
+}
+
+void binFramePutU32(BinFrame_t *f, uint8_t tag, uint32_t v)
+{
+  uint8_t b[4] = { (uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24) };
+  putTlv(f, tag, b, 4);
+}
+
+void binFramePutBytes(BinFrame_t *f, uint8_t tag, const void *p, uint8_t n) { putTlv(f, tag, p, n); }
+
+// Longer than 255 bytes: consecutive TLVs with the same tag
+void binFramePutStr(BinFrame_t *f, uint8_t tag, const char *s)
+{
+  size_t n = s ? strlen(s) : 0;
+  do {
+    uint8_t c = (n > 0xFFu) ? 0xFFu : (uint8_t)n;
+    putTlv(f, tag, s, c);
+    s += c;
+    n -= c;
+  } while (n > 0);
+}
+
+static uart_tx_class_t frameClass(uint8_t type)
+{
+  switch (type) {
+    case BIN_T_ACK:  return UART_TX_ACK;
+    case BIN_T_ALRM: return UART_TX_ALRM;
+    case BIN_T_DATA: return UART_TX_DATA;
+    case BIN_T_INFO: return UART_TX_INFO;
+    default:         return UART_TX_LOG;
+  }
+}
+
+bool binFrameSend(BinFrame_t *f)
+{
+  if (f->overflow) return false;
+
+  uint16_t crc = binCrc16(f->buf, f->len);
+  f->buf[f->len++] = (uint8_t)crc;
+  f->buf[f->len++] = (uint8_t)(crc >> 8);
+
+  // 0x00 | COBS | 0x00 (leading delimiter resyncs after any text output)
+  static uint8_t out[BIN_FRAME_MAX + (BIN_FRAME_MAX / 254u) + 3u];
+  out[0] = 0;
+  uint16_t n = cobsEncode(f->buf, f->len, &out[1], (uint16_t)(sizeof(out) - 2u));
+  if (n == 0) return false;
+  out[1 + n] = 0;
+
+  return uartLinkTxWrite(frameClass(f->buf[0]), out, (uint16_t)(n + 2u));
+}
+
+// ===== RECEIVE =====
+
+bool binProtoDecodeCmd(uint8_t *seg, uint16_t len, const char **json)
+{
+  uint16_t n = cobsDecode(seg, len, seg, len);
+  if (n < 4) return false;   // type + seq + crc16
+
+  uint16_t crc = (uint16_t)seg[n - 2] | ((uint16_t)seg[n - 1] << 8);
+  n = (uint16_t)(n - 2u);
+  if (binCrc16(seg, n) != crc) return false;
+  if (seg[0] != BIN_T_CMD) return false;
+
+  // the JSON may span consecutive CMD_JSON TLVs: join them in place
+  uint16_t i = 2;
+  uint16_t start = 0;
+  uint16_t w = 0;
+  bool found = false;
+  while (i + 2u <= n) {
+    uint8_t tag = seg[i];
+    uint8_t tlen = seg[i + 1];
+    i = (uint16_t)(i + 2u);
+    if ((uint16_t)(i + tlen) > n) return false;
+
+    if (tag == BIN_TAG_CMD_JSON) {
+      if (!found) {
+        start = w = i;
+        found = true;
+      }
+      memmove(&seg[w], &seg[i], tlen);
+      w = (uint16_t)(w + tlen);
+    } else if (found) {
+      break;
+    }
+    i = (uint16_t)(i + tlen);
+  }
+  if (!found) return false;
+
+  seg[w] = 0;   // overwrites a consumed TLV header or the CRC
+  *json = (const char *)&seg[start];
+  return true;
+}
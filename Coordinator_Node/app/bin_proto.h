@@ -0,0 +1,136 @@
+#ifndef BIN_PROTO_H
+#define BIN_PROTO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ===== BINARY FRAMED UART PROTOCOL (optional) =====
+// Negotiated with @CMD {"op":"proto_set","value":"binary"|"text"}.
+// Wire format: 0x00 COBS( type | seq | TLV... | crc16 ) 0x00
+//   type  : BIN_T_*            seq : 8-bit, per direction
+//   TLV   : tag(1) len(1) value(len), integers little-endian; a string
+//           longer than 255 bytes is split over consecutive TLVs with
+//           the same tag, which the receiver joins
+//   crc16 : CRC-16/CCITT-FALSE over type..last TLV, little-endian
+// Tag numbers are shared by all frame types and mirrored in
+// wfms/common/proto.py (BIN_TAGS) - keep both in sync.
+
+#define BIN_FRAME_MAX   600u   // raw (pre-COBS) frame bytes
+
+// Frame types
+#define BIN_T_DATA   0x01u
+#define BIN_T_INFO   0x02u
+#define BIN_T_ACK    0x03u
+#define BIN_T_LOG    0x04u
+#define BIN_T_STAT   0x05u
+#define BIN_T_HIST   0x06u
+#define BIN_T_ALRM   0x07u   // own TX class, drained after ACK
+#define BIN_T_CMD    0x10u   // gateway -> coordinator
+
+// TLV tags
+#define BIN_TAG_ID            0x01u  // u32
+#define BIN_TAG_OK            0x02u  // u8 bool
+#define BIN_TAG_MSG           0x03u  // str
+#define BIN_TAG_MODE          0x04u  // u8: 0 manual, 1 auto
+#define BIN_TAG_VALVE         0x05u  // u8: 0 closed, 1 open
+#define BIN_TAG_ZSTATUS       0x06u  // u8
+#define BIN_TAG_STAGE         0x07u  // str
+#define BIN_TAG_FLOW          0x08u  // u16
+#define BIN_TAG_BATTERY       0x09u  // u8
+#define BIN_TAG_TX_PENDING    0x0Au  // u8 bool
+#define BIN_TAG_VALVE_PATH    0x0Bu  // u8: valve_path_t
+#define BIN_TAG_VALVE_NODE_ID 0x0Cu  // u16
+#define BIN_TAG_VALVE_KNOWN   0x0Du  // u8 bool
+#define BIN_TAG_TAG           0x0Eu  // str
+#define BIN_TAG_EVENT         0x0Fu  // str
+#define BIN_TAG_EXTRA         0x10u  // str, JSON members without braces
+#define BIN_TAG_UPTIME        0x11u  // u32
+#define BIN_TAG_NODE_ID       0x12u  // u16
+#define BIN_TAG_EUI64         0x13u  // 8 bytes, little-endian
+#define BIN_TAG_PAN_ID        0x14u  // u16
+#define BIN_TAG_CH            0x15u  // u8
+#define BIN_TAG_TX_POWER      0x16u  // i8
+#define BIN_TAG_NET_STATE     0x17u  // u8
+#define BIN_TAG_UART_GATEWAY  0x18u  // u8 bool
+#define BIN_TAG_VALVE_EUI64   0x19u  // 8 bytes, little-endian
+#define BIN_TAG_BIND_INDEX    0x1Au  // u8
+#define BIN_TAG_RESULTS       0x1Bu  // str, JSON array members (batch ACK)
+#define BIN_TAG_TX_HWM        0x1Cu  // u16, UART TX ring high-water (bytes)
+#define BIN_TAG_TX_DROP       0x1Du  // u32[5] ack,data,info,log,alrm: TX frames dropped
+#define BIN_TAG_VER           0x1Eu  // u32, @DATA state version
+#define BIN_TAG_DELTA         0x1Fu  // u8 bool, @DATA carries changed fields only
+#define BIN_TAG_CMD_JSON      0x20u  // str, @CMD JSON object
+#define BIN_TAG_LAT           0x21u  // u32[3] n,avg_us,max_us: @CMD -> @ACK latency
+#define BIN_TAG_STAT_STAGE    0x22u  // str
+#define BIN_TAG_STAT_N        0x23u  // u32
+#define BIN_TAG_STAT_AVG_US   0x24u  // u32
+#define BIN_TAG_STAT_MAX_US   0x25u  // u32
+#define BIN_TAG_STAT_HIST     0x26u  // u16[LAT_BUCKETS] log2 bucket counts
+#define BIN_TAG_SENSOR        0x27u  // u16, sensor node ID (per-sensor @DATA)
+#define BIN_TAG_LQI           0x28u  // u8
+#define BIN_TAG_AGE_S         0x29u  // u32, seconds since last report
+#define BIN_TAG_PRIMARY       0x2Au  // u8 bool
+#define BIN_TAG_TEMP          0x2Bu  // i16, 0.01 degC (ZCL MeasuredValue)
+#define BIN_TAG_PRESSURE      0x2Cu  // i16, 0.1 kPa (ZCL MeasuredValue)
+#define BIN_TAG_LEVEL         0x2Du  // u8
+#define BIN_TAG_HIST_KIND     0x2Eu  // u8: 0 raw, 1 minute buckets
+#define BIN_TAG_HIST_OFFSET   0x2Fu  // u16, position of the first entry
+#define BIN_TAG_HIST_RAW      0x30u  // bytes: n x (t u32, v u16)
+#define BIN_TAG_HIST_MIN      0x31u  // bytes: n x (t u32, min u16, max u16, avg u16, n u8)
+#define BIN_TAG_SEQ           0x32u  // u32[4] rx,lost,dup,reord: ZCL report sequence stats
+#define BIN_TAG_FLOW_F        0x33u  // u16, filtered flow (AUTO control input)
+#define BIN_TAG_FILTER        0x34u  // u8[2] median_n, ewma_shift
+#define BIN_TAG_VOL_ML        0x35u  // u64, consumed volume (mL)
+#define BIN_TAG_CKPT_WRITES   0x36u  // u32, totalizer NVM3 writes since boot
+#define BIN_TAG_ALRM_KIND     0x37u  // u8: alrm_kind_t, 0 deviation, 1 min_flow, 2 stale
+#define BIN_TAG_ALRM_RAISED   0x38u  // u8 bool, 0 = cleared
+#define BIN_TAG_ALRM_LIMIT    0x39u  // u16, deviation limit of the hour
+#define BIN_TAG_ALRM_MIN      0x3Au  // u16, lowest flow in the min_flow window
+#define BIN_TAG_ALRM_FOR_S    0x3Bu  // u32, seconds the condition has held
+#define BIN_TAG_LEAK          0x3Cu  // u8[2] alarms active, valve lock
+#define BIN_TAG_LOCAL_S       0x3Du  // u32, local time (0 = not set)
+#define BIN_TAG_ALRM_TIMEOUT_S 0x3Eu  // u32, stale deadline (s)
+#define BIN_TAG_STALE         0x3Fu  // u8[2] sensors stale (max 255), fail-safe active
+#define BIN_TAG_VALVE_IDX     0x40u  // u8, valve table index (per-valve @DATA)
+#define BIN_TAG_VALVES        0x41u  // u8[2] valves paired, TX in flight
+#define BIN_TAG_VTX           0x42u  // u32[4] valve commands ok, failed, retries, timeouts
+#define BIN_TAG_VPATH         0x43u  // u16[6] direct, binding: lat_ms, ok_pct, n
+#define BIN_TAG_CONF          0x44u  // u8 valve_conf_t
+#define BIN_TAG_CONF_MS       0x45u  // u16 last confirmation latency, ms
+#define BIN_TAG_VCONF         0x46u  // u32[4] OnOff reports, confirmed, unconfirmed, diverged
+#define BIN_TAG_TOT_UNSAVED   0x47u  // u16, sensors whose volume is not checkpointed
+#define BIN_TAG_TRUNCATED     0x48u  // u8 bool, batch @ACK results left out
+
+typedef struct {
+  uint8_t  buf[BIN_FRAME_MAX];
+  uint16_t len;
+  bool     overflow;
+} BinFrame_t;
+
+// Mode
+bool binProtoEnabled(void);
+void binProtoRequestMode(bool binary);  // applied by binProtoApplyMode()
+void binProtoApplyMode(void);           // call after the proto_set ACK is out
+void binProtoTextFallback(void);        // text @CMD received: back to text now
+
+// Frame building
+void binFrameBegin(BinFrame_t *f, uint8_t type);
+void binFramePutU8(BinFrame_t *f, uint8_t tag, uint8_t v);
+void binFramePutU16(BinFrame_t *f, uint8_t tag, uint16_t v);
+void binFramePutU32(BinFrame_t *f, uint8_t tag, uint32_t v);
+void binFramePutBytes(BinFrame_t *f, uint8_t tag, const void *p, uint8_t n);
+void binFramePutStr(BinFrame_t *f, uint8_t tag, const char *s);
+// Append CRC, COBS-encode and queue on the UART TX ring.
+// Returns false if the frame was not queued (overflow or TX class full).
+bool binFrameSend(BinFrame_t *f);
+
+// Receive: decode one COBS segment (delimiters already stripped) in place.
+// On success *json points at the NUL-terminated @CMD JSON inside seg.
+bool binProtoDecodeCmd(uint8_t *seg, uint16_t len, const char **json);
+
+// Codec helpers
+uint16_t binCrc16(const uint8_t *p, uint16_t n);
+uint16_t cobsEncode(const uint8_t *in, uint16_t n, uint8_t *out, uint16_t outMax);
+uint16_t cobsDecode(const uint8_t *in, uint16_t n, uint8_t *out, uint16_t outMax);
+
+#endif
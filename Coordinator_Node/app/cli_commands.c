@@ -13,6 +13,7 @@
 #include "sl_cli_command.h"
 #include "sl_cli_handles.h"
 #include "cmd_handler.h"
+#include "app_config.h"
 #include "app/framework/include/af.h"
 
 #include <string.h>
@@ -31,7 +32,7 @@ void cli_cmd_json(sl_cli_command_arg_t *arguments)
   }
   
   // Build @CMD line and process
-  static char cmdBuf[256];
+  static char cmdBuf[UART_LINE_MAX];
   int n = snprintf(cmdBuf, sizeof(cmdBuf), "@CMD %s", json_arg);
   if (n < 0 || (size_t)n >= sizeof(cmdBuf)) {
     emberAfCorePrintln("json: command too long");
@@ -3,8 +3,13 @@
 #include "app_state.h"
 #include "app_utils.h"
 #include "app_log.h"
+#include "json_tok.h"
+#include "lat_stats.h"
+#include "sensor_table.h"
+#include "bin_proto.h"
 #include "net_mgr.h"
 #include "valve_ctrl.h"
+#include "uart_link.h"
 #include "sl_cli.h"
 
 #include <string.h>
@@ -12,212 +17,935 @@
 
 // ===== COMMAND DEBOUNCE =====
 // Prevent duplicate command processing (Dashboard may spam)
-#define CMD_DEBOUNCE_MS       500   // Min interval between same-type commands
-#define CMD_DEDUP_WINDOW_MS   2000  // Window to detect duplicate IDs
+#define CMD_DEBOUNCE_MS       500   // Min interval between same-type commands (mode_set)
+
+// ===== RECENT COMMAND IDS =====
+// Ring of the last CMD_RECENT_MAX command IDs with their final ACK.
+// A retried ID is never executed twice: if its ACK is known (for
+// CMD_DEDUP_WINDOW_MS) it is replayed; if it is still in flight
+// (valve_set waiting for tx_done) it gets the interim ACK "in_flight" and
+// its final ACK follows. This lets the gateway keep several commands in
+// flight at once.
+// A PENDING entry is never evicted and stays matchable, however old, until
+// its final ACK: only FREE and DONE slots are reused. With every slot
+// pending a new ID is refused with "busy" and not executed.
+#define CMD_RECENT_MAX        32u     // >= VALVE_TABLE_MAX valve_set in flight
+#define CMD_DEDUP_WINDOW_MS   10000u  // after the final ACK; > gateway ACK timeout x retries
+#define CMD_ACK_MSG_MAX       48u     // longest ACK text + NUL, replayed whole
+
+typedef enum { CMD_SLOT_FREE = 0, CMD_SLOT_PENDING, CMD_SLOT_DONE } cmd_slot_state_t;
+
+typedef struct {
+  uint32_t id;
+  uint32_t tick;      // PENDING: arrival, DONE: final ACK
+  uint8_t  state;     // cmd_slot_state_t
+  bool     ok;
+  bool     hasZb;
+  uint8_t  zstatus;
+  char     msg[CMD_ACK_MSG_MAX];
+  char     stage[8];
+} CmdRecent_t;
+
+static CmdRecent_t s_recent[CMD_RECENT_MAX];
+static bool s_replaying = false;
+
+static CmdRecent_t *findRecent(uint32_t id)
+{
+  uint32_t now = halCommonGetInt32uMillisecondTick();
+  for (uint8_t i = 0; i < CMD_RECENT_MAX; i++) {
+    CmdRecent_t *r = &s_recent[i];
+    if (r->state == CMD_SLOT_FREE || r->id != id) continue;
+    if (r->state == CMD_SLOT_PENDING || (now - r->tick) < CMD_DEDUP_WINDOW_MS) return r;
+  }
+  return NULL;
+}
 
-static uint32_t s_lastModeSetTick = 0;
-static uint32_t s_lastValveSetTick = 0;
-static uint32_t s_lastCmdId = 0xFFFFFFFF;
-static uint32_t s_lastCmdTick = 0;
+// Slot for a new ID: a free or expired DONE one first, else the oldest
+// DONE. NULL when every slot is PENDING.
+static CmdRecent_t *allocRecent(uint32_t now)
+{
+  CmdRecent_t *oldest = NULL;
+  for (uint8_t i = 0; i < CMD_RECENT_MAX; i++) {
+    CmdRecent_t *r = &s_recent[i];
+    if (r->state == CMD_SLOT_FREE) return r;
+    if (r->state != CMD_SLOT_DONE) continue;
+    if ((now - r->tick) >= CMD_DEDUP_WINDOW_MS) return r;
+    if (oldest == NULL || (now - r->tick) > (now - oldest->tick)) oldest = r;
+  }
+  return oldest;
+}
 
+// true = already seen (ACK replayed, or "in_flight" while it runs) or no
+// slot free to track it, do not execute
 static bool isDuplicateCmd(uint32_t id)
 {
+  if (id == 0) return false;   // no ID -> nothing to match retries against
+
+  CmdRecent_t *r = findRecent(id);
+  if (r) {
+    if (r->state == CMD_SLOT_DONE) {
+      appLogLog("CMD", "duplicate", "\"id\":%lu,\"replayed\":true", (unsigned long)id);
+      s_replaying = true;
+      if (r->hasZb) appLogAckZb(id, r->ok, r->msg, r->zstatus, r->stage);
+      else appLogAck(id, r->ok, r->msg);
+      s_replaying = false;
+    } else {
+      appLogLog("CMD", "duplicate", "\"id\":%lu,\"in_flight\":true", (unsigned long)id);
+      appLogAckInterim(id, "in_flight");
+    }
+    return true;
+  }
+
   uint32_t now = halCommonGetInt32uMillisecondTick();
-  
-  // Check if same ID within dedup window
-  if (id == s_lastCmdId && (now - s_lastCmdTick) < CMD_DEDUP_WINDOW_MS) {
-    appLogLog("CMD", "duplicate", "\"id\":%lu,\"ignored\":true", (unsigned long)id);
+  r = allocRecent(now);
+  if (!r) {
+    // every tracked ID still awaits its ACK; the gateway retries later
+    appLogLog("CMD", "busy", "\"id\":%lu", (unsigned long)id);
+    appLogAck(id, false, "busy");
     return true;
   }
-  
-  s_lastCmdId = id;
-  s_lastCmdTick = now;
+  memset(r, 0, sizeof(*r));
+  r->id = id;
+  r->tick = now;
+  r->state = CMD_SLOT_PENDING;
   return false;
 }
 
-void cmdHandleLine(const char *line)
+void cmdNoteAck(uint32_t id, bool ok, const char *msg, bool hasZb, uint8_t zstatus, const char *stage)
 {
-  if (!line) return;
+  if (id == 0 || s_replaying) return;
+
+  // the first final ACK wins; a late one for the same ID must not replace it
+  CmdRecent_t *r = findRecent(id);
+  if (!r || r->state == CMD_SLOT_DONE) return;
+
+  r->state = CMD_SLOT_DONE;
+  r->tick = halCommonGetInt32uMillisecondTick();   // the replay window runs from the final ACK
+  r->ok = ok;
+  r->hasZb = hasZb;
+  r->zstatus = zstatus;
+  strncpy(r->msg, msg ? msg : "", sizeof(r->msg) - 1u);
+  r->msg[sizeof(r->msg) - 1u] = 0;
+  strncpy(r->stage, stage ? stage : "", sizeof(r->stage) - 1u);
+  r->stage[sizeof(r->stage) - 1u] = 0;
+}
 
-  const char *p = line;
-  if (strncmp(p, "@CMD", 4) != 0) return;
-  p += 4;
-  p = skipSpaces(p);
+// ===== OP TABLE =====
+// Every @CMD op is declared once below: name, handler, debounce, follow-up
+// output and its fields (type, required, range). cmdHandleLine() looks the
+// op up through a perfect hash generated from this table, validates the
+// fields from the declaration and only then calls the handler, so a handler
+// only sees values that are present (or defaulted) and in range.
+
+#define CMD_MAX_ARGS   6u
+
+typedef enum {
+  ARG_UINT = 0,   // plain decimal number
+  ARG_U32_ANY,    // number or string, "0x1234" / "4660"
+  ARG_STR,        // string span (not copied)
+  ARG_ENUM,       // string, one of "a|b|c" -> index in u[]
+} cmd_arg_type_t;
+
+typedef struct {
+  const char *key;
+  uint8_t     type;       // cmd_arg_type_t
+  bool        required;
+  uint32_t    min;
+  uint32_t    max;
+  const char *choices;    // ARG_ENUM only
+  const char *errMsg;     // range / enum failure (NULL -> "bad <key>")
+} CmdArgDef_t;
+
+typedef struct {
+  bool               present[CMD_MAX_ARGS];
+  uint32_t           u[CMD_MAX_ARGS];
+  const JsonField_t *s[CMD_MAX_ARGS];
+} CmdArgs_t;
+
+// Return ok; *msg = ACK text, or NULL when the ACK is sent later (tx_done)
+typedef bool (*cmd_fn_t)(uint32_t id, const CmdArgs_t *a, const char **msg);
+
+// Follow-up output after a successful ACK
+#define CMD_POST_AUTO  0x01u   // re-run valveCtrlAutoControl()
+#define CMD_POST_DATA  0x02u   // emit @DATA
+#define CMD_POST_INFO  0x04u   // emit @INFO
+#define CMD_POST_PROTO 0x08u   // switch text/binary framing (after the ACK)
+#define CMD_OP_DEFERRED 0x80u  // final ACK comes later (tx_done): not in a batch
+
+typedef struct {
+  const char *name;
+  cmd_fn_t    fn;
+  uint16_t    debounceMs;
+  uint8_t     post;
+  uint8_t     nArgs;
+  CmdArgDef_t args[CMD_MAX_ARGS];
+} CmdOpDef_t;
+
+#define U16_MAX  0xFFFFu
+#define U32_MAX  0xFFFFFFFFu
+
+static uint32_t argU(const CmdArgs_t *a, uint8_t i, uint32_t def)
+{
+  return a->present[i] ? a->u[i] : def;
+}
 
-  uint32_t id = 0;
-  (void)parseUintField(p, "\"id\"", &id);
-  
-  // Duplicate detection
-  if (isDuplicateCmd(id)) {
-    return;  // Silently ignore duplicate
-  }
+// ===== OP HANDLERS =====
 
-  char op[28] = {0};
-  if (!parseStringField(p, "\"op\"", op, sizeof(op))) {
-    appLogAck(id, false, "missing op");
-    return;
+static bool opInfo(uint32_t id, const CmdArgs_t *a, const char **msg)
+{
+  (void)id; (void)a;
+  appLogInfo();
+  *msg = "info";
+  return true;
+}
+
+// args: value(auto|manual)
+static bool opModeSet(uint32_t id, const CmdArgs_t *a, const char **msg)
+{
+  (void)id;
+  g_mode = (a->u[0] == 0) ? MODE_AUTO : MODE_MANUAL;
+  *msg = "mode set";
+  return true;
+}
+
+// args: close_th, open_th
+static bool opThresholdSet(uint32_t id, const CmdArgs_t *a, const char **msg)
+{
+  (void)id;
+  uint32_t closeTh = a->u[0];
+  uint32_t openTh = argU(a, 1, 0);
+
+  if (openTh >= closeTh) { *msg = "open_th must be < close_th"; return false; }
+
+  valveCtrlSetThresholds((uint16_t)closeTh, (uint16_t)openTh);
+  *msg = "threshold updated";
+  return true;
+}
+
+// args: value(auto|direct|binding)
+static bool opValvePathSet(uint32_t id, const CmdArgs_t *a, const char **msg)
+{
+  (void)id;
+  static const valve_path_t paths[] = { VALVE_PATH_AUTO, VALVE_PATH_DIRECT, VALVE_PATH_BINDING };
+  valveCtrlSetPath((uint8_t)argU(a, 1, VALVE_DEFAULT), paths[a->u[0]]);
+  *msg = "valve_path_set";
+  return true;
+}
+
+// args: node_id, dst_ep, valve
+static bool opValveTargetSet(uint32_t id, const CmdArgs_t *a, const char **msg)
+{
+  (void)id;
+  valveCtrlSetTarget((uint8_t)argU(a, 2, VALVE_DEFAULT),
+                     (EmberNodeId)a->u[0], (uint8_t)argU(a, 1, VALVE_EP_DEFAULT));
+  *msg = "valve_target_set";
+  return true;
+}
+
+// args: eui64, node_id, bind_index, dst_ep, valve
+static bool opValvePair(uint32_t id, const CmdArgs_t *a, const char **msg)
+{
+  (void)id;
+  char euiStr[40];
+  uint16_t n = a->s[0]->valLen;
+  if (n >= sizeof(euiStr)) n = sizeof(euiStr) - 1u;
+  memcpy(euiStr, a->s[0]->val, n);
+  euiStr[n] = 0;
+
+  bool ok = valveCtrlPair((uint8_t)argU(a, 4, VALVE_DEFAULT), euiStr, (EmberNodeId)a->u[1],
+                          (uint8_t)argU(a, 2, 0), (uint8_t)argU(a, 3, VALVE_EP_DEFAULT));
+  *msg = ok ? "valve_pair set" : "bad eui64";
+  return ok;
+}
+
+// args: value(open|closed|close), valve
+static bool opValveSet(uint32_t id, const CmdArgs_t *a, const char **msg)
+{
+  if (g_mode == MODE_AUTO) {
+    *msg = "rejected: AUTO mode";
+    return false;
   }
 
-  uint32_t now = halCommonGetInt32uMillisecondTick();
+  // Final @ACK comes from valve_ctrl (tx_done or immediate failure)
+  (void)valveCtrlQueueTx((uint8_t)argU(a, 1, VALVE_DEFAULT), id, (a->u[0] == 0));
+  *msg = NULL;
+  return true;
+}
 
-  if (strcmp(op, "info") == 0) {
-    appLogInfo();
-    appLogAck(id, true, "info");
-    return;
+// args: pan_id, ch, tx_power
+static bool opNetCfgSet(uint32_t id, const CmdArgs_t *a, const char **msg)
+{
+  (void)id;
+  g_netCfg.panId = (uint16_t)argU(a, 0, g_netCfg.panId);
+  g_netCfg.ch = (uint8_t)argU(a, 1, g_netCfg.ch);
+  g_netCfg.txPowerDbm = (int8_t)argU(a, 2, (uint32_t)g_netCfg.txPowerDbm);
+
+  *msg = "net cfg updated";
+  return true;
+}
+
+// args: pan_id, ch, tx_power, force
+static bool opNetForm(uint32_t id, const CmdArgs_t *a, const char **msg)
+{
+  (void)id;
+  NetCfg_t cfg = {
+    (uint16_t)argU(a, 0, g_netCfg.panId),
+    (uint8_t)argU(a, 1, g_netCfg.ch),
+    (int8_t)argU(a, 2, (uint32_t)g_netCfg.txPowerDbm),
+  };
+  bool ok = netMgrRequestForm(cfg, "uart", (argU(a, 3, 0) != 0));
+  *msg = ok ? "net_form accepted" : "net_form rejected";
+  return ok;
+}
+
+// args: enable
+static bool opUartGatewaySet(uint32_t id, const CmdArgs_t *a, const char **msg)
+{
+  (void)id;
+  g_uartGatewayEnabled = (argU(a, 0, 1) != 0);
+  *msg = "uart_gateway_set";
+  return true;
+}
+
+// args: value(text|binary)
+static bool opProtoSet(uint32_t id, const CmdArgs_t *a, const char **msg)
+{
+  (void)id;
+  binProtoRequestMode(a->u[0] == 1);
+  *msg = "proto_set";
+  return true;
+}
+
+// args: delta(0|1), full_every
+static bool opDataCfgSet(uint32_t id, const CmdArgs_t *a, const char **msg)
+{
+  (void)id;
+  appLogDataConfig(argU(a, 0, appLogDataDeltaEnabled() ? 1u : 0u) != 0,
+                   (uint8_t)argU(a, 1, appLogDataFullEvery()));
+  *msg = "data_cfg_set";
+  return true;
+}
+
+// args: median (odd, 1 = off), ewma_shift (0 = off). Restarts every
+// sensor's filter so old samples do not leak into the new setting.
+static bool opFilterSet(uint32_t id, const CmdArgs_t *a, const char **msg)
+{
+  (void)id;
+  if (!flowFilterConfig((uint8_t)argU(a, 0, flowFilterMedianN()),
+                        (uint8_t)argU(a, 1, flowFilterEwmaShift()))) {
+    *msg = "median must be odd";
+    return false;
   }
+  // Restart every filter from the last raw reading, so flow_f and the AUTO
+  // input never keep a value the old setting produced
+  for (uint16_t i = 0; i < sensorTableCount(); i++) {
+    Sensor_t *s = sensorTableAt(i);
+    flowFilterReset(&s->filt);
+    s->flowF = (uint16_t)s->meas[MEAS_FLOW];
+  }
+  Sensor_t *p = sensorTablePrimary();
+  g_flowFiltered = p ? p->flowF : g_flow;
+  *msg = "filter_set";
+  return true;
+}
 
-  if (strcmp(op, "mode_set") == 0) {
-    // Debounce: ignore if too fast
-    if ((now - s_lastModeSetTick) < CMD_DEBOUNCE_MS) {
-      appLogAck(id, false, "debounced");
-      return;
-    }
-    s_lastModeSetTick = now;
-    
-    char value[16] = {0};
-    if (!parseStringField(p, "\"value\"", value, sizeof(value))) {
-      appLogAck(id, false, "missing value");
-      return;
-    }
-    if (strcmp(value, "auto") == 0) g_mode = MODE_AUTO;
-    else if (strcmp(value, "manual") == 0) g_mode = MODE_MANUAL;
-    else { appLogAck(id, false, "value must be auto/manual"); return; }
+static bool opTotalCfgSet(uint32_t id, const CmdArgs_t *a, const char **msg)
+{
+  (void)id;
+  totalizerConfig(argU(a, 0, totalizerIntervalS()), (uint16_t)argU(a, 1, totalizerDeltaL()));
+  *msg = "total_cfg_set";
+  return true;
+}
 
-    appLogAck(id, true, "mode set");
-    valveCtrlAutoControl();
-    appLogData();
-    return;
+// args: value (local time: seconds since the epoch + zone offset)
+static bool opTimeSet(uint32_t id, const CmdArgs_t *a, const char **msg)
+{
+  (void)id;
+  appLogSetLocalTime(a->u[0]);
+  *msg = "time_set";
+  return true;
+}
+
+// args: dev_window_s, min_window_s, close(0|1)
+static bool opLeakCfgSet(uint32_t id, const CmdArgs_t *a, const char **msg)
+{
+  (void)id;
+  leakConfig(argU(a, 0, leakDevWindowS()), argU(a, 1, leakMinWindowS()),
+             argU(a, 2, leakCloseValve() ? 1u : 0u) != 0);
+  *msg = "leak_cfg_set";
+  return true;
+}
+
+static bool opLeakClear(uint32_t id, const CmdArgs_t *a, const char **msg)
+{
+  (void)id; (void)a;
+  leakClear();
+  *msg = "leak_clear";
+  return true;
+}
+
+// args: timeout_s, action(none|close|open)
+static bool opStaleCfgSet(uint32_t id, const CmdArgs_t *a, const char **msg)
+{
+  (void)id;
+  staleConfig(argU(a, 0, staleTimeoutS()), (stale_action_t)argU(a, 1, staleAction()));
+  *msg = "stale_cfg_set";
+  return true;
+}
+
+// args: valve
+static bool opValveGet(uint32_t id, const CmdArgs_t *a, const char **msg)
+{
+  (void)id;
+  appLogValveData((uint8_t)a->u[0]);
+  *msg = "valve";
+  return true;
+}
+
+static bool opDataGet(uint32_t id, const CmdArgs_t *a, const char **msg)
+{
+  (void)id; (void)a;
+  appLogDataRequestFull();
+  *msg = "data";
+  return true;
+}
+
+// args: reset(0|1)
+static bool opStats(uint32_t id, const CmdArgs_t *a, const char **msg)
+{
+  appLogStats(id);
+  if (argU(a, 0, 0) != 0) latStatsReset();
+  *msg = "stats";
+  return true;
+}
+
+// args: node_id | offset. One sensor, or a page of up to SENSOR_GET_PAGE
+// sensors; the page ends early when the DATA ring has no room for another
+// worst-case frame (the ring must hold two, checked below).
+#define SENSOR_GET_PAGE  4u
+_Static_assert(2u * (APP_LOG_SENSOR_FRAME_MAX + 6u) <= UART_TX_RING_DATA,
+               "DATA ring too small for a sensor_get page");
+
+static bool opSensorGet(uint32_t id, const CmdArgs_t *a, const char **msg)
+{
+  (void)id;
+  static char s_sensorMsg[32];
+
+  if (a->present[0]) {
+    Sensor_t *s = sensorTableFind((EmberNodeId)a->u[0]);
+    if (!s) { *msg = "unknown sensor"; return false; }
+    if (uartLinkTxFree(UART_TX_DATA) < APP_LOG_SENSOR_FRAME_MAX) { *msg = "tx busy"; return false; }
+    appLogSensorData(s);
+    *msg = "sensor";
+    return true;
   }
 
-  if (strcmp(op, "threshold_set") == 0) {
-    uint32_t closeTh = 0, openTh = 0;
-    if (!parseUintField(p, "\"close_th\"", &closeTh)) { appLogAck(id, false, "missing close_th"); return; }
-    (void)parseUintField(p, "\"open_th\"", &openTh);
+  uint16_t count = sensorTableCount();
+  uint32_t first = argU(a, 1, 0);
+  uint32_t i = first;
+  uint8_t sent = 0;
+  for (; i < count && sent < SENSOR_GET_PAGE; i++) {
+    Sensor_t *s = sensorTableAt((uint16_t)i);
+    if (s->nodeId == EMBER_NULL_NODE_ID) continue;
+    // DATA evicts its oldest frame when full: stop the page instead, so
+    // no frame of it (or queued telemetry) is dropped; "next" says where
+    if (uartLinkTxFree(UART_TX_DATA) < APP_LOG_SENSOR_FRAME_MAX) break;
+    appLogSensorData(s);
+    sent++;
+  }
 
-    if (openTh >= closeTh) { appLogAck(id, false, "open_th must be < close_th"); return; }
-    if (closeTh > 65535u || openTh > 65535u) { appLogAck(id, false, "th too big"); return; }
+  // "next" is the offset for the following page, == total when done
+  snprintf(s_sensorMsg, sizeof(s_sensorMsg), "sensors %u next %lu/%u",
+           (unsigned)sent, (unsigned long)i, (unsigned)count);
+  *msg = s_sensorMsg;
+  return true;
+}
 
-    valveCtrlSetThresholds((uint16_t)closeTh, (uint16_t)openTh);
+// args: node_id (default: primary sensor), kind raw|min, offset.
+// One @HIST page per call; the gateway repeats with "next" until == total.
+static bool opHistory(uint32_t id, const CmdArgs_t *a, const char **msg)
+{
+  static char s_histMsg[32];
 
-    appLogAck(id, true, "threshold updated");
-    valveCtrlAutoControl();
-    appLogData();
-    return;
+  Sensor_t *s = a->present[0] ? sensorTableFind((EmberNodeId)a->u[0]) : sensorTablePrimary();
+  if (!s) { *msg = "unknown sensor"; return false; }
+  if (s->hist == HIST_NONE) { *msg = "no history"; return false; }
+
+  uint8_t kind = (uint8_t)argU(a, 1, HIST_KIND_MIN);
+  uint16_t total = historyCount(s, (hist_kind_t)kind);
+  uint8_t sent = 0;
+  uint16_t next = appLogHistory(id, s, kind, (uint16_t)argU(a, 2, 0), &sent);
+
+  snprintf(s_histMsg, sizeof(s_histMsg), "hist %u next %u/%u",
+           (unsigned)sent, (unsigned)next, (unsigned)total);
+  *msg = s_histMsg;
+  return true;
+}
+
+#define ARG_VALVE \
+  { "valve", ARG_UINT, false, 0, VALVE_TABLE_MAX - 1u, NULL, "bad valve" }
+
+#define ARG_NET_CFG \
+  { "pan_id",   ARG_U32_ANY, false, 0,  U16_MAX, NULL, NULL }, \
+  { "ch",       ARG_U32_ANY, false, 11, 26,      NULL, "bad channel" }, \
+  { "tx_power", ARG_U32_ANY, false, 0,  U32_MAX, NULL, NULL }
+
+static const CmdOpDef_t s_ops[] = {
+  { "info", opInfo, 0, 0, 0, { { 0 } } },
+  { "mode_set", opModeSet, CMD_DEBOUNCE_MS, CMD_POST_AUTO | CMD_POST_DATA, 1, {
+      { "value", ARG_ENUM, true, 0, 0, "auto|manual", "value must be auto/manual" },
+  } },
+  { "threshold_set", opThresholdSet, 0, CMD_POST_AUTO | CMD_POST_DATA, 2, {
+      { "close_th", ARG_UINT, true,  0, U16_MAX, NULL, "th too big" },
+      { "open_th",  ARG_UINT, false, 0, U16_MAX, NULL, "th too big" },
+  } },
+  { "valve_path_set", opValvePathSet, 0, CMD_POST_INFO, 2, {
+      { "value", ARG_ENUM, true, 0, 0, "auto|direct|binding", "value must be auto/direct/binding" },
+      ARG_VALVE,
+  } },
+  { "valve_target_set", opValveTargetSet, 0, CMD_POST_INFO, 3, {
+      { "node_id", ARG_U32_ANY, true,  0, U16_MAX, NULL, NULL },
+      { "dst_ep",  ARG_UINT,    false, 0, 0xFFu,   NULL, NULL },
+      ARG_VALVE,
+  } },
+  { "valve_pair", opValvePair, 0, CMD_POST_INFO, 5, {
+      { "eui64",      ARG_STR,     true,  0, 0,       NULL, NULL },
+      { "node_id",    ARG_U32_ANY, true,  0, U16_MAX, NULL, NULL },
+      { "bind_index", ARG_UINT,    false, 0, 0xFFu,   NULL, NULL },
+      { "dst_ep",     ARG_UINT,    false, 0, 0xFFu,   NULL, NULL },
+      ARG_VALVE,
+  } },
+  // no debounce: it would be per op, so one valve's command would block
+  // the other 31; valve_ctrl already supersedes a queued command to the
+  // same valve, which bounds the radio traffic per valve
+  { "valve_set", opValveSet, 0, CMD_OP_DEFERRED, 2, {
+      { "value", ARG_ENUM, true, 0, 0, "open|closed|close", "value must be open/closed" },
+      ARG_VALVE,
+  } },
+  { "valve_get", opValveGet, 0, 0, 1, {
+      { "valve", ARG_UINT, true, 0, VALVE_TABLE_MAX - 1u, NULL, NULL },
+  } },
+  { "net_cfg_set", opNetCfgSet, 0, 0, 3, { ARG_NET_CFG } },
+  { "net_form", opNetForm, 0, 0, 4, {
+      ARG_NET_CFG,
+      { "force", ARG_UINT, false, 0, U32_MAX, NULL, NULL },
+  } },
+  { "uart_gateway_set", opUartGatewaySet, 0, 0, 1, {
+      { "enable", ARG_UINT, false, 0, U32_MAX, NULL, NULL },
+  } },
+  { "proto_set", opProtoSet, 0, CMD_POST_PROTO, 1, {
+      { "value", ARG_ENUM, true, 0, 0, "text|binary", "value must be text/binary" },
+  } },
+  { "data_cfg_set", opDataCfgSet, 0, CMD_POST_DATA, 2, {
+      { "delta",      ARG_UINT, false, 0, 1,    NULL, "delta must be 0/1" },
+      { "full_every", ARG_UINT, false, 1, 0xFFu, NULL, "full_every must be 1..255" },
+  } },
+  { "filter_set", opFilterSet, 0, CMD_POST_AUTO | CMD_POST_DATA | CMD_POST_INFO, 2, {
+      { "median",     ARG_UINT, false, 1, FLOW_FILTER_MEDIAN_MAX, NULL, "median must be 1..7" },
+      { "ewma_shift", ARG_UINT, false, 0, FLOW_FILTER_SHIFT_MAX,  NULL, "ewma_shift must be 0..7" },
+  } },
+  { "total_cfg_set", opTotalCfgSet, 0, 0, 2, {
+      { "interval_s", ARG_UINT, false, 60, 86400u,  NULL, "interval_s must be 60..86400" },
+      { "delta_l",    ARG_UINT, false, 1,  U16_MAX, NULL, "delta_l must be 1..65535" },
+  } },
+  { "time_set", opTimeSet, 0, 0, 1, {
+      { "value", ARG_UINT, true, 0, U32_MAX, NULL, NULL },
+  } },
+  { "leak_cfg_set", opLeakCfgSet, 0, CMD_POST_INFO, 3, {
+      { "dev_window_s", ARG_UINT, false, 60,  86400u, NULL, "dev_window_s must be 60..86400" },
+      { "min_window_s", ARG_UINT, false, 600, 86400u, NULL, "min_window_s must be 600..86400" },
+      { "close",        ARG_UINT, false, 0,   1,      NULL, "close must be 0/1" },
+  } },
+  { "leak_clear", opLeakClear, 0, CMD_POST_AUTO | CMD_POST_INFO, 0, { { 0 } } },
+  { "stale_cfg_set", opStaleCfgSet, 0, CMD_POST_AUTO | CMD_POST_INFO, 2, {
+      { "timeout_s", ARG_UINT, false, 30, 86400u, NULL, "timeout_s must be 30..86400" },
+      { "action",    ARG_ENUM, false, 0,  0,      "none|close|open", "action must be none/close/open" },
+  } },
+  { "data_get", opDataGet, 0, CMD_POST_DATA, 0, { { 0 } } },
+  { "sensor_get", opSensorGet, 0, 0, 2, {
+      { "node_id", ARG_U32_ANY, false, 0, U16_MAX, NULL, NULL },
+      { "offset",  ARG_UINT,    false, 0, SENSOR_TABLE_MAX, NULL, NULL },
+  } },
+  { "history", opHistory, 0, 0, 3, {
+      { "node_id", ARG_U32_ANY, false, 0, U16_MAX, NULL, NULL },
+      { "kind",    ARG_ENUM,    false, 0, 0,       "raw|min", "kind must be raw/min" },
+      { "offset",  ARG_UINT,    false, 0, U16_MAX, NULL, NULL },
+  } },
+  { "stats", opStats, 0, 0, 1, {
+      { "reset", ARG_UINT, false, 0, 1, NULL, "reset must be 0/1" },
+  } },
+};
+
+#define CMD_OP_COUNT  (sizeof(s_ops) / sizeof(s_ops[0]))
+
+// Seed and slot table come from tools/codegen/gen_op_hash.py: every name
+// has its own slot, so a lookup is one hash and one compare. Re-run the
+// script after changing s_ops[].
+// ----- BEGIN GENERATED by tools/codegen/gen_op_hash.py -----
+#define CMD_OP_SLOTS      64u   // power of 2
+#define CMD_OP_HASH_BASIS 0x811C9DD9u
+#define CMD_OP_HASH_COUNT 23u
+
+// slot -> op index + 1, 0 = empty
+static const uint8_t s_opSlot[CMD_OP_SLOTS] = {
+  [1]  = 1,  // info
+  [3]  = 13, // data_cfg_set
+  [4]  = 21, // sensor_get
+  [6]  = 12, // proto_set
+  [8]  = 18, // leak_clear
+  [11] = 16, // time_set
+  [14] = 20, // data_get
+  [15] = 3,  // threshold_set
+  [19] = 10, // net_form
+  [20] = 14, // filter_set
+  [22] = 6,  // valve_pair
+  [30] = 9,  // net_cfg_set
+  [31] = 11, // uart_gateway_set
+  [36] = 19, // stale_cfg_set
+  [40] = 5,  // valve_target_set
+  [43] = 22, // history
+  [46] = 7,  // valve_set
+  [50] = 8,  // valve_get
+  [51] = 15, // total_cfg_set
+  [52] = 17, // leak_cfg_set
+  [56] = 23, // stats
+  [57] = 2,  // mode_set
+  [62] = 4,  // valve_path_set
+};
+// ----- END GENERATED -----
+
+_Static_assert(CMD_OP_COUNT == CMD_OP_HASH_COUNT,
+               "s_ops[] changed: re-run tools/codegen/gen_op_hash.py");
+
+static uint32_t s_opLastTick[CMD_OP_COUNT];   // debounce per op
+
+// FNV-1a from the generated basis, masked to the slot table
+static uint8_t opHash(const char *s, uint16_t n)
+{
+  uint32_t h = CMD_OP_HASH_BASIS;
+  for (uint16_t i = 0; i < n; i++) {
+    h ^= (uint8_t)s[i];
+    h *= 16777619u;
   }
+  return (uint8_t)(h & (CMD_OP_SLOTS - 1u));
+}
 
-  if (strcmp(op, "valve_path_set") == 0) {
-    char value[16] = {0};
-    if (!parseStringField(p, "\"value\"", value, sizeof(value))) { appLogAck(id, false, "missing value"); return; }
+int cmdOpFind(const char *op, uint16_t len)
+{
+  if (!op) return -1;
+  uint8_t s = s_opSlot[opHash(op, len)];
+  if (s == 0) return -1;
+  const char *name = s_ops[s - 1u].name;
+  if (strlen(name) != len || memcmp(op, name, len) != 0) return -1;
+  return (int)(s - 1u);
+}
 
-    if (strcmp(value, "auto") == 0) valveCtrlSetPath(VALVE_PATH_AUTO);
-    else if (strcmp(value, "direct") == 0) valveCtrlSetPath(VALVE_PATH_DIRECT);
-    else if (strcmp(value, "binding") == 0) valveCtrlSetPath(VALVE_PATH_BINDING);
-    else { appLogAck(id, false, "value must be auto/direct/binding"); return; }
+const char *cmdOpName(int idx)
+{
+  return (idx >= 0 && (unsigned)idx < CMD_OP_COUNT) ? s_ops[idx].name : NULL;
+}
 
-    appLogAck(id, true, "valve_path_set");
-    appLogInfo();
-    return;
+static bool enumIndex(const JsonField_t *f, const char *choices, uint32_t *out)
+{
+  uint32_t idx = 0;
+  const char *c = choices;
+  while (*c) {
+    const char *e = strchr(c, '|');
+    size_t n = e ? (size_t)(e - c) : strlen(c);
+    if (f->valLen == n && memcmp(f->val, c, n) == 0) { *out = idx; return true; }
+    if (!e) break;
+    c = e + 1;
+    idx++;
   }
+  return false;
+}
 
-  if (strcmp(op, "valve_target_set") == 0) {
-    uint32_t nodeId = 0;
-    uint32_t dstEp = (uint32_t)VALVE_EP_DEFAULT;
+// Fill args from the declaration; on failure *msg says why
+static bool validateArgs(const CmdOpDef_t *def, const JsonTok_t *tok, CmdArgs_t *a, const char **msg)
+{
+  static char errBuf[CMD_ACK_MSG_MAX];
+  memset(a, 0, sizeof(*a));
+
+  for (uint8_t i = 0; i < def->nArgs; i++) {
+    const CmdArgDef_t *ad = &def->args[i];
+    const JsonField_t *f = jsonTokFind(tok, ad->key);
+    bool ok = false;
+
+    switch (ad->type) {
+      case ARG_UINT:    ok = jsonTokGetUint(tok, ad->key, &a->u[i]); break;
+      case ARG_U32_ANY: ok = jsonTokGetU32Any(tok, ad->key, &a->u[i]); break;
+      case ARG_STR:     ok = (f != NULL && f->type == JSON_TOK_STRING); break;
+      case ARG_ENUM:    ok = (f != NULL && f->type == JSON_TOK_STRING); break;
+      default: break;
+    }
 
-    if (!parseU32FieldAny(p, "\"node_id\"", &nodeId)) { appLogAck(id, false, "missing node_id"); return; }
-    (void)parseUintField(p, "\"dst_ep\"", &dstEp);
+    if (!ok && f == NULL) {
+      if (!ad->required) continue;
+      snprintf(errBuf, sizeof(errBuf), "missing %s", ad->key);
+      *msg = errBuf;
+      return false;
+    }
 
-    valveCtrlSetTarget((EmberNodeId)nodeId, (uint8_t)dstEp);
+    // present but not parsable (12.5, 1e3, > 32 bits): refused like an
+    // out-of-range value, optional or not
+    bool valid = ok;
+    if (valid && (ad->type == ARG_UINT || ad->type == ARG_U32_ANY)) {
+      valid = (a->u[i] >= ad->min) && (a->u[i] <= ad->max);
+    } else if (valid && ad->type == ARG_ENUM) {
+      valid = enumIndex(f, ad->choices, &a->u[i]);
+    }
+    if (!valid) {
+      if (ad->errMsg) {
+        *msg = ad->errMsg;
+      } else {
+        snprintf(errBuf, sizeof(errBuf), "bad %s", ad->key);
+        *msg = errBuf;
+      }
+      return false;
+    }
 
-    appLogAck(id, true, "valve_target_set");
-    appLogInfo();
-    return;
+    a->present[i] = true;
+    a->s[i] = f;
   }
+  return true;
+}
 
-  if (strcmp(op, "valve_pair") == 0) {
-    char euiStr[40] = {0};
-    uint32_t nodeId = 0;
-    uint32_t bindIndex = 0;
-    uint32_t dstEp = (uint32_t)VALVE_EP_DEFAULT;
+static void runPost(uint8_t post)
+{
+  if (post & CMD_POST_AUTO) valveCtrlAutoControl();
+  if (post & CMD_POST_DATA) appLogData();
+  if (post & CMD_POST_INFO) appLogInfo();
+  if (post & CMD_POST_PROTO) binProtoApplyMode();
+}
 
-    if (!parseStringField(p, "\"eui64\"", euiStr, sizeof(euiStr))) { appLogAck(id, false, "missing eui64"); return; }
-    if (!parseU32FieldAny(p, "\"node_id\"", &nodeId)) { appLogAck(id, false, "missing node_id"); return; }
-    (void)parseUintField(p, "\"bind_index\"", &bindIndex);
-    (void)parseUintField(p, "\"dst_ep\"", &dstEp);
+void cmdHandleLine(const char *line)
+{
+  if (!line) return;
 
-    bool ok = valveCtrlPair(euiStr, (EmberNodeId)nodeId, (uint8_t)bindIndex, (uint8_t)dstEp);
-    appLogAck(id, ok, ok ? "valve_pair set" : "bad eui64");
-    if (ok) appLogInfo();
-    return;
+  const char *p = line;
+  if (strncmp(p, "@CMD", 4) != 0) return;
+  p += 4;
+  cmdHandleJson(skipSpaces(p));
+}
+
+// Look up, debounce, validate and run one op. Returns ok; *msg is the ACK
+// text or NULL when the handler's ACK comes later (valve_set).
+static bool execOp(uint32_t id, const JsonTok_t *tok, bool inBatch,
+                   const JsonField_t **opOut, const char **msg, uint8_t *post)
+{
+  *msg = NULL;
+  *post = 0;
+
+  const JsonField_t *opField = jsonTokFind(tok, "op");
+  *opOut = opField;
+  if (!opField || opField->type != JSON_TOK_STRING) {
+    *msg = "missing op";
+    return false;
+  }
+
+  int idx = cmdOpFind(opField->val, opField->valLen);
+  if (idx < 0) {
+    *msg = "unknown op";
+    return false;
+  }
+  const CmdOpDef_t *def = &s_ops[idx];
+
+  // its later ACK would share the batch ID and overwrite the batch summary
+  if (inBatch && (def->post & CMD_OP_DEFERRED)) {
+    *msg = "not allowed in batch";
+    return false;
   }
 
-  if (strcmp(op, "valve_set") == 0) {
+  if (def->debounceMs != 0) {
+    uint32_t now = halCommonGetInt32uMillisecondTick();
     // Debounce: ignore if too fast
-    if ((now - s_lastValveSetTick) < CMD_DEBOUNCE_MS) {
-      appLogAck(id, false, "debounced");
-      return;
+    if ((now - s_opLastTick[idx]) < def->debounceMs) {
+      *msg = "debounced";
+      return false;
     }
-    s_lastValveSetTick = now;
-    
-    if (g_mode == MODE_AUTO) {
-      appLogAck(id, false, "rejected: AUTO mode");
-      return;
+    s_opLastTick[idx] = now;
+  }
+
+  CmdArgs_t args;
+  if (!validateArgs(def, tok, &args, msg)) {
+    return false;
+  }
+
+  bool ok = def->fn(id, &args, msg);
+  if (ok) *post = def->post;
+  return ok;
+}
+
+// ===== BATCH =====
+// @CMD {"id":N,"batch":[{"op":...},{"op":...}],"stop_on_error":1}
+// Ops run in order under the batch ID; one @ACK carries every result.
+// Follow-up output (@INFO/@DATA, auto-control) runs once after the ACK.
+// Ops whose final ACK comes later (valve_set) are refused per element, so
+// the summary is the only ACK for the batch ID. ACKs that handlers send
+// for the batch ID themselves are captured into the element's result.
+// A retried batch ID gets the summary ACK replayed, without "results".
+// "results" is bounded so the @ACK fits one text line and one binary
+// frame; results that do not fit are left out and the ACK carries
+// "truncated":true (the ops still run, the summary counts them all).
+#define CMD_BATCH_MAX          8u
+#define CMD_BATCH_OP_ECHO      24u    // op name echoed per result, longer ones cut
+#define CMD_BATCH_RESULTS_MAX  512u   // results text + NUL
+
+_Static_assert(CMD_BATCH_RESULTS_MAX + 160u <= APP_LOG_LINE_MAX, "batch @ACK line");
+_Static_assert(CMD_BATCH_RESULTS_MAX + 80u <= BIN_FRAME_MAX, "batch @ACK frame");
+
+static struct {
+  bool        active;
+  uint32_t    id;
+  bool        captured;
+  bool        ok;
+  char        msg[CMD_ACK_MSG_MAX];
+} s_batch;
+
+bool cmdCaptureAck(uint32_t id, bool ok, const char *msg)
+{
+  if (!s_batch.active || id != s_batch.id) return false;
+
+  s_batch.captured = true;
+  s_batch.ok = ok;
+  strncpy(s_batch.msg, msg ? msg : "", sizeof(s_batch.msg) - 1u);
+  s_batch.msg[sizeof(s_batch.msg) - 1u] = 0;
+  return true;
+}
+
+// Echoed length of the op name: capped, without a trailing backslash the
+// cut could leave escaping the closing quote
+static int opEchoLen(const JsonField_t *op)
+{
+  if (!op) return 0;
+  uint16_t n = (op->valLen > CMD_BATCH_OP_ECHO) ? CMD_BATCH_OP_ECHO : op->valLen;
+  while (n > 0 && op->val[n - 1u] == '\\') n--;
+  return (int)n;
+}
+
+static void runBatch(uint32_t id, const JsonField_t *batch, bool stopOnError)
+{
+  static char results[CMD_BATCH_RESULTS_MAX];
+  uint16_t rlen = 0;
+  uint8_t post = 0;
+  uint8_t total = 0;
+  uint8_t okCount = 0;
+  bool stopped = false;
+  bool truncated = false;
+
+  results[0] = 0;
+
+  // walk the array span: [ {..}, {..} ]
+  const char *p = batch->val + 1;
+  const char *end = batch->val + batch->valLen - 1;
+
+  while (p < end) {
+    while (p < end && (*p == ',' || *p == ' ' || *p == '\t')) p++;
+    if (p >= end) break;
+
+    if (total >= CMD_BATCH_MAX) { stopped = true; break; }
+
+    // element span = balanced {...}
+    const char *e = p;
+    int16_t depth = 0;   // signed: a stray '}' must not wrap to 255
+    bool inStr = false;
+    while (e < end) {
+      char c = *e++;
+      if (inStr) {
+        if (c == '\\') e++;
+        else if (c == '\"') inStr = false;
+      } else if (c == '\"') inStr = true;
+      else if (c == '{') depth++;
+      else if (c == '}' && --depth <= 0) break;
     }
 
-    char value[16] = {0};
-    if (!parseStringField(p, "\"value\"", value, sizeof(value))) {
-      appLogAck(id, false, "missing value");
-      return;
+    JsonTok_t tok;
+    const JsonField_t *op = NULL;
+    const char *msg = NULL;
+    uint8_t opPost = 0;
+    bool ok;
+
+    if (!jsonTokParseN(&tok, p, (uint16_t)(e - p))) {
+      ok = false;
+      msg = "bad json";
+    } else {
+      s_batch.active = true;
+      s_batch.id = id;
+      s_batch.captured = false;
+      ok = execOp(id, &tok, true, &op, &msg, &opPost);
+      s_batch.active = false;
+
+      if (!msg) {
+        ok = s_batch.captured ? s_batch.ok : ok;
+        msg = s_batch.captured ? s_batch.msg : "queued";
+      }
     }
 
-    bool wantOpen = false;
-    if (strcmp(value, "open") == 0) wantOpen = true;
-    else if (strcmp(value, "closed") == 0 || strcmp(value, "close") == 0) wantOpen = false;
-    else { appLogAck(id, false, "value must be open/closed"); return; }
+    total++;
+    if (ok) { okCount++; post |= opPost; }
+
+    if (!truncated) {
+      int n = snprintf(&results[rlen], sizeof(results) - rlen,
+                       "%s{\"op\":\"%.*s\",\"ok\":%s,\"msg\":\"%s\"}",
+                       (rlen > 0) ? "," : "",
+                       opEchoLen(op), op ? op->val : "",
+                       ok ? "true" : "false", msg);
+      if (n > 0 && (uint16_t)n < sizeof(results) - rlen) {
+        rlen = (uint16_t)(rlen + n);
+      } else {
+        results[rlen] = 0;   // drop the cut-off element, keep the array valid
+        truncated = true;
+      }
+    }
 
-    (void)valveCtrlQueueTx(id, wantOpen);
-    return;
+    p = e;
+    if (!ok && stopOnError) { stopped = (p < end); break; }
   }
 
-  if (strcmp(op, "net_cfg_set") == 0) {
-    uint32_t pan = g_netCfg.panId, ch = g_netCfg.ch, pwr = (uint32_t)g_netCfg.txPowerDbm;
-    (void)parseU32FieldAny(p, "\"pan_id\"", &pan);
-    (void)parseU32FieldAny(p, "\"ch\"", &ch);
-    (void)parseU32FieldAny(p, "\"tx_power\"", &pwr);
+  char summary[28];
+  snprintf(summary, sizeof(summary), "batch %u/%u%s",
+           (unsigned)okCount, (unsigned)total, stopped ? " stopped" : "");
 
-    if (ch < 11 || ch > 26) { appLogAck(id, false, "bad channel"); return; }
+  appLogAckBatch(id, (total > 0 && okCount == total && !stopped), summary, results, truncated);
+  runPost(post);
+}
 
-    g_netCfg.panId = (uint16_t)pan;
-    g_netCfg.ch = (uint8_t)ch;
-    g_netCfg.txPowerDbm = (int8_t)pwr;
+void cmdHandleJson(const char *p)
+{
+  if (!p) return;
 
-    appLogAck(id, true, "net cfg updated");
-    return;
-  }
+  // One scan of the line; every field lookup below is a table hit
+  JsonTok_t tok;
+  bool parsed = jsonTokParse(&tok, p);
 
-  if (strcmp(op, "net_form") == 0) {
-    uint32_t pan = g_netCfg.panId, ch = g_netCfg.ch, pwr = (uint32_t)g_netCfg.txPowerDbm, force = 0;
-    (void)parseU32FieldAny(p, "\"pan_id\"", &pan);
-    (void)parseU32FieldAny(p, "\"ch\"", &ch);
-    (void)parseU32FieldAny(p, "\"tx_power\"", &pwr);
-    (void)parseUintField(p, "\"force\"", &force);
+  uint32_t id = 0;
+  (void)jsonTokGetUint(&tok, "id", &id);
 
-    if (ch < 11 || ch > 26) { appLogAck(id, false, "bad channel"); return; }
+  // Duplicate detection
+  if (isDuplicateCmd(id)) {
+    return;  // Replayed or still in flight, not traced again
+  }
+  latStatsMark(id, LAT_PT_CMD);
 
-    NetCfg_t cfg = { (uint16_t)pan, (uint8_t)ch, (int8_t)pwr };
-    bool ok = netMgrRequestForm(cfg, "uart", (force != 0));
-    appLogAck(id, ok, ok ? "net_form accepted" : "net_form rejected");
+  if (!parsed) {
+    appLogAck(id, false, "bad json");
     return;
   }
 
-  if (strcmp(op, "uart_gateway_set") == 0) {
-    uint32_t en = 1;
-    (void)parseUintField(p, "\"enable\"", &en);
-    g_uartGatewayEnabled = (en != 0);
-    appLogAck(id, true, "uart_gateway_set");
+  const JsonField_t *batch = jsonTokFind(&tok, "batch");
+  if (batch && batch->type == JSON_TOK_ARRAY) {
+    uint32_t stop = 1;
+    (void)jsonTokGetUint(&tok, "stop_on_error", &stop);
+    runBatch(id, batch, (stop != 0));
     return;
   }
 
-  appLogAck(id, false, "unknown op");
+  const JsonField_t *op = NULL;
+  const char *msg = NULL;
+  uint8_t post = 0;
+  bool ok = execOp(id, &tok, false, &op, &msg, &post);
+  if (msg) appLogAck(id, ok, msg);
+  runPost(post);
 }
 
 // ===== CLI COMMAND HANDLER =====
@@ -233,7 +961,7 @@ void cli_json_command(sl_cli_command_arg_t *arguments)
   }
   
   // Build @CMD line: "@CMD " + json
-  static char cmdBuf[256];
+  static char cmdBuf[UART_LINE_MAX];
   int n = snprintf(cmdBuf, sizeof(cmdBuf), "@CMD %s", json_arg);
   if (n < 0 || (size_t)n >= sizeof(cmdBuf)) {
     appLogLog("CMD", "cli_error", "\"msg\":\"command too long\"");
@@ -3,9 +3,28 @@
 
 #include "sl_cli.h"
 
+#include <stdint.h>
+#include <stdbool.h>
+
 // Called from uartLinkPoll() when @CMD line is parsed
 void cmdHandleLine(const char *line);
 
+// Same, for the JSON object alone (binary @CMD frames)
+void cmdHandleJson(const char *json);
+
+// Called by app_log for every @ACK: caches the final result of a command ID
+// so a retry of that ID gets the same ACK replayed instead of re-executing
+void cmdNoteAck(uint32_t id, bool ok, const char *msg, bool hasZb, uint8_t zstatus, const char *stage);
+
+// Called by app_log before emitting an @ACK: returns true if a running
+// @CMD batch takes the ACK as the result of its current op (not emitted)
+bool cmdCaptureAck(uint32_t id, bool ok, const char *msg);
+
+// Op table lookup (one hash, one compare): index of `op` or -1.
+// cmdOpName() walks the table by index, NULL past the last op.
+int cmdOpFind(const char *op, uint16_t len);
+const char *cmdOpName(int idx);
+
 // CLI command handler for "json {...}" - called by CLI framework
 void cli_json_command(sl_cli_command_arg_t *arguments);
 
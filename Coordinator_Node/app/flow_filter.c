@@ -0,0 +1,68 @@
+#include "flow_filter.h"
+#include "app_config.h"
+
+#include <string.h>
+
+static uint8_t s_medianN = FLOW_FILTER_MEDIAN_DEFAULT;
+static uint8_t s_ewmaShift = FLOW_FILTER_SHIFT_DEFAULT;
+
+_Static_assert((FLOW_FILTER_MEDIAN_MAX & 1u) == 1u, "median window must be odd");
+_Static_assert((FLOW_FILTER_MEDIAN_DEFAULT & 1u) == 1u
+               && FLOW_FILTER_MEDIAN_DEFAULT <= FLOW_FILTER_MEDIAN_MAX, "bad median default");
+
+bool flowFilterConfig(uint8_t medianN, uint8_t ewmaShift)
+{
+  if (medianN == 0 || (medianN & 1u) == 0 || medianN > FLOW_FILTER_MEDIAN_MAX) return false;
+  if (ewmaShift > FLOW_FILTER_SHIFT_MAX) return false;
+  s_medianN = medianN;
+  s_ewmaShift = ewmaShift;
+  return true;
+}
+
+uint8_t flowFilterMedianN(void) { return s_medianN; }
+uint8_t flowFilterEwmaShift(void) { return s_ewmaShift; }
+
+void flowFilterReset(FlowFilter_t *f)
+{
+  memset(f, 0, sizeof(*f));
+}
+
+// median of the last n entries (n <= 7): insertion sort of a copy;
+// while the window fills, the lower middle of what is there
+static uint16_t median(const FlowFilter_t *f, uint8_t n)
+{
+  uint16_t v[FLOW_FILTER_MEDIAN_MAX];
+  for (uint8_t k = 0; k < n; k++) {
+    uint16_t x = f->win[(f->pos + FLOW_FILTER_MEDIAN_MAX - 1u - k) % FLOW_FILTER_MEDIAN_MAX];
+    uint8_t j = k;
+    while (j > 0 && v[j - 1u] > x) {
+      v[j] = v[j - 1u];
+      j--;
+    }
+    v[j] = x;
+  }
+  return v[(n - 1u) / 2u];
+}
+
+uint16_t flowFilterUpdate(FlowFilter_t *f, uint16_t raw)
+{
+  f->win[f->pos] = raw;
+  f->pos = (uint8_t)((f->pos + 1u) % FLOW_FILTER_MEDIAN_MAX);
+  if (f->n < FLOW_FILTER_MEDIAN_MAX) f->n++;
+
+  uint8_t n = (f->n < s_medianN) ? f->n : s_medianN;
+  uint16_t x = (n > 1u) ? median(f, n) : raw;
+
+  if (s_ewmaShift == 0) return x;
+
+  uint32_t xQ8 = (uint32_t)x << 8;
+  if (!f->primed) {
+    f->ewmaQ8 = xQ8;
+    f->primed = true;
+  } else if (xQ8 >= f->ewmaQ8) {
+    f->ewmaQ8 += (xQ8 - f->ewmaQ8) >> s_ewmaShift;
+  } else {
+    f->ewmaQ8 -= (f->ewmaQ8 - xQ8) >> s_ewmaShift;
+  }
+  return (uint16_t)((f->ewmaQ8 + 0x80u) >> 8);
+}
@@ -0,0 +1,38 @@
+#ifndef FLOW_FILTER_H
+#define FLOW_FILTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ===== FLOW FILTER =====
+// Per-sensor integer filter ahead of the AUTO hysteresis:
+//   raw -> median of the last N reports -> EWMA y += (x - y) >> shift
+// N = 1 disables the median, shift = 0 disables the EWMA. The EWMA state is
+// Q8 fixed point so small steps are not lost to truncation.
+// The setting is global, not per sensor: only the primary sensor's output
+// drives control (AUTO hysteresis), the others are reported as flow_f.
+// A per-sensor setting would add 2 B to every Sensor_t for no control
+// benefit. `filter_set` changes it and restarts every filter; each
+// sensor's flow_f (and g_flowFiltered) restart from the last raw report.
+
+#define FLOW_FILTER_MEDIAN_MAX  7u    // odd
+#define FLOW_FILTER_SHIFT_MAX   7u
+
+typedef struct {
+  uint16_t win[FLOW_FILTER_MEDIAN_MAX];  // last reports, ring
+  uint32_t ewmaQ8;
+  uint8_t  pos;
+  uint8_t  n;                            // valid entries in win
+  bool     primed;                       // ewmaQ8 holds a value
+} FlowFilter_t;
+
+// false if medianN is even / out of range or shift too large
+bool flowFilterConfig(uint8_t medianN, uint8_t ewmaShift);
+uint8_t flowFilterMedianN(void);
+uint8_t flowFilterEwmaShift(void);
+
+void flowFilterReset(FlowFilter_t *f);
+// Feed one raw report, returns the filtered value
+uint16_t flowFilterUpdate(FlowFilter_t *f, uint16_t raw);
+
+#endif
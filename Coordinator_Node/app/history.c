@@ -0,0 +1,155 @@
+#include "history.h"
+#include "app_log.h"
+#include "sensor_table.h"
+
+#include <string.h>
+
+typedef struct {
+  HistBucket_t bucket[HIST_BUCKETS];   // indexed by minute % HIST_BUCKETS
+  HistRaw_t    raw[HIST_RAW_SAMPLES];
+  uint32_t     headMin;    // uptime minute of the newest bucket
+  uint32_t     firstMin;   // minute of the first sample
+  uint32_t     sum;        // newest bucket: running sum / unsaturated count
+  uint16_t     cnt;
+  uint16_t     rawHead;    // next write position
+  uint16_t     rawCount;
+  bool         used;
+} HistSlot_t;
+
+static HistSlot_t s_hist[HIST_SENSORS];
+
+_Static_assert(sizeof(s_hist) <= HIST_RAM_BUDGET, "flow history exceeds HIST_RAM_BUDGET");
+_Static_assert(HIST_SENSORS < HIST_NONE, "HIST_SENSORS too large");
+_Static_assert(HIST_BUCKETS <= 0xFFFFu && HIST_RAW_SAMPLES <= 0xFFFFu, "history index is 16 bits");
+
+static HistSlot_t *slotOf(const Sensor_t *s)
+{
+  return (s && s->hist < HIST_SENSORS) ? &s_hist[s->hist] : NULL;
+}
+
+void historyInit(void)
+{
+  memset(s_hist, 0, sizeof(s_hist));
+}
+
+static HistSlot_t *allocSlot(Sensor_t *s, uint32_t minute)
+{
+  for (uint8_t k = 0; k < HIST_SENSORS; k++) {
+    HistSlot_t *h = &s_hist[k];
+    if (h->used) continue;
+    memset(h, 0, sizeof(*h));
+    h->used = true;
+    h->headMin = minute;
+    h->firstMin = minute;
+    s->hist = k;
+    return h;
+  }
+  return NULL;
+}
+
+void historyAdd(Sensor_t *s, uint16_t v)
+{
+  if (!s) return;
+
+  uint32_t now = appLogGetUptimeSec();
+  uint32_t minute = now / 60u;
+
+  HistSlot_t *h = slotOf(s);
+  if (!h) h = allocSlot(s, minute);
+  if (!h) return;
+
+  h->raw[h->rawHead].tS = now;
+  h->raw[h->rawHead].v = v;
+  h->rawHead = (uint16_t)((h->rawHead + 1u) % HIST_RAW_SAMPLES);
+  if (h->rawCount < HIST_RAW_SAMPLES) h->rawCount++;
+
+  // new minute: clear the buckets of the minutes without samples
+  if (minute != h->headMin) {
+    uint32_t gap = minute - h->headMin;
+    if (gap > HIST_BUCKETS) gap = HIST_BUCKETS;
+    for (uint32_t k = 0; k < gap; k++) {
+      memset(&h->bucket[(minute - k) % HIST_BUCKETS], 0, sizeof(HistBucket_t));
+    }
+    h->headMin = minute;
+    h->sum = 0;
+    h->cnt = 0;
+  }
+
+  HistBucket_t *b = &h->bucket[minute % HIST_BUCKETS];
+  if (h->cnt == 0) {
+    b->min = v;
+    b->max = v;
+  } else {
+    if (v < b->min) b->min = v;
+    if (v > b->max) b->max = v;
+  }
+  if (h->cnt < 0xFFFFu) {
+    h->sum += v;
+    h->cnt++;
+  }
+  b->avg = (uint16_t)((h->sum + h->cnt / 2u) / h->cnt);
+  b->n = (h->cnt > 0xFFu) ? 0xFFu : (uint8_t)h->cnt;
+}
+
+void historyRelease(Sensor_t *s)
+{
+  HistSlot_t *h = slotOf(s);
+  if (h) h->used = false;
+  if (s) s->hist = HIST_NONE;
+}
+
+// ===== QUERY =====
+
+// raw samples older than the window, counted from the oldest
+static uint16_t rawExpired(const HistSlot_t *h)
+{
+  uint32_t now = appLogGetUptimeSec();
+  uint16_t oldest = (uint16_t)((h->rawHead + HIST_RAW_SAMPLES - h->rawCount) % HIST_RAW_SAMPLES);
+  uint16_t k = 0;
+  while (k < h->rawCount
+         && (now - h->raw[(oldest + k) % HIST_RAW_SAMPLES].tS) > HIST_RAW_WINDOW_S) {
+    k++;
+  }
+  return k;
+}
+
+static uint16_t bucketSpan(const HistSlot_t *h)
+{
+  uint32_t span = h->headMin - h->firstMin + 1u;
+  return (uint16_t)((span > HIST_BUCKETS) ? HIST_BUCKETS : span);
+}
+
+uint16_t historyCount(const Sensor_t *s, hist_kind_t kind)
+{
+  const HistSlot_t *h = slotOf(s);
+  if (!h) return 0;
+  if (kind == HIST_KIND_RAW) return (uint16_t)(h->rawCount - rawExpired(h));
+  return bucketSpan(h);
+}
+
+bool historyRawAt(const Sensor_t *s, uint16_t idx, HistRaw_t *out)
+{
+  const HistSlot_t *h = slotOf(s);
+  if (!h) return false;
+
+  uint16_t skip = rawExpired(h);
+  if ((uint32_t)skip + idx >= h->rawCount) return false;
+
+  uint16_t oldest = (uint16_t)((h->rawHead + HIST_RAW_SAMPLES - h->rawCount) % HIST_RAW_SAMPLES);
+  *out = h->raw[(oldest + skip + idx) % HIST_RAW_SAMPLES];
+  return true;
+}
+
+bool historyBucketAt(const Sensor_t *s, uint16_t idx, uint32_t *minute, HistBucket_t *out)
+{
+  const HistSlot_t *h = slotOf(s);
+  if (!h) return false;
+
+  uint16_t span = bucketSpan(h);
+  if (idx >= span) return false;
+
+  uint32_t m = h->headMin - (uint32_t)(span - 1u) + idx;
+  *minute = m;
+  *out = h->bucket[m % HIST_BUCKETS];
+  return true;
+}
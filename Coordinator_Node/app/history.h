@@ -0,0 +1,61 @@
+#ifndef HISTORY_H
+#define HISTORY_H
+
+#include "app_config.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+struct Sensor_s;
+
+// ===== FLOW HISTORY =====
+// In-RAM flow history for up to HIST_SENSORS sensors, so the gateway can
+// backfill after a reconnect (`history` op, paginated @HIST).
+// - raw ring: the last HIST_RAW_SAMPLES reports, served for HIST_RAW_WINDOW_S
+// - minute ring: HIST_BUCKETS 1-minute min/max/avg/count buckets (24 h);
+//   a bucket's minute is implied by its ring position, so buckets carry
+//   no timestamp and skipped minutes are simply empty (n == 0)
+// Times are uptime seconds (the same clock as "uptime" in @LOG / @INFO).
+// A history slot is taken by the first HIST_SENSORS sensors to report flow
+// and released when the sensor table evicts that sensor, so a new sensor
+// gets one as soon as an earlier one leaves.
+//
+// RAM: HIST_SENSORS x sizeof(HistSlot_t), checked against HIST_RAM_BUDGET
+// at compile time (history.c); with the defaults 2 x ~10.6 KiB
+// (1440 x 7 B buckets + 128 x 6 B raw samples + header).
+// This is deliberately not one slot per sensor table entry: 256 slots would
+// be ~2.7 MiB against the EFR32MG12's 256 KiB of RAM, and even 24 h of
+// buckets for 8 sensors (~85 KiB) would crowd out the stack's own heap.
+// The gateway keeps long-term per-sensor history; other sensors get
+// "no history" from the `history` op.
+
+#define HIST_NONE  0xFFu   // Sensor_t.hist: no history slot
+
+typedef struct __attribute__((packed)) {
+  uint32_t tS;      // uptime seconds
+  uint16_t v;
+} HistRaw_t;
+
+typedef struct __attribute__((packed)) {
+  uint16_t min;
+  uint16_t max;
+  uint16_t avg;     // rounded mean of the minute
+  uint8_t  n;       // samples, saturates at 255 (0 = no data)
+} HistBucket_t;
+
+typedef enum { HIST_KIND_RAW = 0, HIST_KIND_MIN } hist_kind_t;
+
+void historyInit(void);
+
+// Record a flow sample for s (takes a free slot on first use)
+void historyAdd(struct Sensor_s *s, uint16_t v);
+void historyRelease(struct Sensor_s *s);
+
+// Entries in the raw window / minute ring, oldest first. Empty minutes are
+// counted (positions are stable while paging within the same minute).
+uint16_t historyCount(const struct Sensor_s *s, hist_kind_t kind);
+bool historyRawAt(const struct Sensor_s *s, uint16_t idx, HistRaw_t *out);
+// *minute = uptime minute of the bucket; false if idx is out of range
+bool historyBucketAt(const struct Sensor_s *s, uint16_t idx, uint32_t *minute, HistBucket_t *out);
+
+#endif
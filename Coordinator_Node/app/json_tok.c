@@ -0,0 +1,209 @@
+#include "json_tok.h"
+
+#include <string.h>
+#include <errno.h>
+#include <stdlib.h>
+
+static uint8_t keyHash(const char *k, uint8_t len)
+{
+  if (len == 0) return 0;
+  return (uint8_t)(((uint32_t)len * 31u + (uint8_t)k[0] * 7u + (uint8_t)k[len - 1])
+                   & (JSON_TOK_HASH_SLOTS - 1u));
+}
+
+static void addField(JsonTok_t *t, const JsonField_t *f)
+{
+  uint8_t h = keyHash(f->key, f->keyLen);
+  while (t->slot[h] != 0) h = (uint8_t)((h + 1u) & (JSON_TOK_HASH_SLOTS - 1u));
+
+  t->f[t->count] = *f;
+  t->count++;
+  t->slot[h] = t->count;
+}
+
+// p points at the opening quote; returns pointer past the closing quote
+static const char *skipString(const char *p, const char *end)
+{
+  p++;
+  while (p < end && *p != '\"') {
+    if (*p == '\\') p++;
+    p++;
+  }
+  return (p < end) ? p + 1 : NULL;
+}
+
+// p points at '{' or '['; returns pointer past the matching bracket
+static const char *skipNested(const char *p, const char *end)
+{
+  uint8_t depth = 0;
+  while (p < end) {
+    char c = *p;
+    if (c == '\"') {
+      p = skipString(p, end);
+      if (!p) return NULL;
+      continue;
+    }
+    if (c == '{' || c == '[') depth++;
+    else if (c == '}' || c == ']') {
+      if (--depth == 0) return p + 1;
+    }
+    p++;
+  }
+  return NULL;
+}
+
+// JSON whitespace and digits; plain compares, not the locale-aware ctype calls
+static bool isWs(char c) { return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\n'); }
+
+static bool isDigit(char c) { return (c >= '0') && (c <= '9'); }
+
+static const char *skipWs(const char *p, const char *end)
+{
+  while (p < end && isWs(*p)) p++;
+  return p;
+}
+
+bool jsonTokParseN(JsonTok_t *t, const char *json, uint16_t len)
+{
+  if (!t) return false;
+  memset(t->slot, 0, sizeof(t->slot));
+  t->count = 0;
+  if (!json) return false;
+
+  const char *p = json;
+  const char *end = json + len;
+
+  p = skipWs(p, end);
+  if (p >= end || *p != '{') return false;
+  p = skipWs(p + 1, end);
+  if (p < end && *p == '}') return true;
+
+  while (p < end) {
+    JsonField_t f;
+
+    // "key"
+    if (*p != '\"') return false;
+    const char *kEnd = skipString(p, end);
+    if (!kEnd || (kEnd - p - 2) > 0xFF) return false;
+    f.key = p + 1;
+    f.keyLen = (uint8_t)(kEnd - p - 2);
+
+    p = skipWs(kEnd, end);
+    if (p >= end || *p != ':') return false;
+    p = skipWs(p + 1, end);
+    if (p >= end) return false;
+
+    // value
+    const char *vEnd;
+    if (*p == '\"') {
+      vEnd = skipString(p, end);
+      if (!vEnd) return false;
+      f.type = JSON_TOK_STRING;
+      f.val = p + 1;
+      f.valLen = (uint16_t)(vEnd - p - 2);
+    } else if (*p == '{' || *p == '[') {
+      vEnd = skipNested(p, end);
+      if (!vEnd) return false;
+      f.type = (*p == '{') ? JSON_TOK_OBJECT : JSON_TOK_ARRAY;
+      f.val = p;
+      f.valLen = (uint16_t)(vEnd - p);
+    } else {
+      vEnd = p;
+      while (vEnd < end && *vEnd != ',' && *vEnd != '}' && !isWs(*vEnd)) vEnd++;
+      if (vEnd == p) return false;
+      f.type = (isDigit(*p) || *p == '-') ? JSON_TOK_NUMBER : JSON_TOK_LITERAL;
+      f.val = p;
+      f.valLen = (uint16_t)(vEnd - p);
+    }
+
+    if (t->count >= JSON_TOK_MAX_FIELDS) return false;
+    addField(t, &f);
+
+    p = skipWs(vEnd, end);
+    if (p >= end) return false;
+    if (*p == '}') return true;
+    if (*p != ',') return false;
+    p = skipWs(p + 1, end);
+  }
+  return false;
+}
+
+bool jsonTokParse(JsonTok_t *t, const char *json)
+{
+  size_t n = json ? strlen(json) : 0;
+  if (n > 0xFFFFu) n = 0xFFFFu;
+  return jsonTokParseN(t, json, (uint16_t)n);
+}
+
+const JsonField_t *jsonTokFind(const JsonTok_t *t, const char *key)
+{
+  if (!t || !key) return NULL;
+
+  size_t n = strlen(key);
+  if (n > 0xFF) return NULL;
+  uint8_t h = keyHash(key, (uint8_t)n);
+
+  for (uint8_t probes = 0; probes < JSON_TOK_HASH_SLOTS; probes++) {
+    uint8_t s = t->slot[h];
+    if (s == 0) return NULL;
+    const JsonField_t *f = &t->f[s - 1u];
+    if (f->keyLen == n && memcmp(f->key, key, n) == 0) return f;
+    h = (uint8_t)((h + 1u) & (JSON_TOK_HASH_SLOTS - 1u));
+  }
+  return NULL;
+}
+
+bool jsonTokStrEq(const JsonField_t *f, const char *s)
+{
+  if (!f || !s) return false;
+  size_t n = strlen(s);
+  return (f->valLen == n) && (memcmp(f->val, s, n) == 0);
+}
+
+bool jsonTokGetUint(const JsonTok_t *t, const char *key, uint32_t *out)
+{
+  const JsonField_t *f = jsonTokFind(t, key);
+  if (!f || !out || f->type != JSON_TOK_NUMBER) return false;
+
+  uint32_t v = 0;
+  uint16_t i = 0;
+  while (i < f->valLen && isDigit(f->val[i])) {
+    uint32_t d = (uint32_t)(f->val[i] - '0');
+    if (v > (UINT32_MAX - d) / 10u) return false;   // would wrap
+    v = (v * 10u) + d;
+    i++;
+  }
+  // "12.5", "1e3", "-1": not a plain decimal
+  if (i == 0 || i != f->valLen) return false;
+
+  *out = v;
+  return true;
+}
+
+bool jsonTokGetString(const JsonTok_t *t, const char *key, char *out, uint32_t outSize)
+{
+  const JsonField_t *f = jsonTokFind(t, key);
+  if (!f || !out || outSize == 0) return false;
+  if (f->type != JSON_TOK_STRING && f->type != JSON_TOK_NUMBER && f->type != JSON_TOK_LITERAL) return false;
+
+  uint32_t n = f->valLen;
+  if (n + 1u > outSize) n = outSize - 1u;
+  memcpy(out, f->val, n);
+  out[n] = 0;
+  return (f->type == JSON_TOK_STRING) || (n > 0);
+}
+
+bool jsonTokGetU32Any(const JsonTok_t *t, const char *key, uint32_t *out)
+{
+  char tmp[24];
+  if (!out || !jsonTokGetString(t, key, tmp, sizeof(tmp))) return false;
+
+  char *endp = NULL;
+  errno = 0;
+  unsigned long v = strtoul(tmp, &endp, 0);
+  if (endp == tmp || *endp != 0 || tmp[0] == '-') return false;
+  if (errno == ERANGE || v > UINT32_MAX) return false;
+
+  *out = (uint32_t)v;
+  return true;
+}
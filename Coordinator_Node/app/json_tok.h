@@ -0,0 +1,57 @@
+#ifndef JSON_TOK_H
+#define JSON_TOK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ===== SINGLE-PASS JSON FIELD TOKENIZER =====
+// Scans one flat JSON object once and records key/value spans into a fixed
+// table (no allocation, no copies). Values point into the source line.
+// Nested objects/arrays are recorded as one raw span (brackets included)
+// and can be tokenized again with jsonTokParseN().
+
+#define JSON_TOK_MAX_FIELDS  16u
+#define JSON_TOK_HASH_SLOTS  32u   // power of 2, > JSON_TOK_MAX_FIELDS
+
+typedef enum {
+  JSON_TOK_NUMBER = 0,
+  JSON_TOK_STRING,     // span excludes the quotes, escapes left as-is
+  JSON_TOK_LITERAL,    // true / false / null
+  JSON_TOK_OBJECT,
+  JSON_TOK_ARRAY,
+} json_tok_type_t;
+
+typedef struct {
+  const char *key;
+  const char *val;
+  uint16_t    valLen;
+  uint8_t     keyLen;
+  uint8_t     type;    // json_tok_type_t
+} JsonField_t;
+
+typedef struct {
+  uint8_t     count;
+  uint8_t     slot[JSON_TOK_HASH_SLOTS];  // field index + 1, 0 = empty
+  JsonField_t f[JSON_TOK_MAX_FIELDS];
+} JsonTok_t;
+
+// Parse "{...}" (leading spaces allowed). Returns false on malformed input
+// or too many fields; fields seen before the error stay in the table.
+bool jsonTokParse(JsonTok_t *t, const char *json);
+bool jsonTokParseN(JsonTok_t *t, const char *json, uint16_t len);
+
+// Exact key match (no quotes): jsonTokFind(&t, "node_id")
+const JsonField_t *jsonTokFind(const JsonTok_t *t, const char *key);
+
+bool jsonTokStrEq(const JsonField_t *f, const char *s);
+
+// Plain decimal number: digits only (no sign, fraction or exponent),
+// false if it does not fit in 32 bits
+bool jsonTokGetUint(const JsonTok_t *t, const char *key, uint32_t *out);
+// Number or string, "0xbeef" or "48879" (strtoul base 0); the whole
+// value must parse and fit in 32 bits
+bool jsonTokGetU32Any(const JsonTok_t *t, const char *key, uint32_t *out);
+// Copy string (or bare token) value, NUL-terminated
+bool jsonTokGetString(const JsonTok_t *t, const char *key, char *out, uint32_t outSize);
+
+#endif
@@ -0,0 +1,170 @@
+#include "lat_stats.h"
+
+#include <string.h>
+
+#ifndef LAT_CLOCK_TICKS
+  #include "sl_sleeptimer.h"
+  #define LAT_CLOCK_TICKS()  sl_sleeptimer_get_tick_count()
+  #define LAT_CLOCK_HZ       sl_sleeptimer_get_timer_frequency()
+#endif
+
+typedef struct {
+  uint32_t id;       // 0 = free
+  uint8_t  mask;     // bit per lat_point_t
+  uint32_t t[LAT_PT_COUNT];
+} LatTrace_t;
+
+static LatHist_t  s_hist[LAT_ST_COUNT];
+static LatTrace_t s_trace[LAT_TRACE_SLOTS];
+static uint8_t    s_traceNext = 0;
+static uint32_t   s_lineTick = 0;
+static bool       s_lineValid = false;
+
+static const char *const s_stageNames[LAT_ST_COUNT] = {
+  [LAT_ST_LINE_CMD]   = "line_cmd",
+  [LAT_ST_CMD_QUEUE]  = "cmd_queue",
+  [LAT_ST_QUEUE_SEND] = "queue_send",
+  [LAT_ST_SEND_SENT]  = "send_sent",
+  [LAT_ST_SENT_ACK]   = "sent_ack",
+  [LAT_ST_ACK_UART]   = "ack_uart",
+  [LAT_ST_TOTAL]      = "total",
+  [LAT_ST_RX_CB]      = "rx_cb",
+  [LAT_ST_RX_PASS]    = "rx_pass",
+  [LAT_ST_VALVE_TTS]  = "valve_tts",
+  [LAT_ST_VALVE_CONFIRM] = "valve_confirm",
+};
+
+uint32_t latStatsNow(void) { return LAT_CLOCK_TICKS(); }
+
+static uint32_t ticksToUs(uint32_t ticks)
+{
+  uint32_t hz = LAT_CLOCK_HZ;
+  if (hz == 0) return 0;
+  return (uint32_t)(((uint64_t)ticks * 1000000u) / hz);
+}
+
+static uint8_t bucketOf(uint32_t us)
+{
+  uint32_t v = us / LAT_BUCKET0_US;
+  uint8_t b = 0;
+  while (v != 0 && b < (LAT_BUCKETS - 1u)) {
+    v >>= 1;
+    b++;
+  }
+  return b;
+}
+
+static void addSample(lat_stage_t st, uint32_t ticks)
+{
+  LatHist_t *h = &s_hist[st];
+  uint32_t us = ticksToUs(ticks);
+  uint8_t b = bucketOf(us);
+
+  h->n++;
+  h->sumUs += us;
+  if (us > h->maxUs) h->maxUs = us;
+  if (h->h[b] != 0xFFFFu) h->h[b]++;
+}
+
+void latStatsRecord(lat_stage_t st, uint32_t startTicks)
+{
+  if ((unsigned)st >= LAT_ST_COUNT) return;
+  addSample(st, latStatsNow() - startTicks);
+}
+
+void latStatsLineRx(void)
+{
+  s_lineTick = latStatsNow();
+  s_lineValid = true;
+}
+
+// A line that carried no traced command (no id, not @CMD, duplicate) must
+// not lend its tick to a later command from another source (CLI)
+void latStatsLineEnd(void)
+{
+  s_lineValid = false;
+}
+
+static LatTrace_t *findTrace(uint32_t id)
+{
+  for (uint8_t i = 0; i < LAT_TRACE_SLOTS; i++) {
+    if (s_trace[i].id == id) return &s_trace[i];
+  }
+  return NULL;
+}
+
+static LatTrace_t *openTrace(uint32_t id)
+{
+  LatTrace_t *t = findTrace(0);
+  if (!t) {
+    // all busy: reuse the oldest opened slot
+    t = &s_trace[s_traceNext];
+    s_traceNext = (uint8_t)((s_traceNext + 1u) % LAT_TRACE_SLOTS);
+  }
+  memset(t, 0, sizeof(*t));
+  t->id = id;
+  return t;
+}
+
+static void closeTrace(LatTrace_t *t)
+{
+  for (uint8_t k = 0; k + 1u < LAT_PT_COUNT; k++) {
+    uint8_t both = (uint8_t)((1u << k) | (1u << (k + 1u)));
+    if ((t->mask & both) == both) {
+      addSample((lat_stage_t)(LAT_ST_LINE_CMD + k), t->t[k + 1u] - t->t[k]);
+    }
+  }
+
+  uint8_t first = (t->mask & (1u << LAT_PT_LINE)) ? LAT_PT_LINE : LAT_PT_CMD;
+  if (t->mask & (1u << first)) {
+    addSample(LAT_ST_TOTAL, t->t[LAT_PT_ACK] - t->t[first]);
+  }
+
+  memset(t, 0, sizeof(*t));
+}
+
+void latStatsMark(uint32_t id, lat_point_t pt)
+{
+  if (id == 0 || (unsigned)pt >= LAT_PT_COUNT) return;
+
+  uint32_t now = latStatsNow();
+  LatTrace_t *t = findTrace(id);
+
+  if (pt == LAT_PT_CMD) {
+    bool fromLine = s_lineValid;
+    s_lineValid = false;
+    if (t) return;   // retry of an in-flight id: keep the original trace
+
+    t = openTrace(id);
+    if (fromLine) {
+      t->t[LAT_PT_LINE] = s_lineTick;
+      t->mask |= (uint8_t)(1u << LAT_PT_LINE);
+    }
+  }
+  if (!t) return;
+
+  t->t[pt] = now;
+  t->mask |= (uint8_t)(1u << pt);
+
+  if (pt == LAT_PT_ACK) closeTrace(t);
+}
+
+const LatHist_t *latStatsGet(lat_stage_t st)
+{
+  return ((unsigned)st < LAT_ST_COUNT) ? &s_hist[st] : NULL;
+}
+
+const char *latStatsStageName(lat_stage_t st)
+{
+  return ((unsigned)st < LAT_ST_COUNT) ? s_stageNames[st] : "";
+}
+
+uint32_t latStatsAvgUs(const LatHist_t *h)
+{
+  return (h && h->n) ? (uint32_t)(h->sumUs / h->n) : 0;
+}
+
+void latStatsReset(void)
+{
+  memset(s_hist, 0, sizeof(s_hist));
+}
@@ -0,0 +1,68 @@
+#ifndef LAT_STATS_H
+#define LAT_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ===== COMMAND LATENCY INSTRUMENTATION =====
+// A command is timestamped at fixed points on its way through the
+// coordinator; the time between consecutive points goes into a per-stage
+// histogram with log2 buckets:
+//   bucket 0 : < LAT_BUCKET0_US
+//   bucket k : [LAT_BUCKET0_US << (k-1), LAT_BUCKET0_US << k)
+//   last     : everything above
+// Timestamps use the sleeptimer tick (32768 Hz on EFR32, ~31 us).
+// A host build can provide its own clock: -DLAT_CLOCK_TICKS=fn() -DLAT_CLOCK_HZ=n
+
+#define LAT_BUCKETS      16u
+#define LAT_BUCKET0_US   64u
+#define LAT_TRACE_SLOTS  4u    // commands traced concurrently
+
+typedef enum {
+  LAT_PT_LINE = 0,   // uart_link: line / frame complete
+  LAT_PT_CMD,        // cmd_handler: JSON parsed, id known
+  LAT_PT_QUEUE,      // valve_ctrl: valveCtrlQueueTx() entered
+  LAT_PT_SEND,       // valve_ctrl: emberAfSendCommandUnicast() returned
+  LAT_PT_SENT,       // valve_ctrl: emberAfMessageSentCallback()
+  LAT_PT_ACK,        // app_log: final @ACK queued
+  LAT_PT_COUNT
+} lat_point_t;
+
+typedef enum {
+  LAT_ST_LINE_CMD = 0,   // point k -> k+1
+  LAT_ST_CMD_QUEUE,
+  LAT_ST_QUEUE_SEND,
+  LAT_ST_SEND_SENT,
+  LAT_ST_SENT_ACK,
+  LAT_ST_ACK_UART,       // @ACK queued -> written to UART (TX ring wait)
+  LAT_ST_TOTAL,          // first point (line or cmd) -> @ACK queued
+  LAT_ST_RX_CB,          // telemetry report callback (store + mark dirty)
+  LAT_ST_RX_PASS,        // coalesced telemetry pass (control + @DATA)
+  LAT_ST_VALVE_TTS,      // valve command first send -> delivered, retries included
+  LAT_ST_VALVE_CONFIRM,  // valve command first send -> OnOff report of the new state
+  LAT_ST_COUNT
+} lat_stage_t;
+
+typedef struct {
+  uint32_t n;
+  uint32_t maxUs;
+  uint64_t sumUs;
+  uint16_t h[LAT_BUCKETS];   // saturating counts
+} LatHist_t;
+
+uint32_t latStatsNow(void);                     // raw clock ticks
+
+// Tracing by command id (id 0 = untracked, e.g. AUTO mode valve commands)
+void latStatsLineRx(void);                      // next LAT_PT_CMD starts here
+void latStatsLineEnd(void);                     // line handled: forget its tick
+void latStatsMark(uint32_t id, lat_point_t pt); // LAT_PT_ACK closes the trace
+
+// Direct sample: now - startTicks
+void latStatsRecord(lat_stage_t st, uint32_t startTicks);
+
+const LatHist_t *latStatsGet(lat_stage_t st);
+const char *latStatsStageName(lat_stage_t st);
+uint32_t latStatsAvgUs(const LatHist_t *h);
+void latStatsReset(void);
+
+#endif
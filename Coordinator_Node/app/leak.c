@@ -0,0 +1,251 @@
+#include "leak.h"
+#include "app_log.h"
+#include "app_state.h"
+#include "sensor_table.h"
+#include "valve_ctrl.h"
+
+#include <string.h>
+
+typedef struct {
+  uint32_t mean[24];     // Q4 typical flow per local hour
+  uint32_t dev[24];      // Q4 mean absolute deviation of the hour
+  uint8_t  days[24];     // hours learned, saturates at 255
+  uint32_t hourAbs;      // local hour being accumulated (localS / 3600)
+  uint32_t sum;          // ... its flow sum / sample count
+  uint16_t cnt;
+  bool     hourValid;    // hourAbs/sum/cnt in use
+  bool     taint;        // an alarm was up this hour: do not learn it
+  uint32_t lastS;        // uptime s of the last sample
+  uint32_t since[LEAK_KIND_COUNT];  // uptime s the condition started
+  uint16_t limit;        // deviation limit of the current hour
+  uint16_t minFlow;      // lowest flow in the min_flow window
+  uint8_t  cond;         // bit per leak_kind_t: condition holds
+  uint8_t  active;       // bit per leak_kind_t: alarm raised
+  uint8_t  pend;         // bit per leak_kind_t: @ALRM pending
+  bool     running;      // lastS valid
+  bool     used;
+} LeakSlot_t;
+
+static LeakSlot_t s_leak[LEAK_SENSORS];
+static bool       s_pending = false;
+static bool       s_lock = false;
+static uint32_t   s_devWindowS = LEAK_DEV_WINDOW_S;
+static uint32_t   s_minWindowS = LEAK_MIN_WINDOW_S;
+static bool       s_close = (LEAK_CLOSE_DEFAULT != 0);
+
+_Static_assert(LEAK_SENSORS < LEAK_NONE, "LEAK_SENSORS too large");
+_Static_assert(LEAK_KIND_COUNT <= 8u, "kind bits are 8 bits");
+
+static LeakSlot_t *slotOf(const Sensor_t *s)
+{
+  return (s && s->leak < LEAK_SENSORS) ? &s_leak[s->leak] : NULL;
+}
+
+void leakInit(void)
+{
+  memset(s_leak, 0, sizeof(s_leak));
+  s_pending = false;
+  s_lock = false;
+}
+
+static LeakSlot_t *allocSlot(Sensor_t *s)
+{
+  for (uint8_t k = 0; k < LEAK_SENSORS; k++) {
+    LeakSlot_t *l = &s_leak[k];
+    if (l->used) continue;
+    memset(l, 0, sizeof(*l));
+    l->used = true;
+    s->leak = k;
+    return l;
+  }
+  return NULL;
+}
+
+void leakRelease(Sensor_t *s)
+{
+  LeakSlot_t *l = slotOf(s);
+  if (l) l->used = false;
+  if (s) s->leak = LEAK_NONE;
+}
+
+// ===== BASELINE =====
+
+// Fold the finished hour's average into its hour-of-day EWMAs
+static void fold(LeakSlot_t *l)
+{
+  if (l->cnt < LEAK_HOUR_MIN_SAMPLES || l->taint) return;
+
+  uint8_t h = (uint8_t)(l->hourAbs % 24u);
+  int32_t avg = (int32_t)(((uint64_t)l->sum << 4) / l->cnt);
+
+  if (l->days[h] == 0) {
+    l->mean[h] = (uint32_t)avg;
+    l->dev[h] = 0;
+  } else {
+    int32_t d = avg - (int32_t)l->mean[h];
+    int32_t ad = (d < 0) ? -d : d;
+    l->mean[h] = (uint32_t)((int32_t)l->mean[h] + d / (1 << LEAK_LEARN_SHIFT));
+    l->dev[h] = (uint32_t)((int32_t)l->dev[h] + (ad - (int32_t)l->dev[h]) / (1 << LEAK_LEARN_SHIFT));
+  }
+  if (l->days[h] < 0xFFu) l->days[h]++;
+}
+
+// Accumulate the sample into its local hour; returns the hour of the
+// day, or -1 while the local time is unknown
+static int learn(LeakSlot_t *l, uint16_t flow)
+{
+  uint32_t localS;
+  if (!appLogLocalTime(&localS)) return -1;
+
+  uint32_t hourAbs = localS / 3600u;
+  if (!l->hourValid || hourAbs != l->hourAbs) {
+    if (l->hourValid) fold(l);
+    l->hourAbs = hourAbs;
+    l->sum = 0;
+    l->cnt = 0;
+    l->hourValid = true;
+    l->taint = (l->active != 0);
+  }
+  if (l->cnt < 0xFFFFu) {
+    l->sum += flow;
+    l->cnt++;
+  }
+  return (int)(hourAbs % 24u);
+}
+
+// ===== DETECTION =====
+
+static void track(LeakSlot_t *l, uint8_t kind, bool holds, uint32_t now, uint32_t window)
+{
+  uint8_t bit = (uint8_t)(1u << kind);
+
+  if (!holds) {
+    l->cond &= (uint8_t)~bit;
+    if (l->active & bit) {
+      l->active &= (uint8_t)~bit;
+      l->pend |= bit;
+      s_pending = true;
+    }
+    return;
+  }
+  if (!(l->cond & bit)) {
+    l->cond |= bit;
+    l->since[kind] = now;
+  }
+  if (!(l->active & bit) && (now - l->since[kind]) >= window) {
+    l->active |= bit;
+    l->pend |= bit;
+    l->taint = true;
+    s_pending = true;
+  }
+}
+
+void leakAdd(Sensor_t *s, uint16_t flow)
+{
+  if (!s) return;
+  LeakSlot_t *l = slotOf(s);
+  if (!l) l = allocSlot(s);
+  if (!l) return;
+
+  uint32_t now = appLogGetUptimeSec();
+  if (l->running && (now - l->lastS) > LEAK_MAX_GAP_S) l->cond = 0;
+  l->lastS = now;
+  l->running = true;
+
+  int h = learn(l, flow);
+
+  bool high = false;
+  if (h >= 0 && l->days[h] >= LEAK_LEARN_DAYS) {
+    uint32_t lim = ((l->mean[h] + LEAK_DEV_K * l->dev[h] + 8u) >> 4) + LEAK_DEV_MARGIN;
+    l->limit = (lim > 0xFFFFu) ? 0xFFFFu : (uint16_t)lim;
+    high = (flow > l->limit);
+  }
+  track(l, LEAK_KIND_DEVIATION, high, now, s_devWindowS);
+
+  bool flowing = (flow > LEAK_ZERO_FLOW);
+  if (flowing && (!(l->cond & (1u << LEAK_KIND_MIN_FLOW)) || flow < l->minFlow)) l->minFlow = flow;
+  track(l, LEAK_KIND_MIN_FLOW, flowing, now, s_minWindowS);
+}
+
+void leakProcess(void)
+{
+  if (!s_pending) return;
+  s_pending = false;
+
+  uint32_t now = appLogGetUptimeSec();
+  bool primaryRaised = false;
+  bool full = false;
+
+  // @ALRM uses the ALRM class, which drops new frames when full: what did
+  // not fit stays pending for the next tick
+  for (uint16_t i = 0; i < sensorTableCount() && !full; i++) {
+    Sensor_t *s = sensorTableAt(i);
+    LeakSlot_t *l = slotOf(s);
+    if (!l || l->pend == 0) continue;
+
+    for (uint8_t k = 0; k < LEAK_KIND_COUNT; k++) {
+      uint8_t bit = (uint8_t)(1u << k);
+      if (!(l->pend & bit)) continue;
+      bool raised = (l->active & bit) != 0;
+      if (raised && sensorTableIsPrimary(s)) primaryRaised = true;
+      uint16_t v = (k == LEAK_KIND_DEVIATION) ? l->limit : l->minFlow;
+      if (!appLogAlarm(s, (alrm_kind_t)k, raised, v, now - l->since[k])) {
+        full = true;
+        s_pending = true;
+        break;
+      }
+      l->pend &= (uint8_t)~bit;
+    }
+  }
+
+  // the lock itself is decided by AUTO control (leakValveLockEval)
+  if (primaryRaised) valveCtrlAutoControl();
+}
+
+bool leakValveLockEval(void)
+{
+  if (s_lock || !s_close || leakActiveCount() == 0) return s_lock;
+
+  const LeakSlot_t *l = slotOf(sensorTablePrimary());
+  if (!l || l->active == 0) return false;
+
+  s_lock = true;
+  appLogLog("LEAK", "valve_lock", "\"valve_open\":%s", valveCtrlIsOpen(VALVE_DEFAULT) ? "true" : "false");
+  return true;
+}
+
+void leakClear(void)
+{
+  for (uint8_t k = 0; k < LEAK_SENSORS; k++) {
+    LeakSlot_t *l = &s_leak[k];
+    if (!l->used) continue;
+    l->pend |= l->active;
+    l->active = 0;
+    l->cond = 0;
+    if (l->pend) s_pending = true;
+  }
+  s_lock = false;
+}
+
+bool leakValveLock(void) { return s_lock; }
+
+uint8_t leakActiveCount(void)
+{
+  uint8_t n = 0;
+  for (uint8_t k = 0; k < LEAK_SENSORS; k++) {
+    if (!s_leak[k].used) continue;
+    for (uint8_t a = s_leak[k].active; a; a &= (uint8_t)(a - 1u)) n++;
+  }
+  return n;
+}
+
+void leakConfig(uint32_t devWindowS, uint32_t minWindowS, bool closeValve)
+{
+  s_devWindowS = devWindowS;
+  s_minWindowS = minWindowS;
+  s_close = closeValve;
+}
+
+uint32_t leakDevWindowS(void) { return s_devWindowS; }
+uint32_t leakMinWindowS(void) { return s_minWindowS; }
+bool leakCloseValve(void) { return s_close; }
@@ -0,0 +1,65 @@
+#ifndef LEAK_H
+#define LEAK_H
+
+#include "app_config.h"
+#include "app_log.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+struct Sensor_s;
+
+// ===== LEAK DETECTION =====
+// Runs on the coordinator so detection survives a gateway outage. Input is
+// the filtered flow (flow_filter.h) of each report; integer maths, O(1)
+// per report. Per sensor (first LEAK_SENSORS sensors to report flow):
+// - baseline: for each hour of the local day a typical flow and its mean
+//   absolute deviation (Q4 EWMAs, alpha 1/2^LEAK_LEARN_SHIFT), folded in
+//   once per hour from that hour's average. Needs the local time
+//   (time_set op); hours with an alarm raised are not learned.
+// - "deviation": flow above mean + LEAK_DEV_K x dev + LEAK_DEV_MARGIN of
+//   the current hour (once it has LEAK_LEARN_DAYS days) for dev_window_s.
+// - "min_flow": flow never back at or below LEAK_ZERO_FLOW for
+//   min_window_s (a running toilet, a dripping pipe); no baseline needed.
+// A report gap over LEAK_MAX_GAP_S restarts both windows.
+//
+// Alarms are raised and cleared with @ALRM (app_log.h) from leakProcess().
+// With close enabled, an alarm on the primary sensor closes the valve in
+// AUTO mode and keeps it closed (leakValveLock()) until leak_clear. The
+// lock is decided by valveCtrlAutoControl() through leakValveLockEval(),
+// so an alarm raised in MANUAL mode still locks once AUTO is entered.
+
+#define LEAK_NONE  0xFFu   // Sensor_t.leak: no leak slot
+
+// leak kinds are the first @ALRM kinds
+typedef enum {
+  LEAK_KIND_DEVIATION = ALRM_DEVIATION,
+  LEAK_KIND_MIN_FLOW = ALRM_MIN_FLOW,
+  LEAK_KIND_COUNT
+} leak_kind_t;
+
+void leakInit(void);
+
+// Receive path: feed one (filtered) flow sample; takes a free slot on
+// first use. Alarm changes are only flagged here.
+void leakAdd(struct Sensor_s *s, uint16_t flow);
+void leakRelease(struct Sensor_s *s);
+
+// Main tick: emit pending @ALRM frames, apply the valve lock
+void leakProcess(void);
+
+// leak_clear: drop all alarms and restart the windows, release the lock
+void leakClear(void);
+
+bool leakValveLock(void);
+// AUTO control only: latch the lock if close is enabled and the current
+// primary sensor has an alarm raised; returns the lock
+bool leakValveLockEval(void);
+uint8_t leakActiveCount(void);      // alarms currently raised
+
+void leakConfig(uint32_t devWindowS, uint32_t minWindowS, bool closeValve);
+uint32_t leakDevWindowS(void);
+uint32_t leakMinWindowS(void);
+bool leakCloseValve(void);
+
+#endif
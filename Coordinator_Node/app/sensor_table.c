@@ -0,0 +1,213 @@
+#include "sensor_table.h"
+#include "app_utils.h"
+
+#include <string.h>
+
+#define SLOT_MASK   (SENSOR_TABLE_SLOTS - 1u)
+#define KEY_EMPTY   EMBER_NULL_NODE_ID
+#define NO_PRIMARY  0xFFFFu
+
+static Sensor_t s_sensors[SENSOR_TABLE_MAX];
+static uint16_t s_count = 0;
+static uint16_t s_primary = NO_PRIMARY;
+
+static uint16_t s_key[SENSOR_TABLE_SLOTS];   // node ID, KEY_EMPTY = free
+static uint16_t s_idx[SENSOR_TABLE_SLOTS];   // index into s_sensors
+
+// Fibonacci hashing: top bits of nodeId * 2^16/phi
+static uint16_t homeSlot(uint16_t nodeId)
+{
+  return (uint16_t)((uint16_t)(nodeId * 40503u) >> (16u - SENSOR_TABLE_SLOT_BITS));
+}
+
+static int findSlot(uint16_t nodeId)
+{
+  if (nodeId == KEY_EMPTY) return -1;
+  uint16_t h = homeSlot(nodeId);
+  for (uint16_t probes = 0; probes < SENSOR_TABLE_SLOTS; probes++) {
+    if (s_key[h] == nodeId) return h;
+    if (s_key[h] == KEY_EMPTY) return -1;
+    h = (uint16_t)((h + 1u) & SLOT_MASK);
+  }
+  return -1;
+}
+
+static void slotInsert(uint16_t nodeId, uint16_t index)
+{
+  uint16_t h = homeSlot(nodeId);
+  while (s_key[h] != KEY_EMPTY) h = (uint16_t)((h + 1u) & SLOT_MASK);
+  s_key[h] = nodeId;
+  s_idx[h] = index;
+}
+
+// Backward-shift delete keeps probe chains intact without tombstones
+static void slotDelete(uint16_t i)
+{
+  uint16_t j = i;
+  for (;;) {
+    j = (uint16_t)((j + 1u) & SLOT_MASK);
+    if (s_key[j] == KEY_EMPTY) break;
+
+    uint16_t home = homeSlot(s_key[j]);
+    // entry at j may move to i only if its home is not in (i, j]
+    bool stays = (i <= j) ? (home > i && home <= j) : (home > i || home <= j);
+    if (!stays) {
+      s_key[i] = s_key[j];
+      s_idx[i] = s_idx[j];
+      i = j;
+    }
+  }
+  s_key[i] = KEY_EMPTY;
+}
+
+// Drop an entry's key and everything it holds in the other modules; the
+// entry stays in the array with nodeId KEY_EMPTY until allocEntry() reuses it
+static void releaseEntry(uint16_t index)
+{
+  Sensor_t *s = &s_sensors[index];
+  int slot = findSlot(s->nodeId);
+  if (slot >= 0) slotDelete((uint16_t)slot);
+  if (index == s_primary) s_primary = NO_PRIMARY;
+  historyRelease(s);
+  totalizerRelease(s);
+  leakRelease(s);
+  staleRelease(s);
+  s->nodeId = KEY_EMPTY;
+  s->flags &= (uint8_t)~SENSOR_F_EUI;
+}
+
+static void rekey(Sensor_t *s, uint16_t nodeId)
+{
+  int slot = findSlot(s->nodeId);
+  uint16_t index = (uint16_t)(s - s_sensors);
+  if (slot >= 0) slotDelete((uint16_t)slot);
+
+  // the new ID may still be held by a stale entry (address reuse): that
+  // device is gone, release it like an eviction
+  int other = findSlot(nodeId);
+  if (other >= 0) releaseEntry(s_idx[other]);
+
+  s->nodeId = nodeId;
+  slotInsert(nodeId, index);
+  if (s_primary == NO_PRIMARY) s_primary = index;
+}
+
+static Sensor_t *findByEui(const EmberEUI64 eui)
+{
+  for (uint16_t i = 0; i < s_count; i++) {
+    Sensor_t *s = &s_sensors[i];
+    if ((s->flags & SENSOR_F_EUI) && memcmp(s->eui, eui, EUI64_SIZE) == 0) return s;
+  }
+  return NULL;
+}
+
+static Sensor_t *allocEntry(void)
+{
+  if (s_count < SENSOR_TABLE_MAX) {
+    return &s_sensors[s_count++];
+  }
+
+  // full: reuse an entry orphaned by node ID reuse (already released),
+  // else evict the sensor not heard from for the longest time
+  uint32_t now = msTick();
+  uint16_t victim = 0;
+  uint32_t oldest = 0;
+  for (uint16_t i = 0; i < s_count; i++) {
+    if (s_sensors[i].nodeId == KEY_EMPTY) return &s_sensors[i];
+    uint32_t age = now - s_sensors[i].lastSeenMs;
+    if (age >= oldest) { oldest = age; victim = i; }
+  }
+
+  releaseEntry(victim);
+  return &s_sensors[victim];
+}
+
+void sensorTableInit(void)
+{
+  memset(s_sensors, 0, sizeof(s_sensors));
+  for (uint16_t i = 0; i < SENSOR_TABLE_SLOTS; i++) s_key[i] = KEY_EMPTY;
+  s_count = 0;
+  s_primary = NO_PRIMARY;
+}
+
+Sensor_t *sensorTableFind(EmberNodeId nodeId)
+{
+  int slot = findSlot((uint16_t)nodeId);
+  return (slot >= 0) ? &s_sensors[s_idx[slot]] : NULL;
+}
+
+Sensor_t *sensorTableTouch(EmberNodeId nodeId)
+{
+  if (nodeId == EMBER_NULL_NODE_ID) return NULL;
+
+  Sensor_t *s = sensorTableFind(nodeId);
+  if (s) return s;
+
+  // unknown node ID: same device after a rejoin?
+  EmberEUI64 eui;
+  bool haveEui = (emberLookupEui64ByNodeId(nodeId, eui) == EMBER_SUCCESS);
+  if (haveEui) {
+    s = findByEui(eui);
+    if (s) {
+      rekey(s, (uint16_t)nodeId);
+      return s;
+    }
+  }
+
+  s = allocEntry();
+  memset(s, 0, sizeof(*s));
+  s->nodeId = (uint16_t)nodeId;
+  s->hist = HIST_NONE;
+  s->leak = LEAK_NONE;
+  s->wNext = STALE_NONE;
+  s->wPrev = STALE_NONE;
+  s->lastSeenMs = msTick();
+  if (haveEui) {
+    memcpy(s->eui, eui, EUI64_SIZE);
+    s->flags |= SENSOR_F_EUI;
+  }
+  slotInsert((uint16_t)nodeId, (uint16_t)(s - s_sensors));
+
+  if (s_primary == NO_PRIMARY) s_primary = (uint16_t)(s - s_sensors);
+  return s;
+}
+
+void sensorTableNoteJoin(EmberNodeId nodeId, const EmberEUI64 eui)
+{
+  if (nodeId == EMBER_NULL_NODE_ID) return;
+
+  Sensor_t *s = findByEui(eui);
+  if (s) {
+    if (s->nodeId != (uint16_t)nodeId) rekey(s, (uint16_t)nodeId);
+    return;
+  }
+
+  // first time we learn the EUI64 of a sensor already reporting
+  s = sensorTableFind(nodeId);
+  if (s) {
+    memcpy(s->eui, eui, EUI64_SIZE);
+    s->flags |= SENSOR_F_EUI;
+  }
+}
+
+uint16_t sensorTableCount(void) { return s_count; }
+
+Sensor_t *sensorTableAt(uint16_t index)
+{
+  return (index < s_count) ? &s_sensors[index] : NULL;
+}
+
+uint16_t sensorTableIndex(const Sensor_t *s)
+{
+  return (uint16_t)(s - s_sensors);
+}
+
+bool sensorTableIsPrimary(const Sensor_t *s)
+{
+  return s && s_primary != NO_PRIMARY && s == &s_sensors[s_primary];
+}
+
+Sensor_t *sensorTablePrimary(void)
+{
+  return (s_primary != NO_PRIMARY) ? &s_sensors[s_primary] : NULL;
+}
@@ -0,0 +1,88 @@
+#ifndef SENSOR_TABLE_H
+#define SENSOR_TABLE_H
+
+#include "app/framework/include/af.h"
+#include "attr_registry.h"
+#include "history.h"
+#include "flow_filter.h"
+#include "totalizer.h"
+#include "leak.h"
+#include "stale.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ===== SENSOR TABLE =====
+// Fixed-capacity table of reporting sensors; one value slot per
+// measurement in ATTR_REGISTRY (attr_registry.h).
+// - Lookup by 16-bit node ID: linear-probing hash over a compact key array
+//   (2 bytes per slot), so a probe sequence stays within one or two cache
+//   lines; entries themselves are a dense array for iteration.
+// - Identity across rejoins is the EUI64: when a known EUI64 shows up with
+//   a new node ID the entry is re-keyed, history is kept.
+// - When full, the sensor not heard from for the longest time is evicted.
+// - The primary sensor (first one seen) is mirrored through the registry's
+//   onPrimary hooks into g_flow / g_batteryPercent (AUTO control, LCD).
+
+// RAM: SENSOR_TABLE_MAX * sizeof(Sensor_t) (112 B) = 28 KiB for 256
+// sensors, plus 4 B per hash slot (2 KiB). Indices are 16-bit.
+#define SENSOR_TABLE_MAX        256u
+#define SENSOR_TABLE_SLOT_BITS  9u      // 512 slots, load factor <= 0.5
+#define SENSOR_TABLE_SLOTS      (1u << SENSOR_TABLE_SLOT_BITS)
+
+#define SENSOR_F_EUI   0x01u   // eui is valid
+#define SENSOR_F_RAISE 0x02u   // went stale, @ALRM pending
+#define SENSOR_F_SEQ   0x04u   // lastSeq is valid
+#define SENSOR_F_DIRTY 0x08u   // changed since the last telemetry pass
+#define SENSOR_F_STALE 0x10u   // last-seen deadline expired (stale.h)
+#define SENSOR_F_WHEEL 0x20u   // linked into the stale timer wheel
+#define SENSOR_F_FRESH 0x40u   // recovered from stale, @ALRM pending
+
+// ZCL sequence statistics of the sensor's reports (telemetry_rx.c)
+typedef struct {
+  uint32_t rx;      // reports accepted
+  uint32_t lost;    // sequence numbers skipped (minus late arrivals)
+  uint32_t dup;     // same sequence number again, dropped
+  uint32_t reord;   // arrived late (behind the last one), dropped
+} SeqStats_t;
+
+typedef struct Sensor_s {
+  EmberEUI64 eui;          // little-endian, as used by the stack
+  uint32_t   lastSeenMs;
+  uint32_t   staleDue;     // stale wheel tick of the deadline
+  SeqStats_t seq;
+  FlowFilter_t filt;       // flow -> flowF
+  Totalizer_t  tot;        // consumed volume
+  int32_t    meas[MEAS_COUNT];   // latest value per ATTR_REGISTRY entry
+  uint16_t   measMask;           // bit per meas_id_t: value has been reported
+  uint16_t   nodeId;
+  uint16_t   flowF;        // filtered flow (valid with MEAS_FLOW in measMask)
+  uint8_t    lqi;          // last-hop LQI of the last report
+  uint8_t    lastSeq;      // ZCL sequence number of the last report
+  uint8_t    flags;        // SENSOR_F_*
+  uint8_t    hist;         // history slot or HIST_NONE (history.h)
+  uint8_t    leak;         // leak slot or LEAK_NONE (leak.h)
+  uint16_t   wNext;        // stale wheel links, table indices (stale.h)
+  uint16_t   wPrev;
+} Sensor_t;
+
+_Static_assert(MEAS_COUNT <= 16, "measMask is 16 bits");
+
+void sensorTableInit(void);
+
+// Find the sensor for nodeId, adding it if unknown (never returns NULL
+// for a valid node ID; may evict the stalest entry)
+Sensor_t *sensorTableTouch(EmberNodeId nodeId);
+Sensor_t *sensorTableFind(EmberNodeId nodeId);
+
+// Trust Center join/rejoin: bind nodeId <-> eui, re-keying a known sensor
+void sensorTableNoteJoin(EmberNodeId nodeId, const EmberEUI64 eui);
+
+uint16_t sensorTableCount(void);
+// 0 .. count-1; nodeId == EMBER_NULL_NODE_ID marks an unused entry
+Sensor_t *sensorTableAt(uint16_t index);
+uint16_t sensorTableIndex(const Sensor_t *s);   // inverse of sensorTableAt()
+bool sensorTableIsPrimary(const Sensor_t *s);
+Sensor_t *sensorTablePrimary(void);   // NULL before the first report
+
+#endif
@@ -0,0 +1,189 @@
+#include "stale.h"
+#include "app_log.h"
+#include "app_state.h"
+#include "app_utils.h"
+#include "sensor_table.h"
+#include "valve_ctrl.h"
+
+#include <string.h>
+
+#define WHEEL_MASK  (STALE_WHEEL_SLOTS - 1u)
+
+static uint16_t s_head[STALE_WHEEL_SLOTS];   // sensor index, STALE_NONE = empty
+static uint32_t s_tick = 0;                  // wheel ticks processed
+static uint32_t s_tickMs = 0;                // msTick() of s_tick
+static uint16_t s_stale = 0;
+static bool     s_pending = false;           // @ALRM raises / recoveries to report
+static uint32_t s_timeoutS = STALE_TIMEOUT_S_DEFAULT;
+static stale_action_t s_action = (stale_action_t)STALE_ACTION_DEFAULT;
+
+_Static_assert((STALE_WHEEL_SLOTS & WHEEL_MASK) == 0u, "STALE_WHEEL_SLOTS must be a power of 2");
+_Static_assert(SENSOR_TABLE_MAX < STALE_NONE, "wheel links are 16-bit table indices");
+
+// Wheel tick at which ms from now have passed (never early)
+static uint32_t dueIn(uint32_t ms)
+{
+  uint32_t t = ((msTick() - s_tickMs) + ms + STALE_TICK_MS - 1u) / STALE_TICK_MS;
+  return s_tick + (t ? t : 1u);
+}
+
+// ===== WHEEL =====
+
+static void wheelLink(Sensor_t *s, uint32_t due)
+{
+  uint16_t idx = sensorTableIndex(s);
+  uint32_t slot = due & WHEEL_MASK;
+
+  s->staleDue = due;
+  s->wPrev = STALE_NONE;
+  s->wNext = s_head[slot];
+  if (s->wNext != STALE_NONE) sensorTableAt(s->wNext)->wPrev = idx;
+  s_head[slot] = idx;
+  s->flags |= SENSOR_F_WHEEL;
+}
+
+static void wheelUnlink(Sensor_t *s)
+{
+  if (!(s->flags & SENSOR_F_WHEEL)) return;
+  uint32_t slot = s->staleDue & WHEEL_MASK;
+
+  if (s->wPrev != STALE_NONE) sensorTableAt(s->wPrev)->wNext = s->wNext;
+  else s_head[slot] = s->wNext;
+  if (s->wNext != STALE_NONE) sensorTableAt(s->wNext)->wPrev = s->wPrev;
+  s->flags &= (uint8_t)~SENSOR_F_WHEEL;
+}
+
+static void expire(Sensor_t *s)
+{
+  if (s->nodeId == EMBER_NULL_NODE_ID || (s->flags & SENSOR_F_STALE)) return;
+
+  s->flags |= SENSOR_F_STALE | SENSOR_F_RAISE;
+  s_stale++;
+  s_pending = true;
+
+  if (sensorTableIsPrimary(s) && s_action != STALE_ACT_NONE) {
+    appLogLog("STALE", "failsafe", "\"sensor\":\"0x%04X\",\"action\":\"%s\",\"mode\":\"%s\"",
+              s->nodeId, staleActionStr(), (g_mode == MODE_AUTO) ? "auto" : "manual");
+    valveCtrlAutoControl();
+  }
+}
+
+static void processSlot(uint32_t slot)
+{
+  uint16_t idx = s_head[slot];
+  while (idx != STALE_NONE) {
+    Sensor_t *s = sensorTableAt(idx);
+    idx = s->wNext;
+    // later turns of the wheel stay in the slot
+    if ((int32_t)(s->staleDue - s_tick) > 0) continue;
+    wheelUnlink(s);
+    expire(s);
+  }
+}
+
+void staleInit(void)
+{
+  for (uint32_t i = 0; i < STALE_WHEEL_SLOTS; i++) s_head[i] = STALE_NONE;
+  s_tick = 0;
+  s_tickMs = msTick();
+  s_stale = 0;
+  s_pending = false;
+}
+
+void staleTouch(Sensor_t *s)
+{
+  if (!s) return;
+  wheelUnlink(s);
+  wheelLink(s, dueIn(s_timeoutS * 1000u));
+
+  if (s->flags & SENSOR_F_STALE) {
+    s->flags &= (uint8_t)~SENSOR_F_STALE;
+    s->flags |= SENSOR_F_FRESH;
+    if (s_stale) s_stale--;
+    s_pending = true;
+  }
+}
+
+void staleRelease(Sensor_t *s)
+{
+  if (!s) return;
+  wheelUnlink(s);
+  if ((s->flags & SENSOR_F_STALE) && s_stale) s_stale--;
+  s->flags &= (uint8_t)~(SENSOR_F_STALE | SENSOR_F_FRESH | SENSOR_F_RAISE);
+}
+
+void staleTick(void)
+{
+  uint32_t behind = (msTick() - s_tickMs) / STALE_TICK_MS;
+  if (behind > STALE_WHEEL_SLOTS) {
+    // every slot gets visited once below; skip whole turns
+    uint32_t skip = behind - STALE_WHEEL_SLOTS;
+    s_tick += skip;
+    s_tickMs += skip * STALE_TICK_MS;
+    behind = STALE_WHEEL_SLOTS;
+  }
+  while (behind--) {
+    s_tick++;
+    s_tickMs += STALE_TICK_MS;
+    processSlot(s_tick & WHEEL_MASK);
+  }
+
+  // @ALRM goes out on the ALRM class, which drops new frames when full: a
+  // burst of expiries is emitted as room allows, the rest next tick
+  if (!s_pending) return;
+  s_pending = false;
+  for (uint16_t i = 0; i < sensorTableCount(); i++) {
+    Sensor_t *s = sensorTableAt(i);
+    if (s->flags & SENSOR_F_RAISE) {
+      if (!appLogAlarm(s, ALRM_STALE, true, s_timeoutS, (msTick() - s->lastSeenMs) / 1000u)) {
+        s_pending = true;
+        return;
+      }
+      s->flags &= (uint8_t)~SENSOR_F_RAISE;
+    }
+    if (s->flags & SENSOR_F_FRESH) {
+      if (!appLogAlarm(s, ALRM_STALE, false, s_timeoutS, 0)) {
+        s_pending = true;
+        return;
+      }
+      s->flags &= (uint8_t)~SENSOR_F_FRESH;
+    }
+  }
+}
+
+bool staleFailSafe(void)
+{
+  const Sensor_t *p = sensorTablePrimary();
+  return s_action != STALE_ACT_NONE && p && (p->flags & SENSOR_F_STALE);
+}
+
+bool staleSafeOpen(void) { return s_action == STALE_ACT_OPEN; }
+uint16_t staleCount(void) { return s_stale; }
+
+void staleConfig(uint32_t timeoutS, stale_action_t action)
+{
+  s_timeoutS = timeoutS;
+  s_action = action;
+
+  uint32_t now = msTick();
+  for (uint16_t i = 0; i < sensorTableCount(); i++) {
+    Sensor_t *s = sensorTableAt(i);
+    if (!(s->flags & SENSOR_F_WHEEL)) continue;
+    uint32_t age = now - s->lastSeenMs;
+    uint32_t left = (age < timeoutS * 1000u) ? timeoutS * 1000u - age : 0u;
+    wheelUnlink(s);
+    wheelLink(s, dueIn(left));
+  }
+}
+
+uint32_t staleTimeoutS(void) { return s_timeoutS; }
+stale_action_t staleAction(void) { return s_action; }
+
+const char *staleActionStr(void)
+{
+  switch (s_action) {
+    case STALE_ACT_CLOSE: return "close";
+    case STALE_ACT_OPEN:  return "open";
+    default: return "none";
+  }
+}
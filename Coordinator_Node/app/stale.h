@@ -0,0 +1,51 @@
+#ifndef STALE_H
+#define STALE_H
+
+#include "app_config.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+struct Sensor_s;
+
+// ===== STALE SENSOR DETECTION =====
+// Every sensor has a last-seen deadline (now + timeout_s, re-armed by each
+// accepted report). Deadlines live in a hashed timer wheel of
+// STALE_WHEEL_SLOTS slots of STALE_TICK_MS: staleTick() only visits the
+// slot(s) of the ticks that passed, and an entry whose deadline is one or
+// more wheel turns away stays put until its turn comes. Per-report and
+// per-tick cost is O(1) (amortised), independent of the sensor count.
+// Entries are intrusive (Sensor_t.wNext / wPrev, table indices).
+//
+// On expiry: @ALRM kind "stale" (raised), cleared by the next report. Both
+// are flagged on the sensor and sent by staleTick() as the ACK TX ring has
+// room, so a burst of expiries is spread over ticks instead of dropped.
+// If the primary sensor goes stale in AUTO mode and action is close/open,
+// valveCtrlAutoControl() drives the valve to that safe state instead of
+// acting on the last flow, until the primary sensor reports again.
+
+#define STALE_NONE  0xFFFFu // Sensor_t.wNext / wPrev: end of list
+
+typedef enum { STALE_ACT_NONE = 0, STALE_ACT_CLOSE, STALE_ACT_OPEN } stale_action_t;
+
+void staleInit(void);
+
+// Receive path: (re-)arm the deadline of s; a stale sensor recovers
+void staleTouch(struct Sensor_s *s);
+void staleRelease(struct Sensor_s *s);   // sensor evicted
+
+// Main tick: expire deadlines, emit pending @ALRM
+void staleTick(void);
+
+// AUTO fail-safe: primary sensor stale and action != none
+bool staleFailSafe(void);
+bool staleSafeOpen(void);                // safe state: true = open
+uint16_t staleCount(void);               // sensors currently stale
+
+// Re-arms every sensor from its last report
+void staleConfig(uint32_t timeoutS, stale_action_t action);
+uint32_t staleTimeoutS(void);
+stale_action_t staleAction(void);
+const char *staleActionStr(void);
+
+#endif
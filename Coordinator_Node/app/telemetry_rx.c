@@ -2,81 +2,226 @@
 #include "app_state.h"
 #include "app_utils.h"
 #include "app_log.h"
+#include "telemetry_rx.h"
+#include "lat_stats.h"
 #include "valve_ctrl.h"
 #include "app/framework/include/af.h"
 #include "app_zcl_fallback.h"
-#include "lcd_ui.h"
-#include "app/framework/include/af.h"
+#include "attr_registry.h"
+#include "sensor_table.h"
+#include "history.h"
+#include "zcl_report.h"
 
 #include <stdint.h>
 #include <stdbool.h>
 
+// ===== ATTRIBUTE DISPATCH =====
+// Records are matched against ATTR_REGISTRY (attr_registry.h); everything
+// else in a report is stepped over by the decoder. The sensor entry is only
+// touched once a known attribute shows up.
+typedef struct {
+  uint16_t  source;
+  Sensor_t *sensor;
+  uint16_t  changed;   // bit per meas_id_t
+} ReportCtx_t;
+
+// ===== DEFERRED PROCESSING =====
+static bool     s_rxPending = false;
+static uint32_t s_rxPendingSince = 0;
+static uint16_t s_primaryChanged = 0;   // meas bits changed on the primary sensor
+
+static SeqStats_t s_seqTotals;
+
+const SeqStats_t *telemetryRxSeqTotals(void) { return &s_seqTotals; }
+
+// false = duplicate or late report, do not apply (see telemetry_rx.h)
+static bool acceptSeq(Sensor_t *s, uint8_t seq)
+{
+  if (!(s->flags & SENSOR_F_SEQ)) return true;
+
+  uint8_t d = (uint8_t)(seq - s->lastSeq);
+  if (d == 0) {
+    s->seq.dup++;
+    s_seqTotals.dup++;
+    return false;
+  }
+  if (d < 0x80u) {
+    s->seq.lost += (uint32_t)(d - 1u);
+    s_seqTotals.lost += (uint32_t)(d - 1u);
+    return true;
+  }
+  if ((uint8_t)(s->lastSeq - seq) <= SEQ_REORDER_WINDOW) {
+    s->seq.reord++;
+    s_seqTotals.reord++;
+    // the gap it left was counted as lost; a sensor with none to take back
+    // (first report after a resync) must not lower the totals either
+    if (s->seq.lost) {
+      s->seq.lost--;
+      if (s_seqTotals.lost) s_seqTotals.lost--;
+    }
+    return false;
+  }
+  return true;   // far behind: counter restarted
+}
+
+static void onReportAttr(void *ctx, const ZclAttr_t *a)
+{
+  ReportCtx_t *rc = (ReportCtx_t *)ctx;
+  int id = attrRegistryFind(a->cluster, a->attrId);
+  if (id < 0) return;
+
+  const AttrDef_t *def = attrRegistryGet((uint8_t)id);
+  int32_t v;
+  if (def->type != a->type || !def->decode(a, &v)) return;
+
+  if (rc->sensor == NULL) {
+    rc->sensor = sensorTableTouch(rc->source);
+    if (rc->sensor == NULL) return;
+  }
+
+  Sensor_t *s = rc->sensor;
+  uint16_t bit = (uint16_t)(1u << id);
+
+  // every report, changed or not
+  if (id == MEAS_FLOW) {
+    historyAdd(s, (uint16_t)v);
+    totalizerAdd(s, (uint16_t)v);
+    uint16_t f = flowFilterUpdate(&s->filt, (uint16_t)v);
+    leakAdd(s, f);
+    if (f != s->flowF || !(s->measMask & bit)) rc->changed |= bit;
+    s->flowF = f;
+  }
+
+  if ((s->measMask & bit) && s->meas[id] == v) return;
+  s->meas[id] = v;
+  s->measMask |= bit;
+  rc->changed |= bit;
+}
+
+// OnOff attribute of a valve report
+typedef struct {
+  bool found;
+  bool on;
+} OnOffCtx_t;
+
+static void onOnOffAttr(void *ctx, const ZclAttr_t *a)
+{
+  OnOffCtx_t *oc = (OnOffCtx_t *)ctx;
+  uint32_t v;
+  if (a->attrId != ZCL_ON_OFF_ATTRIBUTE_ID || !zclAttrU32(a, &v)) return;
+  oc->found = true;
+  oc->on = (v != 0u);
+}
+
 bool emberAfPreCommandReceivedCallback(EmberAfClusterCommand *cmd)
 {
   if (cmd == NULL || cmd->apsFrame == NULL) return false;
 
-  // 1) Telemetry reports (Flow + Battery)
+  // 1) Telemetry reports (any cluster in ATTR_REGISTRY)
   if (cmd->commandId == ZCL_REPORT_ATTRIBUTES_COMMAND_ID) {
+    uint32_t t0 = latStatsNow();
     EmberAfClusterId clusterId = cmd->apsFrame->clusterId;
 
+    if (cmd->bufLen < cmd->payloadStartIndex) return false;
+
     const uint8_t *p = cmd->buffer + cmd->payloadStartIndex;
     uint16_t len = (uint16_t)(cmd->bufLen - cmd->payloadStartIndex);
 
-    bool updated = false;
-    uint16_t i = 0;
-
-    while (i + 3 <= len) {
-      uint16_t attrId = u16le(&p[i]);
-      uint8_t type = p[i + 2];
-      i += 3;
-
-      if (clusterId == ZCL_FLOW_MEASUREMENT_CLUSTER_ID
-          && attrId == 0x0000
-          && type == ZCL_INT16U_ATTRIBUTE_TYPE) {
+    // Valve state: OnOff reports of a valve node go to valve_ctrl, not
+    // to the sensor table
+    uint8_t valve;
+    if (clusterId == ZCL_ON_OFF_CLUSTER_ID && valveCtrlFindByNodeId(cmd->source, &valve)) {
+      OnOffCtx_t oc = { false, false };
+      if (zclReportDecode(clusterId, p, len, onOnOffAttr, &oc) != ZCL_REPORT_OK) {
+        appLogLog("ZB", "report_malformed", "\"src\":\"0x%04X\",\"cluster\":\"0x0006\"", cmd->source);
+      }
+      if (oc.found) valveCtrlReport(valve, cmd->seqNum, oc.on);
+      latStatsRecord(LAT_ST_RX_CB, t0);
+      return false;
+    }
 
-        if (i + 2 > len) break;
-        uint16_t v = u16le(&p[i]);
-        i += 2;
+    // Duplicates / late reports are counted and dropped before decoding
+    Sensor_t *known = sensorTableFind(cmd->source);
+    if (known && !acceptSeq(known, cmd->seqNum)) {
+      latStatsRecord(LAT_ST_RX_CB, t0);
+      return false;
+    }
 
-        if (g_flow != v) { 
-          g_flow = v; 
-          updated = true;
-          lcd_ui_set_flow(v);  // Update LCD
-        }
-      }
-      else if (clusterId == ZCL_POWER_CONFIGURATION_CLUSTER_ID
-               && attrId == 0x0021
-               && type == ZCL_INT8U_ATTRIBUTE_TYPE) {
-
-        if (i + 1 > len) break;
-        uint8_t half = p[i];
-        i += 1;
-
-        uint8_t percent = (uint8_t)(half / 2u);
-        if (g_batteryPercent != percent) { 
-          g_batteryPercent = percent; 
-          updated = true;
-          lcd_ui_set_battery(percent);  // Update LCD
-        }
-      } else {
-        break;
-      }
+    ReportCtx_t rc = { cmd->source, known, 0 };
+    zcl_report_status_t st = zclReportDecode(clusterId, p, len, onReportAttr, &rc);
+    if (st != ZCL_REPORT_OK) {
+      appLogLog("ZB", "report_malformed", "\"src\":\"0x%04X\",\"cluster\":\"0x%04X\",\"err\":%u",
+                cmd->source, (unsigned)clusterId, (unsigned)st);
     }
 
-    if (updated) {
-      //lcdUiShowMsg("RX", "DATA ARRIVED");
-      valveCtrlAutoControl();
-      appLogData();
+    Sensor_t *sensor = rc.sensor;
+    if (sensor == NULL) return false;
+
+    sensor->lastSeenMs = msTick();
+    staleTouch(sensor);
+    sensor->lastSeq = cmd->seqNum;
+    sensor->flags |= SENSOR_F_SEQ;
+    sensor->seq.rx++;
+    s_seqTotals.rx++;
+    (void)emberGetLastHopLqi(&sensor->lqi);
 
+    if (rc.changed != 0) {
+      sensor->flags |= SENSOR_F_DIRTY;
+      if (sensorTableIsPrimary(sensor)) s_primaryChanged |= rc.changed;
+      if (!s_rxPending) {
+        s_rxPending = true;
+        s_rxPendingSince = msTick();
+      }
     }
+    latStatsRecord(LAT_ST_RX_CB, t0);
     return false;
   }
 
   // 2) Debug: ZCL Default Response from valve
   if (cmd->apsFrame->clusterId == ZCL_ON_OFF_CLUSTER_ID && cmd->commandId == 0x0B) {
-    emberAfCorePrintln("@LOG {\"event\":\"zcl_default_rsp\",\"cluster\":\"0x0006\",\"src\":\"0x%04X\"}",
-                       cmd->source);
+    appLogLog("ZB", "zcl_default_rsp", "\"cluster\":\"0x0006\",\"src\":\"0x%04X\"",
+              cmd->source);
   }
 
   return false;
 }
+
+void telemetryRxProcess(void)
+{
+  if (!s_rxPending || (msTick() - s_rxPendingSince) < TELEMETRY_COALESCE_MS) return;
+
+  uint32_t t0 = latStatsNow();
+  s_rxPending = false;
+
+  bool primaryChanged = false;
+  for (uint16_t i = 0; i < sensorTableCount(); i++) {
+    Sensor_t *s = sensorTableAt(i);
+    if (!(s->flags & SENSOR_F_DIRTY)) continue;
+    s->flags &= (uint8_t)~SENSOR_F_DIRTY;
+    //lcdUiShowMsg("RX", "DATA ARRIVED");
+
+    // The primary sensor drives app state (g_flow / g_batteryPercent, LCD).
+    // Its readings then go out once, in the primary @DATA; a per-sensor
+    // frame is only added for measurements that one does not carry.
+    if (sensorTableIsPrimary(s) && s_primaryChanged != 0) {
+      uint16_t own = 0;
+      for (uint8_t id = 0; id < MEAS_COUNT; id++) {
+        const AttrDef_t *def = attrRegistryGet(id);
+        if (!def->onPrimary) continue;
+        own |= (uint16_t)(1u << id);
+        if (s_primaryChanged & (1u << id)) def->onPrimary(s->meas[id]);
+      }
+      if (s_primaryChanged & (1u << MEAS_FLOW)) g_flowFiltered = s->flowF;
+      primaryChanged = true;
+      if ((s_primaryChanged & ~own) == 0) continue;
+    }
+    appLogSensorData(s);
+  }
+  s_primaryChanged = 0;
+
+  if (primaryChanged) {
+    valveCtrlAutoControl();
+    appLogData();
+  }
+  latStatsRecord(LAT_ST_RX_PASS, t0);
+}
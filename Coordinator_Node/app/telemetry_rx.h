@@ -0,0 +1,33 @@
+#ifndef TELEMETRY_RX_H
+#define TELEMETRY_RX_H
+
+#include "sensor_table.h"
+
+// ===== TELEMETRY RECEIVE =====
+// emberAfPreCommandReceivedCallback() only stores decoded values in the
+// sensor table and marks them dirty; control and output run here, once
+// per TELEMETRY_COALESCE_MS window: per-sensor @DATA for every dirty
+// sensor, then (if the primary sensor changed) its onPrimary hooks,
+// valveCtrlAutoControl() and a single appLogData(). The primary sensor
+// gets no per-sensor @DATA when appLogData() carries all it reported
+// (flow, battery); lqi/seq/age for it come from sensor_get.
+// OnOff reports from a valve node ID are not telemetry: they are stored
+// by valveCtrlReport() and applied in valveCtrlTick() (confirmed valve
+// state, valve_ctrl.h).
+// Call from the main tick.
+void telemetryRxProcess(void);
+
+// ===== ZCL SEQUENCE TRACKING =====
+// Per sensor in Sensor_t.seq; d = seq - lastSeq (mod 256):
+//   d == 0                        duplicate, dropped before it is decoded
+//   d = 1 .. 127                  accepted, d - 1 counted as lost
+//   behind <= SEQ_REORDER_WINDOW  late arrival, dropped (and lost - 1)
+//   further behind                the sensor restarted its counter: resync
+// The ZCL sequence number is per device, so other commands the sensor
+// sends also show up as gaps.
+#define SEQ_REORDER_WINDOW  8u
+
+// Totals over all sensors, evicted ones included (@INFO "seq")
+const SeqStats_t *telemetryRxSeqTotals(void);
+
+#endif
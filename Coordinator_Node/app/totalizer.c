@@ -0,0 +1,203 @@
+#include "totalizer.h"
+#include "app_log.h"
+#include "app_utils.h"
+#include "sensor_table.h"
+#include "nvm3_default.h"
+
+#include <string.h>
+
+#define ACC_PER_ML  60u   // acc units (L/min x ms) per mL
+
+typedef struct {
+  uint8_t  eui[EUI64_SIZE];
+  uint64_t acc;
+} TotalRec_t;
+
+typedef struct {
+  uint32_t   seq;
+  uint8_t    count;
+  uint8_t    rsv[3];
+  TotalRec_t rec[TOTAL_PERSIST_MAX];
+} TotalCkpt_t;
+
+static TotalCkpt_t s_ckpt;            // last written / restored record
+static bool        s_ckptFullWarned = false;
+static uint64_t    s_sinceCkpt = 0;   // acc added since the last checkpoint
+static uint32_t    s_lastCkptMs = 0;
+static uint32_t    s_ckptWrites = 0;
+static uint32_t    s_intervalS = TOTAL_CKPT_INTERVAL_S;
+static uint16_t    s_deltaL = TOTAL_CKPT_DELTA_L;
+
+_Static_assert(TOTAL_NVM_KEYS >= 2u, "rotation needs at least two keys");
+
+// ===== RECORDS =====
+
+static TotalRec_t *findRec(const uint8_t *eui)
+{
+  for (uint8_t i = 0; i < s_ckpt.count; i++) {
+    if (memcmp(s_ckpt.rec[i].eui, eui, EUI64_SIZE) == 0) return &s_ckpt.rec[i];
+  }
+  return NULL;
+}
+
+// Copy the totals of live sensors into the record (new EUI64s if room)
+static void syncRecords(void)
+{
+  for (uint16_t i = 0; i < sensorTableCount(); i++) {
+    Sensor_t *s = sensorTableAt(i);
+    if (!s->tot.seeded) continue;
+
+    TotalRec_t *r = findRec(s->eui);
+    if (!r) {
+      if (s_ckpt.count >= TOTAL_PERSIST_MAX) {
+        if (!s_ckptFullWarned) {
+          s_ckptFullWarned = true;
+          appLogLog("TOT", "persist_full", "\"sensor\":\"0x%04X\",\"max\":%u",
+                    s->nodeId, (unsigned)TOTAL_PERSIST_MAX);
+        }
+        continue;
+      }
+      r = &s_ckpt.rec[s_ckpt.count++];
+      memcpy(r->eui, s->eui, EUI64_SIZE);
+    }
+    r->acc = s->tot.acc;
+  }
+}
+
+// ===== NVM3 =====
+
+static bool readCkpt(uint8_t k, TotalCkpt_t *out)
+{
+  uint32_t type;
+  size_t len;
+  nvm3_ObjectKey_t key = TOTAL_NVM_KEY_BASE + k;
+  if (nvm3_getObjectInfo(nvm3_defaultHandle, key, &type, &len) != ECODE_NVM3_OK) return false;
+  if (len != sizeof(*out)) return false;
+  if (nvm3_readData(nvm3_defaultHandle, key, out, sizeof(*out)) != ECODE_NVM3_OK) return false;
+  return out->count <= TOTAL_PERSIST_MAX;
+}
+
+void totalizerInit(void)
+{
+  memset(&s_ckpt, 0, sizeof(s_ckpt));
+
+  bool found = false;
+  TotalCkpt_t c;
+  for (uint8_t k = 0; k < TOTAL_NVM_KEYS; k++) {
+    if (!readCkpt(k, &c)) continue;
+    if (!found || (int32_t)(c.seq - s_ckpt.seq) > 0) {
+      s_ckpt = c;
+      found = true;
+    }
+  }
+  s_lastCkptMs = msTick();
+
+  if (found) {
+    appLogLog("TOT", "restored", "\"seq\":%lu,\"sensors\":%u",
+              (unsigned long)s_ckpt.seq, (unsigned)s_ckpt.count);
+  }
+}
+
+static void writeCkpt(void)
+{
+  syncRecords();
+  s_ckpt.seq++;
+
+  nvm3_ObjectKey_t key = TOTAL_NVM_KEY_BASE + (s_ckpt.seq % TOTAL_NVM_KEYS);
+  Ecode_t ec = nvm3_writeData(nvm3_defaultHandle, key, &s_ckpt, sizeof(s_ckpt));
+  s_lastCkptMs = msTick();
+  if (ec != ECODE_NVM3_OK) {
+    appLogLog("TOT", "ckpt_error", "\"key\":\"0x%05lX\",\"ec\":\"0x%08lX\"",
+              (unsigned long)key, (unsigned long)ec);
+    return;
+  }
+  s_ckptWrites++;
+  s_sinceCkpt = 0;
+}
+
+void totalizerTick(void)
+{
+  if (s_sinceCkpt == 0) return;
+
+  uint32_t age = msTick() - s_lastCkptMs;
+  bool due = age >= s_intervalS * 1000u;
+  bool big = s_sinceCkpt >= (uint64_t)s_deltaL * 1000u * ACC_PER_ML
+             && age >= TOTAL_CKPT_MIN_S * 1000u;
+  if (due || big) writeCkpt();
+}
+
+// ===== INTEGRATION =====
+
+static void seed(Sensor_t *s)
+{
+  if (s->tot.seeded || !(s->flags & SENSOR_F_EUI)) return;
+  TotalRec_t *r = findRec(s->eui);
+  if (r) s->tot.acc += r->acc;
+  s->tot.seeded = true;
+}
+
+void totalizerAdd(Sensor_t *s, uint16_t flow)
+{
+  if (!s) return;
+  Totalizer_t *t = &s->tot;
+  uint32_t now = msTick();
+
+  if (t->running) {
+    uint32_t dt = now - t->lastMs;
+    if (dt <= TOTAL_MAX_GAP_MS) {
+      uint64_t add = (uint64_t)t->lastFlow * dt;
+      t->acc += add;
+      s_sinceCkpt += add;
+    }
+  }
+  t->lastFlow = flow;
+  t->lastMs = now;
+  t->running = true;
+  seed(s);
+}
+
+void totalizerRelease(Sensor_t *s)
+{
+  if (s && s->tot.seeded) syncRecords();
+}
+
+uint64_t totalizerVolumeMl(const Sensor_t *s)
+{
+  return s ? s->tot.acc / ACC_PER_ML : 0;
+}
+
+uint64_t totalizerSiteMl(void)
+{
+  uint64_t acc = 0;
+  syncRecords();
+  for (uint8_t i = 0; i < s_ckpt.count; i++) acc += s_ckpt.rec[i].acc;
+  // live sensors that are not persisted (no EUI64 yet, or no room)
+  for (uint16_t i = 0; i < sensorTableCount(); i++) {
+    const Sensor_t *s = sensorTableAt(i);
+    if (!s->tot.seeded || !findRec(s->eui)) acc += s->tot.acc;
+  }
+  return acc / ACC_PER_ML;
+}
+
+uint32_t totalizerCkptWrites(void) { return s_ckptWrites; }
+
+uint16_t totalizerUnsaved(void)
+{
+  uint16_t n = 0;
+  syncRecords();
+  for (uint16_t i = 0; i < sensorTableCount(); i++) {
+    const Sensor_t *s = sensorTableAt(i);
+    if (s->tot.acc == 0) continue;
+    if (!s->tot.seeded || !findRec(s->eui)) n++;
+  }
+  return n;
+}
+
+void totalizerConfig(uint32_t intervalS, uint16_t deltaL)
+{
+  s_intervalS = intervalS;
+  s_deltaL = deltaL;
+}
+
+uint32_t totalizerIntervalS(void) { return s_intervalS; }
+uint16_t totalizerDeltaL(void) { return s_deltaL; }
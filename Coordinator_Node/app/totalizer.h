@@ -0,0 +1,57 @@
+#ifndef TOTALIZER_H
+#define TOTALIZER_H
+
+#include "app_config.h"
+
+#include <stdint.h>
+#include <stdbool.h>
+
+struct Sensor_s;
+
+// ===== VOLUME TOTALIZER =====
+// Per-sensor consumed volume: every flow report adds the previous flow
+// times the time since it (sample-and-hold; gaps longer than
+// TOTAL_MAX_GAP_MS count as no flow) to a 64-bit accumulator in
+// L/min x ms, i.e. 1/60 mL per unit, so integration never truncates.
+//
+// Persistence (NVM3): one checkpoint record holds the totals of up to
+// TOTAL_PERSIST_MAX sensors keyed by EUI64 plus a sequence number. Each
+// checkpoint goes to the next of TOTAL_NVM_KEYS keys; at boot the record
+// with the highest sequence wins, and a sensor picks its total up again
+// once its EUI64 is known. A checkpoint is written every interval_s, or
+// when the volume since the last one reaches delta_l (at most once per
+// TOTAL_CKPT_MIN_S), and only if something was added.
+// The record is capped at TOTAL_PERSIST_MAX sensors (one NVM3 object,
+// rewritten whole on each checkpoint), well below SENSOR_TABLE_MAX: the
+// volume of further sensors lives in RAM only and is lost on reboot.
+// totalizerUnsaved() counts them (@INFO "tot_unsaved") so it never
+// happens silently.
+
+#define TOTAL_PERSIST_MAX   8u
+#define TOTAL_NVM_KEYS      4u
+#define TOTAL_NVM_KEY_BASE  0x0A100u   // application NVM3 key range
+
+typedef struct {
+  uint64_t acc;        // L/min x ms, restored total included
+  uint32_t lastMs;     // time of the last flow report
+  uint16_t lastFlow;
+  bool     running;    // lastFlow/lastMs valid
+  bool     seeded;     // restored total merged (needs the EUI64)
+} Totalizer_t;
+
+void totalizerInit(void);                 // load the newest checkpoint
+void totalizerTick(void);                 // checkpoint policy, main tick
+
+void totalizerAdd(struct Sensor_s *s, uint16_t flow);
+void totalizerRelease(struct Sensor_s *s);   // sensor evicted: keep its total
+
+uint64_t totalizerVolumeMl(const struct Sensor_s *s);
+uint64_t totalizerSiteMl(void);           // all persisted + live sensors
+uint32_t totalizerCkptWrites(void);       // NVM3 writes since boot
+uint16_t totalizerUnsaved(void);          // live sensors with volume not in the record
+
+void totalizerConfig(uint32_t intervalS, uint16_t deltaL);
+uint32_t totalizerIntervalS(void);
+uint16_t totalizerDeltaL(void);
+
+#endif
@@ -1,6 +1,8 @@
 #include "uart_link.h"
 #include "app_config.h"
 #include "cmd_handler.h"
+#include "bin_proto.h"
+#include "lat_stats.h"
 
 #include "sl_iostream.h"
 #include "sl_status.h"
@@ -8,38 +10,368 @@
 #include <stddef.h>
 #include <string.h>
 #include <stdint.h>
+#include <stdbool.h>
 
-static char s_uartLine[UART_LINE_MAX];
-static uint16_t s_uartLen = 0;
+// ===== RX BUFFER =====
+// Bytes are appended by one bulk sl_iostream_read() per poll (not per byte).
+// Complete lines are terminated in place and passed to cmdHandleLine()
+// directly from this buffer; only the trailing partial line is moved back
+// to the front afterwards, so a full @CMD line is never copied.
+// In binary mode the same buffer holds 0x00-delimited COBS frames, which
+// are decoded in place (see bin_proto.h); a '\n'-terminated @CMD text line
+// is still accepted and switches back to text.
+static char s_rxBuf[UART_RX_BUF_SIZE + 1];   // +1 for in-place '\0'
+static uint16_t s_rxLen = 0;
+static bool s_rxDropping = false;             // overflowed line: skip to next delimiter
+static char s_rxDropDelim = '\n';
 
-void uartLinkPoll(void)
+// Word-at-a-time search for the delimiter ('\n' in text mode, 0x00 in
+// binary mode): SWAR "has zero byte" test on w ^ (delim * 0x01010101)
+static const char *findDelim(const char *p, const char *end, char delim)
 {
-  char c;
-  size_t n = 0;
-  sl_status_t st = sl_iostream_read(SL_IOSTREAM_STDIN, &c, 1, &n);
-
-  while ((st == SL_STATUS_OK) && (n == 1)) {
-
-    if (c == '\r') {
-      // ignore
-    } else if (c == '\n') {
-      if (s_uartLen > 0) {
-        s_uartLine[s_uartLen] = 0;
-        if (strncmp(s_uartLine, "@CMD", 4) == 0) {
-          cmdHandleLine(s_uartLine);
-        }
-        s_uartLen = 0;
-      }
-    } else {
-      if ((uint16_t)(s_uartLen + 1u) < (uint16_t)UART_LINE_MAX) {
-        s_uartLine[s_uartLen++] = c;
-      } else {
-        // overflow -> drop line
-        s_uartLen = 0;
+  const uint32_t pattern = (uint32_t)(uint8_t)delim * 0x01010101u;
+
+  while (p < end && ((uintptr_t)p & 3u) != 0u) {
+    if (*p == delim) return p;
+    p++;
+  }
+  while ((size_t)(end - p) >= 4u) {
+    uint32_t w;
+    memcpy(&w, p, 4);
+    w ^= pattern;
+    if (((w - 0x01010101u) & ~w & 0x80808080u) != 0u) break;
+    p += 4;
+  }
+  while (p < end) {
+    if (*p == delim) return p;
+    p++;
+  }
+  return NULL;
+}
+
+// "@CMD" after any CR/LF; partial: the bytes seen so far may still become it.
+// A COBS CMD segment never matches (its byte 2 is BIN_T_CMD = 0x10).
+static bool isTextCmd(const char *p, const char *end, bool partial)
+{
+  while (p < end && (*p == '\r' || *p == '\n')) p++;
+  size_t n = (size_t)(end - p);
+  if (n >= 4u) return strncmp(p, "@CMD", 4) == 0;
+  return partial && n > 0u && strncmp(p, "@CMD", n) == 0;
+}
+
+static void routeLine(char *line, uint16_t len)
+{
+  // binary mode: COBS frame, unless the gateway restarted in text mode;
+  // then answer in text again until it negotiates binary anew
+  if (binProtoEnabled()) {
+    if (!isTextCmd(line, line + len, false)) {
+      const char *json = NULL;
+      if (binProtoDecodeCmd((uint8_t *)line, len, &json)) {
+        cmdHandleJson(json);
       }
+      return;
+    }
+    binProtoTextFallback();
+    while (len > 0 && (line[0] == '\r' || line[0] == '\n')) {
+      line++;
+      len--;
+    }
+  }
+
+  // strip trailing CR(s)
+  while (len > 0 && line[len - 1] == '\r') len--;
+  if (len == 0) return;
+
+  line[len] = 0;
+  if (strncmp(line, "@CMD", 4) == 0) {
+    cmdHandleLine(line);
+  }
+}
+
+// '\n' in text mode; 0x00 in binary mode, except for a text @CMD line
+static char rxDelim(const char *p, const char *end)
+{
+  return (binProtoEnabled() && !isTextCmd(p, end, true)) ? '\0' : '\n';
+}
+
+static void dispatchLine(char *line, uint16_t len)
+{
+  // the line tick belongs to the command parsed from this line only
+  latStatsLineRx();
+  routeLine(line, len);
+  latStatsLineEnd();
+}
+
+// Split buffered bytes into lines, keep any trailing partial line
+static void processRx(void)
+{
+  char *start = s_rxBuf;
+  char *end = s_rxBuf + s_rxLen;
+
+  for (;;) {
+    // re-read per line: a proto_set line switches framing for what follows
+    char delim = s_rxDropping ? s_rxDropDelim : rxDelim(start, end);
+    char *nl = (char *)findDelim(start, end, delim);
+    if (!nl) break;
+
+    uint16_t len = (uint16_t)(nl - start);
+    if (s_rxDropping) {
+      s_rxDropping = false;
+    } else if (len < (uint16_t)UART_LINE_MAX) {
+      dispatchLine(start, len);
+    }
+    start = nl + 1;
+  }
+
+  uint16_t rest = (uint16_t)(end - start);
+  if (s_rxDropping) {
+    rest = 0;
+  } else if (rest >= (uint16_t)UART_LINE_MAX) {
+    // overflow -> drop line (up to and including its delimiter)
+    s_rxDropDelim = rxDelim(start, end);
+    rest = 0;
+    s_rxDropping = true;
+  }
+
+  if (rest > 0 && start != s_rxBuf) {
+    memmove(s_rxBuf, start, rest);
+  }
+  s_rxLen = rest;
+}
+
+void uartLinkPoll(void)
+{
+  for (uint8_t reads = 0; reads < UART_RX_MAX_READS_PER_POLL; reads++) {
+    size_t n = 0;
+    size_t room = (size_t)UART_RX_BUF_SIZE - s_rxLen;
+    sl_status_t st = sl_iostream_read(SL_IOSTREAM_STDIN, &s_rxBuf[s_rxLen], room, &n);
+    if (st != SL_STATUS_OK || n == 0) break;
+
+    s_rxLen = (uint16_t)(s_rxLen + n);
+    processRx();
+
+    if (n < room) break;  // driver drained
+  }
+}
+
+// ===== TX RINGS =====
+// One ring per output class; frames are stored as
+// [len lo][len hi][enqueue tick, 4 bytes LE][bytes...].
+// Writers (including stack callbacks) only copy into RAM; the UART write
+// happens in uartLinkTxDrain() and always covers whole frames, so debug
+// prints from other modules can never land in the middle of a frame.
+// Drain order is strict priority (ACK, ALRM, DATA, INFO, LOG) at frame boundaries,
+// so a pending @ACK waits for at most one lower-class frame.
+// An @ACK that does not fit the ACK ring is not dropped while LOG, INFO or
+// DATA frames are queued: it takes room in the lowest of those rings (their
+// oldest frames are dropped as needed) and is flagged in its length field.
+// A ring holding a spilled @ACK drains right after the ACK ring, so the
+// @ACK waits only for the frames queued ahead of it in that ring.
+typedef struct {
+  uint8_t  *buf;
+  uint16_t size;
+  uint16_t head;     // write index
+  uint16_t tail;     // read index
+  uint16_t used;
+  uint16_t acks;     // spilled @ACKs queued
+} TxRing_t;
+
+static uint8_t s_txAckBuf[UART_TX_RING_ACK];
+static uint8_t s_txAlrmBuf[UART_TX_RING_ALRM];
+static uint8_t s_txDataBuf[UART_TX_RING_DATA];
+static uint8_t s_txInfoBuf[UART_TX_RING_INFO];
+static uint8_t s_txLogBuf[UART_TX_RING_LOG];
+
+static TxRing_t s_tx[UART_TX_CLASS_COUNT] = {
+  [UART_TX_ACK]  = { s_txAckBuf,  UART_TX_RING_ACK,  0, 0, 0, 0 },
+  [UART_TX_ALRM] = { s_txAlrmBuf, UART_TX_RING_ALRM, 0, 0, 0, 0 },
+  [UART_TX_DATA] = { s_txDataBuf, UART_TX_RING_DATA, 0, 0, 0, 0 },
+  [UART_TX_INFO] = { s_txInfoBuf, UART_TX_RING_INFO, 0, 0, 0, 0 },
+  [UART_TX_LOG]  = { s_txLogBuf,  UART_TX_RING_LOG,  0, 0, 0, 0 },
+};
+
+static uint16_t s_txHighWater = 0;
+static uint32_t s_txDropped[UART_TX_CLASS_COUNT];
+
+static void ringPut(TxRing_t *r, const uint8_t *p, uint16_t n)
+{
+  uint16_t first = (uint16_t)(r->size - r->head);
+  if (first > n) first = n;
+  memcpy(&r->buf[r->head], p, first);
+  memcpy(&r->buf[0], p + first, (size_t)(n - first));
+  r->head = (uint16_t)((r->head + n) % r->size);
+  r->used = (uint16_t)(r->used + n);
+}
+
+#define TX_LEN_ACK  0x8000u   // length flag: @ACK spilled into a lower ring
+_Static_assert(UART_TX_RING_ACK < TX_LEN_ACK && UART_TX_RING_ALRM < TX_LEN_ACK &&
+               UART_TX_RING_DATA < TX_LEN_ACK && UART_TX_RING_INFO < TX_LEN_ACK &&
+               UART_TX_RING_LOG < TX_LEN_ACK, "frame length must leave bit 15 free");
+
+static uint16_t ringPeekRawLen(const TxRing_t *r)
+{
+  return (uint16_t)r->buf[r->tail]
+       | ((uint16_t)r->buf[(r->tail + 1u) % r->size] << 8);
+}
+
+static uint16_t ringPeekLen(const TxRing_t *r) { return (uint16_t)(ringPeekRawLen(r) & ~TX_LEN_ACK); }
+
+static bool ringPeekAck(const TxRing_t *r) { return (ringPeekRawLen(r) & TX_LEN_ACK) != 0u; }
+
+#define TX_HDR_LEN  6u
+
+static uint32_t ringPeekTick(const TxRing_t *r)
+{
+  uint32_t t = 0;
+  for (uint8_t i = 0; i < 4u; i++) {
+    t |= (uint32_t)r->buf[(r->tail + 2u + i) % r->size] << (8u * i);
+  }
+  return t;
+}
+
+static void ringDropOldest(TxRing_t *r)
+{
+  uint16_t len = ringPeekLen(r);
+  r->tail = (uint16_t)((r->tail + TX_HDR_LEN + len) % r->size);
+  r->used = (uint16_t)(r->used - len - TX_HDR_LEN);
+}
+
+// @DATA / @INFO are full snapshots: under back-pressure the oldest queued
+// snapshot is superseded by the new one. @ACK / @ALRM / @LOG drop the new frame.
+static bool classCoalesces(uart_tx_class_t cls)
+{
+  return (cls == UART_TX_DATA) || (cls == UART_TX_INFO);
+}
+
+static void ringPush(TxRing_t *r, const void *data, uint16_t len, bool spilledAck)
+{
+  uint32_t now = latStatsNow();
+  uint16_t lenField = spilledAck ? (uint16_t)(len | TX_LEN_ACK) : len;
+  uint8_t hdr[TX_HDR_LEN] = {
+    (uint8_t)lenField, (uint8_t)(lenField >> 8),
+    (uint8_t)now, (uint8_t)(now >> 8), (uint8_t)(now >> 16), (uint8_t)(now >> 24)
+  };
+  ringPut(r, hdr, TX_HDR_LEN);
+  ringPut(r, (const uint8_t *)data, len);
+  if (spilledAck) r->acks++;
+
+  uint16_t total = 0;
+  for (uint8_t c = 0; c < UART_TX_CLASS_COUNT; c++) total = (uint16_t)(total + s_tx[c].used);
+  if (total > s_txHighWater) s_txHighWater = total;
+}
+
+// ACK ring full: LOG, then INFO, then DATA give up their oldest frames
+// (never a spilled @ACK). ALRM is left alone, its writers think it queued.
+static bool spillAck(const void *data, uint16_t len)
+{
+  static const uart_tx_class_t order[] = { UART_TX_LOG, UART_TX_INFO, UART_TX_DATA };
+  uint32_t need = (uint32_t)len + TX_HDR_LEN;
+
+  for (uint8_t k = 0; k < sizeof(order) / sizeof(order[0]); k++) {
+    TxRing_t *r = &s_tx[order[k]];
+    if (need > r->size) continue;
+    while (need > (uint32_t)(r->size - r->used) && r->used > 0 && !ringPeekAck(r)) {
+      ringDropOldest(r);
+      s_txDropped[order[k]]++;
+    }
+    if (need <= (uint32_t)(r->size - r->used)) {
+      ringPush(r, data, len, true);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool uartLinkTxWrite(uart_tx_class_t cls, const void *data, uint16_t len)
+{
+  if (!data || len == 0) return true;
+  if ((unsigned)cls >= UART_TX_CLASS_COUNT) cls = UART_TX_LOG;
+
+  TxRing_t *r = &s_tx[cls];
+  uint32_t need = (uint32_t)len + TX_HDR_LEN;
+
+  if (need > r->size) {
+    s_txDropped[cls]++;
+    return false;
+  }
+
+  if (cls == UART_TX_ACK && need > (uint32_t)(r->size - r->used)) {
+    if (spillAck(data, len)) return true;
+    s_txDropped[cls]++;
+    return false;
+  }
+
+  while (need > (uint32_t)(r->size - r->used)) {
+    if (!classCoalesces(cls) || r->used == 0 || ringPeekAck(r)) {
+      s_txDropped[cls]++;
+      return false;
     }
+    ringDropOldest(r);
+    s_txDropped[cls]++;
+  }
+
+  ringPush(r, data, len, false);
+  return true;
+}
+
+uint16_t uartLinkTxFree(uart_tx_class_t cls)
+{
+  if ((unsigned)cls >= UART_TX_CLASS_COUNT) return 0;
+  uint16_t room = (uint16_t)(s_tx[cls].size - s_tx[cls].used);
+  return (room > TX_HDR_LEN) ? (uint16_t)(room - TX_HDR_LEN) : 0u;
+}
 
-    n = 0;
-    st = sl_iostream_read(SL_IOSTREAM_STDIN, &c, 1, &n);
+// ACK ring, then a ring holding a spilled @ACK, then class order
+static TxRing_t *nextRing(void)
+{
+  if (s_tx[UART_TX_ACK].used >= TX_HDR_LEN) return &s_tx[UART_TX_ACK];
+  for (uint8_t c = 0; c < UART_TX_CLASS_COUNT; c++) {
+    if (s_tx[c].acks > 0u) return &s_tx[c];
+  }
+  for (uint8_t c = 0; c < UART_TX_CLASS_COUNT; c++) {
+    if (s_tx[c].used >= TX_HDR_LEN) return &s_tx[c];
   }
+  return NULL;
+}
+
+void uartLinkTxDrain(void)
+{
+  uint16_t budget = UART_TX_BUDGET_PER_TICK;
+  bool sentAny = false;
+
+  for (;;) {
+    TxRing_t *r = nextRing();
+    if (!r) break;
+
+    bool spilled = ringPeekAck(r);
+    bool ack = spilled || (r == &s_tx[UART_TX_ACK]);
+    uint16_t len = ringPeekLen(r);
+
+    // whole frames only; one oversize frame may exceed the budget
+    if (sentAny && len > budget) break;
+
+    uint32_t queuedAt = ringPeekTick(r);
+    uint16_t start = (uint16_t)((r->tail + TX_HDR_LEN) % r->size);
+    uint16_t first = (uint16_t)(r->size - start);
+    if (first > len) first = len;
+    (void)sl_iostream_write(SL_IOSTREAM_STDOUT, &r->buf[start], first);
+    if (len > first) {
+      (void)sl_iostream_write(SL_IOSTREAM_STDOUT, &r->buf[0], (size_t)(len - first));
+    }
+
+    r->tail = (uint16_t)((start + len) % r->size);
+    r->used = (uint16_t)(r->used - len - TX_HDR_LEN);
+    if (spilled) r->acks--;
+    if (ack) latStatsRecord(LAT_ST_ACK_UART, queuedAt);
+    budget = (len >= budget) ? 0 : (uint16_t)(budget - len);
+    sentAny = true;
+    if (budget == 0) break;
+  }
+}
+
+uint16_t uartLinkTxHighWater(void) { return s_txHighWater; }
+
+uint32_t uartLinkTxDropped(uart_tx_class_t cls)
+{
+  return ((unsigned)cls < UART_TX_CLASS_COUNT) ? s_txDropped[cls] : 0;
 }
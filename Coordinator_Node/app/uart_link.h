@@ -1,6 +1,35 @@
 #ifndef UART_LINK_H
 #define UART_LINK_H
 
+#include <stdint.h>
+#include <stdbool.h>
+
+// RX: read @CMD lines / binary frames from the gateway UART
 void uartLinkPoll(void);
 
+// TX: protocol output is queued here (never blocks) and written to the
+// UART by uartLinkTxDrain() from the main tick, whole frames at a time,
+// within UART_TX_BUDGET_PER_TICK bytes per call.
+// Each frame has a class; lower value = higher drain priority.
+// When a class ring is full, DATA/INFO evict their oldest queued frame
+// (snapshots, newest wins) and ACK/ALRM/LOG drop the new frame. @ALRM has
+// its own ring so an alarm burst (retried every tick) never fills the
+// ring @ACK needs. A full ACK ring borrows room from LOG/INFO/DATA (their
+// oldest frames are dropped) before an @ACK is lost.
+typedef enum {
+  UART_TX_ACK = 0,
+  UART_TX_ALRM,
+  UART_TX_DATA,
+  UART_TX_INFO,
+  UART_TX_LOG,
+  UART_TX_CLASS_COUNT
+} uart_tx_class_t;
+
+bool uartLinkTxWrite(uart_tx_class_t cls, const void *data, uint16_t len);  // false = dropped
+void uartLinkTxDrain(void);
+
+uint16_t uartLinkTxFree(uart_tx_class_t cls);       // payload bytes that fit without eviction
+uint16_t uartLinkTxHighWater(void);                 // max bytes queued (all classes)
+uint32_t uartLinkTxDropped(uart_tx_class_t cls);    // frames dropped/coalesced
+
 #endif
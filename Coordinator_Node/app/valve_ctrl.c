@@ -4,41 +4,119 @@
 #include "app_utils.h"
 #include "app_log.h"
 #include "lcd_ui.h"
+#include "lat_stats.h"
+#include "sensor_table.h"
+#include "leak.h"
+#include "stale.h"
+#include "telemetry_rx.h"
 
 #include "stack/include/binding-table.h"
 
 #include <string.h>
 #include <stdio.h>
-#include "app_log.h"
 
 static uint16_t g_flowCloseTh = 60u;
 static uint16_t g_flowOpenTh  = 5u;
 
-// confirmed state by tx_done success
-static bool g_valveOpen = false;
-
-// Stable identity: EUI64
-static bool       g_valveKnown = false;
-static EmberEUI64  g_valveEuiLe = {0};
-static EmberNodeId g_valveNodeId = EMBER_NULL_NODE_ID;
-static uint8_t     g_valveDstEp = VALVE_EP_DEFAULT;
-
-// Optional binding
-static uint8_t g_valveBindIndex = 0;
-static valve_path_t g_valvePath = VALVE_PATH_AUTO;
-
-// TX tracking
+// TX tracking, one slot per valve
 typedef struct {
-  bool active;
+  bool active;           // command owns the slot (in flight or backing off)
+  bool inFlight;         // frame with the stack, deadline running
   uint32_t cmdId;
   bool wantOpen;
   bool usedDirect;
   uint16_t dstOrIndex;
+  uint8_t apsSeq;        // matches emberAfMessageSentCallback()
+  uint8_t tries;         // retries so far
+  uint32_t dueMs;        // in flight: deadline, else: retry time
+  uint32_t sentMs;       // msTick() of the attempt in flight
+  uint32_t firstTicks;   // latStatsNow() at the first send
 } TxTrack_t;
 
-static TxTrack_t g_tx = {0};
+// Next command of the valve while its TX (or the in-flight cap) is busy;
+// a newer request replaces it
+typedef struct {
+  bool active;
+  uint32_t cmdId;
+  bool wantOpen;
+} TxPend_t;
+
+// Delivery statistics of one path of a valve, fed by every attempt
+typedef struct {
+  uint32_t latQ4;        // EWMA send -> delivered, ms Q4 (deliveries only)
+  uint32_t failQ4;       // EWMA send -> failure known, ms Q4 (timeout: deadline)
+  uint32_t okQ16;        // EWMA delivery ratio, 65536 = all delivered
+  uint16_t n;            // attempts, saturating
+} PathStats_t;
+
+enum { PS_DIRECT = 0, PS_BINDING = 1 };
 
-static EmberStatus queueValveOnOff(bool wantOpen, bool useDirect)
+typedef struct {
+  // Stable identity: EUI64
+  bool         known;
+  EmberEUI64   euiLe;
+  EmberNodeId  nodeId;
+  uint8_t      dstEp;
+  // Optional binding
+  uint8_t      bindIndex;
+  valve_path_t path;
+  // valve state: its OnOff reports, or the delivered command until it reports
+  bool         open;
+  bool         reports;       // OnOff reports applied
+  uint8_t      lastSeq;       // valid once reports or repDirty
+  bool         repDirty;      // report stored by the stack callback, not applied yet
+  bool         repOn;         // ... its state
+  bool         commanded;     // a command was sent since boot
+  bool         cmdOpen;       // ... the last one
+  valve_conf_t conf;
+  uint16_t     confMs;        // last confirmation latency
+  uint32_t     cmdMs;         // msTick() / latStatsNow() at the first send of
+  uint32_t     cmdTicks;      // the command awaiting its report
+  uint32_t     confDueMs;     // wait, command finished: report deadline
+  TxTrack_t    tx;
+  TxPend_t     pend;
+  PathStats_t  ps[2];    // PS_DIRECT, PS_BINDING
+  uint8_t      probeCnt; // AUTO first attempts since the last probe
+  bool         preferDirect;  // AUTO path currently preferred
+} Valve_t;
+
+static Valve_t g_valves[VALVE_TABLE_MAX];
+static uint8_t g_txInFlight = 0;
+static uint8_t g_txBusy = 0;           // valves with tx.active
+static bool    g_pendReady = false;    // a TX finished: try the pending slots
+static bool    g_repReady = false;     // a valve has repDirty set
+static uint8_t g_pendNext = 0;         // round-robin start of the drain
+static ValveTxStats_t g_txStats;
+static ValveConfStats_t g_confStats;
+static uint8_t g_confWait = 0;         // valves in VALVE_CONF_WAIT
+
+_Static_assert(VALVE_TABLE_MAX <= 0xFFu, "valve index is 8 bits");
+
+void valveCtrlInit(void)
+{
+  memset(g_valves, 0, sizeof(g_valves));
+  for (uint8_t v = 0; v < VALVE_TABLE_MAX; v++) {
+    g_valves[v].nodeId = EMBER_NULL_NODE_ID;
+    g_valves[v].dstEp = VALVE_EP_DEFAULT;
+    g_valves[v].path = VALVE_PATH_AUTO;
+    g_valves[v].preferDirect = true;
+  }
+  g_txInFlight = 0;
+  g_txBusy = 0;
+  memset(&g_txStats, 0, sizeof(g_txStats));
+  memset(&g_confStats, 0, sizeof(g_confStats));
+  g_confWait = 0;
+  g_pendReady = false;
+  g_repReady = false;
+  g_pendNext = 0;
+}
+
+static Valve_t *valveAt(uint8_t v)
+{
+  return (v < VALVE_TABLE_MAX) ? &g_valves[v] : NULL;
+}
+
+static EmberStatus queueValveOnOff(const Valve_t *vl, bool wantOpen, bool useDirect, uint8_t *apsSeq)
 {
   uint8_t cmdId = wantOpen ? ZCL_ON_COMMAND_ID : ZCL_OFF_COMMAND_ID;
 
@@ -47,7 +125,7 @@ static EmberStatus queueValveOnOff(bool wantOpen, bool useDirect)
                             cmdId,
                             "");
 
-  emberAfSetCommandEndpoints(COORD_EP_CONTROL, g_valveDstEp);
+  emberAfSetCommandEndpoints(COORD_EP_CONTROL, vl->dstEp);
 
   EmberApsFrame *aps = emberAfGetCommandApsFrame();
   if (aps) {
@@ -59,55 +137,288 @@ static EmberStatus queueValveOnOff(bool wantOpen, bool useDirect)
 #endif
   }
 
+  EmberStatus st;
   if (useDirect) {
-    return emberAfSendCommandUnicast(EMBER_OUTGOING_DIRECT, g_valveNodeId);
+    st = emberAfSendCommandUnicast(EMBER_OUTGOING_DIRECT, vl->nodeId);
   } else {
-    return emberAfSendCommandUnicast(EMBER_OUTGOING_VIA_BINDING, g_valveBindIndex);
+    st = emberAfSendCommandUnicast(EMBER_OUTGOING_VIA_BINDING, vl->bindIndex);
   }
+  // the stack stamps the APS counter into the command frame on send
+  *apsSeq = aps ? aps->sequence : 0u;
+  return st;
 }
 
-bool valveCtrlQueueTx(uint32_t id, bool wantOpen)
+// Hand one attempt of the slot's command to the stack; it is then in
+// flight until emberAfMessageSentCallback() or its deadline
+static EmberStatus sendTx(Valve_t *vl, bool useDirect)
 {
-  // A1: For errors when id=0 (auto mode), use @LOG instead of @ACK
-  // A2: For valid id, ACK will be sent in tx_done callback (not here)
-  
-  if (emberAfNetworkState() != EMBER_JOINED_NETWORK) {
-    if (id == 0) {
-      appLogLog("ZB", "valve_reject", "\"reason\":\"not_joined\"");
-    } else {
-      appLogAck(id, false, "not joined");
+  TxTrack_t *tx = &vl->tx;
+  uint8_t apsSeq = 0;
+  EmberStatus st = queueValveOnOff(vl, tx->wantOpen, useDirect, &apsSeq);
+  if (st != EMBER_SUCCESS) return st;
+
+  tx->inFlight = true;
+  tx->usedDirect = useDirect;
+  tx->dstOrIndex = useDirect ? (uint16_t)vl->nodeId : (uint16_t)vl->bindIndex;
+  tx->apsSeq = apsSeq;
+  tx->sentMs = msTick();
+  tx->dueMs = tx->sentMs + VALVE_TX_DEADLINE_MS;
+  g_txInFlight++;
+  return st;
+}
+
+// ===== AUTO PATH =====
+
+static void ewmaQ4(uint32_t *e, uint32_t ms)
+{
+  uint32_t s = ms << 4;
+  if (*e == 0) *e = s;
+  else *e = (uint32_t)((int32_t)*e + ((int32_t)s - (int32_t)*e) / (1 << VALVE_PATH_LAT_SHIFT));
+}
+
+static void pathStatsAdd(PathStats_t *ps, bool ok, uint32_t latMs)
+{
+  uint32_t okS = ok ? 65536u : 0u;
+  if (ps->n == 0) {
+    ps->okQ16 = okS;
+  } else {
+    // slower than the latencies: one rare failure must not flip the path
+    ps->okQ16 = (uint32_t)((int32_t)ps->okQ16 + ((int32_t)okS - (int32_t)ps->okQ16) / (1 << VALVE_PATH_OK_SHIFT));
+  }
+  ewmaQ4(ok ? &ps->latQ4 : &ps->failQ4, latMs);
+  if (ps->n < 0xFFFFu) ps->n++;
+}
+
+// Expected time to deliver on this path: its latency plus, per delivery,
+// (1 - p) / p failed attempts, each costing the time a failure takes to
+// show (a timeout costs the deadline). No delivery yet: the deadline.
+static uint32_t pathExpectedMs(const PathStats_t *ps)
+{
+  uint32_t ok = ps->okQ16 ? ps->okQ16 : 1u;
+  uint32_t lat = ps->latQ4 ? (ps->latQ4 >> 4) : VALVE_TX_DEADLINE_MS;
+  uint32_t fail = ps->failQ4 >> 4;
+  return lat + (uint32_t)(((uint64_t)(65536u - ps->okQ16) * fail) / ok);
+}
+
+// First attempt with path AUTO. Without both a node ID and a valve_pair
+// binding there is nothing to choose. Otherwise each path is tried once,
+// then the preferred path is kept until the other one's expected time is
+// lower by 1/4 (no flapping on EWMA noise), and every
+// VALVE_PROBE_EVERY-th command takes the other path so its statistics
+// stay current.
+static bool autoDirect(Valve_t *vl)
+{
+  if (vl->nodeId == EMBER_NULL_NODE_ID) return false;
+  if (!vl->known) return true;
+
+  const PathStats_t *d = &vl->ps[PS_DIRECT];
+  const PathStats_t *b = &vl->ps[PS_BINDING];
+  if (d->n == 0) return true;
+  if (b->n == 0) return false;
+
+  uint32_t cur = pathExpectedMs(vl->preferDirect ? d : b);
+  uint32_t alt = pathExpectedMs(vl->preferDirect ? b : d);
+  if (alt + alt / 4u < cur) {
+    vl->preferDirect = !vl->preferDirect;
+    appLogLog("ZB", "valve_path_auto", "\"valve\":%u,\"path\":\"%s\",\"expect_ms\":[%lu,%lu]",
+              (unsigned)(vl - g_valves), vl->preferDirect ? "direct" : "binding",
+              (unsigned long)pathExpectedMs(d), (unsigned long)pathExpectedMs(b));
+  }
+
+  if (++vl->probeCnt >= VALVE_PROBE_EVERY) {
+    vl->probeCnt = 0;
+    return !vl->preferDirect;
+  }
+  return vl->preferDirect;
+}
+
+static void pathStatsReset(Valve_t *vl)
+{
+  memset(vl->ps, 0, sizeof(vl->ps));
+  vl->probeCnt = 0;
+  vl->preferDirect = true;
+}
+
+// ===== CONFIRMATION =====
+
+static void setConf(Valve_t *vl, valve_conf_t c)
+{
+  if (vl->conf == VALVE_CONF_WAIT && g_confWait) g_confWait--;
+  if (c == VALVE_CONF_WAIT) g_confWait++;
+  vl->conf = c;
+}
+
+static void diverge(Valve_t *vl, const char *reason)
+{
+  setConf(vl, VALVE_CONF_DIVERGED);
+  g_confStats.diverged++;
+  appLogLog("ZB", "valve_diverged", "\"valve\":%u,\"commanded\":\"%s\",\"reported\":\"%s\",\"reason\":\"%s\"",
+            (unsigned)(vl - g_valves), vl->cmdOpen ? "open" : "closed",
+            vl->open ? "open" : "closed", reason);
+}
+
+// New valve behind the entry: forget its reports
+static void confReset(Valve_t *vl)
+{
+  setConf(vl, VALVE_CONF_NONE);
+  vl->reports = false;
+  vl->repDirty = false;
+  vl->confMs = 0;
+}
+
+// A command leaves for the valve: it becomes the commanded state. A valve
+// that reports answers every On/Off command with a report, also when it
+// was there already, so the state seen last is not trusted until then.
+static void confCommand(Valve_t *vl, bool wantOpen)
+{
+  vl->commanded = true;
+  vl->cmdOpen = wantOpen;
+  if (!vl->reports) return;
+  setConf(vl, VALVE_CONF_WAIT);
+  vl->cmdMs = msTick();
+  vl->cmdTicks = vl->tx.firstTicks;
+}
+
+// Release the slot (delivered, given up or superseded)
+static void endTx(uint8_t v)
+{
+  g_valves[v].tx.active = false;
+  // the report deadline runs from the end of the command: a failed
+  // delivery may still have switched the valve (lost APS ACK)
+  g_valves[v].confDueMs = msTick() + VALVE_CONFIRM_MS;
+  if (g_txBusy) g_txBusy--;
+  g_pendReady = true;   // issued from valveCtrlTick(), not from the stack callback
+  if (v == VALVE_DEFAULT) appLogData();
+  else appLogValveData(v);
+}
+
+// Failed or timed-out attempt: retry after an exponential backoff with
+// jitter, or give up after VALVE_TX_RETRIES. A newer command waiting in
+// the pending slot wins over a retry.
+static void retryTx(uint8_t v, bool timedOut, EmberStatus status)
+{
+  Valve_t *vl = &g_valves[v];
+  TxTrack_t *tx = &vl->tx;
+
+  if (tx->tries < VALVE_TX_RETRIES && !vl->pend.active) {
+    // "equal jitter": half the backoff fixed, half random, so valves that
+    // failed together do not retry together
+    uint32_t span = (uint32_t)VALVE_RETRY_BASE_MS << tx->tries;
+    if (span > VALVE_RETRY_MAX_MS) span = VALVE_RETRY_MAX_MS;
+    uint32_t delay = span / 2u + (uint32_t)halCommonGetRandom() % (span / 2u + 1u);
+    tx->tries++;
+    tx->dueMs = msTick() + delay;
+    g_txStats.retries++;
+    appLogLog("ZB", "tx_retry", "\"id\":%lu,\"valve\":%u,\"try\":%u,\"delay_ms\":%lu",
+              (unsigned long)tx->cmdId, v, (unsigned)tx->tries, (unsigned long)delay);
+    return;
+  }
+
+  latStatsMark(tx->cmdId, LAT_PT_SENT);
+  if (vl->pend.active) {
+    if (tx->cmdId != 0) appLogAck(tx->cmdId, false, "superseded");
+  } else {
+    g_txStats.fail++;
+    if (tx->cmdId != 0) {
+      if (timedOut) appLogAck(tx->cmdId, false, "tx_timeout");
+      else appLogAckZb(tx->cmdId, false, "tx_failed", status, "done");
     }
-    return false;
   }
-  if (g_tx.active) {
+  endTx(v);
+}
+
+// Path of a retry: as configured, or in AUTO the other path when the
+// valve has one (node ID for direct, valve_pair binding for binding)
+static bool retryDirect(const Valve_t *vl)
+{
+  if (vl->path != VALVE_PATH_AUTO) return (vl->path == VALVE_PATH_DIRECT);
+  if (vl->tx.usedDirect) return !vl->known;
+  return (vl->nodeId != EMBER_NULL_NODE_ID);
+}
+
+// Deadlines and due retries of the commands holding a TX slot
+static void checkTx(void)
+{
+  uint32_t now = msTick();
+
+  for (uint8_t v = 0; v < VALVE_TABLE_MAX; v++) {
+    Valve_t *vl = &g_valves[v];
+    TxTrack_t *tx = &vl->tx;
+    if (!tx->active || (int32_t)(now - tx->dueMs) < 0) continue;
+
+    if (tx->inFlight) {
+      // no emberAfMessageSentCallback() for this frame; a late one no
+      // longer matches (matchTx() only takes frames in flight)
+      tx->inFlight = false;
+      if (g_txInFlight) g_txInFlight--;
+      g_txStats.timeouts++;
+      pathStatsAdd(&vl->ps[tx->usedDirect ? PS_DIRECT : PS_BINDING], false, VALVE_TX_DEADLINE_MS);
+      appLogLog("ZB", "tx_timeout", "\"id\":%lu,\"valve\":%u,\"try\":%u,\"aps_seq\":%u",
+                (unsigned long)tx->cmdId, v, (unsigned)tx->tries, (unsigned)tx->apsSeq);
+      retryTx(v, true, EMBER_SUCCESS);
+      continue;
+    }
+
+    if (vl->pend.active) {
+      retryTx(v, false, EMBER_SUCCESS);   // superseded
+      continue;
+    }
+    if (g_txInFlight >= VALVE_TX_MAX_INFLIGHT) continue;
+
+    bool useDirect = retryDirect(vl);
+    EmberStatus st = sendTx(vl, useDirect);
+    if (st != EMBER_SUCCESS) {
+      retryTx(v, false, st);
+      continue;
+    }
+    appLogLog("ZB", "valve_resent", "\"id\":%lu,\"valve\":%u,\"try\":%u,\"path\":\"%s\",\"aps_seq\":%u",
+              (unsigned long)tx->cmdId, v, (unsigned)tx->tries,
+              useDirect ? "direct" : "binding", (unsigned)tx->apsSeq);
+  }
+}
+
+// Send the On/Off frame and take the valve's TX slot (slot and in-flight
+// cap already checked)
+static bool startTx(uint8_t v, uint32_t id, bool wantOpen)
+{
+  Valve_t *vl = &g_valves[v];
+
+  if (emberAfNetworkState() != EMBER_JOINED_NETWORK) {
     if (id == 0) {
-      appLogLog("ZB", "valve_reject", "\"reason\":\"tx_pending\"");
+      appLogLog("ZB", "valve_reject", "\"valve\":%u,\"reason\":\"not_joined\"", v);
     } else {
-      appLogAck(id, false, "busy: tx_pending");
+      appLogAck(id, false, "not joined");
     }
     return false;
   }
 
-  bool canDirect = (g_valveNodeId != EMBER_NULL_NODE_ID);
+  bool canDirect = (vl->nodeId != EMBER_NULL_NODE_ID);
   bool useDirect = false;
 
-  if (g_valvePath == VALVE_PATH_DIRECT) useDirect = true;
-  else if (g_valvePath == VALVE_PATH_BINDING) useDirect = false;
-  else useDirect = canDirect; // AUTO
+  if (vl->path == VALVE_PATH_DIRECT) useDirect = true;
+  else if (vl->path == VALVE_PATH_BINDING) useDirect = false;
+  else useDirect = autoDirect(vl);
 
   if (useDirect && !canDirect) {
     if (id == 0) {
-      appLogLog("ZB", "valve_reject", "\"reason\":\"direct_requires_node_id\"");
+      appLogLog("ZB", "valve_reject", "\"valve\":%u,\"reason\":\"direct_requires_node_id\"", v);
     } else {
       appLogAck(id, false, "direct requires valve_node_id");
     }
     return false;
   }
 
-  EmberStatus st = queueValveOnOff(wantOpen, useDirect);
+  TxTrack_t *tx = &vl->tx;
+  tx->cmdId = id;
+  tx->wantOpen = wantOpen;
+  tx->tries = 0;
+  tx->firstTicks = latStatsNow();
+  EmberStatus st = sendTx(vl, useDirect);
+  latStatsMark(id, LAT_PT_SEND);
   if (st != EMBER_SUCCESS) {
     if (id == 0) {
-      appLogLog("ZB", "valve_reject", "\"reason\":\"send_fail\",\"zstatus\":\"0x%02X\"", (unsigned)st);
+      appLogLog("ZB", "valve_reject", "\"valve\":%u,\"reason\":\"send_fail\",\"zstatus\":\"0x%02X\"",
+                v, (unsigned)st);
     } else {
       char buf[48];
       snprintf(buf, sizeof(buf), "send_fail_immediate:0x%02X", st);
@@ -116,33 +427,189 @@ bool valveCtrlQueueTx(uint32_t id, bool wantOpen)
     return false;
   }
 
-  g_tx.active = true;
-  g_tx.cmdId = id;
-  g_tx.wantOpen = wantOpen;
-  g_tx.usedDirect = useDirect;
-  g_tx.dstOrIndex = useDirect ? (uint16_t)g_valveNodeId : (uint16_t)g_valveBindIndex;
+  tx->active = true;
+  g_txBusy++;
+  confCommand(vl, wantOpen);
 
   // A1: Progress log (not ACK) - ACK will come in tx_done callback
-  appLogLog("ZB", "valve_queued", "\"id\":%lu,\"path\":\"%s\",\"want\":\"%s\"",
+  appLogLog("ZB", "valve_queued", "\"id\":%lu,\"valve\":%u,\"path\":\"%s\",\"want\":\"%s\",\"aps_seq\":%u",
     (unsigned long)id,
+    v,
     useDirect ? "direct" : "binding",
-    wantOpen ? "open" : "close"
+    wantOpen ? "open" : "close",
+    tx->apsSeq
+  );
+  return true;
+}
+
+bool valveCtrlQueueTx(uint8_t v, uint32_t id, bool wantOpen)
+{
+  // A1: For errors when id=0 (auto mode), use @LOG instead of @ACK
+  // A2: For valid id, ACK will be sent in tx_done callback (not here)
+  latStatsMark(id, LAT_PT_QUEUE);
+
+  Valve_t *vl = valveAt(v);
+  if (vl == NULL) {
+    if (id != 0) appLogAck(id, false, "bad valve");
+    return false;
+  }
+
+  if (!vl->tx.active && !vl->pend.active && g_txInFlight < VALVE_TX_MAX_INFLIGHT) {
+    return startTx(v, id, wantOpen);
+  }
+
+  // Busy: latest wins. The replaced command is answered now, the new one
+  // when it has been sent (valveCtrlTick) and delivered.
+  TxPend_t *p = &vl->pend;
+  if (p->active && p->cmdId != 0) appLogAck(p->cmdId, false, "superseded");
+  p->active = true;
+  p->cmdId = id;
+  p->wantOpen = wantOpen;
+  if (!vl->tx.active) g_pendReady = true;   // waiting on the cap only
+
+  appLogLog("ZB", "valve_pending", "\"id\":%lu,\"valve\":%u,\"want\":\"%s\",\"reason\":\"%s\"",
+    (unsigned long)id,
+    v,
+    wantOpen ? "open" : "close",
+    vl->tx.active ? "tx_pending" : "tx_limit"
   );
   return true;
 }
 
+// Valves still waiting for the report of a finished command
+static void checkConf(void)
+{
+  uint32_t now = msTick();
+
+  for (uint8_t v = 0; v < VALVE_TABLE_MAX; v++) {
+    Valve_t *vl = &g_valves[v];
+    if (vl->conf != VALVE_CONF_WAIT || vl->tx.active || vl->pend.active) continue;
+    if ((int32_t)(now - vl->confDueMs) < 0) continue;
+
+    g_confStats.unconfirmed++;
+    diverge(vl, "no_confirm");
+    appLogValveData(v);
+    if (v == VALVE_DEFAULT) valveCtrlAutoControl();   // decide again from the reported state
+  }
+}
+
+// Stored report of one valve: confirmation, divergence, output, AUTO
+static void applyReport(uint8_t v)
+{
+  Valve_t *vl = &g_valves[v];
+  bool on = vl->repOn;
+  bool first = !vl->reports;
+  bool changed = first || vl->open != on;
+  valve_conf_t was = vl->conf;
+  vl->repDirty = false;
+  vl->reports = true;
+  vl->open = on;
+  if (!vl->commanded) vl->cmdOpen = on;   // nothing commanded: nothing to diverge from
+
+  if (vl->conf == VALVE_CONF_WAIT) {
+    // a report of the old state (sent before the command got there) keeps
+    // the wait; the deadline decides
+    if (on == vl->cmdOpen) {
+      uint32_t ms = msTick() - vl->cmdMs;
+      vl->confMs = (ms > 0xFFFFu) ? 0xFFFFu : (uint16_t)ms;
+      latStatsRecord(LAT_ST_VALVE_CONFIRM, vl->cmdTicks);
+      g_confStats.confirmed++;
+      setConf(vl, VALVE_CONF_OK);
+      appLogLog("ZB", "valve_confirmed", "\"valve\":%u,\"state\":\"%s\",\"ms\":%u",
+                v, on ? "open" : "closed", (unsigned)vl->confMs);
+    }
+  } else if (on == vl->cmdOpen) {
+    if (vl->conf == VALVE_CONF_DIVERGED) {
+      appLogLog("ZB", "valve_converged", "\"valve\":%u,\"state\":\"%s\"", v, on ? "open" : "closed");
+    }
+    setConf(vl, VALVE_CONF_OK);
+  } else if (vl->conf != VALVE_CONF_DIVERGED) {
+    diverge(vl, "report");
+  }
+
+  if (v != VALVE_DEFAULT) {
+    if (changed || vl->conf != was) appLogValveData(v);
+    return;
+  }
+  // the legacy @DATA carries the state, the per-valve one the confirmation
+  if (vl->conf != was) appLogValveData(v);
+  if (changed) {
+    lcd_ui_set_valve(vl->open);
+    appLogData();
+    valveCtrlAutoControl();
+  }
+}
+
+static void applyReports(void)
+{
+  g_repReady = false;
+  for (uint8_t v = 0; v < VALVE_TABLE_MAX; v++) {
+    if (g_valves[v].repDirty) applyReport(v);
+  }
+}
+
+void valveCtrlTick(void)
+{
+  if (g_repReady) applyReports();   // before checkConf(): a report in hand beats the deadline
+  if (g_txBusy) checkTx();
+  if (g_confWait) checkConf();
+  if (!g_pendReady) return;
+  g_pendReady = false;
+
+  // round-robin so a busy low index cannot starve the rest under the cap
+  for (uint8_t k = 0; k < VALVE_TABLE_MAX; k++) {
+    uint8_t v = (uint8_t)((g_pendNext + k) % VALVE_TABLE_MAX);
+    Valve_t *vl = &g_valves[v];
+    if (!vl->pend.active || vl->tx.active) continue;
+    if (g_txInFlight >= VALVE_TX_MAX_INFLIGHT) {
+      g_pendNext = v;
+      return;
+    }
+    vl->pend.active = false;
+    (void)startTx(v, vl->pend.cmdId, vl->pend.wantOpen);
+  }
+}
+
+// State the valve is heading to: pending, in flight, awaiting its report,
+// then the valve state
+static bool targetOpen(const Valve_t *vl)
+{
+  if (vl->pend.active) return vl->pend.wantOpen;
+  if (vl->tx.active) return vl->tx.wantOpen;
+  if (vl->conf == VALVE_CONF_WAIT) return vl->cmdOpen;
+  return vl->open;
+}
+
 void valveCtrlAutoControl(void)
 {
   if (g_mode != MODE_AUTO) return;
+  // compare against where the valve is going, not where it was confirmed,
+  // so a decision is queued once and not again on every report
+  bool open = targetOpen(&g_valves[VALVE_DEFAULT]);
+
+  // leak alarm on the primary sensor (leak.h): hold the valve closed
+  // until leak_clear
+  if (leakValveLockEval()) {
+    if (open) (void)valveCtrlQueueTx(VALVE_DEFAULT, 0, false);
+    return;
+  }
+
+  // primary sensor stale (stale.h): its last flow is meaningless, go to
+  // the configured safe state instead
+  if (staleFailSafe()) {
+    bool safeOpen = staleSafeOpen();
+    if (open != safeOpen) (void)valveCtrlQueueTx(VALVE_DEFAULT, 0, safeOpen);
+    return;
+  }
 
-  // hysteresis
-  if (g_valveOpen) {
-    if (g_flow > g_flowCloseTh) {
-      (void)valveCtrlQueueTx(0, false);
+  // hysteresis on the filtered flow (flow_filter.h)
+  if (open) {
+    if (g_flowFiltered > g_flowCloseTh) {
+      (void)valveCtrlQueueTx(VALVE_DEFAULT, 0, false);
     }
   } else {
-    if (g_flow < g_flowOpenTh) {
-      (void)valveCtrlQueueTx(0, true);
+    if (g_flowFiltered < g_flowOpenTh) {
+      (void)valveCtrlQueueTx(VALVE_DEFAULT, 0, true);
     }
   }
 }
@@ -153,29 +620,53 @@ void valveCtrlSetThresholds(uint16_t closeTh, uint16_t openTh)
   g_flowOpenTh  = openTh;
 }
 
-void valveCtrlSetPath(valve_path_t p) { g_valvePath = p; }
+void valveCtrlSetPath(uint8_t v, valve_path_t p)
+{
+  Valve_t *vl = valveAt(v);
+  if (vl) vl->path = p;
+}
 
-void valveCtrlSetTarget(EmberNodeId nodeId, uint8_t dstEp)
+void valveCtrlSetTarget(uint8_t v, EmberNodeId nodeId, uint8_t dstEp)
 {
-  g_valveNodeId = nodeId;
-  g_valveDstEp  = dstEp;
+  Valve_t *vl = valveAt(v);
+  if (!vl) return;
+  vl->nodeId = nodeId;
+  vl->dstEp  = dstEp;
+  pathStatsReset(vl);
+  confReset(vl);
 }
 
-bool valveCtrlPair(const char *eui64Str, EmberNodeId nodeId, uint8_t bindIndex, uint8_t dstEp)
+bool valveCtrlPair(uint8_t v, const char *eui64Str, EmberNodeId nodeId, uint8_t bindIndex, uint8_t dstEp)
 {
+  Valve_t *vl = valveAt(v);
   EmberEUI64 euiLe;
-  if (!parseHexEui64(eui64Str, euiLe)) return false;
+  if (!vl || !parseHexEui64(eui64Str, euiLe)) return false;
 
-  g_valveKnown = true;
-  memcpy(g_valveEuiLe, euiLe, EUI64_SIZE);
-  g_valveNodeId = nodeId;
-  g_valveBindIndex = bindIndex;
-  g_valveDstEp = dstEp;
+  vl->known = true;
+  memcpy(vl->euiLe, euiLe, EUI64_SIZE);
+  vl->nodeId = nodeId;
+  vl->bindIndex = bindIndex;
+  vl->dstEp = dstEp;
+  pathStatsReset(vl);
+  confReset(vl);
 
-  (void)emberSetBindingRemoteNodeId(g_valveBindIndex, g_valveNodeId);
+  (void)emberSetBindingRemoteNodeId(vl->bindIndex, vl->nodeId);
   return true;
 }
 
+// The valve whose in-flight On/Off frame this is: same path and
+// destination, same APS sequence number
+static int8_t matchTx(EmberOutgoingMessageType type, uint16_t indexOrDestination, uint8_t apsSeq)
+{
+  bool direct = (type == EMBER_OUTGOING_DIRECT);
+  for (uint8_t v = 0; v < VALVE_TABLE_MAX; v++) {
+    const TxTrack_t *tx = &g_valves[v].tx;
+    if (!tx->inFlight || tx->usedDirect != direct) continue;
+    if (tx->dstOrIndex == indexOrDestination && tx->apsSeq == apsSeq) return (int8_t)v;
+  }
+  return -1;
+}
+
 // FINAL TX result callback (exact signature you used)
 bool emberAfMessageSentCallback(EmberOutgoingMessageType type,
                                uint16_t indexOrDestination,
@@ -184,49 +675,98 @@ bool emberAfMessageSentCallback(EmberOutgoingMessageType type,
                                uint8_t *messageContents,
                                EmberStatus status)
 {
-  (void)type;
-  (void)indexOrDestination;
   (void)messageLength;
   (void)messageContents;
 
   if (!apsFrame) return false;
 
   if (apsFrame->clusterId == ZCL_ON_OFF_CLUSTER_ID && apsFrame->sourceEndpoint == COORD_EP_CONTROL) {
-    if (g_tx.active) {
-      bool txOk = (status == EMBER_SUCCESS);
-      
-      // A2: Send final @ACK only for valid command IDs (not auto mode id=0)
-      if (g_tx.cmdId != 0) {
-        if (txOk) {
-          appLogAckZb(g_tx.cmdId, true, "done", status, "done");
-        } else {
-          appLogAckZb(g_tx.cmdId, false, "tx_failed", status, "done");
-        }
-      }
-      
-      // A1: Always log tx result for debugging
-      appLogLog("ZB", txOk ? "tx_done" : "tx_fail",
-        "\"id\":%lu,\"zstatus\":\"0x%02X\",\"path\":\"%s\",\"dst\":\"0x%04X\",\"want\":\"%s\"",
-        (unsigned long)g_tx.cmdId,
-        (unsigned)status,
-        g_tx.usedDirect ? "direct" : "binding",
-        (unsigned)g_tx.dstOrIndex,
-        g_tx.wantOpen ? "open" : "close"
-      );
-
-      if (txOk) {
-        g_valveOpen = g_tx.wantOpen;
-        lcd_ui_set_valve(g_valveOpen);  // Update LCD when valve state confirmed
-      }
-
-      g_tx.active = false;
-      appLogData();
+    int8_t v = matchTx(type, indexOrDestination, apsFrame->sequence);
+    if (v < 0) {
+      appLogLog("ZB", "tx_unmatched", "\"dst\":\"0x%04X\",\"aps_seq\":%u,\"zstatus\":\"0x%02X\"",
+                (unsigned)indexOrDestination, (unsigned)apsFrame->sequence, (unsigned)status);
+      return false;
     }
+
+    Valve_t *vl = &g_valves[v];
+    TxTrack_t *tx = &vl->tx;
+    bool txOk = (status == EMBER_SUCCESS);
+    tx->inFlight = false;
+    if (g_txInFlight) g_txInFlight--;
+    pathStatsAdd(&vl->ps[tx->usedDirect ? PS_DIRECT : PS_BINDING], txOk, msTick() - tx->sentMs);
+
+    // A1: Always log tx result for debugging
+    appLogLog("ZB", txOk ? "tx_done" : "tx_fail",
+      "\"id\":%lu,\"valve\":%u,\"zstatus\":\"0x%02X\",\"path\":\"%s\",\"dst\":\"0x%04X\",\"want\":\"%s\",\"try\":%u",
+      (unsigned long)tx->cmdId,
+      (unsigned)v,
+      (unsigned)status,
+      tx->usedDirect ? "direct" : "binding",
+      (unsigned)tx->dstOrIndex,
+      tx->wantOpen ? "open" : "close",
+      (unsigned)tx->tries
+    );
+
+    if (!txOk) {
+      retryTx((uint8_t)v, false, status);   // final @ACK once retries are used up
+      return false;
+    }
+
+    g_txStats.ok++;
+    latStatsRecord(LAT_ST_VALVE_TTS, tx->firstTicks);
+    latStatsMark(tx->cmdId, LAT_PT_SENT);
+
+    // A2: Send final @ACK only for valid command IDs (not auto mode id=0)
+    if (tx->cmdId != 0) appLogAckZb(tx->cmdId, true, "done", status, "done");
+
+    // a valve that reports confirms the state itself (valveCtrlReport)
+    if (!vl->reports) {
+      vl->open = tx->wantOpen;
+      if (v == VALVE_DEFAULT) lcd_ui_set_valve(vl->open);
+    }
+    endTx((uint8_t)v);
   }
 
   return false;
 }
 
+// ===== ONOFF REPORTS =====
+
+bool valveCtrlFindByNodeId(EmberNodeId nodeId, uint8_t *v)
+{
+  if (nodeId == EMBER_NULL_NODE_ID) return false;
+  for (uint8_t k = 0; k < VALVE_TABLE_MAX; k++) {
+    if (g_valves[k].nodeId != nodeId) continue;
+    *v = k;
+    return true;
+  }
+  return false;
+}
+
+// false = duplicate or late report (same rules as the sensors)
+static bool acceptReportSeq(const Valve_t *vl, uint8_t seq)
+{
+  if (!vl->reports && !vl->repDirty) return true;
+  uint8_t d = (uint8_t)(seq - vl->lastSeq);
+  if (d == 0) return false;
+  if (d < 0x80u) return true;
+  return (uint8_t)(vl->lastSeq - seq) > SEQ_REORDER_WINDOW;   // far behind: restarted
+}
+
+// Stack callback context: only store the state; valveCtrlTick() applies
+// it. A newer report before the tick replaces the stored one.
+void valveCtrlReport(uint8_t v, uint8_t seq, bool on)
+{
+  Valve_t *vl = valveAt(v);
+  if (!vl || !acceptReportSeq(vl, seq)) return;
+
+  vl->lastSeq = seq;
+  vl->repOn = on;
+  vl->repDirty = true;
+  g_confStats.reports++;
+  g_repReady = true;
+}
+
 // Trust Center join callback (exact signature you used)
 void emberAfTrustCenterJoinCallback(EmberNodeId newNodeId,
                                    EmberEUI64 newNodeEui64,
@@ -251,37 +791,100 @@ void emberAfTrustCenterJoinCallback(EmberNodeId newNodeId,
   );
 #endif
 
-  if (!g_valveKnown) return;
+  sensorTableNoteJoin(newNodeId, newNodeEui64);
+
+  for (uint8_t v = 0; v < VALVE_TABLE_MAX; v++) {
+    Valve_t *vl = &g_valves[v];
+    if (!vl->known || memcmp(newNodeEui64, vl->euiLe, EUI64_SIZE) != 0) continue;
 
-  if (memcmp(newNodeEui64, g_valveEuiLe, EUI64_SIZE) == 0) {
-    g_valveNodeId = newNodeId;
-    (void)emberSetBindingRemoteNodeId(g_valveBindIndex, newNodeId);
+    vl->nodeId = newNodeId;
+    (void)emberSetBindingRemoteNodeId(vl->bindIndex, newNodeId);
+    pathStatsReset(vl);   // rejoined: old routes say nothing
 
     appLogLog("ZB", "valve_nodeid_update",
-      "\"node_id\":\"0x%04X\",\"status\":%u",
-      (unsigned)newNodeId, (unsigned)status
+      "\"valve\":%u,\"node_id\":\"0x%04X\",\"status\":%u",
+      v, (unsigned)newNodeId, (unsigned)status
     );
     appLogInfo();
+    break;
   }
 }
 
 
 // ===== getters =====
-bool valveCtrlIsOpen(void) { return g_valveOpen; }
-bool valveCtrlTxActive(void) { return g_tx.active; }
-valve_path_t valveCtrlGetPath(void) { return g_valvePath; }
+bool valveCtrlIsOpen(uint8_t v) { const Valve_t *vl = valveAt(v); return vl && vl->open; }
+bool valveCtrlTxActive(uint8_t v) { const Valve_t *vl = valveAt(v); return vl && vl->tx.active; }
+bool valveCtrlTxQueued(uint8_t v) { const Valve_t *vl = valveAt(v); return vl && vl->pend.active; }
+
+valve_path_t valveCtrlGetPath(uint8_t v)
+{
+  const Valve_t *vl = valveAt(v);
+  return vl ? vl->path : VALVE_PATH_AUTO;
+}
 
-const char *valveCtrlPathStr(void)
+const char *valveCtrlPathStr(uint8_t v)
 {
-  switch (g_valvePath) {
+  switch (valveCtrlGetPath(v)) {
     case VALVE_PATH_DIRECT:  return "direct";
     case VALVE_PATH_BINDING: return "binding";
     default: return "auto";
   }
 }
 
-bool valveCtrlIsKnown(void) { return g_valveKnown; }
-EmberNodeId valveCtrlGetNodeId(void) { return g_valveNodeId; }
-uint8_t valveCtrlGetBindIndex(void) { return g_valveBindIndex; }
-uint8_t valveCtrlGetDstEp(void) { return g_valveDstEp; }
-const EmberEUI64 *valveCtrlGetEuiLe(void) { return &g_valveEuiLe; }
+valve_conf_t valveCtrlConf(uint8_t v)
+{
+  const Valve_t *vl = valveAt(v);
+  return vl ? vl->conf : VALVE_CONF_NONE;
+}
+
+const char *valveCtrlConfStr(uint8_t v)
+{
+  switch (valveCtrlConf(v)) {
+    case VALVE_CONF_OK:       return "ok";
+    case VALVE_CONF_WAIT:     return "wait";
+    case VALVE_CONF_DIVERGED: return "diverged";
+    default: return "none";
+  }
+}
+
+uint16_t valveCtrlConfirmMs(uint8_t v) { const Valve_t *vl = valveAt(v); return vl ? vl->confMs : 0u; }
+const ValveConfStats_t *valveCtrlConfStats(void) { return &g_confStats; }
+
+bool valveCtrlIsKnown(uint8_t v) { const Valve_t *vl = valveAt(v); return vl && vl->known; }
+
+EmberNodeId valveCtrlGetNodeId(uint8_t v)
+{
+  const Valve_t *vl = valveAt(v);
+  return vl ? vl->nodeId : EMBER_NULL_NODE_ID;
+}
+
+uint8_t valveCtrlGetBindIndex(uint8_t v) { const Valve_t *vl = valveAt(v); return vl ? vl->bindIndex : 0u; }
+uint8_t valveCtrlGetDstEp(uint8_t v) { const Valve_t *vl = valveAt(v); return vl ? vl->dstEp : VALVE_EP_DEFAULT; }
+
+const EmberEUI64 *valveCtrlGetEuiLe(uint8_t v)
+{
+  const Valve_t *vl = valveAt(v);
+  return vl ? &vl->euiLe : NULL;
+}
+
+uint8_t valveCtrlKnownCount(void)
+{
+  uint8_t n = 0;
+  for (uint8_t v = 0; v < VALVE_TABLE_MAX; v++) {
+    if (g_valves[v].known) n++;
+  }
+  return n;
+}
+
+uint8_t valveCtrlTxInFlight(void) { return g_txInFlight; }
+const ValveTxStats_t *valveCtrlTxStats(void) { return &g_txStats; }
+
+void valveCtrlPathStats(uint8_t v, bool direct, uint16_t *latMs, uint8_t *okPct, uint16_t *n)
+{
+  const Valve_t *vl = valveAt(v);
+  const PathStats_t *ps = vl ? &vl->ps[direct ? PS_DIRECT : PS_BINDING] : NULL;
+  uint32_t lat = ps ? (ps->latQ4 + 8u) >> 4 : 0u;
+  *latMs = (lat > 0xFFFFu) ? 0xFFFFu : (uint16_t)lat;
+  *okPct = ps ? (uint8_t)(((uint64_t)ps->okQ16 * 100u + 32768u) >> 16) : 0u;
+  *n = ps ? ps->n : 0u;
+}
@@ -6,27 +6,119 @@
 
 #include "app/framework/include/af.h"
 #include "stack/include/ember.h"
+#include "app_config.h"
 
+// VALVE_PATH_AUTO: per valve and path, every attempt feeds an EWMA of the
+// delivery latency (send -> emberAfMessageSentCallback) and of the
+// delivery ratio. A command takes the path with the lower expected time
+// to deliver (switching only when the other is 1/4 better), and every
+// VALVE_PROBE_EVERY-th one takes the other path.
+// Without a node ID it always takes binding, and without a valve_pair
+// binding it always takes direct. Statistics restart on
+// valve_target_set, valve_pair and rejoin.
 typedef enum { VALVE_PATH_AUTO=0, VALVE_PATH_DIRECT=1, VALVE_PATH_BINDING=2 } valve_path_t;
 
-bool valveCtrlQueueTx(uint32_t id, bool wantOpen);
+// ===== VALVE TABLE =====
+// Up to VALVE_TABLE_MAX valves, addressed by index (the "valve" argument
+// of the valve ops, default 0). Each valve has its own identity (EUI64,
+// node ID, binding index, endpoint), path and TX slot, so commands to
+// different valves are in flight at the same time; at most
+// VALVE_TX_MAX_INFLIGHT overall (APS unicast buffers of the stack).
+// emberAfMessageSentCallback() is matched back to its valve by
+// destination (node ID or binding index) and APS sequence number.
+//
+// VALVE_DEFAULT is the valve of the primary sensor: AUTO control, leak /
+// stale fail-safe, LCD and the legacy valve fields of @DATA / @INFO.
+#define VALVE_DEFAULT  0u
+
+void valveCtrlInit(void);
+
+// A command to a valve whose TX slot is busy (or with VALVE_TX_MAX_INFLIGHT
+// reached) waits in the valve's single pending slot. A newer command
+// replaces it; the replaced id is ACKed "superseded". valveCtrlTick()
+// (main tick) sends pending commands once TX slots free up.
+//
+// Each attempt has a deadline (VALVE_TX_DEADLINE_MS). A delivery failure
+// or a missing emberAfMessageSentCallback() is retried up to
+// VALVE_TX_RETRIES times after an exponential backoff with jitter; with
+// path AUTO the retries alternate between direct and binding. The final
+// @ACK is "done", "tx_failed" or "tx_timeout", within VALVE_CMD_BUDGET_MS
+// (app_config.h); a retry of the ID meanwhile is answered "in_flight".
+bool valveCtrlQueueTx(uint8_t v, uint32_t id, bool wantOpen);
+void valveCtrlTick(void);
 void valveCtrlAutoControl(void);
 
-void valveCtrlSetPath(valve_path_t p);
-void valveCtrlSetTarget(EmberNodeId nodeId, uint8_t dstEp);
-bool valveCtrlPair(const char *eui64Str, EmberNodeId nodeId, uint8_t bindIndex, uint8_t dstEp);
+void valveCtrlSetPath(uint8_t v, valve_path_t p);
+void valveCtrlSetTarget(uint8_t v, EmberNodeId nodeId, uint8_t dstEp);
+bool valveCtrlPair(uint8_t v, const char *eui64Str, EmberNodeId nodeId, uint8_t bindIndex, uint8_t dstEp);
 void valveCtrlSetThresholds(uint16_t closeTh, uint16_t openTh);
 
-// getters for logs/info
-bool valveCtrlIsOpen(void);
-bool valveCtrlTxActive(void);
-valve_path_t valveCtrlGetPath(void);
-const char *valveCtrlPathStr(void);
-
-bool valveCtrlIsKnown(void);
-EmberNodeId valveCtrlGetNodeId(void);
-uint8_t valveCtrlGetBindIndex(void);
-uint8_t valveCtrlGetDstEp(void);
-const EmberEUI64 *valveCtrlGetEuiLe(void);
+// ===== CONFIRMED STATE =====
+// A valve node reports its OnOff attribute on change, after every On/Off
+// command and periodically; telemetry_rx.c hands the reports of valve
+// node IDs to valveCtrlReport(), which runs in the stack callback and
+// only stores the state; valveCtrlTick() applies it (confirmation, LCD,
+// @DATA, AUTO), so nothing is sent from the callback. Once a valve has
+// reported, only its reports set its state (valveCtrlIsOpen); before
+// that, a delivered command does.
+// The commanded state is the last command sent. After a command the valve
+// is "wait" until a report shows the commanded state ("ok"; first send ->
+// report is lat stage valve_confirm). Without one VALVE_CONFIRM_MS after
+// the command finished (lost actuation, lost report), or on a report that
+// leaves the commanded state (manual button, valve reset), it is
+// "diverged" until a report or a command matches again. AUTO re-decides
+// on the confirmed state of VALVE_DEFAULT.
+typedef enum {
+  VALVE_CONF_NONE = 0,      // no report yet: state from delivery
+  VALVE_CONF_OK = 1,        // reported state == commanded
+  VALVE_CONF_WAIT = 2,      // command sent, report not in yet
+  VALVE_CONF_DIVERGED = 3,  // reported state != commanded
+} valve_conf_t;
+
+bool valveCtrlFindByNodeId(EmberNodeId nodeId, uint8_t *v);
+// seq: ZCL sequence number; duplicates and late reports are dropped
+// (rules of telemetry_rx.h)
+void valveCtrlReport(uint8_t v, uint8_t seq, bool on);
+
+valve_conf_t valveCtrlConf(uint8_t v);
+const char *valveCtrlConfStr(uint8_t v);
+uint16_t valveCtrlConfirmMs(uint8_t v);   // last confirmation latency
+
+typedef struct {
+  uint32_t reports;      // OnOff reports taken
+  uint32_t confirmed;    // commands confirmed by a report (lat stage valve_confirm)
+  uint32_t unconfirmed;  // commands without a confirming report in VALVE_CONFIRM_MS
+  uint32_t diverged;     // changes to "diverged"
+} ValveConfStats_t;
+
+const ValveConfStats_t *valveCtrlConfStats(void);
+
+// getters for logs/info (out-of-range v: closed / unknown defaults)
+bool valveCtrlIsOpen(uint8_t v);
+bool valveCtrlTxActive(uint8_t v);
+bool valveCtrlTxQueued(uint8_t v);    // pending slot in use
+valve_path_t valveCtrlGetPath(uint8_t v);
+const char *valveCtrlPathStr(uint8_t v);
+
+bool valveCtrlIsKnown(uint8_t v);
+EmberNodeId valveCtrlGetNodeId(uint8_t v);
+uint8_t valveCtrlGetBindIndex(uint8_t v);
+uint8_t valveCtrlGetDstEp(uint8_t v);
+const EmberEUI64 *valveCtrlGetEuiLe(uint8_t v);
+
+uint8_t valveCtrlKnownCount(void);     // paired valves
+uint8_t valveCtrlTxInFlight(void);     // TX slots in use
+
+typedef struct {
+  uint32_t ok;         // commands delivered (time to success: lat stage valve_tts)
+  uint32_t fail;       // commands given up after VALVE_TX_RETRIES
+  uint32_t retries;    // attempts after the first
+  uint32_t timeouts;   // attempts without emberAfMessageSentCallback()
+} ValveTxStats_t;
+
+const ValveTxStats_t *valveCtrlTxStats(void);
+
+// Path statistics: latency EWMA (ms), delivery ratio (%), attempts
+void valveCtrlPathStats(uint8_t v, bool direct, uint16_t *latMs, uint8_t *okPct, uint16_t *n);
 
 #endif
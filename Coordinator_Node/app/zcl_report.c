@@ -0,0 +1,94 @@
+#include "zcl_report.h"
+
+// ZCL data type -> value size in bytes (ZCL spec, table 2-10)
+static const uint8_t s_typeSize[256] = {
+  [0x00] = ZCL_SIZE_NODATA,                         // no data
+  [0x08] = 1, [0x09] = 2, [0x0A] = 3, [0x0B] = 4,   // data8 .. data64
+  [0x0C] = 5, [0x0D] = 6, [0x0E] = 7, [0x0F] = 8,
+  [0x10] = 1,                                       // boolean
+  [0x18] = 1, [0x19] = 2, [0x1A] = 3, [0x1B] = 4,   // bitmap8 .. bitmap64
+  [0x1C] = 5, [0x1D] = 6, [0x1E] = 7, [0x1F] = 8,
+  [0x20] = 1, [0x21] = 2, [0x22] = 3, [0x23] = 4,   // uint8 .. uint64
+  [0x24] = 5, [0x25] = 6, [0x26] = 7, [0x27] = 8,
+  [0x28] = 1, [0x29] = 2, [0x2A] = 3, [0x2B] = 4,   // int8 .. int64
+  [0x2C] = 5, [0x2D] = 6, [0x2E] = 7, [0x2F] = 8,
+  [0x30] = 1, [0x31] = 2,                           // enum8, enum16
+  [0x38] = 2, [0x39] = 4, [0x3A] = 8,               // semi, single, double
+  [0x41] = ZCL_SIZE_STR8,  [0x42] = ZCL_SIZE_STR8,  // octet / char string
+  [0x43] = ZCL_SIZE_STR16, [0x44] = ZCL_SIZE_STR16, // long octet / char string
+  [0xE0] = 4, [0xE1] = 4, [0xE2] = 4,               // time of day, date, UTC
+  [0xE8] = 2, [0xE9] = 2, [0xEA] = 4,               // cluster id, attr id, BACnet OID
+  [0xF0] = 8, [0xF1] = 16,                          // IEEE address, 128-bit key
+};
+
+uint8_t zclTypeSize(uint8_t type) { return s_typeSize[type]; }
+
+zcl_report_status_t zclReportDecode(uint16_t cluster, const uint8_t *p, uint16_t len,
+                                    ZclAttrFn fn, void *ctx)
+{
+  uint16_t i = 0;
+
+  while (i < len) {
+    if ((uint32_t)i + 3u > len) return ZCL_REPORT_TRUNCATED;
+
+    ZclAttr_t a;
+    a.cluster = cluster;
+    a.attrId = (uint16_t)p[i] | ((uint16_t)p[i + 1] << 8);
+    a.type = p[i + 2];
+    i = (uint16_t)(i + 3u);
+
+    uint8_t size = s_typeSize[a.type];
+    uint32_t n;
+    if (size == ZCL_SIZE_UNKNOWN) {
+      return ZCL_REPORT_BAD_TYPE;
+    } else if (size == ZCL_SIZE_NODATA) {
+      n = 0;
+    } else if (size == ZCL_SIZE_STR8) {
+      if ((uint32_t)i + 1u > len) return ZCL_REPORT_TRUNCATED;
+      n = p[i];
+      if (n == 0xFFu) n = 0;             // invalid / not present
+      i = (uint16_t)(i + 1u);
+    } else if (size == ZCL_SIZE_STR16) {
+      if ((uint32_t)i + 2u > len) return ZCL_REPORT_TRUNCATED;
+      n = (uint32_t)p[i] | ((uint32_t)p[i + 1] << 8);
+      if (n == 0xFFFFu) n = 0;
+      i = (uint16_t)(i + 2u);
+    } else {
+      n = size;
+    }
+
+    if ((uint32_t)i + n > len) return ZCL_REPORT_TRUNCATED;
+    a.val = &p[i];
+    a.len = (uint16_t)n;
+    i = (uint16_t)(i + n);
+
+    if (fn) fn(ctx, &a);
+  }
+  return ZCL_REPORT_OK;
+}
+
+static bool isUnsignedInt(uint8_t type)
+{
+  return (type >= 0x08 && type <= 0x0F) || (type >= 0x18 && type <= 0x27)
+      || type == 0x10 || type == 0x30 || type == 0x31;
+}
+
+bool zclAttrU32(const ZclAttr_t *attr, uint32_t *out)
+{
+  if (!attr || !isUnsignedInt(attr->type) || attr->len == 0 || attr->len > 4) return false;
+  uint32_t v = 0;
+  for (uint8_t k = 0; k < attr->len; k++) v |= (uint32_t)attr->val[k] << (8u * k);
+  *out = v;
+  return true;
+}
+
+bool zclAttrS32(const ZclAttr_t *attr, int32_t *out)
+{
+  if (!attr || attr->type < 0x28 || attr->type > 0x2B || attr->len == 0 || attr->len > 4) return false;
+  uint32_t v = 0;
+  for (uint8_t k = 0; k < attr->len; k++) v |= (uint32_t)attr->val[k] << (8u * k);
+  uint8_t bits = (uint8_t)(8u * attr->len);
+  if (bits < 32u && (v & (1u << (bits - 1u)))) v |= ~((1u << bits) - 1u);
+  *out = (int32_t)v;
+  return true;
+}
@@ -0,0 +1,49 @@
+#ifndef ZCL_REPORT_H
+#define ZCL_REPORT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// ===== ZCL REPORT ATTRIBUTES DECODER =====
+// Walks the attribute records of a Report Attributes payload:
+//   attrId(2, LE) | type(1) | value(size from type)
+// Value sizes come from a compile-time type table, so records the caller
+// does not care about are stepped over instead of ending the walk.
+// Every read is bounds-checked against the payload length; the walk stops
+// at the first truncated record or at a type whose size cannot be derived
+// (array / set / bag / structure).
+
+// zclTypeSize() specials
+#define ZCL_SIZE_UNKNOWN   0u     // cannot be skipped
+#define ZCL_SIZE_NODATA    0xFDu  // no data (0x00): zero-length value
+#define ZCL_SIZE_STR8      0xFEu  // 1-byte length prefix (octet / char string)
+#define ZCL_SIZE_STR16     0xFFu  // 2-byte length prefix (long strings)
+
+typedef struct {
+  uint16_t       cluster;
+  uint16_t       attrId;
+  uint8_t        type;
+  const uint8_t *val;   // value bytes (string data without the length prefix)
+  uint16_t       len;
+} ZclAttr_t;
+
+typedef enum {
+  ZCL_REPORT_OK = 0,        // payload fully consumed
+  ZCL_REPORT_TRUNCATED,     // a record ran past the payload end
+  ZCL_REPORT_BAD_TYPE,      // type with no derivable size
+} zcl_report_status_t;
+
+typedef void (*ZclAttrFn)(void *ctx, const ZclAttr_t *attr);
+
+// Calls fn for every complete record, in order
+zcl_report_status_t zclReportDecode(uint16_t cluster, const uint8_t *p, uint16_t len,
+                                    ZclAttrFn fn, void *ctx);
+
+uint8_t zclTypeSize(uint8_t type);
+
+// Integer value of a fixed-size numeric attribute (data/bitmap/uint/enum up to 32 bits)
+bool zclAttrU32(const ZclAttr_t *attr, uint32_t *out);
+// Sign-extended value of an intN attribute (int8 .. int32)
+bool zclAttrS32(const ZclAttr_t *attr, int32_t *out);
+
+#endif
@@ -6,12 +6,103 @@
 #include "zap-id.h"
 #include "stack/include/ember.h"
 
+// Fallback defines (build stable even if autogen issues)
+#ifndef ZCL_REPORT_ATTRIBUTES_COMMAND_ID
+#define ZCL_REPORT_ATTRIBUTES_COMMAND_ID 0x0A
+#endif
+
+#ifndef ZCL_BOOLEAN_ATTRIBUTE_TYPE
+#define ZCL_BOOLEAN_ATTRIBUTE_TYPE 0x10
+#endif
+
+// ===== CONFIG =====
+#define VALVE_EP             1
+#define COORD_EP_TELEM       1
+#define COORD_NODE_ID        0x0000
+
+// OnOff reports to the coordinator (its confirmed valve state): on every
+// change and after every On/Off command, at most one per
+// REPORT_MIN_INTERVAL_MS (changes inside the interval go out together as
+// the latest state), and every REPORT_MAX_INTERVAL_MS so a lost report
+// does not stick
+#define REPORT_MIN_INTERVAL_MS   1000u
+#define REPORT_MAX_INTERVAL_MS   300000u
+
+// ===== STATE =====
+static sl_zigbee_event_t reportEvent;
+static uint32_t lastReportMs = 0;
+static bool     reportSent = false;   // lastReportMs valid
+
+static bool readOnOff(uint8_t *onOff)
+{
+  EmberAfStatus st = emberAfReadServerAttribute(VALVE_EP,
+                                               ZCL_ON_OFF_CLUSTER_ID,
+                                               ZCL_ON_OFF_ATTRIBUTE_ID,
+                                               onOff,
+                                               sizeof(*onOff));
+  if (st != EMBER_ZCL_STATUS_SUCCESS) {
+    emberAfCorePrintln("Read OnOff attr err: 0x%02X", st);
+    return false;
+  }
+  return true;
+}
+
+// ===== ONOFF REPORT =====
+
+static void reportEventHandler(sl_zigbee_event_t *event)
+{
+  (void)event;
+
+  if (emberAfNetworkState() != EMBER_JOINED_NETWORK) return;
+
+  uint8_t onOff = 0;
+  if (!readOnOff(&onOff)) return;
+
+  emberAfFillExternalBuffer(
+      (ZCL_GLOBAL_COMMAND | ZCL_FRAME_CONTROL_SERVER_TO_CLIENT),
+      ZCL_ON_OFF_CLUSTER_ID,
+      ZCL_REPORT_ATTRIBUTES_COMMAND_ID,
+      "vuu",                  // attrId(u16), type(u8), value(u8)
+      ZCL_ON_OFF_ATTRIBUTE_ID,
+      ZCL_BOOLEAN_ATTRIBUTE_TYPE,
+      onOff);
+
+  emberAfSetCommandEndpoints(VALVE_EP, COORD_EP_TELEM);
+  EmberStatus st = emberAfSendCommandUnicast(EMBER_OUTGOING_DIRECT, COORD_NODE_ID);
+  emberAfCorePrintln("TX onoff=%u st=0x%02X", onOff, st);
+
+  if (st != EMBER_SUCCESS) {
+    // no buffer / no route yet: try again after the minimum interval
+    sl_zigbee_event_set_delay_ms(&reportEvent, REPORT_MIN_INTERVAL_MS);
+    return;
+  }
+  lastReportMs = halCommonGetInt32uMillisecondTick();
+  reportSent = true;
+  sl_zigbee_event_set_delay_ms(&reportEvent, REPORT_MAX_INTERVAL_MS);
+}
+
+// Report the current state as soon as the minimum interval allows; the
+// handler reads the attribute when it runs, so only the latest state goes out
+static void scheduleReport(void)
+{
+  if (emberAfNetworkState() != EMBER_JOINED_NETWORK) return;
+
+  uint32_t delay = 0;
+  if (reportSent) {
+    uint32_t elapsed = halCommonGetInt32uMillisecondTick() - lastReportMs;
+    if (elapsed < REPORT_MIN_INTERVAL_MS) delay = REPORT_MIN_INTERVAL_MS - elapsed;
+  }
+  sl_zigbee_event_set_delay_ms(&reportEvent, delay);
+}
+
 void emberAfMainInitCallback(void)
 {
   emberAfCorePrintln("Valve init: RxOnWhenIdle=1 -> start steering");
   
   // Enable button press callbacks (disabled by default)
   app_button_press_enable();
+
+  sl_zigbee_event_init(&reportEvent, reportEventHandler);
   
   if (emberAfNetworkState() != EMBER_JOINED_NETWORK) {
     EmberStatus st = emberAfPluginNetworkSteeringStart();
@@ -19,6 +110,17 @@ void emberAfMainInitCallback(void)
   }
 }
 
+void emberAfStackStatusCallback(EmberStatus status)
+{
+  if (status == EMBER_NETWORK_UP) {
+    // (re)joined: tell the coordinator where the valve stands
+    reportSent = false;
+    scheduleReport();
+  } else if (status == EMBER_NETWORK_DOWN) {
+    sl_zigbee_event_set_inactive(&reportEvent);
+  }
+}
+
 void emberAfPluginNetworkSteeringCompleteCallback(EmberStatus status,
                                                  uint8_t totalBeacons,
                                                  uint8_t joinAttempts,
@@ -39,16 +141,11 @@ void emberAfPostAttributeChangeCallback(uint8_t endpoint,
 {
   (void)mask; (void)manufacturerCode; (void)type; (void)size; (void)value;
 
-  if (endpoint == 1 && clusterId == ZCL_ON_OFF_CLUSTER_ID &&
+  if (endpoint == VALVE_EP && clusterId == ZCL_ON_OFF_CLUSTER_ID &&
       attributeId == ZCL_ON_OFF_ATTRIBUTE_ID) {
 
     uint8_t onOffValue = 0;
-    EmberAfStatus st = emberAfReadServerAttribute(endpoint,
-                                                 ZCL_ON_OFF_CLUSTER_ID,
-                                                 ZCL_ON_OFF_ATTRIBUTE_ID,
-                                                 &onOffValue,
-                                                 sizeof(onOffValue));
-    if (st == EMBER_ZCL_STATUS_SUCCESS) {
+    if (readOnOff(&onOffValue)) {
       if (onOffValue) {
         sl_led_turn_on(&sl_led_led0);
         emberAfCorePrintln("Valve OPEN (ON) -> LED ON");
@@ -56,8 +153,7 @@ void emberAfPostAttributeChangeCallback(uint8_t endpoint,
         sl_led_turn_off(&sl_led_led0);
         emberAfCorePrintln("Valve CLOSE (OFF) -> LED OFF");
       }
-    } else {
-      emberAfCorePrintln("Read OnOff attr err: 0x%02X", st);
+      scheduleReport();
     }
   }
 }
@@ -69,6 +165,10 @@ bool emberAfPreCommandReceivedCallback(EmberAfClusterCommand *cmd)
   if (cmd->apsFrame->clusterId == ZCL_ON_OFF_CLUSTER_ID) {
     emberAfCorePrintln("RX OnOff: cmdId=0x%02X src=0x%04X ep=%u",
                        cmd->commandId, cmd->source, cmd->apsFrame->destinationEndpoint);
+    // every On/Off command is answered with a report, also when the valve
+    // was already there (no attribute change); the event runs after the
+    // default handler has applied the command
+    if (cmd->clusterSpecific) scheduleReport();
   }
   return false;
 }
@@ -88,6 +188,21 @@ void app_button_press_cb(uint8_t button, uint8_t duration)
 {
   emberAfCorePrintln("Button %d pressed, duration %d", button, duration);
 
+  // PB0 (button == 0): manual open/close on the valve itself. Goes through
+  // the OnOff attribute, so the LED follows and the coordinator gets a report.
+  if (button == 0 && duration == APP_BUTTON_PRESS_DURATION_SHORT) {
+    uint8_t onOff = 0;
+    if (!readOnOff(&onOff)) return;
+    onOff = onOff ? 0u : 1u;
+    EmberAfStatus st = emberAfWriteServerAttribute(VALVE_EP,
+                                                  ZCL_ON_OFF_CLUSTER_ID,
+                                                  ZCL_ON_OFF_ATTRIBUTE_ID,
+                                                  &onOff,
+                                                  ZCL_BOOLEAN_ATTRIBUTE_TYPE);
+    emberAfCorePrintln("PB0: manual %s st=0x%02X", onOff ? "OPEN" : "CLOSE", st);
+    return;
+  }
+
   // PB1 (button == 1): Start network steering (join network)
   // Tương đương với CLI: plugin network-steering start 0
   if (button == 1) {
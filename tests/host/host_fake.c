@@ -0,0 +1,461 @@
+// Host fakes for the coordinator modules, see host_fake.h.
+#include "host_fake.h"
+
+#include "app/framework/include/af.h"
+#include "nvm3_default.h"
+#include "sl_cli.h"
+#include "sl_iostream.h"
+#include "sl_sleeptimer.h"
+#include "app_log.h"
+#include "app_zcl_fallback.h"
+#include "app_state.h"
+#include "history.h"
+#include "lcd_ui.h"
+#include "leak.h"
+#include "net_mgr.h"
+#include "sensor_table.h"
+#include "stale.h"
+#include "telemetry_rx.h"
+#include "totalizer.h"
+#include "uart_link.h"
+#include "valve_ctrl.h"
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// ===== TEST MACROS =====
+
+unsigned g_hostChecks = 0;
+unsigned g_hostFailures = 0;
+static const char *s_testName = "";
+
+void hostCheck(bool ok, const char *file, int line, const char *expr)
+{
+  g_hostChecks++;
+  if (ok) return;
+  g_hostFailures++;
+  fprintf(stderr, "%s:%d: %s: CHECK failed: %s\n", file, line, s_testName, expr);
+}
+
+void hostCheckEq(long long a, long long b, const char *file, int line, const char *expr)
+{
+  g_hostChecks++;
+  if (a == b) return;
+  g_hostFailures++;
+  fprintf(stderr, "%s:%d: %s: CHECK failed: %s (%lld != %lld)\n", file, line, s_testName, expr, a, b);
+}
+
+void hostRun(const char *name, void (*test)(void))
+{
+  unsigned before = g_hostFailures;
+  s_testName = name;
+  test();
+  printf("%-40s %s\n", name, (g_hostFailures == before) ? "ok" : "FAIL");
+}
+
+int hostExit(void)
+{
+  printf("%u checks, %u failed\n", g_hostChecks, g_hostFailures);
+  return (g_hostFailures == 0) ? 0 : 1;
+}
+
+// ===== APP =====
+
+void hostAppInit(void)
+{
+  appStateInit();
+  valveCtrlInit();
+  sensorTableInit();
+  historyInit();
+  totalizerInit();
+  leakInit();
+  staleInit();
+  appStateNotifyChanged();
+}
+
+void hostAppTick(void)
+{
+  uartLinkPoll();
+  netMgrTick();
+  telemetryRxProcess();
+  totalizerTick();
+  leakProcess();
+  staleTick();
+  valveCtrlTick();
+  appLogHeartbeatTick();
+  uartLinkTxDrain();
+}
+
+// ===== CLOCK =====
+
+static uint64_t s_nowUs = 0;
+static uint32_t s_rand = 1;
+
+void hostClockSetUs(uint64_t us) { s_nowUs = us; }
+void hostAdvanceUs(uint64_t us) { s_nowUs += us; }
+void hostAdvanceMs(uint32_t ms) { s_nowUs += (uint64_t)ms * 1000u; }
+uint64_t hostNowUs(void) { return s_nowUs; }
+
+uint32_t halCommonGetInt32uMillisecondTick(void) { return (uint32_t)(s_nowUs / 1000u); }
+uint32_t sl_sleeptimer_get_tick_count(void) { return (uint32_t)s_nowUs; }
+uint32_t sl_sleeptimer_get_timer_frequency(void) { return 1000000u; }
+
+void hostRandomSeed(uint32_t seed) { s_rand = seed ? seed : 1u; }
+
+uint16_t halCommonGetRandom(void)
+{
+  // xorshift32: deterministic across hosts
+  s_rand ^= s_rand << 13;
+  s_rand ^= s_rand >> 17;
+  s_rand ^= s_rand << 5;
+  return (uint16_t)(s_rand >> 8);
+}
+
+// ===== NETWORK =====
+
+static EmberNetworkStatus s_netState = EMBER_JOINED_NETWORK;
+
+void hostSetNetworkState(EmberNetworkStatus st) { s_netState = st; }
+
+EmberNetworkStatus emberAfNetworkState(void) { return s_netState; }
+
+EmberStatus emberAfGetNetworkParameters(EmberNodeType *nodeType, EmberNetworkParameters *params)
+{
+  if (nodeType) *nodeType = 1;   // coordinator
+  if (params) {
+    params->panId = 0x1234;
+    params->radioChannel = 15;
+  }
+  return EMBER_SUCCESS;
+}
+
+EmberStatus emberLeaveNetwork(void) { return EMBER_SUCCESS; }
+EmberNodeId emberGetNodeId(void) { return 0x0000; }
+
+uint8_t *emberGetEui64(void)
+{
+  static uint8_t eui[EUI64_SIZE] = { 0x01, 0x00, 0x00, 0x00, 0x00, 0x6F, 0x0D, 0x00 };
+  return eui;
+}
+
+EmberStatus emberSetBindingRemoteNodeId(uint8_t index, EmberNodeId id)
+{
+  (void)index;
+  (void)id;
+  return EMBER_SUCCESS;
+}
+
+// EUI64 derived from the node ID, so rejoins under a new ID are distinct
+EmberStatus emberLookupEui64ByNodeId(EmberNodeId nodeId, EmberEUI64 eui64Return)
+{
+  memset(eui64Return, 0, EUI64_SIZE);
+  eui64Return[0] = (uint8_t)nodeId;
+  eui64Return[1] = (uint8_t)(nodeId >> 8);
+  eui64Return[7] = 0xA5;
+  return EMBER_SUCCESS;
+}
+
+EmberStatus emberGetLastHopLqi(uint8_t *lastHopLqi)
+{
+  *lastHopLqi = 200;
+  return EMBER_SUCCESS;
+}
+
+// ===== BENCH =====
+
+uint64_t hostWallNs(void)
+{
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+// ===== UART =====
+
+static int s_streams[2];
+sl_iostream_t *SL_IOSTREAM_STDIN = (sl_iostream_t *)&s_streams[0];
+sl_iostream_t *SL_IOSTREAM_STDOUT = (sl_iostream_t *)&s_streams[1];
+
+static char   s_rx[8192];
+static size_t s_rxLen = 0;
+static size_t s_rxPos = 0;
+static unsigned s_rxReads = 0;
+
+static char   *s_tx = NULL;
+static size_t  s_txLen = 0;
+static size_t  s_txCap = 0;
+
+void hostUartFeed(const char *s) { hostUartFeedBytes(s, strlen(s)); }
+
+void hostUartFeedBytes(const void *p, size_t n)
+{
+  if (s_rxPos == s_rxLen) s_rxPos = s_rxLen = 0;
+  if (s_rxLen + n > sizeof(s_rx)) n = sizeof(s_rx) - s_rxLen;
+  memcpy(&s_rx[s_rxLen], p, n);
+  s_rxLen += n;
+}
+
+sl_status_t sl_iostream_read(sl_iostream_t *stream, void *buffer, size_t size, size_t *bytes_read)
+{
+  (void)stream;
+  s_rxReads++;
+  size_t n = s_rxLen - s_rxPos;
+  if (n > size) n = size;
+  memcpy(buffer, &s_rx[s_rxPos], n);
+  s_rxPos += n;
+  *bytes_read = n;
+  return (n > 0) ? SL_STATUS_OK : 1u;
+}
+
+unsigned hostUartReads(void) { return s_rxReads; }
+
+sl_status_t sl_iostream_write(sl_iostream_t *stream, const void *buffer, size_t size)
+{
+  (void)stream;
+  if (s_txLen + size + 1u > s_txCap) {
+    size_t cap = s_txCap ? s_txCap : 4096u;
+    while (cap < s_txLen + size + 1u) cap *= 2u;
+    s_tx = realloc(s_tx, cap);
+    if (!s_tx) abort();
+    s_txCap = cap;
+  }
+  memcpy(&s_tx[s_txLen], buffer, size);
+  s_txLen += size;
+  s_tx[s_txLen] = 0;
+  return SL_STATUS_OK;
+}
+
+void hostUartFlush(void)
+{
+  // one drain writes a bounded budget; stop once a pass adds nothing
+  size_t before;
+  do {
+    before = s_txLen;
+    uartLinkTxDrain();
+  } while (s_txLen != before);
+}
+
+const char *hostUartOutput(void) { return s_tx ? s_tx : ""; }
+
+size_t hostUartOutputLen(void) { return s_txLen; }
+
+unsigned hostUartCount(const char *needle)
+{
+  unsigned n = 0;
+  size_t len = strlen(needle);
+  for (const char *p = hostUartOutput(); (p = strstr(p, needle)) != NULL; p += len) n++;
+  return n;
+}
+
+void hostUartClear(void)
+{
+  s_txLen = 0;
+  if (s_tx) s_tx[0] = 0;
+}
+
+// ===== CLI =====
+
+static char s_cliArg[512];
+
+void hostCliSetArg(const char *json)
+{
+  strncpy(s_cliArg, json, sizeof(s_cliArg) - 1u);
+}
+
+char *sl_cli_get_argument_string(sl_cli_command_arg_t *arguments, int index)
+{
+  (void)arguments;
+  return (index == 0) ? s_cliArg : NULL;
+}
+
+// ===== NVM3 =====
+
+#define HOST_NVM_OBJECTS  64u
+#define HOST_NVM_OBJ_MAX  1024u
+
+typedef struct {
+  bool     used;
+  uint32_t key;
+  size_t   len;
+  uint8_t  data[HOST_NVM_OBJ_MAX];
+} HostNvmObj_t;
+
+static HostNvmObj_t s_nvm[HOST_NVM_OBJECTS];
+static uint32_t s_nvmWrites = 0;
+nvm3_Handle_t *nvm3_defaultHandle = NULL;
+
+void hostNvmReset(void)
+{
+  memset(s_nvm, 0, sizeof(s_nvm));
+  s_nvmWrites = 0;
+}
+
+uint32_t hostNvmWrites(void) { return s_nvmWrites; }
+
+static HostNvmObj_t *nvmFind(uint32_t key)
+{
+  for (uint32_t i = 0; i < HOST_NVM_OBJECTS; i++) {
+    if (s_nvm[i].used && s_nvm[i].key == key) return &s_nvm[i];
+  }
+  return NULL;
+}
+
+Ecode_t nvm3_readData(nvm3_Handle_t *h, nvm3_ObjectKey_t key, void *value, size_t len)
+{
+  (void)h;
+  HostNvmObj_t *o = nvmFind(key);
+  if (!o || o->len != len) return 1u;
+  memcpy(value, o->data, len);
+  return ECODE_NVM3_OK;
+}
+
+Ecode_t nvm3_writeData(nvm3_Handle_t *h, nvm3_ObjectKey_t key, const void *value, size_t len)
+{
+  (void)h;
+  if (len > HOST_NVM_OBJ_MAX) return 1u;
+  HostNvmObj_t *o = nvmFind(key);
+  for (uint32_t i = 0; !o && i < HOST_NVM_OBJECTS; i++) {
+    if (!s_nvm[i].used) o = &s_nvm[i];
+  }
+  if (!o) return 1u;
+  o->used = true;
+  o->key = key;
+  o->len = len;
+  memcpy(o->data, value, len);
+  s_nvmWrites++;
+  return ECODE_NVM3_OK;
+}
+
+Ecode_t nvm3_getObjectInfo(nvm3_Handle_t *h, nvm3_ObjectKey_t key, uint32_t *type, size_t *len)
+{
+  (void)h;
+  HostNvmObj_t *o = nvmFind(key);
+  if (!o) return 1u;
+  if (type) *type = 0;
+  if (len) *len = o->len;
+  return ECODE_NVM3_OK;
+}
+
+// ===== ZIGBEE STACK =====
+
+#define HOST_FRAMES 1024u
+
+static HostFrame_t   s_frames[HOST_FRAMES];
+static uint32_t      s_frameCount = 0;
+static EmberApsFrame s_cmdAps;
+static uint8_t       s_cmdId = 0;
+static uint8_t       s_apsSeq = 0;
+static EmberStatus   s_sendStatus = EMBER_SUCCESS;
+
+bool emberAfMessageSentCallback(EmberOutgoingMessageType type, uint16_t indexOrDestination,
+                                EmberApsFrame *apsFrame, uint16_t messageLength,
+                                uint8_t *messageContents, EmberStatus status);
+
+void hostStackReset(void)
+{
+  memset(s_frames, 0, sizeof(s_frames));
+  s_frameCount = 0;
+  s_sendStatus = EMBER_SUCCESS;
+}
+
+void hostStackSetSendStatus(EmberStatus st) { s_sendStatus = st; }
+uint32_t hostStackSent(void) { return s_frameCount; }
+
+HostFrame_t *hostStackFrame(uint32_t n)
+{
+  if (n >= s_frameCount || s_frameCount - n > HOST_FRAMES) return NULL;
+  return &s_frames[n % HOST_FRAMES];
+}
+
+bool hostStackComplete(uint32_t n, EmberStatus st)
+{
+  HostFrame_t *f = hostStackFrame(n);
+  if (!f || f->completed) return false;
+  f->completed = true;
+  EmberApsFrame aps = f->aps;
+  (void)emberAfMessageSentCallback(f->type, f->indexOrDestination, &aps, 0, NULL, st);
+  return true;
+}
+
+void emberAfFillExternalBuffer(uint8_t frameControl, uint16_t clusterId, uint8_t commandId,
+                               const char *format, ...)
+{
+  (void)frameControl;
+  (void)format;
+  memset(&s_cmdAps, 0, sizeof(s_cmdAps));
+  s_cmdAps.clusterId = clusterId;
+  s_cmdId = commandId;
+}
+
+void emberAfSetCommandEndpoints(uint8_t sourceEndpoint, uint8_t destinationEndpoint)
+{
+  s_cmdAps.sourceEndpoint = sourceEndpoint;
+  s_cmdAps.destinationEndpoint = destinationEndpoint;
+}
+
+EmberApsFrame *emberAfGetCommandApsFrame(void) { return &s_cmdAps; }
+
+EmberStatus emberAfSendCommandUnicast(EmberOutgoingMessageType type, uint16_t indexOrDestination)
+{
+  if (s_sendStatus != EMBER_SUCCESS) return s_sendStatus;
+  s_cmdAps.sequence = ++s_apsSeq;
+  HostFrame_t *f = &s_frames[s_frameCount % HOST_FRAMES];
+  memset(f, 0, sizeof(*f));
+  f->type = type;
+  f->indexOrDestination = indexOrDestination;
+  f->aps = s_cmdAps;
+  f->commandId = s_cmdId;
+  s_frameCount++;
+  return EMBER_SUCCESS;
+}
+
+// ===== ZCL REPORTS =====
+
+bool emberAfPreCommandReceivedCallback(EmberAfClusterCommand *cmd);
+
+void hostReport(EmberNodeId src, uint16_t cluster, uint8_t seq,
+                uint16_t attrId, uint8_t type, uint32_t value)
+{
+  uint8_t buf[16];
+  uint8_t n = 0;
+  buf[n++] = 0x18;                          // server -> client, no default rsp
+  buf[n++] = seq;
+  buf[n++] = ZCL_REPORT_ATTRIBUTES_COMMAND_ID;
+  uint8_t start = n;
+  buf[n++] = (uint8_t)attrId;
+  buf[n++] = (uint8_t)(attrId >> 8);
+  buf[n++] = type;
+  uint8_t width = (type == 0x21u || type == 0x29u) ? 2u : (type == 0x23u || type == 0x2Bu) ? 4u : 1u;
+  for (uint8_t i = 0; i < width; i++) buf[n++] = (uint8_t)(value >> (8u * i));
+
+  EmberApsFrame aps = { 0 };
+  aps.profileId = 0x0104;
+  aps.clusterId = cluster;
+  aps.sourceEndpoint = 1;
+  aps.destinationEndpoint = 1;
+
+  EmberAfClusterCommand cmd = { 0 };
+  cmd.apsFrame = &aps;
+  cmd.commandId = ZCL_REPORT_ATTRIBUTES_COMMAND_ID;
+  cmd.buffer = buf;
+  cmd.bufLen = n;
+  cmd.payloadStartIndex = start;
+  cmd.source = src;
+  cmd.seqNum = seq;
+  cmd.direction = 1;
+  (void)emberAfPreCommandReceivedCallback(&cmd);
+}
+
+void hostReportFlow(EmberNodeId src, uint16_t flow, uint8_t seq)
+{
+  hostReport(src, ZCL_FLOW_MEASUREMENT_CLUSTER_ID, seq, 0x0000u, ZCL_INT16U_ATTRIBUTE_TYPE, flow);
+}
+
+// ===== LCD =====
+
+void lcd_ui_set_flow(uint16_t flow) { (void)flow; }
+void lcd_ui_set_battery(uint8_t percent) { (void)percent; }
+void lcd_ui_set_valve(bool on) { (void)on; }
+void lcd_ui_set_network(const char *status) { (void)status; }
@@ -0,0 +1,101 @@
+// Host fakes for the coordinator modules: clock, RNG, UART, NVM3, Zigbee
+// stack and LCD. The coordinator sources are compiled unchanged against
+// stubs/ and linked with host_fake.c; tests drive time and the stack here.
+#ifndef HOST_FAKE_H
+#define HOST_FAKE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "stack/include/ember-types.h"
+
+// ===== TEST MACROS =====
+// A failed CHECK prints the location and marks the run failed; the test
+// goes on so one run lists every broken expectation.
+extern unsigned g_hostChecks;
+extern unsigned g_hostFailures;
+
+#define CHECK(cond) \
+  hostCheck((cond), __FILE__, __LINE__, #cond)
+
+#define CHECK_EQ(a, b) \
+  hostCheckEq((long long)(a), (long long)(b), __FILE__, __LINE__, #a " == " #b)
+
+#define RUN(test) hostRun(#test, test)
+
+void hostCheck(bool ok, const char *file, int line, const char *expr);
+void hostCheckEq(long long a, long long b, const char *file, int line, const char *expr);
+void hostRun(const char *name, void (*test)(void));
+int  hostExit(void);   // process exit status: 0 = all checks passed
+
+// ===== APP =====
+// Same module init and main-tick order as app.c, without LCD, buttons, CLI.
+void hostAppInit(void);
+void hostAppTick(void);
+
+// ===== CLOCK =====
+// One fake clock drives halCommonGetInt32uMillisecondTick() and the
+// sleeptimer (1 MHz on the host, so lat_stats reports exact microseconds).
+void     hostClockSetUs(uint64_t us);
+void     hostAdvanceUs(uint64_t us);
+void     hostAdvanceMs(uint32_t ms);
+uint64_t hostNowUs(void);
+
+void hostRandomSeed(uint32_t seed);
+
+// ===== BENCH =====
+// Real time for the benchmark cases. Printed, not checked against fixed
+// numbers (machines differ); comparisons use a wide margin.
+uint64_t hostWallNs(void);
+
+// ===== NETWORK =====
+void hostSetNetworkState(EmberNetworkStatus st);
+
+// ===== UART =====
+// RX bytes are returned by the next sl_iostream_read(); TX bytes written by
+// uartLinkTxDrain() are kept until hostUartClear().
+void        hostUartFeed(const char *s);
+void        hostUartFeedBytes(const void *p, size_t n);   // binary frames (0x00 inside)
+unsigned    hostUartReads(void);          // sl_iostream_read() calls so far
+void        hostUartFlush(void);          // drain every queued TX frame
+const char *hostUartOutput(void);         // all TX since the last clear
+size_t      hostUartOutputLen(void);      // bytes, binary output included
+unsigned    hostUartCount(const char *needle);   // occurrences in the output
+void        hostUartClear(void);
+
+// ===== CLI =====
+void hostCliSetArg(const char *json);     // argument of the next cli_json_command()
+
+// ===== NVM3 =====
+void     hostNvmReset(void);              // erase all objects, zero the counter
+uint32_t hostNvmWrites(void);             // nvm3_writeData() calls since reset
+
+// ===== ZIGBEE STACK =====
+// Every emberAfSendCommandUnicast() is recorded with the APS sequence the
+// stack assigned. The test decides what happens next: complete it through
+// emberAfMessageSentCallback(), or drop it (never call back).
+typedef struct {
+  EmberOutgoingMessageType type;
+  uint16_t      indexOrDestination;
+  EmberApsFrame aps;
+  uint8_t       commandId;
+  bool          completed;
+} HostFrame_t;
+
+void     hostStackReset(void);
+void     hostStackSetSendStatus(EmberStatus st);   // returned by the next sends
+uint32_t hostStackSent(void);                      // frames sent since reset
+HostFrame_t *hostStackFrame(uint32_t n);           // n-th frame (0-based), NULL if gone
+bool     hostStackComplete(uint32_t n, EmberStatus st);   // run the sent callback
+
+
+// ===== ZCL REPORTS =====
+// Report Attributes frame with one attribute from node src, delivered
+// through emberAfPreCommandReceivedCallback() as the stack would. The
+// value width follows the ZCL type (bool/u8 1, u16/s16 2, u32 4 bytes).
+void hostReport(EmberNodeId src, uint16_t cluster, uint8_t seq,
+                uint16_t attrId, uint8_t type, uint32_t value);
+void hostReportFlow(EmberNodeId src, uint16_t flow, uint8_t seq);
+
+#endif
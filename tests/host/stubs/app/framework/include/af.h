@@ -0,0 +1,44 @@
+// Host stand-in for the EmberZNet application framework header.
+// Only what the coordinator modules use; implemented in tests/host/host_fake.c.
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "stack/include/ember.h"
+
+#define emberAfCorePrintln(...) ((void)0)
+
+typedef struct {
+  EmberApsFrame *apsFrame;
+  uint8_t        commandId;
+  uint8_t       *buffer;
+  uint16_t       bufLen;
+  uint8_t        payloadStartIndex;
+  EmberNodeId    source;
+  uint8_t        seqNum;
+  bool           mfgSpecific;
+  uint8_t        direction;
+} EmberAfClusterCommand;
+
+#define ZCL_ON_OFF_CLUSTER_ID              0x0006
+#define ZCL_ON_OFF_ATTRIBUTE_ID            0x0000
+#define ZCL_OFF_COMMAND_ID                 0x00
+#define ZCL_ON_COMMAND_ID                  0x01
+#define ZCL_CLUSTER_SPECIFIC_COMMAND       0x01
+#define ZCL_FRAME_CONTROL_CLIENT_TO_SERVER 0x00
+#define ZCL_BOOLEAN_ATTRIBUTE_TYPE         0x10
+#define ZCL_INT8U_ATTRIBUTE_TYPE           0x20
+#define ZCL_INT16U_ATTRIBUTE_TYPE          0x21
+#define EMBER_APS_OPTION_RETRY             0x0040
+
+uint32_t halCommonGetInt32uMillisecondTick(void);
+uint16_t halCommonGetRandom(void);
+
+EmberNetworkStatus emberAfNetworkState(void);
+EmberStatus emberAfGetNetworkParameters(EmberNodeType *nodeType, EmberNetworkParameters *params);
+
+void emberAfFillExternalBuffer(uint8_t frameControl, uint16_t clusterId, uint8_t commandId,
+                               const char *format, ...);
+void emberAfSetCommandEndpoints(uint8_t sourceEndpoint, uint8_t destinationEndpoint);
+EmberApsFrame *emberAfGetCommandApsFrame(void);
+EmberStatus emberAfSendCommandUnicast(EmberOutgoingMessageType type, uint16_t indexOrDestination);
@@ -0,0 +1,16 @@
+// Host stand-in for NVM3: an in-memory object store in host_fake.c.
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint32_t Ecode_t;
+typedef uint32_t nvm3_ObjectKey_t;
+typedef struct nvm3_Handle nvm3_Handle_t;
+
+extern nvm3_Handle_t *nvm3_defaultHandle;
+
+#define ECODE_NVM3_OK 0
+
+Ecode_t nvm3_readData(nvm3_Handle_t *h, nvm3_ObjectKey_t key, void *value, size_t len);
+Ecode_t nvm3_writeData(nvm3_Handle_t *h, nvm3_ObjectKey_t key, const void *value, size_t len);
+Ecode_t nvm3_getObjectInfo(nvm3_Handle_t *h, nvm3_ObjectKey_t key, uint32_t *type, size_t *len);
@@ -0,0 +1,4 @@
+// Host stand-in for the Gecko SDK CLI.
+#pragma once
+typedef struct sl_cli_command_arg sl_cli_command_arg_t;
+char *sl_cli_get_argument_string(sl_cli_command_arg_t *arguments, int index);
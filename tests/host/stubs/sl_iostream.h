@@ -0,0 +1,11 @@
+// Host stand-in for the Gecko SDK iostream: the UART of the coordinator.
+#pragma once
+#include <stddef.h>
+#include "sl_status.h"
+
+typedef struct sl_iostream sl_iostream_t;
+extern sl_iostream_t *SL_IOSTREAM_STDIN;
+extern sl_iostream_t *SL_IOSTREAM_STDOUT;
+
+sl_status_t sl_iostream_read(sl_iostream_t *stream, void *buffer, size_t size, size_t *bytes_read);
+sl_status_t sl_iostream_write(sl_iostream_t *stream, const void *buffer, size_t size);
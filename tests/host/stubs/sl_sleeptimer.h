@@ -0,0 +1,5 @@
+// Host stand-in for the Gecko SDK sleeptimer (driven by the fake clock).
+#pragma once
+#include <stdint.h>
+uint32_t sl_sleeptimer_get_tick_count(void);
+uint32_t sl_sleeptimer_get_timer_frequency(void);
@@ -0,0 +1,5 @@
+// Host stand-in for the Gecko SDK status codes.
+#pragma once
+#include <stdint.h>
+typedef uint32_t sl_status_t;
+#define SL_STATUS_OK 0
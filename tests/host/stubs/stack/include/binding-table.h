@@ -0,0 +1 @@
+// Host stand-in: the binding table API the coordinator uses is declared in ember.h.
@@ -0,0 +1,42 @@
+// Host stand-in for the EmberZNet stack types used by the coordinator.
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef uint8_t  EmberEUI64[8];
+typedef uint16_t EmberNodeId;
+typedef uint8_t  EmberStatus;
+typedef uint8_t  EmberNetworkStatus;
+typedef uint8_t  EmberNodeType;
+typedef uint8_t  EmberOutgoingMessageType;
+typedef uint8_t  EmberDeviceUpdate;
+typedef uint8_t  EmberJoinDecision;
+typedef uint16_t EmberAfClusterId;
+typedef uint16_t EmberAfAttributeId;
+typedef uint8_t  EmberAfStatus;
+
+typedef struct {
+  uint16_t profileId;
+  uint16_t clusterId;
+  uint8_t  sourceEndpoint;
+  uint8_t  destinationEndpoint;
+  uint16_t options;
+  uint16_t groupId;
+  uint8_t  sequence;
+} EmberApsFrame;
+
+typedef struct {
+  uint16_t panId;
+  uint8_t  radioChannel;
+} EmberNetworkParameters;
+
+#define EUI64_SIZE                 8
+#define EMBER_NULL_NODE_ID         0xFFFF
+#define EMBER_SUCCESS              0x00
+#define EMBER_DELIVERY_FAILED      0x66
+#define EMBER_NETWORK_UP           0x90
+#define EMBER_NETWORK_DOWN         0x91
+#define EMBER_NO_NETWORK           0
+#define EMBER_JOINED_NETWORK       2
+#define EMBER_OUTGOING_DIRECT      0
+#define EMBER_OUTGOING_VIA_BINDING 2
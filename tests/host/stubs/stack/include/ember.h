@@ -0,0 +1,10 @@
+// Host stand-in for the EmberZNet stack API used by the coordinator.
+#pragma once
+#include "ember-types.h"
+
+EmberStatus emberLeaveNetwork(void);
+EmberNodeId emberGetNodeId(void);
+uint8_t *emberGetEui64(void);
+EmberStatus emberSetBindingRemoteNodeId(uint8_t index, EmberNodeId id);
+EmberStatus emberLookupEui64ByNodeId(EmberNodeId nodeId, EmberEUI64 eui64Return);
+EmberStatus emberGetLastHopLqi(uint8_t *lastHopLqi);
@@ -0,0 +1 @@
+// Host stand-in: nothing from the trust center API is used on the host.
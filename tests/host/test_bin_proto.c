@@ -0,0 +1,304 @@
+// bin_proto: COBS/CRC codec, TLV chunking, the binary @CMD path and a
+// text vs binary loopback.
+#include "host_fake.h"
+
+#include "app_config.h"
+#include "bin_proto.h"
+#include "uart_link.h"
+
+#include <string.h>
+
+static uint32_t s_cmdId = 13000;   // IDs are never reused: cmd_handler replays them
+
+// 0x00 COBS(CMD frame with json) 0x00 into out, returns its length
+static uint16_t cmdFrame(const char *json, uint8_t *out, uint16_t outMax)
+{
+  BinFrame_t f;
+  binFrameBegin(&f, BIN_T_CMD);
+  binFramePutStr(&f, BIN_TAG_CMD_JSON, json);
+  CHECK(!f.overflow);
+  uint16_t crc = binCrc16(f.buf, f.len);
+  f.buf[f.len++] = (uint8_t)crc;
+  f.buf[f.len++] = (uint8_t)(crc >> 8);
+  out[0] = 0;
+  uint16_t n = cobsEncode(f.buf, f.len, &out[1], (uint16_t)(outMax - 2u));
+  CHECK(n > 0);
+  out[1 + n] = 0;
+  return (uint16_t)(n + 2u);
+}
+
+// Decoded @ACK frames in the TX output: id and msg of the n-th one
+static bool ackFrame(unsigned n, uint32_t *id, char *msg, size_t msgMax)
+{
+  const uint8_t *p = (const uint8_t *)hostUartOutput();
+  size_t len = hostUartOutputLen();
+  static uint8_t seg[BIN_FRAME_MAX + 8u];
+
+  for (size_t i = 0; i < len;) {
+    size_t j = i;
+    while (j < len && p[j] != 0) j++;
+    uint16_t segLen = (uint16_t)(j - i);
+    uint16_t fn = 0;
+    if (segLen > 0 && segLen <= sizeof(seg)) fn = cobsDecode(&p[i], segLen, seg, sizeof(seg));
+    i = j + 1u;
+    if (fn < 4u || seg[0] != BIN_T_ACK) continue;
+    if (binCrc16(seg, (uint16_t)(fn - 2u)) != ((uint16_t)seg[fn - 2u] | ((uint16_t)seg[fn - 1u] << 8))) continue;
+    if (n-- > 0) continue;
+
+    msg[0] = 0;
+    size_t m = 0;
+    for (uint16_t k = 2; k + 2u <= fn - 2u; k = (uint16_t)(k + 2u + seg[k + 1u])) {
+      const uint8_t *v = &seg[k + 2u];
+      if (seg[k] == BIN_TAG_ID) *id = (uint32_t)v[0] | ((uint32_t)v[1] << 8) | ((uint32_t)v[2] << 16) | ((uint32_t)v[3] << 24);
+      if (seg[k] == BIN_TAG_MSG && m + seg[k + 1u] < msgMax) {
+        memcpy(&msg[m], v, seg[k + 1u]);
+        m += seg[k + 1u];
+        msg[m] = 0;
+      }
+    }
+    return true;
+  }
+  return false;
+}
+
+static void setMode(bool binary)
+{
+  char line[96];
+  snprintf(line, sizeof(line), "@CMD {\"id\":%u,\"op\":\"proto_set\",\"value\":\"%s\"}\r\n",
+           (unsigned)s_cmdId++, binary ? "binary" : "text");
+  if (binProtoEnabled()) {
+    static uint8_t frame[160];
+    snprintf(line, sizeof(line), "{\"id\":%u,\"op\":\"proto_set\",\"value\":\"%s\"}",
+             (unsigned)(s_cmdId - 1u), binary ? "binary" : "text");
+    hostUartFeedBytes(frame, cmdFrame(line, frame, sizeof(frame)));
+  } else {
+    hostUartFeed(line);
+  }
+  uartLinkPoll();
+  hostUartFlush();
+  CHECK_EQ(binProtoEnabled(), binary);
+  hostUartClear();
+}
+
+static void setup(void)
+{
+  hostClockSetUs(1000000u);
+  hostAppInit();
+  hostUartFlush();
+  hostUartClear();
+}
+
+static void test_cobs_crc(void)
+{
+  // CRC-16/CCITT-FALSE check value
+  CHECK_EQ(binCrc16((const uint8_t *)"123456789", 9), 0x29B1);
+
+  // zeros, a 254-byte run (code 0xFF) and a trailing zero round-trip
+  static uint8_t in[600], enc[620], dec[600];
+  for (unsigned i = 0; i < sizeof(in); i++) in[i] = (uint8_t)((i % 300u == 0u) ? 0u : (i & 0xFFu) | 1u);
+  in[sizeof(in) - 1u] = 0;
+  uint16_t n = cobsEncode(in, sizeof(in), enc, sizeof(enc));
+  CHECK(n > sizeof(in));
+  CHECK(memchr(enc, 0, n) == NULL);
+  CHECK_EQ(cobsDecode(enc, n, dec, sizeof(dec)), sizeof(in));
+  CHECK(memcmp(in, dec, sizeof(in)) == 0);
+
+  CHECK_EQ(cobsEncode(in, sizeof(in), enc, 100), 0);   // no room
+}
+
+// a @CMD JSON over 255 bytes is split over CMD_JSON TLVs and joined again
+static void test_cmd_json_chunked(void)
+{
+  char json[UART_LINE_MAX];
+  int n = snprintf(json, sizeof(json), "{\"id\":1,\"op\":\"info\",\"cid\":\"");
+  for (; n < 440; n++) json[n] = (char)('a' + n % 26);
+  strcpy(&json[n], "\"}");
+
+  static uint8_t frame[BIN_FRAME_MAX + 8u];
+  uint16_t len = cmdFrame(json, frame, sizeof(frame));
+
+  const char *out = NULL;
+  CHECK(binProtoDecodeCmd(&frame[1], (uint16_t)(len - 2u), &out));
+  CHECK(out != NULL && strcmp(out, json) == 0);
+
+  // corrupted CRC
+  len = cmdFrame(json, frame, sizeof(frame));
+  frame[len - 3u] ^= 0x01u;
+  CHECK(!binProtoDecodeCmd(&frame[1], (uint16_t)(len - 2u), &out));
+}
+
+// end to end: a long binary @CMD is executed and ACKed in binary
+static void test_long_binary_cmd(void)
+{
+  setup();
+  setMode(true);
+
+  char json[UART_LINE_MAX];
+  uint32_t id = s_cmdId++;
+  int n = snprintf(json, sizeof(json), "{\"id\":%u,\"op\":\"threshold_set\",\"close_th\":300,\"cid\":\"",
+                   (unsigned)id);
+  while (n < 400) json[n++] = 'x';
+  strcpy(&json[n], "\"}");
+
+  static uint8_t frame[BIN_FRAME_MAX + 8u];
+  hostUartFeedBytes(frame, cmdFrame(json, frame, sizeof(frame)));
+  uartLinkPoll();
+  hostUartFlush();
+
+  uint32_t ackId = 0;
+  char msg[64];
+  CHECK(ackFrame(0, &ackId, msg, sizeof(msg)));
+  CHECK_EQ(ackId, id);
+  CHECK(strcmp(msg, "threshold updated") == 0);
+
+  setMode(false);
+}
+
+// a gateway restarted in text mode: its '\n'-terminated @CMD lines reach
+// the coordinator in binary mode, also split over reads and right after a
+// binary frame, and are answered in text
+static void test_text_line_in_binary_mode(void)
+{
+  setup();
+  setMode(true);
+
+  char json[64];
+  static uint8_t frame[160];
+  snprintf(json, sizeof(json), "{\"id\":%u,\"op\":\"info\"}", (unsigned)s_cmdId++);
+  hostUartFeedBytes(frame, cmdFrame(json, frame, sizeof(frame)));
+  uartLinkPoll();
+  hostUartFlush();
+  CHECK(binProtoEnabled());
+  hostUartClear();
+
+  char line[96];
+  uint32_t id = s_cmdId++;
+  snprintf(line, sizeof(line), "@CMD {\"id\":%u,\"op\":\"threshold_set\",\"close_th\":300}\r\n",
+           (unsigned)id);
+  hostUartFeed("\r\n@C");
+  uartLinkPoll();
+  CHECK(binProtoEnabled());
+  hostUartFeed(&line[2]);
+  uartLinkPoll();
+  hostUartFlush();
+
+  CHECK(!binProtoEnabled());
+  char ack[64];
+  snprintf(ack, sizeof(ack), "@ACK {\"id\":%u,\"ok\":true", (unsigned)id);
+  CHECK_EQ(hostUartCount(ack), 1);
+
+  // the gateway may negotiate binary again
+  setMode(true);
+  setMode(false);
+}
+
+// ===== LOOPBACK: TEXT VS BINARY =====
+// The same command mix (info, threshold_set) through uartLinkPoll() and
+// out of the TX rings in both framings: bytes on the wire each way, UART
+// time at 115200 baud (10 bits per byte) and host CPU time per command.
+#define LOOP_CMDS  64u
+#define LOOP_BAUD  115200u
+
+typedef struct {
+  size_t   rxBytes;
+  size_t   txBytes;
+  unsigned acks;
+  unsigned badFrames;
+  uint64_t ns;
+} Loop_t;
+
+// Every binary frame in the output: CRC valid, COBS re-encodes to the
+// same bytes; counts the @ACK frames
+static void checkFrames(Loop_t *r)
+{
+  const uint8_t *p = (const uint8_t *)hostUartOutput();
+  size_t len = hostUartOutputLen();
+  static uint8_t seg[BIN_FRAME_MAX + 8u], enc[BIN_FRAME_MAX + 16u];
+
+  for (size_t i = 0; i < len;) {
+    size_t j = i;
+    while (j < len && p[j] != 0) j++;
+    uint16_t segLen = (uint16_t)(j - i);
+    if (segLen > 0) {
+      uint16_t fn = (segLen <= sizeof(seg)) ? cobsDecode(&p[i], segLen, seg, sizeof(seg)) : 0;
+      bool ok = fn >= 4u
+                && binCrc16(seg, (uint16_t)(fn - 2u)) == ((uint16_t)seg[fn - 2u] | ((uint16_t)seg[fn - 1u] << 8))
+                && cobsEncode(seg, fn, enc, sizeof(enc)) == segLen
+                && memcmp(enc, &p[i], segLen) == 0;
+      if (!ok) r->badFrames++;
+      else if (seg[0] == BIN_T_ACK) r->acks++;
+    }
+    i = j + 1u;
+  }
+}
+
+static Loop_t loopback(bool binary)
+{
+  setup();
+  setMode(binary);
+
+  Loop_t r = { 0 };
+  uint64_t t0 = hostWallNs();
+  for (unsigned i = 0; i < LOOP_CMDS; i++) {
+    char json[96];
+    if (i & 1u) {
+      snprintf(json, sizeof(json), "{\"id\":%u,\"op\":\"threshold_set\",\"close_th\":%u}",
+               (unsigned)s_cmdId++, 300u + (i & 7u));
+    } else {
+      snprintf(json, sizeof(json), "{\"id\":%u,\"op\":\"info\"}", (unsigned)s_cmdId++);
+    }
+    if (binary) {
+      static uint8_t frame[160];
+      uint16_t n = cmdFrame(json, frame, sizeof(frame));
+      hostUartFeedBytes(frame, n);
+      r.rxBytes += n;
+    } else {
+      char line[128];
+      int n = snprintf(line, sizeof(line), "@CMD %s\r\n", json);
+      hostUartFeed(line);
+      r.rxBytes += (size_t)n;
+    }
+    uartLinkPoll();
+    hostUartFlush();
+  }
+  r.ns = hostWallNs() - t0;
+  r.txBytes = hostUartOutputLen();
+  if (binary) checkFrames(&r);
+  else r.acks = hostUartCount("@ACK {");
+
+  if (binary) setMode(false);
+  return r;
+}
+
+static void printLoop(const char *name, const Loop_t *r)
+{
+  unsigned long wireUs = (unsigned long)((r->rxBytes + r->txBytes) * 10u * 1000000u / LOOP_BAUD / LOOP_CMDS);
+  printf("  %-6s: RX %4lu B, TX %5lu B, %lu B/cmd, UART %lu us/cmd, CPU %lu ns/cmd\n", name,
+         (unsigned long)r->rxBytes, (unsigned long)r->txBytes,
+         (unsigned long)((r->rxBytes + r->txBytes) / LOOP_CMDS), wireUs,
+         (unsigned long)(r->ns / LOOP_CMDS));
+}
+
+static void test_loopback_text_vs_binary(void)
+{
+  Loop_t text = loopback(false);
+  Loop_t bin = loopback(true);
+  printLoop("text", &text);
+  printLoop("binary", &bin);
+
+  CHECK_EQ(text.acks, LOOP_CMDS);
+  CHECK_EQ(bin.acks, LOOP_CMDS);
+  CHECK_EQ(bin.badFrames, 0);
+  // TLVs replace JSON keys in @ACK/@INFO/@DATA
+  CHECK(bin.txBytes < text.txBytes);
+}
+
+int main(void)
+{
+  RUN(test_cobs_crc);
+  RUN(test_cmd_json_chunked);
+  RUN(test_long_binary_cmd);
+  RUN(test_text_line_in_binary_mode);
+  RUN(test_loopback_text_vs_binary);
+  return hostExit();
+}
@@ -0,0 +1,467 @@
+// cmd_handler ops driven through the UART path with the fake clock.
+#include "host_fake.h"
+
+#include "app_log.h"
+#include "app_state.h"
+#include "cmd_handler.h"
+#include "json_tok.h"
+#include "sensor_table.h"
+#include "uart_link.h"
+#include "valve_ctrl.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static void sendLine(const char *line)
+{
+  hostUartFeed(line);
+  uartLinkPoll();
+}
+
+static void setup(void)
+{
+  hostClockSetUs(1000000u);
+  hostAppInit();
+  hostUartFlush();
+  hostUartClear();
+}
+
+// sensor_get pages never make the DATA ring evict a frame
+static void test_sensor_get_page_fits(void)
+{
+  setup();
+  for (unsigned k = 0; k < 8u; k++) {
+    hostReport((EmberNodeId)(0x3000u + k), 0x0402, 1, 0x0000, 0x29, 2000u + k);
+  }
+  hostAdvanceMs(TELEMETRY_COALESCE_MS);
+  hostAppTick();
+  hostUartFlush();
+  hostUartClear();
+
+  uint32_t dropped = uartLinkTxDropped(UART_TX_DATA);
+  sendLine("@CMD {\"id\":301,\"op\":\"sensor_get\",\"offset\":0}\r\n");
+  hostUartFlush();
+  CHECK_EQ(uartLinkTxDropped(UART_TX_DATA), dropped);
+  CHECK_EQ(hostUartCount("\"id\":301,\"ok\":true,\"msg\":\"sensors 4 next 4/8\""), 1);
+  CHECK_EQ(hostUartCount("\"sensor\":\"0x30"), 4);
+
+  // a nearly full DATA ring: the page stops instead of evicting
+  hostUartClear();
+  char filler[64];
+  memset(filler, 'x', sizeof(filler));
+  while (uartLinkTxFree(UART_TX_DATA) >= APP_LOG_SENSOR_FRAME_MAX) {
+    uartLinkTxWrite(UART_TX_DATA, filler, sizeof(filler));
+  }
+  dropped = uartLinkTxDropped(UART_TX_DATA);
+  sendLine("@CMD {\"id\":302,\"op\":\"sensor_get\",\"offset\":4}\r\n");
+  sendLine("@CMD {\"id\":303,\"op\":\"sensor_get\",\"node_id\":12292}\r\n");
+  hostUartFlush();
+  CHECK_EQ(uartLinkTxDropped(UART_TX_DATA), dropped);
+  CHECK_EQ(hostUartCount("\"id\":302,\"ok\":true,\"msg\":\"sensors 0 next 4/8\""), 1);
+  CHECK_EQ(hostUartCount("\"id\":303,\"ok\":false,\"msg\":\"tx busy\""), 1);
+  CHECK_EQ(hostUartCount("\"sensor\":\"0x30"), 0);
+}
+
+// ===== BATCH =====
+
+// JSON of the first "@ACK {" line in the output, NUL-terminated in buf
+static bool ackJson(char *buf, size_t size)
+{
+  const char *p = strstr(hostUartOutput(), "@ACK {");
+  if (!p) return false;
+  p += 5;
+  const char *e = strstr(p, "\r\n");
+  size_t n = e ? (size_t)(e - p) : strlen(p);
+  if (n >= size) return false;
+  memcpy(buf, p, n);
+  buf[n] = 0;
+  return true;
+}
+
+// results that do not fit are left out whole: the @ACK stays valid JSON
+// and says so
+static void test_batch_results_truncated(void)
+{
+  setup();
+  char line[512];
+  int n = snprintf(line, sizeof(line), "@CMD {\"id\":%u,\"batch\":[", 5100u);
+  for (unsigned i = 0; i < 8u; i++) {
+    n += snprintf(&line[n], sizeof(line) - (size_t)n, "%s{\"op\":\"valve_path_set\",\"value\":\"x\"}",
+                  i ? "," : "");
+  }
+  snprintf(&line[n], sizeof(line) - (size_t)n, "],\"stop_on_error\":0}\r\n");
+  sendLine(line);
+  hostUartFlush();
+
+  char ack[APP_LOG_LINE_MAX];
+  CHECK(ackJson(ack, sizeof(ack)));
+  JsonTok_t t;
+  CHECK(jsonTokParse(&t, ack));
+  const JsonField_t *r = jsonTokFind(&t, "results");
+  CHECK(r != NULL && r->type == JSON_TOK_ARRAY);
+  CHECK(jsonTokFind(&t, "valve") != NULL);
+  CHECK_EQ(hostUartCount("\"msg\":\"batch 0/8\""), 1);
+  CHECK_EQ(hostUartCount("\"truncated\":true"), 1);
+  CHECK(hostUartCount("value must be auto/direct/binding") < 8u);
+
+  // a short batch is complete and not flagged
+  hostUartClear();
+  sendLine("@CMD {\"id\":5101,\"batch\":[{\"op\":\"info\"},{\"op\":\"data_get\"}]}\r\n");
+  hostUartFlush();
+  CHECK_EQ(hostUartCount("\"msg\":\"batch 2/2\""), 1);
+  CHECK_EQ(hostUartCount("truncated"), 0);
+}
+
+// a long op name is cut in the echo, never inside an escape
+static void test_batch_op_echo_capped(void)
+{
+  setup();
+  sendLine("@CMD {\"id\":5102,\"batch\":[{\"op\":\"abcdefghijklmnopqrstuvw\\\\xyz_long_unknown\"}]}\r\n");
+  hostUartFlush();
+  char ack[APP_LOG_LINE_MAX];
+  CHECK(ackJson(ack, sizeof(ack)));
+  JsonTok_t t;
+  CHECK(jsonTokParse(&t, ack));
+  CHECK_EQ(hostUartCount("\"op\":\"abcdefghijklmnopqrstuvw\""), 1);
+}
+
+// ===== VALVE THROUGHPUT =====
+// A burst of valve_set commands, one every gapMs, round-robin over the
+// first `valves` valves; the fake stack delivers each frame
+// DELIVERY_MS after it was sent (a one-hop APS round trip).
+#define DELIVERY_MS  60u
+
+typedef struct {
+  unsigned ok;
+  unsigned superseded;
+  unsigned debounced;
+  uint32_t ms;           // first command -> last final ACK
+} Burst_t;
+
+static uint32_t s_done = 0;
+static uint32_t s_seen = 0;
+static uint32_t s_cmdId = 7000;   // IDs are never reused: cmd_handler replays them
+static uint64_t s_sentUs[64];
+
+static void completeFrames(void)
+{
+  for (; s_seen < hostStackSent() && s_seen < 64u; s_seen++) s_sentUs[s_seen] = hostNowUs();
+  while (s_done < s_seen && hostNowUs() - s_sentUs[s_done] >= DELIVERY_MS * 1000u) {
+    hostStackComplete(s_done++, EMBER_SUCCESS);
+  }
+}
+
+static Burst_t burst(unsigned valves, unsigned cmds, uint32_t gapMs)
+{
+  setup();
+  hostStackReset();
+  s_done = 0;
+  s_seen = 0;
+  g_mode = MODE_MANUAL;
+  for (unsigned v = 0; v < valves; v++) {
+    char eui[17];
+    snprintf(eui, sizeof(eui), "00000000000010%02X", (unsigned)(v & 0xFFu));
+    CHECK(valveCtrlPair((uint8_t)v, eui, (EmberNodeId)(0x1000u + v), (uint8_t)v, 1));
+  }
+
+  uint64_t t0 = hostNowUs();
+  for (unsigned i = 0; i < cmds; i++) {
+    char line[96];
+    snprintf(line, sizeof(line), "@CMD {\"id\":%u,\"op\":\"valve_set\",\"value\":\"%s\",\"valve\":%u}\r\n",
+             (unsigned)s_cmdId++, ((i / valves) & 1u) ? "closed" : "open", i % valves);
+    sendLine(line);
+    for (uint32_t t = 0; t < gapMs; t += 10u) {
+      hostAdvanceMs(10);
+      hostAppTick();
+      completeFrames();
+    }
+  }
+  Burst_t b = { 0 };
+  for (unsigned t = 0; t < 500u && hostUartCount("\"msg\":\"done\"") + hostUartCount("superseded") < cmds; t++) {
+    hostAdvanceMs(10);
+    hostAppTick();
+    completeFrames();
+    hostUartFlush();
+  }
+  hostUartFlush();
+  b.ms = (uint32_t)((hostNowUs() - t0) / 1000u);
+  b.ok = hostUartCount("\"msg\":\"done\"");
+  b.superseded = hostUartCount("superseded");
+  b.debounced = hostUartCount("debounced");
+  return b;
+}
+
+// 32 valves, one command each, 20 ms apart: every one is executed; the
+// op-level debounce used to refuse all but one per 500 ms
+static void test_valve_set_throughput(void)
+{
+  Burst_t one = burst(1, 32, 20);
+  Burst_t many = burst(VALVE_TABLE_MAX, VALVE_TABLE_MAX, 20);
+
+  printf("  1 valve : %u done, %u superseded in %lu ms\n", one.ok, one.superseded, (unsigned long)one.ms);
+  printf("  32 valves: %u done, %u superseded in %lu ms\n", many.ok, many.superseded, (unsigned long)many.ms);
+
+  CHECK_EQ(many.debounced, 0);
+  CHECK_EQ(many.ok, VALVE_TABLE_MAX);
+  CHECK_EQ(many.superseded, 0);
+
+  // one valve: every command gets a final ACK; rapid ones collapse in the
+  // pending slot instead of being debounced
+  CHECK_EQ(one.debounced, 0);
+  CHECK_EQ(one.ok + one.superseded, 32);
+  CHECK(one.ok >= 2u);
+}
+
+// ===== RECENT COMMAND IDS =====
+#define CMD_RECENT_MAX_TEST  32u   // cmd_handler.c CMD_RECENT_MAX
+
+static void pairValves(unsigned valves)
+{
+  hostStackReset();
+  s_done = 0;
+  s_seen = 0;
+  g_mode = MODE_MANUAL;
+  for (unsigned v = 0; v < valves; v++) {
+    char eui[17];
+    snprintf(eui, sizeof(eui), "00000000000010%02X", (unsigned)(v & 0xFFu));
+    CHECK(valveCtrlPair((uint8_t)v, eui, (EmberNodeId)(0x1000u + v), (uint8_t)v, 1));
+  }
+}
+
+static void sendValveSet(uint32_t id, unsigned v)
+{
+  char line[96];
+  snprintf(line, sizeof(line), "@CMD {\"id\":%lu,\"op\":\"valve_set\",\"value\":\"open\",\"valve\":%u}\r\n",
+           (unsigned long)id, v);
+  sendLine(line);
+}
+
+static unsigned countId(uint32_t id, const char *msg)
+{
+  char needle[64];
+  snprintf(needle, sizeof(needle), "\"id\":%lu,\"ok\":%s", (unsigned long)id, msg);
+  return hostUartCount(needle);
+}
+
+// a retry of a finished ID gets the same ACK, without running the op again
+static void test_retry_replayed(void)
+{
+  setup();
+  uint32_t id = s_cmdId++;
+  char line[64];
+  snprintf(line, sizeof(line), "@CMD {\"id\":%lu,\"op\":\"info\"}\r\n", (unsigned long)id);
+  sendLine(line);
+  sendLine(line);
+  hostUartFlush();
+  CHECK_EQ(countId(id, "true,\"msg\":\"info\""), 2);
+  CHECK_EQ(hostUartCount("@INFO"), 1);
+  CHECK_EQ(hostUartCount("\"replayed\":true"), 1);
+}
+
+// a retry while the op runs gets "in_flight", then the final ACK follows
+// once; a retry after that replays it
+static void test_retry_in_flight(void)
+{
+  setup();
+  pairValves(1);
+  uint32_t id = s_cmdId++;
+  sendValveSet(id, 0);
+  hostAppTick();
+  CHECK_EQ(hostStackSent(), 1);
+
+  sendValveSet(id, 0);
+  hostUartFlush();
+  CHECK_EQ(countId(id, "false,\"msg\":\"in_flight\""), 1);
+  CHECK_EQ(hostStackSent(), 1);
+
+  CHECK(hostStackComplete(0, EMBER_SUCCESS));
+  hostAppTick();
+  sendValveSet(id, 0);
+  hostUartFlush();
+  CHECK_EQ(countId(id, "true,\"msg\":\"done\""), 2);
+  CHECK_EQ(hostStackSent(), 1);
+}
+
+// a command in flight longer than the dedup window, with more new IDs
+// than slots meanwhile, still matches its retries and is not run twice
+static void test_pending_outlives_window(void)
+{
+  setup();
+  pairValves(1);
+  uint32_t id = s_cmdId++;
+  sendValveSet(id, 0);
+  hostAppTick();
+
+  for (unsigned i = 0; i < 2u * CMD_RECENT_MAX_TEST; i++) {
+    char line[64];
+    snprintf(line, sizeof(line), "@CMD {\"id\":%lu,\"op\":\"data_get\"}\r\n", (unsigned long)s_cmdId++);
+    sendLine(line);
+    hostAdvanceMs(500);
+    hostAppTick();
+    hostUartFlush();
+  }
+  uint32_t sent = hostStackSent();
+  hostUartClear();
+  sendValveSet(id, 0);
+  hostUartFlush();
+  CHECK_EQ(countId(id, "false,\"msg\":\"in_flight\""), 1);
+  CHECK_EQ(hostStackSent(), sent);          // the retry sent nothing
+
+  // its final ACK still comes (retries used up)
+  for (unsigned t = 0; t < 6000u && countId(id, "false,\"msg\":\"tx_timeout\"") == 0u; t++) {
+    hostAdvanceMs(10);
+    hostAppTick();
+    hostUartFlush();
+  }
+  CHECK_EQ(countId(id, "false,\"msg\":\"tx_timeout\""), 1);
+}
+
+// with every slot awaiting its final ACK a new ID is refused, not run
+static void test_busy_when_all_pending(void)
+{
+  setup();
+  pairValves(VALVE_TABLE_MAX);
+  uint32_t first = s_cmdId;
+  for (unsigned v = 0; v < CMD_RECENT_MAX_TEST; v++) sendValveSet(s_cmdId++, v % VALVE_TABLE_MAX);
+  hostAppTick();
+  hostUartFlush();
+  hostUartClear();
+
+  uint32_t id = s_cmdId++;
+  char line[64];
+  snprintf(line, sizeof(line), "@CMD {\"id\":%lu,\"op\":\"info\"}\r\n", (unsigned long)id);
+  sendLine(line);
+  hostUartFlush();
+  CHECK_EQ(countId(id, "false,\"msg\":\"busy\""), 1);
+  CHECK_EQ(hostUartCount("@INFO"), 0);
+
+  // deliver them all: slots free up, the same ID is taken now
+  for (unsigned t = 0; t < 500u && hostUartCount("\"msg\":\"done\"") < CMD_RECENT_MAX_TEST; t++) {
+    if (s_done < hostStackSent()) hostStackComplete(s_done++, EMBER_SUCCESS);
+    hostAdvanceMs(10);
+    hostAppTick();
+    hostUartFlush();
+  }
+  CHECK_EQ(hostUartCount("\"msg\":\"done\""), CMD_RECENT_MAX_TEST);
+  CHECK(countId(first, "true,\"msg\":\"done\"") == 1u);
+  hostUartClear();
+  sendLine(line);
+  hostUartFlush();
+  CHECK_EQ(countId(id, "true,\"msg\":\"info\""), 1);
+}
+
+// Interleaved retries at a high rate: 32 valve_set on 32 valves, and every
+// 5 ms a retry of a random earlier ID. Each ID runs exactly once (one
+// frame per valve) and ends with exactly one final "done"; the other ACKs
+// for it are "in_flight" or replays of "done".
+static void test_interleaved_retries(void)
+{
+  setup();
+  pairValves(VALVE_TABLE_MAX);
+  uint32_t base = s_cmdId;
+  s_cmdId += VALVE_TABLE_MAX;
+  uint32_t rnd = 12345u;
+  unsigned retries = 0;
+
+  for (unsigned step = 0; step < 400u; step++) {
+    if (step < VALVE_TABLE_MAX) sendValveSet(base + step, step);
+    unsigned issued = (step < VALVE_TABLE_MAX) ? step + 1u : VALVE_TABLE_MAX;
+    rnd = rnd * 1103515245u + 12345u;
+    unsigned k = (rnd >> 16) % issued;
+    sendValveSet(base + k, k);
+    retries++;
+    hostAdvanceMs(5);
+    hostAppTick();
+    completeFrames();
+    hostUartFlush();
+  }
+
+  CHECK_EQ(hostStackSent(), VALVE_TABLE_MAX);
+  unsigned perValve[VALVE_TABLE_MAX] = { 0 };
+  for (uint32_t n = 0; n < hostStackSent(); n++) {
+    HostFrame_t *f = hostStackFrame(n);
+    if (f && f->type == EMBER_OUTGOING_DIRECT) perValve[(f->indexOrDestination - 0x1000u) % VALVE_TABLE_MAX]++;
+    else if (f) perValve[f->indexOrDestination % VALVE_TABLE_MAX]++;
+  }
+  for (unsigned v = 0; v < VALVE_TABLE_MAX; v++) CHECK_EQ(perValve[v], 1);
+
+  unsigned acks = 0;
+  for (unsigned v = 0; v < VALVE_TABLE_MAX; v++) {
+    unsigned done = countId(base + v, "true,\"msg\":\"done\"");
+    CHECK(done >= 1u);
+    acks += done + countId(base + v, "false,\"msg\":\"in_flight\"");
+  }
+  CHECK_EQ(hostUartCount("\"msg\":\"busy\""), 0);
+  // every retry got an answer: in_flight or a replay (ACK ring permitting)
+  CHECK_EQ(acks, VALVE_TABLE_MAX + retries);
+  printf("  %u retries: %u in_flight, %u replayed\n", retries,
+         hostUartCount("\"msg\":\"in_flight\""), hostUartCount("\"replayed\":true"));
+}
+
+// the strcmp chain the op table replaced, grown to today's op count
+static int chainFind(const char *op)
+{
+  for (int i = 0; cmdOpName(i); i++) {
+    if (strcmp(op, cmdOpName(i)) == 0) return i;
+  }
+  return -1;
+}
+
+#define DISPATCH_ROUNDS  20000u
+
+static uint64_t timeLookup(const char *op, bool hash, volatile int *sink)
+{
+  uint16_t len = (uint16_t)strlen(op);
+  uint64_t t0 = hostWallNs();
+  for (unsigned r = 0; r < DISPATCH_ROUNDS; r++) {
+    *sink += hash ? cmdOpFind(op, len) : chainFind(op);
+  }
+  return hostWallNs() - t0;
+}
+
+// every op resolves to its own entry; lookup time does not grow with the
+// op's position in the table the way the strcmp chain does
+static void test_dispatch_vs_strcmp_chain(void)
+{
+  volatile int sink = 0;
+  int ops = 0;
+  while (cmdOpName(ops)) ops++;
+  for (int i = 0; i < ops; i++) {
+    CHECK_EQ(cmdOpFind(cmdOpName(i), (uint16_t)strlen(cmdOpName(i))), i);
+    CHECK_EQ(chainFind(cmdOpName(i)), i);
+  }
+  CHECK_EQ(cmdOpFind("valve", 5), -1);
+  CHECK_EQ(cmdOpFind("info_", 5), -1);
+  CHECK_EQ(cmdOpFind("info", 3), -1);
+
+  uint64_t chainNs = 0, hashNs = 0, chainWorst = 0, hashWorst = 0;
+  for (int i = 0; i <= ops; i++) {
+    const char *op = (i < ops) ? cmdOpName(i) : "no_such_op";
+    uint64_t c = timeLookup(op, false, &sink);
+    uint64_t h = timeLookup(op, true, &sink);
+    chainNs += c;
+    hashNs += h;
+    if (c > chainWorst) chainWorst = c;
+    if (h > hashWorst) hashWorst = h;
+  }
+  double n = (double)DISPATCH_ROUNDS;
+  printf("  %d ops + 1 unknown\n", ops);
+  printf("  strcmp chain: %.1f ns avg, %.1f ns worst\n", (double)chainNs / n / (ops + 1), (double)chainWorst / n);
+  printf("  op hash     : %.1f ns avg, %.1f ns worst\n", (double)hashNs / n / (ops + 1), (double)hashWorst / n);
+  CHECK(hashNs <= chainNs * 2u);   // wide margin: wall time
+}
+
+int main(void)
+{
+  RUN(test_sensor_get_page_fits);
+  RUN(test_batch_results_truncated);
+  RUN(test_batch_op_echo_capped);
+  RUN(test_valve_set_throughput);
+  RUN(test_retry_replayed);
+  RUN(test_retry_in_flight);
+  RUN(test_pending_outlives_window);
+  RUN(test_busy_when_all_pending);
+  RUN(test_interleaved_retries);
+  RUN(test_dispatch_vs_strcmp_chain);
+  return hostExit();
+}
@@ -0,0 +1,83 @@
+// flow_filter on recorded flow traces, and filter_set restarting state.
+#include "host_fake.h"
+
+#include "app_state.h"
+#include "flow_filter.h"
+#include "sensor_table.h"
+#include "uart_link.h"
+
+// L/min from a field sensor: steady flow with single-report spikes, a
+// real step to ~70, and one dropout
+static const uint16_t s_trace[] = { 10, 10, 11, 80, 10, 9, 10, 70, 75, 72, 71, 70, 3, 70, 69 };
+#define TRACE_LEN  (sizeof(s_trace) / sizeof(s_trace[0]))
+
+static void runTrace(uint8_t medianN, uint8_t shift, uint16_t *out)
+{
+  FlowFilter_t f;
+  flowFilterReset(&f);
+  CHECK(flowFilterConfig(medianN, shift));
+  for (unsigned i = 0; i < TRACE_LEN; i++) out[i] = flowFilterUpdate(&f, s_trace[i]);
+}
+
+static void test_median_rejects_spikes(void)
+{
+  static const uint16_t want[TRACE_LEN] = { 10, 10, 10, 11, 11, 10, 10, 10, 70, 72, 72, 71, 70, 70, 69 };
+  uint16_t out[TRACE_LEN];
+  runTrace(3, 0, out);
+  for (unsigned i = 0; i < TRACE_LEN; i++) CHECK_EQ(out[i], want[i]);
+}
+
+static void test_off_is_raw(void)
+{
+  uint16_t out[TRACE_LEN];
+  runTrace(1, 0, out);
+  for (unsigned i = 0; i < TRACE_LEN; i++) CHECK_EQ(out[i], s_trace[i]);
+  CHECK(!flowFilterConfig(4, 0));
+  CHECK(!flowFilterConfig(3, FLOW_FILTER_SHIFT_MAX + 1u));
+}
+
+// median + EWMA: the step is followed, never overshot
+static void test_ewma_follows_step(void)
+{
+  uint16_t out[TRACE_LEN];
+  runTrace(3, 2, out);
+  for (unsigned i = 0; i < 8u; i++) CHECK(out[i] <= 11u);
+  for (unsigned i = 8; i < TRACE_LEN; i++) CHECK(out[i] >= out[i - 1u]);
+  for (unsigned i = 0; i < TRACE_LEN; i++) CHECK(out[i] <= 72u);
+}
+
+// filter_set restarts flow_f and the AUTO input from the last raw report
+static void test_filter_set_resets_state(void)
+{
+  hostClockSetUs(1000000u);
+  hostAppInit();
+  CHECK(flowFilterConfig(FLOW_FILTER_MEDIAN_DEFAULT, 4));
+  for (unsigned i = 0; i < 4u; i++) {
+    hostReportFlow(0x1111, (uint16_t)(i < 3u ? 10u : 90u), (uint8_t)(i + 1u));
+    hostAdvanceMs(TELEMETRY_COALESCE_MS);
+    hostAppTick();
+  }
+  Sensor_t *s = sensorTableFind(0x1111);
+  CHECK(s != NULL && s->flowF < 20u);
+  CHECK(g_flowFiltered < 20u);
+
+  hostUartFlush();
+  hostUartClear();
+  hostUartFeed("@CMD {\"id\":401,\"op\":\"filter_set\",\"median\":1,\"ewma_shift\":0}\r\n");
+  uartLinkPoll();
+  hostAppTick();
+  hostUartFlush();
+  CHECK_EQ(hostUartCount("\"id\":401,\"ok\":true"), 1);
+  CHECK_EQ(s->flowF, 90);
+  CHECK_EQ(g_flowFiltered, 90);
+  CHECK_EQ(hostUartCount("\"flow_f\":90"), 1);
+}
+
+int main(void)
+{
+  RUN(test_median_rejects_spikes);
+  RUN(test_off_is_raw);
+  RUN(test_ewma_follows_step);
+  RUN(test_filter_set_resets_state);
+  return hostExit();
+}
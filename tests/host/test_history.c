@@ -0,0 +1,79 @@
+// history op: @HIST paging against a full LOG TX class, slot allocation.
+#include "host_fake.h"
+
+#include "app_state.h"
+#include "history.h"
+#include "sensor_table.h"
+#include "uart_link.h"
+
+#include <string.h>
+
+static void sendLine(const char *line)
+{
+  hostUartFeed(line);
+  uartLinkPoll();
+}
+
+static void setup(void)
+{
+  hostClockSetUs(1000000u);
+  hostAppInit();
+  hostUartFlush();
+  hostUartClear();
+}
+
+static void feedRaw(EmberNodeId src, unsigned n)
+{
+  for (unsigned i = 0; i < n; i++) {
+    hostReportFlow(src, (uint16_t)(10u + i), (uint8_t)i);
+    hostAdvanceMs(1000);
+    hostAppTick();
+  }
+  hostUartFlush();
+  hostUartClear();
+}
+
+// a page the LOG class refused is reported as 0 sent, offset unchanged
+static void test_dropped_page_not_claimed(void)
+{
+  setup();
+  feedRaw(0x1234, 5);
+
+  char filler[16];
+  memset(filler, 'x', sizeof(filler));
+  while (uartLinkTxWrite(UART_TX_LOG, filler, sizeof(filler))) { }
+
+  sendLine("@CMD {\"id\":201,\"op\":\"history\",\"kind\":\"raw\",\"node_id\":4660}\r\n");
+  hostUartFlush();
+  CHECK_EQ(hostUartCount("\"id\":201,\"ok\":true,\"msg\":\"hist 0 next 0/5\""), 1);
+  CHECK_EQ(hostUartCount("@HIST"), 0);
+
+  hostUartClear();
+  sendLine("@CMD {\"id\":202,\"op\":\"history\",\"kind\":\"raw\",\"node_id\":4660}\r\n");
+  hostUartFlush();
+  CHECK_EQ(hostUartCount("\"id\":202,\"ok\":true,\"msg\":\"hist 5 next 5/5\""), 1);
+  CHECK_EQ(hostUartCount("@HIST"), 1);
+}
+
+// only the first HIST_SENSORS flow sensors keep history
+static void test_no_history_slot(void)
+{
+  setup();
+  for (unsigned k = 0; k <= HIST_SENSORS; k++) {
+    feedRaw((EmberNodeId)(0x2000u + k), 2);
+  }
+  Sensor_t *last = sensorTableFind((EmberNodeId)(0x2000u + HIST_SENSORS));
+  CHECK(last != NULL);
+  CHECK_EQ(last ? last->hist : 0, HIST_NONE);
+
+  sendLine("@CMD {\"id\":203,\"op\":\"history\",\"kind\":\"raw\",\"node_id\":8194}\r\n");
+  hostUartFlush();
+  CHECK_EQ(hostUartCount("\"id\":203,\"ok\":false,\"msg\":\"no history\""), 1);
+}
+
+int main(void)
+{
+  RUN(test_dropped_page_not_claimed);
+  RUN(test_no_history_slot);
+  return hostExit();
+}
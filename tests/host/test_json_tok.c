@@ -0,0 +1,329 @@
+// json_tok: number parsing edge cases, the op table refusing them, and a
+// corpus of every op against the strstr field parsers it replaced.
+#include "host_fake.h"
+
+#include "json_tok.h"
+#include "uart_link.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t s_cmdId = 11000;   // IDs are never reused: cmd_handler replays them
+
+static bool getUint(const char *json, uint32_t *v)
+{
+  JsonTok_t t;
+  CHECK(jsonTokParse(&t, json));
+  return jsonTokGetUint(&t, "v", v);
+}
+
+static bool getAny(const char *json, uint32_t *v)
+{
+  JsonTok_t t;
+  CHECK(jsonTokParse(&t, json));
+  return jsonTokGetU32Any(&t, "v", v);
+}
+
+static void test_uint_range(void)
+{
+  uint32_t v = 0;
+  CHECK(getUint("{\"v\":0}", &v));
+  CHECK_EQ(v, 0);
+  CHECK(getUint("{\"v\":4294967295}", &v));
+  CHECK_EQ(v, 4294967295u);
+  CHECK(!getUint("{\"v\":4294967296}", &v));
+  CHECK(!getUint("{\"v\":4294967306}", &v));     // used to wrap to 10
+  CHECK(!getUint("{\"v\":99999999999999999999}", &v));
+}
+
+static void test_uint_not_plain(void)
+{
+  uint32_t v = 0;
+  CHECK(!getUint("{\"v\":12.5}", &v));
+  CHECK(!getUint("{\"v\":1e3}", &v));
+  CHECK(!getUint("{\"v\":-1}", &v));
+  CHECK(!getUint("{\"v\":\"12\"}", &v));
+  CHECK(getUint("{\"v\":12 }", &v));
+  CHECK_EQ(v, 12);
+}
+
+static void test_u32_any(void)
+{
+  uint32_t v = 0;
+  CHECK(getAny("{\"v\":\"0xbeef\"}", &v));
+  CHECK_EQ(v, 0xBEEF);
+  CHECK(getAny("{\"v\":48879}", &v));
+  CHECK_EQ(v, 48879);
+  CHECK(!getAny("{\"v\":\"0x1FFFFFFFF\"}", &v));
+  CHECK(!getAny("{\"v\":\"12abc\"}", &v));
+  CHECK(!getAny("{\"v\":\"-1\"}", &v));
+}
+
+static void sendCmd(const char *fmt, const char *arg)
+{
+  char line[160];
+  snprintf(line, sizeof(line), fmt, (unsigned)s_cmdId, arg);
+  hostUartFeed(line);
+  uartLinkPoll();
+  hostUartFlush();
+}
+
+// a wrapped or fractional value no longer slips past the range checks,
+// and a malformed optional argument is not taken as absent
+static void test_op_refuses(void)
+{
+  hostClockSetUs(1000000u);
+  hostAppInit();
+  hostUartFlush();
+  hostUartClear();
+
+  sendCmd("@CMD {\"id\":%u,\"op\":\"threshold_set\",\"close_th\":%s}\r\n", "4294967306");
+  CHECK_EQ(hostUartCount("\"ok\":false,\"msg\":\"th too big\""), 1);
+  s_cmdId++;
+  sendCmd("@CMD {\"id\":%u,\"op\":\"threshold_set\",\"close_th\":%s}\r\n", "12.5");
+  CHECK_EQ(hostUartCount("\"ok\":false,\"msg\":\"th too big\""), 2);
+  s_cmdId++;
+  sendCmd("@CMD {\"id\":%u,\"op\":\"valve_path_set\",\"value\":\"auto\",\"valve\":%s}\r\n", "1e3");
+  CHECK_EQ(hostUartCount("\"ok\":false,\"msg\":\"bad valve\""), 1);
+  s_cmdId++;
+  sendCmd("@CMD {\"id\":%u,\"op\":\"threshold_set\",\"close_th\":%s}\r\n", "300");
+  CHECK_EQ(hostUartCount("\"ok\":true"), 1);
+}
+
+// ----- the strstr parsers cmd_handler used before json_tok -----
+
+static const char *oldSkipSpaces(const char *s)
+{
+  while (s && *s && isspace((unsigned char)*s)) s++;
+  return s;
+}
+
+static bool oldUintField(const char *json, const char *key, uint32_t *out)
+{
+  const char *p = strstr(json, key);
+  if (!p) return false;
+  p = strchr(p, ':');
+  if (!p) return false;
+  p = oldSkipSpaces(p + 1);
+
+  uint32_t v = 0;
+  bool any = false;
+  while (*p && isdigit((unsigned char)*p)) {
+    any = true;
+    v = (v * 10u) + (uint32_t)(*p - '0');
+    p++;
+  }
+  if (!any) return false;
+  *out = v;
+  return true;
+}
+
+static bool oldStringField(const char *json, const char *key, char *out, uint32_t outSize)
+{
+  const char *p = strstr(json, key);
+  if (!p) return false;
+  p = strchr(p, ':');
+  if (!p) return false;
+  p = oldSkipSpaces(p + 1);
+
+  uint32_t i = 0;
+  if (*p == '\"') {
+    p++;
+    while (*p && *p != '\"' && i + 1 < outSize) out[i++] = *p++;
+    out[i] = 0;
+    return (*p == '\"');
+  }
+  while (*p && *p != ',' && *p != '}' && !isspace((unsigned char)*p) && i + 1 < outSize) {
+    out[i++] = *p++;
+  }
+  out[i] = 0;
+  return (i > 0);
+}
+
+static bool oldU32Any(const char *json, const char *key, uint32_t *out)
+{
+  char tmp[24] = { 0 };
+  if (oldStringField(json, key, tmp, sizeof(tmp))) {
+    char *endp = NULL;
+    unsigned long v = strtoul(tmp, &endp, 0);
+    if (endp != tmp) {
+      *out = (uint32_t)v;
+      return true;
+    }
+  }
+  return oldUintField(json, key, out);
+}
+
+// ----- corpus: one line per op in cmd_handler.c, every field set -----
+
+typedef struct {
+  char        type;    // 'u' uint, 'a' u32 any, 's' string
+  const char *key;
+  const char *quoted;  // key as the old parsers searched for it
+} CorpusField_t;
+
+#define U(k) { 'u', k, "\"" k "\"" }
+#define A(k) { 'a', k, "\"" k "\"" }
+#define S(k) { 's', k, "\"" k "\"" }
+
+typedef struct {
+  const char   *json;
+  CorpusField_t f[7];
+} CorpusLine_t;
+
+static const CorpusLine_t s_corpus[] = {
+  { "{\"id\":1,\"op\":\"info\"}", { U("id"), S("op") } },
+  { "{\"id\":2,\"op\":\"mode_set\",\"value\":\"auto\"}", { U("id"), S("op"), S("value") } },
+  { "{\"id\":3,\"op\":\"threshold_set\",\"close_th\":300,\"open_th\":120}",
+    { U("id"), S("op"), U("close_th"), U("open_th") } },
+  { "{\"id\":4,\"op\":\"valve_path_set\",\"value\":\"binding\",\"valve\":3}",
+    { U("id"), S("op"), S("value"), U("valve") } },
+  { "{\"id\":5,\"op\":\"valve_target_set\",\"node_id\":\"0x1A2B\",\"dst_ep\":1,\"valve\":2}",
+    { U("id"), S("op"), A("node_id"), U("dst_ep"), U("valve") } },
+  { "{\"id\":6,\"op\":\"valve_pair\",\"eui64\":\"000D6F000A1B2C3D\",\"node_id\":6699,"
+    "\"bind_index\":4,\"dst_ep\":1,\"valve\":5}",
+    { U("id"), S("op"), S("eui64"), A("node_id"), U("bind_index"), U("dst_ep"), U("valve") } },
+  { "{\"id\":7,\"op\":\"valve_set\",\"value\":\"closed\",\"valve\":31}", { U("id"), S("op"), S("value"), U("valve") } },
+  { "{\"id\":8,\"op\":\"valve_get\",\"valve\":0}", { U("id"), S("op"), U("valve") } },
+  { "{\"id\":9,\"op\":\"net_cfg_set\",\"pan_id\":\"0xBEEF\",\"ch\":15,\"tx_power\":8}",
+    { U("id"), S("op"), A("pan_id"), A("ch"), A("tx_power") } },
+  { "{\"id\":10,\"op\":\"net_form\",\"pan_id\":4660,\"ch\":\"20\",\"tx_power\":3,\"force\":1}",
+    { U("id"), S("op"), A("pan_id"), A("ch"), A("tx_power"), U("force") } },
+  { "{\"id\":11,\"op\":\"uart_gateway_set\",\"enable\":1}", { U("id"), S("op"), U("enable") } },
+  { "{\"id\":12,\"op\":\"proto_set\",\"value\":\"binary\"}", { U("id"), S("op"), S("value") } },
+  { "{\"id\":13,\"op\":\"data_cfg_set\",\"delta\":1,\"full_every\":10}",
+    { U("id"), S("op"), U("delta"), U("full_every") } },
+  { "{\"id\":14,\"op\":\"filter_set\",\"median\":5,\"ewma_shift\":2}",
+    { U("id"), S("op"), U("median"), U("ewma_shift") } },
+  { "{\"id\":15,\"op\":\"total_cfg_set\",\"interval_s\":3600,\"delta_l\":10}",
+    { U("id"), S("op"), U("interval_s"), U("delta_l") } },
+  { "{\"id\":16,\"op\":\"time_set\",\"value\":1791000000}", { U("id"), S("op"), U("value") } },
+  { "{\"id\":17,\"op\":\"leak_cfg_set\",\"dev_window_s\":900,\"min_window_s\":7200,\"close\":1}",
+    { U("id"), S("op"), U("dev_window_s"), U("min_window_s"), U("close") } },
+  { "{\"id\":18,\"op\":\"leak_clear\"}", { U("id"), S("op") } },
+  { "{\"id\":19,\"op\":\"stale_cfg_set\",\"timeout_s\":120,\"action\":\"close\"}",
+    { U("id"), S("op"), U("timeout_s"), S("action") } },
+  { "{\"id\":20,\"op\":\"data_get\"}", { U("id"), S("op") } },
+  { "{\"id\":21,\"op\":\"sensor_get\",\"node_id\":\"0x2001\",\"offset\":8}",
+    { U("id"), S("op"), A("node_id"), U("offset") } },
+  { "{\"id\":22,\"op\":\"history\",\"node_id\":8193,\"kind\":\"min\",\"offset\":16}",
+    { U("id"), S("op"), A("node_id"), S("kind"), U("offset") } },
+  { "{\"id\":23,\"op\":\"stats\",\"reset\":1}", { U("id"), S("op"), U("reset") } },
+};
+#define CORPUS_LEN  (sizeof(s_corpus) / sizeof(s_corpus[0]))
+
+// every field the way cmd_handler reads it; returns a checksum of the values
+static uint32_t readNew(const CorpusLine_t *c)
+{
+  JsonTok_t t;
+  uint32_t sum = 0, v = 0;
+  char str[24];
+  if (!jsonTokParse(&t, c->json)) return 0;
+  for (const CorpusField_t *f = c->f; f < &c->f[7] && f->key; f++) {
+    if (f->type == 'u' && jsonTokGetUint(&t, f->key, &v)) sum += v;
+    if (f->type == 'a' && jsonTokGetU32Any(&t, f->key, &v)) sum += v;
+    if (f->type == 's' && jsonTokGetString(&t, f->key, str, sizeof(str))) sum += (uint32_t)strlen(str) * 131u + (uint8_t)str[0];
+  }
+  return sum;
+}
+
+static uint32_t readOld(const CorpusLine_t *c)
+{
+  uint32_t sum = 0, v = 0;
+  char str[24];
+  for (const CorpusField_t *f = c->f; f < &c->f[7] && f->key; f++) {
+    if (f->type == 'u' && oldUintField(c->json, f->quoted, &v)) sum += v;
+    if (f->type == 'a' && oldU32Any(c->json, f->quoted, &v)) sum += v;
+    if (f->type == 's' && oldStringField(c->json, f->quoted, str, sizeof(str))) sum += (uint32_t)strlen(str) * 131u + (uint8_t)str[0];
+  }
+  return sum;
+}
+
+// every op's fields decode to what the strstr parsers read
+static void test_corpus_matches_old(void)
+{
+  for (unsigned i = 0; i < CORPUS_LEN; i++) {
+    const CorpusLine_t *c = &s_corpus[i];
+    JsonTok_t t;
+    CHECK(jsonTokParse(&t, c->json));
+    unsigned n = 0;
+    for (const CorpusField_t *f = c->f; f < &c->f[7] && f->key; f++, n++) {
+      const JsonField_t *jf = jsonTokFind(&t, f->key);
+      CHECK(jf != NULL);
+      char oldStr[24], newStr[24];
+      CHECK(oldStringField(c->json, f->quoted, oldStr, sizeof(oldStr)));
+      CHECK(jsonTokGetString(&t, f->key, newStr, sizeof(newStr)));
+      if (strcmp(oldStr, newStr) != 0) printf("  %s: \"%s\" != \"%s\"\n", f->key, newStr, oldStr);
+      CHECK(strcmp(oldStr, newStr) == 0);
+    }
+    CHECK_EQ(t.count, n);
+    CHECK_EQ(readNew(c), readOld(c));
+    CHECK(readNew(c) != 0u);
+  }
+
+  // a key inside another key's name: the old substring search hit the wrong one
+  JsonTok_t t;
+  uint32_t v = 0;
+  CHECK(jsonTokParse(&t, "{\"node_id\":5,\"id\":7}"));
+  CHECK(jsonTokGetUint(&t, "id", &v));
+  CHECK_EQ(v, 7);
+  CHECK(oldUintField("{\"node_id\":5,\"id\":7}", "id", &v));
+  CHECK_EQ(v, 5);
+}
+
+#define BENCH_ROUNDS  2000u
+
+// bytes read per line: json_tok reads the line twice (strlen, then the
+// pass); each strstr lookup reads from the start to the end of its value
+static void scanned(const CorpusLine_t *c, unsigned *oldBytes, unsigned *newBytes)
+{
+  JsonTok_t t;
+  CHECK(jsonTokParse(&t, c->json));
+  *newBytes += 2u * (unsigned)strlen(c->json);
+  for (const CorpusField_t *f = c->f; f < &c->f[7] && f->key; f++) {
+    const JsonField_t *jf = jsonTokFind(&t, f->key);
+    if (jf) *oldBytes += (unsigned)(jf->val + jf->valLen - c->json);
+  }
+}
+
+// one tokenizer pass plus table lookups against one strstr per field.
+// Host glibc strstr is vectorised, the firmware's is a byte loop: wall
+// time here favours the old parsers, so it only guards against a gross
+// regression; bytes read is the comparison that carries over.
+static void test_bench_vs_strstr(void)
+{
+  volatile uint32_t sink = 0;
+  unsigned oldBytes = 0, newBytes = 0;
+  for (unsigned i = 0; i < CORPUS_LEN; i++) scanned(&s_corpus[i], &oldBytes, &newBytes);
+
+  uint64_t t0 = hostWallNs();
+  for (unsigned r = 0; r < BENCH_ROUNDS; r++) {
+    for (unsigned i = 0; i < CORPUS_LEN; i++) sink += readOld(&s_corpus[i]);
+  }
+  uint64_t oldNs = hostWallNs() - t0;
+
+  t0 = hostWallNs();
+  for (unsigned r = 0; r < BENCH_ROUNDS; r++) {
+    for (unsigned i = 0; i < CORPUS_LEN; i++) sink += readNew(&s_corpus[i]);
+  }
+  uint64_t newNs = hostWallNs() - t0;
+  (void)sink;
+
+  double lines = (double)BENCH_ROUNDS * CORPUS_LEN;
+  printf("  strstr  : %4.0f ns/line, %u bytes read/line\n", (double)oldNs / lines, oldBytes / (unsigned)CORPUS_LEN);
+  printf("  json_tok: %4.0f ns/line, %u bytes read/line\n", (double)newNs / lines, newBytes / (unsigned)CORPUS_LEN);
+  CHECK(newBytes < oldBytes);
+  CHECK(newNs <= oldNs * 4u);   // wide margin: wall time
+}
+
+int main(void)
+{
+  RUN(test_uint_range);
+  RUN(test_uint_not_plain);
+  RUN(test_u32_any);
+  RUN(test_op_refuses);
+  RUN(test_corpus_matches_old);
+  RUN(test_bench_vs_strstr);
+  return hostExit();
+}
@@ -0,0 +1,121 @@
+// Command latency tracing (lat_stats) driven through the UART and CLI
+// paths with the fake clock.
+#include "host_fake.h"
+
+#include "app_state.h"
+#include "cmd_handler.h"
+#include "lat_stats.h"
+#include "uart_link.h"
+
+#include <string.h>
+
+static uint32_t samples(lat_stage_t st) { return latStatsGet(st)->n; }
+static uint32_t maxUs(lat_stage_t st) { return latStatsGet(st)->maxUs; }
+
+static void sendLine(const char *line)
+{
+  hostUartFeed(line);
+  uartLinkPoll();
+  hostUartFlush();
+}
+
+static void setup(void)
+{
+  hostClockSetUs(1000000u);
+  hostAppInit();
+  latStatsReset();
+  hostUartClear();
+}
+
+// UART line -> @ACK: one trace, line_cmd and total sampled once
+static void test_line_trace(void)
+{
+  setup();
+  sendLine("@CMD {\"id\":101,\"op\":\"time_set\",\"value\":1000}\r\n");
+
+  CHECK_EQ(hostUartCount("\"id\":101,\"ok\":true"), 1);
+  CHECK_EQ(samples(LAT_ST_LINE_CMD), 1);
+  CHECK_EQ(samples(LAT_ST_TOTAL), 1);
+}
+
+// a retried ID gets its ACK replayed without opening a second trace
+static void test_duplicate_not_traced(void)
+{
+  setup();
+  sendLine("@CMD {\"id\":102,\"op\":\"time_set\",\"value\":1000}\r\n");
+  hostAdvanceMs(700);
+  sendLine("@CMD {\"id\":102,\"op\":\"time_set\",\"value\":1000}\r\n");
+
+  CHECK_EQ(hostUartCount("\"id\":102,\"ok\":true"), 2);
+  CHECK_EQ(samples(LAT_ST_LINE_CMD), 1);
+  CHECK_EQ(samples(LAT_ST_TOTAL), 1);
+  CHECK(maxUs(LAT_ST_TOTAL) < 700000u);
+}
+
+// a UART line that traced nothing must not lend its tick to a CLI command
+static void test_cli_no_stale_line(void)
+{
+  setup();
+  sendLine("@CMD {\"op\":\"time_set\",\"value\":1000}\r\n");   // no id
+  sendLine("hello\r\n");                                      // not @CMD
+  hostAdvanceMs(2000);
+
+  hostCliSetArg("{\"id\":103,\"op\":\"time_set\",\"value\":1000}");
+  cli_json_command(NULL);
+  hostUartFlush();
+
+  CHECK_EQ(hostUartCount("\"id\":103,\"ok\":true"), 1);
+  CHECK_EQ(samples(LAT_ST_LINE_CMD), 0);
+  CHECK_EQ(samples(LAT_ST_TOTAL), 1);
+  CHECK_EQ(maxUs(LAT_ST_TOTAL), 0);
+}
+
+// valve_set: each stage gets the time the fake clock spent in it
+static void test_valve_stages(void)
+{
+  setup();
+  g_mode = MODE_MANUAL;
+  hostStackReset();
+
+  hostUartFeed("@CMD {\"id\":104,\"op\":\"valve_set\",\"value\":\"open\"}\r\n");
+  hostAdvanceUs(300);   // line complete -> polled
+  uartLinkPoll();
+  CHECK_EQ(hostStackSent(), 1);
+
+  hostAdvanceMs(25);    // radio + MAC retries
+  CHECK(hostStackComplete(0, EMBER_SUCCESS));
+  hostUartFlush();
+
+  CHECK_EQ(hostUartCount("\"id\":104,\"ok\":true,\"msg\":\"done\""), 1);
+  CHECK_EQ(samples(LAT_ST_SEND_SENT), 1);
+  CHECK_EQ(maxUs(LAT_ST_SEND_SENT), 25000);
+  CHECK_EQ(samples(LAT_ST_TOTAL), 1);
+  CHECK_EQ(maxUs(LAT_ST_TOTAL), 25000);
+  CHECK_EQ(samples(LAT_ST_VALVE_TTS), 1);
+}
+
+// more commands in flight than trace slots: the oldest trace is reused,
+// the rest still close with their own timing
+static void test_trace_slots_reused(void)
+{
+  setup();
+  for (uint32_t i = 0; i < LAT_TRACE_SLOTS + 2u; i++) {
+    latStatsMark(200u + i, LAT_PT_CMD);
+    hostAdvanceMs(1);
+  }
+  for (uint32_t i = 0; i < LAT_TRACE_SLOTS + 2u; i++) {
+    latStatsMark(200u + i, LAT_PT_ACK);
+  }
+  CHECK_EQ(samples(LAT_ST_TOTAL), LAT_TRACE_SLOTS);
+  CHECK_EQ(maxUs(LAT_ST_TOTAL), LAT_TRACE_SLOTS * 1000u);
+}
+
+int main(void)
+{
+  RUN(test_line_trace);
+  RUN(test_duplicate_not_traced);
+  RUN(test_cli_no_stale_line);
+  RUN(test_valve_stages);
+  RUN(test_trace_slots_reused);
+  return hostExit();
+}
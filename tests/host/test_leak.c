@@ -0,0 +1,91 @@
+// leak: the valve lock is decided by AUTO control, not at @ALRM time.
+#include "host_fake.h"
+
+#include "app_state.h"
+#include "leak.h"
+#include "sensor_table.h"
+#include "uart_link.h"
+
+// steady flow (never back to zero) from the primary sensor, main tick
+// in between, until the min_flow window has run out
+static void runningToilet(EmberNodeId src, uint32_t seconds)
+{
+  static uint8_t seq = 0;
+  for (uint32_t t = 0; t < seconds; t += 30u) {
+    hostReportFlow(src, 5, ++seq);
+    hostAdvanceMs(30000);
+    hostAppTick();
+  }
+}
+
+static void sendCmd(const char *line)
+{
+  hostUartFeed(line);
+  hostAppTick();
+  hostUartFlush();
+}
+
+static void setup(void)
+{
+  hostClockSetUs(1000000u);
+  hostAppInit();
+  leakConfig(LEAK_DEV_WINDOW_S, 600u, true);
+  hostUartFlush();
+  hostUartClear();
+}
+
+// alarm raised in MANUAL: no lock yet, entering AUTO locks and closes
+static void test_lock_on_auto_entry(void)
+{
+  setup();
+  g_mode = MODE_MANUAL;
+  runningToilet(0x1111, 900u);
+  hostUartFlush();
+  CHECK_EQ(hostUartCount("\"kind\":\"min_flow\",\"state\":\"raised\""), 1);
+  CHECK_EQ(leakActiveCount(), 1);
+  CHECK(!leakValveLock());
+
+  sendCmd("@CMD {\"id\":601,\"op\":\"mode_set\",\"value\":\"auto\"}\r\n");
+  CHECK(leakValveLock());
+  CHECK_EQ(hostUartCount("\"event\":\"valve_lock\""), 1);
+
+  sendCmd("@CMD {\"id\":602,\"op\":\"leak_clear\"}\r\n");
+  CHECK(!leakValveLock());
+}
+
+// close disabled: alarm but never a lock
+static void test_no_lock_without_close(void)
+{
+  setup();
+  leakConfig(LEAK_DEV_WINDOW_S, 600u, false);
+  g_mode = MODE_AUTO;
+  runningToilet(0x1111, 900u);
+  CHECK_EQ(leakActiveCount(), 1);
+  CHECK(!leakValveLock());
+}
+
+// LEAK_SENSORS alarms in one tick overflow the ACK ring: none is lost
+static void test_alarm_burst_not_dropped(void)
+{
+  setup();
+  g_mode = MODE_MANUAL;
+  uint8_t seq = 0;
+  for (uint32_t t = 0; t < 900u; t += 30u) {
+    seq++;
+    for (unsigned k = 0; k < LEAK_SENSORS; k++) hostReportFlow((EmberNodeId)(0x5000u + k), 5, seq);
+    hostAdvanceMs(30000);
+    hostAppTick();
+  }
+  for (unsigned i = 0; i < 10u; i++) hostAppTick();
+  hostUartFlush();
+  CHECK_EQ(leakActiveCount(), LEAK_SENSORS);
+  CHECK_EQ(hostUartCount("\"kind\":\"min_flow\",\"state\":\"raised\""), LEAK_SENSORS);
+}
+
+int main(void)
+{
+  RUN(test_lock_on_auto_entry);
+  RUN(test_no_lock_without_close);
+  RUN(test_alarm_burst_not_dropped);
+  return hostExit();
+}
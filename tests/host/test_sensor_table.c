@@ -0,0 +1,99 @@
+// Sensor table: node ID reuse on rejoin, and a full 256-sensor table with
+// the stale wheel, driven through ZCL reports.
+#include "host_fake.h"
+
+#include "sensor_table.h"
+#include "stale.h"
+
+#include <string.h>
+
+static void setup(void)
+{
+  hostClockSetUs(1000000u);
+  hostNvmReset();
+  hostAppInit();
+  hostUartClear();
+}
+
+static void euiOf(EmberNodeId id, EmberEUI64 eui)
+{
+  (void)emberLookupEui64ByNodeId(id, eui);
+}
+
+// B rejoins under the node ID A used to have: A is released like an
+// eviction (slots back to the pools, off the wheel, no longer primary)
+static void test_reuse_releases_old_entry(void)
+{
+  setup();
+  hostReportFlow(0x1111, 100, 1);
+  hostReportFlow(0x2222, 200, 1);
+
+  Sensor_t *a = sensorTableFind(0x1111);
+  Sensor_t *b = sensorTableFind(0x2222);
+  CHECK(a != NULL && b != NULL);
+  CHECK(sensorTableIsPrimary(a));
+  CHECK(a->hist != HIST_NONE && a->leak != LEAK_NONE);
+  CHECK(a->flags & SENSOR_F_WHEEL);
+  uint8_t aHist = a->hist;
+  uint8_t aLeak = a->leak;
+
+  EmberEUI64 eui;
+  euiOf(0x2222, eui);
+  sensorTableNoteJoin(0x1111, eui);
+
+  CHECK(sensorTableFind(0x1111) == b);
+  CHECK(sensorTableFind(0x2222) == NULL);
+  CHECK_EQ(a->nodeId, EMBER_NULL_NODE_ID);
+  CHECK_EQ(a->hist, HIST_NONE);
+  CHECK_EQ(a->leak, LEAK_NONE);
+  CHECK(!(a->flags & (SENSOR_F_WHEEL | SENSOR_F_EUI)));
+  CHECK(sensorTablePrimary() == b);
+
+  // the freed history/leak slots go to the next sensor, in A's old entry
+  hostReportFlow(0x3333, 300, 1);
+  Sensor_t *c = sensorTableFind(0x3333);
+  CHECK(c != NULL);
+  CHECK_EQ(c->hist, aHist);
+  CHECK_EQ(c->leak, aLeak);
+
+  // A's node ID no longer expires anything: only B and C are on the wheel
+  hostAdvanceMs((staleTimeoutS() + 2u) * 1000u);
+  staleTick();
+  CHECK_EQ(staleCount(), 2);
+}
+
+static void test_full_table(void)
+{
+  setup();
+  for (uint16_t i = 0; i < SENSOR_TABLE_MAX; i++) {
+    hostReportFlow((EmberNodeId)(0x0100u + i * 7u), i, 1);
+    hostAdvanceMs(10);
+  }
+  CHECK_EQ(sensorTableCount(), SENSOR_TABLE_MAX);
+
+  uint16_t found = 0;
+  for (uint16_t i = 0; i < SENSOR_TABLE_MAX; i++) {
+    Sensor_t *s = sensorTableFind((EmberNodeId)(0x0100u + i * 7u));
+    if (s && s->meas[MEAS_FLOW] == i && sensorTableIndex(s) == i) found++;
+  }
+  CHECK_EQ(found, SENSOR_TABLE_MAX);
+
+  // every entry is on the wheel and expires once
+  hostAdvanceMs((staleTimeoutS() + 2u) * 1000u);
+  staleTick();
+  CHECK_EQ(staleCount(), SENSOR_TABLE_MAX);
+
+  // one more sensor evicts the one not heard from for the longest time
+  hostReportFlow(0x7777, 1, 1);
+  CHECK_EQ(sensorTableCount(), SENSOR_TABLE_MAX);
+  CHECK(sensorTableFind(0x0100) == NULL);
+  CHECK(sensorTableFind(0x7777) != NULL);
+  CHECK_EQ(staleCount(), SENSOR_TABLE_MAX - 1u);
+}
+
+int main(void)
+{
+  RUN(test_reuse_releases_old_entry);
+  RUN(test_full_table);
+  return hostExit();
+}
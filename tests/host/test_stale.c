@@ -0,0 +1,129 @@
+// stale: timer wheel expiry on the fake clock, across the msTick wrap.
+#include "host_fake.h"
+
+#include "app_state.h"
+#include "sensor_table.h"
+#include "stale.h"
+#include "uart_link.h"
+
+#define SENSORS  16u
+
+static uint8_t s_seq = 0;
+
+// one main tick per second; sensors whose bit is set in live report
+// every 10 s
+static void run(uint32_t seconds, uint32_t live)
+{
+  for (uint32_t t = 0; t < seconds; t++) {
+    if ((t % 10u) == 0) {
+      s_seq++;
+      for (uint32_t k = 0; k < SENSORS; k++) {
+        if (live & (1u << k)) hostReportFlow((EmberNodeId)(0x4000u + k), 10, s_seq);
+      }
+    }
+    hostAdvanceMs(1000);
+    hostAppTick();
+  }
+}
+
+static void setup(uint32_t timeoutS, stale_action_t action)
+{
+  // ~65 s before msTick() wraps, so every test crosses it
+  hostClockSetUs(0xFFFF0000ull * 1000u);
+  hostAppInit();
+  staleConfig(timeoutS, action);
+  run(20, 0xFFFFu);
+  hostUartFlush();
+  hostUartClear();
+}
+
+// silent sensors go stale after timeout_s (+1 wheel tick), not before;
+// reporting ones never do
+static void test_expiry_timing(void)
+{
+  setup(300, STALE_ACT_NONE);
+  run(10, 0xFFFFu);            // last report of the silent half at t = 0
+  run(289, 0x00FFu);
+  CHECK_EQ(staleCount(), 0);
+  run(3, 0x00FFu);
+  CHECK_EQ(staleCount(), 8);
+  hostUartFlush();
+  CHECK_EQ(hostUartCount("\"kind\":\"stale\",\"state\":\"raised\""), 8);
+
+  run(600, 0x00FFu);           // raised once, not again every turn
+  hostUartFlush();
+  CHECK_EQ(hostUartCount("\"kind\":\"stale\",\"state\":\"raised\""), 8);
+}
+
+// the next report clears the alarm and re-arms the deadline
+static void test_recovery(void)
+{
+  setup(60, STALE_ACT_NONE);
+  run(80, 0x0001u);
+  CHECK_EQ(staleCount(), SENSORS - 1u);
+  run(10, 0xFFFFu);
+  CHECK_EQ(staleCount(), 0);
+  hostUartFlush();
+  CHECK_EQ(hostUartCount("\"kind\":\"stale\",\"state\":\"cleared\""), SENSORS - 1u);
+}
+
+// a deadline several wheel turns away waits for its own turn
+static void test_multi_turn(void)
+{
+  setup(STALE_WHEEL_SLOTS * 3u + 100u, STALE_ACT_NONE);
+  run(10, 0xFFFFu);
+  run(STALE_WHEEL_SLOTS * 3u + 100u - 12u, 0);   // 10 s already silent
+  CHECK_EQ(staleCount(), 0);
+  run(3, 0);
+  CHECK_EQ(staleCount(), SENSORS);
+}
+
+// primary stale in AUTO with action close: fail-safe on until it reports
+static void test_fail_safe(void)
+{
+  setup(60, STALE_ACT_CLOSE);
+  g_mode = MODE_AUTO;
+  CHECK(sensorTableIsPrimary(sensorTableFind(0x4000)));
+  run(80, 0xFFFEu);
+  CHECK(staleFailSafe());
+  CHECK(!staleSafeOpen());
+  run(10, 0xFFFFu);
+  CHECK(!staleFailSafe());
+}
+
+// every sensor goes stale in one tick: the @ALRM burst waits in its own
+// ring and comes out over the next ticks, @ACKs queued meanwhile are not
+// refused (they shared the ACK ring before)
+static void test_alarm_burst_keeps_acks(void)
+{
+  setup(60, STALE_ACT_NONE);
+  uint32_t ackDrops = uartLinkTxDropped(UART_TX_ACK);
+  for (uint32_t t = 0; t < 120u && staleCount() == 0; t++) run(1, 0);
+  CHECK_EQ(staleCount(), SENSORS);
+  CHECK(uartLinkTxFree(UART_TX_ALRM) < 200u);
+
+  for (unsigned i = 0; i < 4u; i++) {
+    char line[96];
+    snprintf(line, sizeof(line), "@CMD {\"id\":%u,\"op\":\"threshold_set\",\"close_th\":%u}\r\n",
+             14000u + i, 300u + i);
+    hostUartFeed(line);
+    uartLinkPoll();
+  }
+  hostUartFlush();
+  CHECK_EQ(hostUartCount("@ACK {"), 4);
+  CHECK_EQ(uartLinkTxDropped(UART_TX_ACK) - ackDrops, 0);
+
+  run(5, 0);
+  hostUartFlush();
+  CHECK_EQ(hostUartCount("\"kind\":\"stale\",\"state\":\"raised\""), SENSORS);
+}
+
+int main(void)
+{
+  RUN(test_expiry_timing);
+  RUN(test_recovery);
+  RUN(test_multi_turn);
+  RUN(test_fail_safe);
+  RUN(test_alarm_burst_keeps_acks);
+  return hostExit();
+}
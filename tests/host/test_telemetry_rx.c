@@ -0,0 +1,90 @@
+// telemetry_rx: coalesced output pass, one frame per primary report.
+#include "host_fake.h"
+
+#include "app_state.h"
+#include "sensor_table.h"
+#include "telemetry_rx.h"
+
+static void setup(void)
+{
+  hostClockSetUs(1000000u);
+  hostAppInit();
+  hostUartFlush();
+  hostUartClear();
+}
+
+// reports inside one TELEMETRY_COALESCE_MS window share one output pass
+static void test_reports_coalesced(void)
+{
+  setup();
+  hostReportFlow(0x1111, 10, 1);
+  hostAppTick();
+  hostAdvanceMs(10);
+  hostReportFlow(0x1111, 20, 2);
+  hostAppTick();
+  hostUartFlush();
+  CHECK_EQ(hostUartCount("@DATA"), 0);
+
+  hostAdvanceMs(TELEMETRY_COALESCE_MS);
+  hostAppTick();
+  hostUartFlush();
+  CHECK_EQ(hostUartCount("@DATA"), 1);
+  CHECK_EQ(g_flow, 20);
+}
+
+// the primary sensor's flow goes out in the primary @DATA only; a
+// second sensor still gets its per-sensor frame
+static void test_primary_single_frame(void)
+{
+  setup();
+  hostReportFlow(0x1111, 10, 1);
+  hostAdvanceMs(TELEMETRY_COALESCE_MS);
+  hostAppTick();
+  hostUartFlush();
+  CHECK(sensorTableIsPrimary(sensorTableFind(0x1111)));
+  hostUartClear();
+
+  hostReportFlow(0x1111, 30, 2);
+  hostReportFlow(0x2222, 40, 1);
+  hostAdvanceMs(TELEMETRY_COALESCE_MS);
+  hostAppTick();
+  hostUartFlush();
+  CHECK_EQ(hostUartCount("@DATA"), 2);
+  CHECK_EQ(hostUartCount("\"sensor\":\"0x1111\""), 0);
+  CHECK_EQ(hostUartCount("\"sensor\":\"0x2222\""), 1);
+  CHECK_EQ(hostUartCount("\"flow\":30"), 1);
+
+  // a measurement the primary @DATA lacks still gets a per-sensor frame
+  hostUartClear();
+  hostReport(0x1111, 0x0402, 3, 0x0000, 0x29, 2150);   // temperature
+  hostAdvanceMs(TELEMETRY_COALESCE_MS);
+  hostAppTick();
+  hostUartFlush();
+  CHECK_EQ(hostUartCount("\"sensor\":\"0x1111\""), 1);
+}
+
+// a late report only takes back a lost count its own sensor recorded
+static void test_reorder_lost_totals(void)
+{
+  setup();
+  hostReportFlow(0x1111, 10, 1);
+  hostReportFlow(0x1111, 11, 3);        // seq 2 missing: lost 1
+  hostReportFlow(0x2222, 20, 10);
+  hostReportFlow(0x2222, 21, 8);        // late, but 0x2222 lost nothing
+  CHECK_EQ(sensorTableFind(0x1111)->seq.lost, 1);
+  CHECK_EQ(sensorTableFind(0x2222)->seq.lost, 0);
+  CHECK_EQ(sensorTableFind(0x2222)->seq.reord, 1);
+  CHECK_EQ(telemetryRxSeqTotals()->lost, 1);
+
+  hostReportFlow(0x1111, 12, 2);        // the missing one, late
+  CHECK_EQ(sensorTableFind(0x1111)->seq.lost, 0);
+  CHECK_EQ(telemetryRxSeqTotals()->lost, 0);
+}
+
+int main(void)
+{
+  RUN(test_reports_coalesced);
+  RUN(test_primary_single_frame);
+  RUN(test_reorder_lost_totals);
+  return hostExit();
+}
@@ -0,0 +1,78 @@
+// totalizer: NVM3 checkpoint count, restore, sensors beyond the record.
+#include "host_fake.h"
+
+#include "sensor_table.h"
+#include "totalizer.h"
+#include "uart_link.h"
+
+// flow reports every 10 s for the given minutes, main tick in between
+static void flowFor(EmberNodeId first, unsigned sensors, uint16_t flow, unsigned minutes)
+{
+  static uint8_t seq = 0;
+  for (unsigned t = 0; t < minutes * 6u; t++) {
+    seq++;
+    for (unsigned k = 0; k < sensors; k++) hostReportFlow((EmberNodeId)(first + k), flow, seq);
+    hostAdvanceMs(10000);
+    hostAppTick();
+  }
+}
+
+static void boot(void)
+{
+  hostClockSetUs(1000000u);
+  hostAppInit();
+}
+
+// 100 L/min: the 1000 L delta trips every 10 min (the first report only
+// starts the integration), the 1 h interval never
+static void test_ckpt_writes(void)
+{
+  hostNvmReset();
+  boot();
+  flowFor(0x1111, 1, 100, 120);
+  CHECK_EQ(hostNvmWrites(), 11);
+  CHECK_EQ(totalizerCkptWrites(), 11);
+
+  // flow stops: one interval checkpoint for the remainder, then nothing
+  flowFor(0x1111, 1, 0, 180);
+  CHECK_EQ(hostNvmWrites(), 12);
+}
+
+// the newest checkpoint comes back after a reboot; volume after it is lost
+static void test_restore(void)
+{
+  hostNvmReset();
+  boot();
+  flowFor(0x1111, 1, 60, 61);
+  CHECK_EQ(hostNvmWrites(), 3);   // 1000 L each, the last at 3000 L
+  CHECK_EQ(totalizerVolumeMl(sensorTableFind(0x1111)), 3650000u);   // 365 x 10 s
+
+  boot();
+  flowFor(0x1111, 1, 0, 1);
+  CHECK_EQ(totalizerVolumeMl(sensorTableFind(0x1111)), 3000000u);
+}
+
+// sensors beyond TOTAL_PERSIST_MAX are counted in @INFO, not hidden
+static void test_unsaved_reported(void)
+{
+  hostNvmReset();
+  boot();
+  flowFor(0x2000, TOTAL_PERSIST_MAX + 2u, 20, 61);
+  CHECK(hostNvmWrites() >= 1u);
+  CHECK_EQ(totalizerUnsaved(), 2);
+
+  hostUartFlush();
+  hostUartClear();
+  hostUartFeed("@CMD {\"id\":501,\"op\":\"info\"}\r\n");
+  hostAppTick();
+  hostUartFlush();
+  CHECK_EQ(hostUartCount("\"tot_unsaved\":2"), 1);
+}
+
+int main(void)
+{
+  RUN(test_ckpt_writes);
+  RUN(test_restore);
+  RUN(test_unsaved_reported);
+  return hostExit();
+}
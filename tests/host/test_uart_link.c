@@ -0,0 +1,178 @@
+// uart_link TX rings: class priority, eviction and the @ACK spill.
+#include "host_fake.h"
+
+#include "app_config.h"
+#include "app_state.h"
+#include "uart_link.h"
+#include "valve_ctrl.h"
+
+#include <string.h>
+
+#define FRAME_LEN  64u
+
+static void setup(void)
+{
+  hostClockSetUs(1000000u);
+  hostAppInit();
+  hostUartFlush();
+  hostUartClear();
+}
+
+// "<tag><n>" padded with '.' to FRAME_LEN, ending in '\n'
+static bool put(uart_tx_class_t cls, const char *tag, unsigned n)
+{
+  char f[FRAME_LEN + 1u];
+  int w = snprintf(f, sizeof(f), "%s%03u", tag, n);
+  memset(&f[w], '.', FRAME_LEN - (size_t)w);
+  f[FRAME_LEN - 1u] = '\n';
+  return uartLinkTxWrite(cls, f, FRAME_LEN);
+}
+
+// ACK ring full, LOG and INFO hold frames: no @ACK is refused, lower
+// frames make room, and every @ACK still drains before them
+static void test_ack_spills_over_lower_classes(void)
+{
+  setup();
+  uint32_t ackDrops = uartLinkTxDropped(UART_TX_ACK);
+  uint32_t logDrops = uartLinkTxDropped(UART_TX_LOG);
+  uint32_t infoDrops = uartLinkTxDropped(UART_TX_INFO);
+
+  for (unsigned i = 0; i < 12u; i++) CHECK(put(UART_TX_LOG, "L", i));
+  for (unsigned i = 0; i < 12u; i++) CHECK(put(UART_TX_INFO, "I", i));
+
+  unsigned acks = 2u * UART_TX_RING_ACK / (FRAME_LEN + 6u);   // twice what the ring holds
+  for (unsigned i = 0; i < acks; i++) CHECK(put(UART_TX_ACK, "A", i));
+  CHECK_EQ(uartLinkTxDropped(UART_TX_ACK) - ackDrops, 0);
+  CHECK(uartLinkTxDropped(UART_TX_LOG) - logDrops > 0u);
+  CHECK_EQ(uartLinkTxDropped(UART_TX_INFO) - infoDrops, 0);   // LOG had enough
+
+  hostUartFlush();
+  CHECK_EQ(hostUartCount("A"), acks);
+  // every @ACK before any INFO frame (LOG frames queued ahead of a
+  // spilled @ACK in its ring may go first)
+  const char *lastAck = NULL;
+  for (const char *p = hostUartOutput(); (p = strchr(p, 'A')) != NULL; p++) lastAck = p;
+  const char *firstInfo = strchr(hostUartOutput(), 'I');
+  CHECK(lastAck != NULL && firstInfo != NULL && lastAck < firstInfo);
+  CHECK_EQ(hostUartCount("I"), 12);
+}
+
+// nothing left to give: ACK, LOG, INFO and DATA rings all hold @ACKs
+static void test_ack_dropped_when_nothing_to_evict(void)
+{
+  setup();
+  uint32_t ackDrops = uartLinkTxDropped(UART_TX_ACK);
+  unsigned cap = (UART_TX_RING_ACK + UART_TX_RING_LOG + UART_TX_RING_INFO + UART_TX_RING_DATA) / (FRAME_LEN + 6u);
+  unsigned ok = 0;
+  for (unsigned i = 0; i < cap + 4u; i++) ok += put(UART_TX_ACK, "A", i) ? 1u : 0u;
+  CHECK(ok <= cap);
+  CHECK(ok >= cap - 4u);
+  CHECK_EQ(uartLinkTxDropped(UART_TX_ACK) - ackDrops, cap + 4u - ok);
+
+  hostUartFlush();
+  CHECK_EQ(hostUartCount("A"), ok);
+}
+
+// @ALRM is never evicted for an @ACK (its writers count it as queued)
+static void test_alrm_not_evicted(void)
+{
+  setup();
+  uint32_t alrmDrops = uartLinkTxDropped(UART_TX_ALRM);
+  for (unsigned i = 0; i < 10u; i++) CHECK(put(UART_TX_ALRM, "R", i));
+  for (unsigned i = 0; i < 60u; i++) put(UART_TX_ACK, "A", i);
+  CHECK_EQ(uartLinkTxDropped(UART_TX_ALRM) - alrmDrops, 0);
+  hostUartFlush();
+  CHECK_EQ(hostUartCount("R"), 10);
+}
+
+void emberAfStackStatusCallback(EmberStatus status);
+
+static uint32_t s_cmdId = 16000;   // IDs are never reused: cmd_handler replays them
+
+typedef struct {
+  size_t   written;     // UART bytes written inside the callback
+  size_t   queued;      // bytes it produced (what a synchronous print writes)
+  uint64_t ns;          // wall time of the callback
+  size_t   worstTick;   // most bytes one uartLinkTxDrain() wrote
+  unsigned ticks;
+} CbRun_t;
+
+static bool oneFrame(const char *p, size_t n)
+{
+  size_t lines = 0;
+  for (size_t i = 0; i < n; i++) lines += (p[i] == '\n') ? 1u : 0u;
+  return lines == 1u;
+}
+
+// run the callback, then drain it one main tick at a time
+static CbRun_t measure(void (*cb)(void))
+{
+  CbRun_t r = { 0 };
+  hostUartFlush();
+  size_t out0 = hostUartOutputLen();
+  uint64_t t0 = hostWallNs();
+  cb();
+  r.ns = hostWallNs() - t0;
+  r.written = hostUartOutputLen() - out0;
+
+  for (size_t before = hostUartOutputLen();; before = hostUartOutputLen()) {
+    uartLinkTxDrain();
+    size_t n = hostUartOutputLen() - before;
+    if (n == 0) break;
+    r.ticks++;
+    if (n > r.worstTick) r.worstTick = n;
+    // over budget only for a single oversize frame
+    CHECK(n <= UART_TX_BUDGET_PER_TICK || oneFrame(hostUartOutput() + before, n));
+  }
+  r.queued = hostUartOutputLen() - out0;
+  return r;
+}
+
+// tx_done: @ACK with the Zigbee status, @LOG and both @DATA snapshots
+static void txDone(void) { CHECK(hostStackComplete(0, EMBER_SUCCESS)); }
+
+static void netUp(void) { emberAfStackStatusCallback(EMBER_NETWORK_UP); }
+
+static void print(const char *name, const CbRun_t *r)
+{
+  // 10 bits per byte at 115200 baud
+  printf("  %-8s: %zu B in callback (was %zu B = %.1f ms blocking), %.1f us, %u ticks, worst tick %zu B = %.1f ms\n",
+         name, r->written, r->queued, (double)r->queued * 10000.0 / 115200.0, (double)r->ns / 1000.0,
+         r->ticks, r->worstTick, (double)r->worstTick * 10000.0 / 115200.0);
+}
+
+// stack callbacks only queue: nothing reaches the UART until the main
+// tick drains it, within UART_TX_BUDGET_PER_TICK per tick
+static void test_callbacks_do_not_block(void)
+{
+  setup();
+  hostStackReset();
+  g_mode = MODE_MANUAL;
+  CHECK(valveCtrlPair(0, "0000000000001000", 0x1000, 0, 1));
+  char line[96];
+  snprintf(line, sizeof(line), "@CMD {\"id\":%u,\"op\":\"valve_set\",\"value\":\"open\"}\r\n", (unsigned)s_cmdId++);
+  hostUartFeed(line);
+  uartLinkPoll();
+  hostAppTick();
+  CHECK_EQ(hostStackSent(), 1);
+
+  CbRun_t sent = measure(txDone);
+  CbRun_t up = measure(netUp);
+  print("tx_done", &sent);
+  print("net_up", &up);
+
+  CHECK_EQ(sent.written, 0);
+  CHECK_EQ(up.written, 0);
+  CHECK(sent.queued > UART_TX_BUDGET_PER_TICK);   // the burst a direct print blocked on
+  CHECK(sent.ticks >= 2u);
+  CHECK(up.queued > 0u);
+}
+
+int main(void)
+{
+  RUN(test_ack_spills_over_lower_classes);
+  RUN(test_ack_dropped_when_nothing_to_evict);
+  RUN(test_alrm_not_evicted);
+  RUN(test_callbacks_do_not_block);
+  return hostExit();
+}
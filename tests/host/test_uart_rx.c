@@ -0,0 +1,147 @@
+// uart_link RX: bulk reads against the byte-per-read loop it replaced, on
+// recorded gateway @CMD traffic through the stubbed iostream.
+#include "host_fake.h"
+
+#include "app_config.h"
+#include "cmd_handler.h"
+#include "uart_link.h"
+
+#include "sl_iostream.h"
+#include "sl_status.h"
+
+#include <string.h>
+
+static uint32_t s_cmdId = 15000;   // IDs are never reused: cmd_handler replays them
+
+// what the gateway sends in a session: polls, reads and settings
+static const char *const s_traffic[] = {
+  "@CMD {\"id\":%u,\"op\":\"info\"}\r\n",
+  "@CMD {\"id\":%u,\"op\":\"valve_get\",\"valve\":0}\r\n",
+  "@CMD {\"id\":%u,\"op\":\"threshold_set\",\"close_th\":300,\"open_th\":120}\r\n",
+  "@CMD {\"id\":%u,\"op\":\"valve_path_set\",\"value\":\"auto\",\"valve\":0}\r\n",
+  "@CMD {\"id\":%u,\"op\":\"info\"}\r\n",
+  "@CMD {\"id\":%u,\"op\":\"threshold_set\",\"close_th\":280}\r\n",
+};
+#define TRAFFIC_LINES  (sizeof(s_traffic) / sizeof(s_traffic[0]))
+
+#define RX_TICK_BYTES  115u    // 10 ms tick at 115200 baud
+#define RX_ROUNDS      200u
+
+// uartLinkPoll() before the bulk read: one sl_iostream_read() per byte
+static char s_oldLine[UART_LINE_MAX];
+static uint16_t s_oldLen = 0;
+
+static void oldPoll(void)
+{
+  char c;
+  size_t n = 0;
+  sl_status_t st = sl_iostream_read(SL_IOSTREAM_STDIN, &c, 1, &n);
+
+  while ((st == SL_STATUS_OK) && (n == 1)) {
+    if (c == '\r') {
+      // ignore
+    } else if (c == '\n') {
+      if (s_oldLen > 0) {
+        s_oldLine[s_oldLen] = 0;
+        if (strncmp(s_oldLine, "@CMD", 4) == 0) {
+          cmdHandleLine(s_oldLine);
+        }
+        s_oldLen = 0;
+      }
+    } else {
+      if ((uint16_t)(s_oldLen + 1u) < (uint16_t)UART_LINE_MAX) {
+        s_oldLine[s_oldLen++] = c;
+      } else {
+        s_oldLen = 0;
+      }
+    }
+    n = 0;
+    st = sl_iostream_read(SL_IOSTREAM_STDIN, &c, 1, &n);
+  }
+}
+
+static void setup(void)
+{
+  hostClockSetUs(1000000u);
+  hostAppInit();
+  hostUartFlush();
+  hostUartClear();
+}
+
+static size_t record(char *buf, size_t cap)
+{
+  size_t len = 0;
+  for (unsigned i = 0; i < TRAFFIC_LINES; i++) {
+    int w = snprintf(&buf[len], cap - len, s_traffic[i], (unsigned)s_cmdId++);
+    len += (size_t)w;
+  }
+  return len;
+}
+
+typedef struct {
+  uint64_t ns;        // in the poll calls only
+  uint64_t worstNs;   // slowest single poll
+  unsigned polls;
+  unsigned reads;
+  size_t   bytes;
+  unsigned acks;
+} RxRun_t;
+
+// the recorded traffic arrives RX_TICK_BYTES per tick; one poll per tick
+static RxRun_t run(void (*poll)(void))
+{
+  RxRun_t r = { 0 };
+  char buf[1024];
+  setup();
+  unsigned reads0 = hostUartReads();
+
+  for (unsigned round = 0; round < RX_ROUNDS; round++) {
+    size_t len = record(buf, sizeof(buf));
+    for (size_t off = 0; off < len; off += RX_TICK_BYTES) {
+      size_t n = (len - off < RX_TICK_BYTES) ? len - off : RX_TICK_BYTES;
+      hostUartFeedBytes(&buf[off], n);
+      uint64_t t0 = hostWallNs();
+      poll();
+      uint64_t dt = hostWallNs() - t0;
+      r.ns += dt;
+      if (dt > r.worstNs) r.worstNs = dt;
+      r.polls++;
+      hostUartFlush();
+    }
+    r.bytes += len;
+    r.acks += hostUartCount("@ACK");
+    hostUartClear();
+  }
+  r.reads = hostUartReads() - reads0;
+  return r;
+}
+
+static void print(const char *name, const RxRun_t *r)
+{
+  double mbps = (r->ns > 0u) ? (double)r->bytes * 1000.0 / (double)r->ns : 0.0;
+  printf("  %s: %.1f MB/s, tick %.2f us avg / %.2f us worst, %.2f reads/line\n", name, mbps,
+         (double)r->ns / r->polls / 1000.0, (double)r->worstNs / 1000.0,
+         (double)r->reads / (RX_ROUNDS * TRAFFIC_LINES));
+}
+
+// same lines handled either way; bulk reads need a few driver calls per
+// tick instead of one per byte, and are not slower
+static void test_rx_bench(void)
+{
+  RxRun_t oldRun = run(oldPoll);
+  RxRun_t newRun = run(uartLinkPoll);
+  print("byte reads", &oldRun);
+  print("bulk reads", &newRun);
+
+  CHECK_EQ(oldRun.acks, RX_ROUNDS * TRAFFIC_LINES);
+  CHECK_EQ(newRun.acks, oldRun.acks);
+  CHECK_EQ(oldRun.reads, oldRun.bytes + oldRun.polls);     // one per byte, one to find it empty
+  CHECK(newRun.reads <= newRun.polls * UART_RX_MAX_READS_PER_POLL);
+  CHECK(newRun.ns <= oldRun.ns * 2u);                       // wide margin: wall time
+}
+
+int main(void)
+{
+  RUN(test_rx_bench);
+  return hostExit();
+}
@@ -0,0 +1,82 @@
+// valve OnOff reports: stored in the stack callback, applied in the tick.
+#include "host_fake.h"
+
+#include "app_state.h"
+#include "valve_ctrl.h"
+
+#define VALVE_NODE  0x1000
+
+static void setup(app_mode_t mode)
+{
+  hostClockSetUs(1000000u);
+  hostAppInit();
+  hostStackReset();
+  g_mode = mode;
+  CHECK(valveCtrlPair(0, "0000000000001000", VALVE_NODE, 0, 1));
+  hostUartFlush();
+  hostUartClear();
+}
+
+static void reportOnOff(uint8_t seq, bool on)
+{
+  hostReport(VALVE_NODE, 0x0006, seq, 0x0000, 0x10, on ? 1u : 0u);
+}
+
+// nothing is queued or sent from the callback; the tick applies the state
+static void test_applied_in_tick(void)
+{
+  setup(MODE_MANUAL);
+  reportOnOff(1, true);
+  hostUartFlush();
+  CHECK_EQ(hostUartCount("@DATA"), 0);
+  CHECK_EQ(hostStackSent(), 0);
+  CHECK(!valveCtrlIsOpen(0));
+
+  hostAppTick();
+  hostUartFlush();
+  CHECK(valveCtrlIsOpen(0));
+  CHECK_EQ(valveCtrlConf(0), VALVE_CONF_OK);
+  CHECK(hostUartCount("\"valve\":\"open\"") >= 1);   // legacy and per-valve @DATA
+}
+
+// AUTO reacts to the reported state from the tick, not from the callback
+static void test_auto_decides_in_tick(void)
+{
+  setup(MODE_AUTO);
+  valveCtrlSetThresholds(100, 50);
+  g_flowFiltered = 200;
+  reportOnOff(1, true);
+  CHECK_EQ(hostStackSent(), 0);
+
+  hostAppTick();
+  CHECK_EQ(hostStackSent(), 1);
+  CHECK_EQ(hostStackFrame(0) ? hostStackFrame(0)->commandId : 0xFF, 0x00);   // Off
+}
+
+// reports before one tick: the newest wins, duplicates are still dropped
+static void test_newest_report_wins(void)
+{
+  setup(MODE_MANUAL);
+  uint32_t n = valveCtrlConfStats()->reports;
+  reportOnOff(5, true);
+  reportOnOff(5, true);    // duplicate
+  reportOnOff(6, false);
+  CHECK_EQ(valveCtrlConfStats()->reports - n, 2);
+
+  hostAppTick();
+  hostUartFlush();
+  CHECK(!valveCtrlIsOpen(0));
+  CHECK_EQ(hostUartCount("\"valve\":\"open\""), 0);
+
+  reportOnOff(4, true);    // late
+  hostAppTick();
+  CHECK(!valveCtrlIsOpen(0));
+}
+
+int main(void)
+{
+  RUN(test_applied_in_tick);
+  RUN(test_auto_decides_in_tick);
+  RUN(test_newest_report_wins);
+  return hostExit();
+}
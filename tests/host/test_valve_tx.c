@@ -0,0 +1,189 @@
+// valve_ctrl TX: deadlines, backoff retries and path alternation against a
+// stack that drops emberAfMessageSentCallback().
+#include "host_fake.h"
+
+#include "app_state.h"
+#include "uart_link.h"
+#include "valve_ctrl.h"
+
+static uint32_t s_cmdId = 9000;   // IDs are never reused: cmd_handler replays them
+static uint32_t s_seen = 0;
+
+static void setup(valve_path_t path)
+{
+  hostClockSetUs(1000000u);
+  hostAppInit();
+  hostStackReset();
+  s_seen = 0;
+  g_mode = MODE_MANUAL;
+  CHECK(valveCtrlPair(0, "0000000000001000", 0x1000, 0, 1));
+  valveCtrlSetPath(0, path);
+  hostUartFlush();
+  hostUartClear();
+}
+
+static void valveSet(const char *value)
+{
+  char line[96];
+  snprintf(line, sizeof(line), "@CMD {\"id\":%u,\"op\":\"valve_set\",\"value\":\"%s\"}\r\n",
+           (unsigned)s_cmdId++, value);
+  hostUartFeed(line);
+  uartLinkPoll();
+}
+
+// sendMs[i]: fake time frame i was first seen
+static void noteSent(uint32_t *sendMs)
+{
+  for (; s_seen < hostStackSent(); s_seen++) sendMs[s_seen] = (uint32_t)(hostNowUs() / 1000u);
+}
+
+// Tick in 10 ms steps until `frames` frames went out or maxMs passed
+static void runUntil(uint32_t frames, uint32_t maxMs, uint32_t *sendMs)
+{
+  noteSent(sendMs);
+  for (uint32_t t = 0; t < maxMs && hostStackSent() < frames; t += 10u) {
+    hostAdvanceMs(10);
+    hostAppTick();
+    noteSent(sendMs);
+  }
+  hostUartFlush();
+}
+
+// never delivered: every attempt times out, retries back off within the
+// equal-jitter window and alternate the path, then the command gives up
+static void test_dropped_until_given_up(void)
+{
+  setup(VALVE_PATH_AUTO);
+  ValveTxStats_t before = *valveCtrlTxStats();
+  uint32_t sendMs[VALVE_TX_RETRIES + 2u] = { 0 };
+
+  valveSet("open");
+  runUntil(1, 100, sendMs);
+  CHECK_EQ(hostStackSent(), 1);
+  runUntil(VALVE_TX_RETRIES + 2u, 60000u, sendMs);
+  CHECK_EQ(hostStackSent(), VALVE_TX_RETRIES + 1u);
+
+  for (uint32_t i = 1; i < hostStackSent(); i++) {
+    uint32_t span = (uint32_t)VALVE_RETRY_BASE_MS << (i - 1u);
+    if (span > VALVE_RETRY_MAX_MS) span = VALVE_RETRY_MAX_MS;
+    uint32_t backoff = sendMs[i] - sendMs[i - 1u] - VALVE_TX_DEADLINE_MS;
+    CHECK(backoff >= span / 2u);
+    CHECK(backoff <= span + 20u);                 // two 10 ms ticks of slack
+    CHECK(backoff >= VALVE_RETRY_BASE_MS / 2u && backoff <= VALVE_RETRY_MAX_MS + 20u);
+    CHECK(hostStackFrame(i)->type != hostStackFrame(i - 1u)->type);
+  }
+
+  const ValveTxStats_t *s = valveCtrlTxStats();
+  CHECK_EQ(s->timeouts - before.timeouts, VALVE_TX_RETRIES + 1u);
+  CHECK_EQ(s->retries - before.retries, VALVE_TX_RETRIES);
+  CHECK_EQ(s->fail - before.fail, 1);
+  CHECK_EQ(s->ok - before.ok, 0);
+  CHECK_EQ(hostUartCount("\"msg\":\"tx_timeout\""), 1);
+  CHECK_EQ(valveCtrlTxInFlight(), 0);
+
+  // a callback after the deadline no longer matches the command
+  hostStackComplete(0, EMBER_SUCCESS);
+  CHECK_EQ(valveCtrlTxStats()->ok - before.ok, 0);
+}
+
+// the first attempt is dropped, the retry is delivered
+static void test_retry_delivered(void)
+{
+  setup(VALVE_PATH_AUTO);
+  ValveTxStats_t before = *valveCtrlTxStats();
+  uint32_t sendMs[4] = { 0 };
+
+  valveSet("closed");
+  runUntil(2, 20000u, sendMs);
+  CHECK_EQ(hostStackSent(), 2);
+  CHECK(hostStackComplete(1, EMBER_SUCCESS));
+  hostAppTick();
+  hostUartFlush();
+
+  const ValveTxStats_t *s = valveCtrlTxStats();
+  CHECK_EQ(s->timeouts - before.timeouts, 1);
+  CHECK_EQ(s->retries - before.retries, 1);
+  CHECK_EQ(s->ok - before.ok, 1);
+  CHECK_EQ(s->fail - before.fail, 0);
+  CHECK_EQ(hostUartCount("\"msg\":\"done\""), 1);
+  CHECK_EQ(hostUartCount("\"msg\":\"tx_timeout\""), 0);
+  CHECK_EQ(valveCtrlTxInFlight(), 0);
+}
+
+// a fixed path is kept on every retry
+static void test_fixed_path_kept(void)
+{
+  setup(VALVE_PATH_DIRECT);
+  uint32_t sendMs[VALVE_TX_RETRIES + 2u] = { 0 };
+
+  valveSet("open");
+  runUntil(VALVE_TX_RETRIES + 2u, 60000u, sendMs);
+  CHECK_EQ(hostStackSent(), VALVE_TX_RETRIES + 1u);
+  for (uint32_t i = 0; i < hostStackSent(); i++) {
+    CHECK_EQ(hostStackFrame(i)->type, EMBER_OUTGOING_DIRECT);
+  }
+  CHECK_EQ(hostUartCount("\"msg\":\"tx_timeout\""), 1);
+}
+
+// Final ACK of the command from its arrival, dropping every frame
+static uint32_t msToFinal(uint32_t id, uint32_t t0Ms)
+{
+  char needle[48];
+  snprintf(needle, sizeof(needle), "\"id\":%lu,\"ok\":false,\"msg\":\"tx_", (unsigned long)id);
+  for (uint32_t t = 0; t < 120000u; t += 10u) {
+    hostAdvanceMs(10);
+    hostAppTick();
+    hostUartFlush();
+    if (hostUartCount(needle) > 0u) break;
+  }
+  return (uint32_t)(hostNowUs() / 1000u) - t0Ms;
+}
+
+// the final ACK comes within the budget the gateway waits for, also for a
+// command queued behind the one it replaces; retries meanwhile: in_flight
+static void test_final_ack_within_budget(void)
+{
+  setup(VALVE_PATH_AUTO);
+  uint32_t t0 = (uint32_t)(hostNowUs() / 1000u);
+  uint32_t id = s_cmdId;
+  valveSet("open");
+  uint32_t ms = msToFinal(id, t0);
+  printf("  alone: final ACK after %lu ms (budget %lu)\n", (unsigned long)ms, (unsigned long)VALVE_TX_BUDGET_MS);
+  CHECK(ms <= VALVE_TX_BUDGET_MS);
+
+  setup(VALVE_PATH_AUTO);
+  valveSet("open");
+  for (uint32_t t = 0; t < VALVE_TX_DEADLINE_MS - 100u; t += 10u) {
+    hostAdvanceMs(10);
+    hostAppTick();
+  }
+  t0 = (uint32_t)(hostNowUs() / 1000u);
+  id = s_cmdId;
+  valveSet("closed");                      // waits for the first attempt to end
+  for (uint32_t t = 0; t < 20000u; t += 10u) {
+    hostAdvanceMs(10);
+    hostAppTick();
+  }
+  hostUartFlush();
+  hostUartClear();
+  char retry[96];
+  snprintf(retry, sizeof(retry), "@CMD {\"id\":%lu,\"op\":\"valve_set\",\"value\":\"closed\"}\r\n",
+           (unsigned long)id);
+  hostUartFeed(retry);
+  uartLinkPoll();
+  hostUartFlush();
+  CHECK_EQ(hostUartCount("\"msg\":\"in_flight\""), 1);
+  ms = msToFinal(id, t0);
+  printf("  queued: final ACK after %lu ms (budget %lu)\n", (unsigned long)ms, (unsigned long)VALVE_CMD_BUDGET_MS);
+  CHECK(ms <= VALVE_CMD_BUDGET_MS);
+  CHECK_EQ(hostUartCount("\"msg\":\"tx_timeout\""), 1);
+}
+
+int main(void)
+{
+  RUN(test_dropped_until_given_up);
+  RUN(test_retry_delivered);
+  RUN(test_fixed_path_kept);
+  RUN(test_final_ack_within_budget);
+  return hostExit();
+}
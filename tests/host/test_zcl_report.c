@@ -0,0 +1,261 @@
+// ZCL Report Attributes decoder: record walking and value sizes, a corpus
+// of device payloads with mutations, and decode throughput.
+#include "host_fake.h"
+
+#include "zcl_report.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  unsigned n;
+  uint16_t attrId[4];
+  uint8_t  type[4];
+  uint16_t len[4];
+} Seen_t;
+
+static void onAttr(void *ctx, const ZclAttr_t *a)
+{
+  Seen_t *s = (Seen_t *)ctx;
+  if (s->n < 4u) {
+    s->attrId[s->n] = a->attrId;
+    s->type[s->n] = a->type;
+    s->len[s->n] = a->len;
+  }
+  s->n++;
+}
+
+// nodata (0x00) is a zero-length value; the walk goes on past it
+static void test_nodata_is_empty_value(void)
+{
+  const uint8_t p[] = {
+    0x01, 0x00, 0x00,               // attr 1, nodata
+    0x00, 0x00, 0x21, 0x34, 0x12,   // attr 0, uint16 0x1234
+  };
+  Seen_t s = { 0 };
+  CHECK_EQ(zclReportDecode(0x0404, p, sizeof(p), onAttr, &s), ZCL_REPORT_OK);
+  CHECK_EQ(s.n, 2);
+  CHECK_EQ(s.type[0], 0x00);
+  CHECK_EQ(s.len[0], 0);
+  CHECK_EQ(s.attrId[1], 0x0000);
+  CHECK_EQ(s.len[1], 2);
+}
+
+// strings are skipped by their length prefix, 0xFF = not present
+static void test_strings_skipped(void)
+{
+  const uint8_t p[] = {
+    0x05, 0x00, 0x42, 0x03, 'a', 'b', 'c',   // char string "abc"
+    0x06, 0x00, 0x41, 0xFF,                  // octet string, invalid
+    0x00, 0x00, 0x20, 0x07,                  // uint8 7
+  };
+  Seen_t s = { 0 };
+  CHECK_EQ(zclReportDecode(0x0000, p, sizeof(p), onAttr, &s), ZCL_REPORT_OK);
+  CHECK_EQ(s.n, 3);
+  CHECK_EQ(s.len[0], 3);
+  CHECK_EQ(s.len[1], 0);
+  CHECK_EQ(s.len[2], 1);
+}
+
+static void test_bad_and_truncated(void)
+{
+  const uint8_t structure[] = { 0x00, 0x00, 0x4C, 0x01, 0x00 };
+  const uint8_t cut[] = { 0x00, 0x00, 0x21, 0x34 };
+  Seen_t s = { 0 };
+  CHECK_EQ(zclReportDecode(0x0404, structure, sizeof(structure), onAttr, &s), ZCL_REPORT_BAD_TYPE);
+  CHECK_EQ(zclReportDecode(0x0404, cut, sizeof(cut), onAttr, &s), ZCL_REPORT_TRUNCATED);
+  CHECK_EQ(s.n, 0);
+}
+
+// ----- corpus: payloads as the sensors on this network send them -----
+
+typedef struct {
+  const char    *name;
+  uint16_t       cluster;
+  const uint8_t *p;
+  uint16_t       len;
+  unsigned       records;
+} Payload_t;
+
+static const uint8_t s_flow[]     = { 0x00, 0x00, 0x21, 0xE8, 0x03 };
+static const uint8_t s_flowFull[] = { 0x00, 0x00, 0x21, 0xE8, 0x03,   // measured
+                                      0x01, 0x00, 0x21, 0x00, 0x00,   // min
+                                      0x02, 0x00, 0x21, 0x10, 0x27,   // max
+                                      0x03, 0x00, 0x21, 0x05, 0x00 }; // tolerance
+static const uint8_t s_power[]    = { 0x20, 0x00, 0x20, 0x1E,         // voltage 3.0 V
+                                      0x21, 0x00, 0x20, 0xC8 };       // 100 %
+static const uint8_t s_temp[]     = { 0x00, 0x00, 0x29, 0x66, 0x08 };
+static const uint8_t s_humidity[] = { 0x00, 0x00, 0x21, 0x10, 0x17 };
+static const uint8_t s_onOff[]    = { 0x00, 0x00, 0x10, 0x01 };
+static const uint8_t s_basic[]    = { 0x04, 0x00, 0x42, 0x07, '_', 'T', 'Z', '3', '0', '0', '0',
+                                      0x05, 0x00, 0x42, 0x06, 'T', 'S', '0', '2', '0', '1',
+                                      0x07, 0x00, 0x30, 0x03 };       // power source
+// manufacturer attribute first: a binary blob in a char string
+static const uint8_t s_vendor[]   = { 0x01, 0xFF, 0x42, 0x0A, 0x01, 0x21, 0xD1, 0x0B, 0x03, 0x28,
+                                      0x1A, 0x05, 0x21, 0x07,
+                                      0x00, 0x00, 0x21, 0x2C, 0x01 };
+
+static const Payload_t s_corpus[] = {
+  { "flow",     0x0404, s_flow,     sizeof(s_flow),     1 },
+  { "flow4",    0x0404, s_flowFull, sizeof(s_flowFull), 4 },
+  { "power",    0x0001, s_power,    sizeof(s_power),    2 },
+  { "temp",     0x0402, s_temp,     sizeof(s_temp),     1 },
+  { "humidity", 0x0405, s_humidity, sizeof(s_humidity), 1 },
+  { "on_off",   0x0006, s_onOff,    sizeof(s_onOff),    1 },
+  { "basic",    0x0000, s_basic,    sizeof(s_basic),    3 },
+  { "vendor",   0x0404, s_vendor,   sizeof(s_vendor),   2 },
+};
+#define CORPUS_LEN  (sizeof(s_corpus) / sizeof(s_corpus[0]))
+
+// every record handed out lies inside the payload; OK means every byte
+// was consumed by a record
+typedef struct {
+  const uint8_t *p;
+  uint16_t       len;
+  unsigned       n;
+  unsigned       consumed;
+  bool           inside;
+} Walk_t;
+
+static void onWalk(void *ctx, const ZclAttr_t *a)
+{
+  Walk_t *w = (Walk_t *)ctx;
+  uint8_t size = zclTypeSize(a->type);
+  unsigned prefix = (size == ZCL_SIZE_STR8) ? 1u : (size == ZCL_SIZE_STR16) ? 2u : 0u;
+  if (a->len > 0u && (a->val < w->p || a->val + a->len > w->p + w->len)) w->inside = false;
+  w->consumed += 3u + prefix + a->len;
+  w->n++;
+}
+
+static zcl_report_status_t walk(uint16_t cluster, const uint8_t *src, uint16_t len, Walk_t *w)
+{
+  // exact-size copy: a read past the end is a heap overrun, not a neighbour
+  uint8_t *p = malloc(len ? len : 1u);
+  if (len) memcpy(p, src, len);
+  memset(w, 0, sizeof(*w));
+  w->p = p;
+  w->len = len;
+  w->inside = true;
+  zcl_report_status_t st = zclReportDecode(cluster, p, len, onWalk, w);
+  free(p);
+  return st;
+}
+
+static void test_corpus_decodes(void)
+{
+  for (unsigned i = 0; i < CORPUS_LEN; i++) {
+    const Payload_t *c = &s_corpus[i];
+    Walk_t w;
+    CHECK_EQ(walk(c->cluster, c->p, c->len, &w), ZCL_REPORT_OK);
+    CHECK_EQ(w.n, c->records);
+    CHECK_EQ(w.consumed, c->len);
+    CHECK(w.inside);
+  }
+}
+
+// a record of every skippable type in front: the real records still come out
+static void test_unknown_record_first(void)
+{
+  unsigned types = 0;
+  for (unsigned t = 0; t < 256u; t++) {
+    uint8_t size = zclTypeSize((uint8_t)t);
+    if (size == ZCL_SIZE_UNKNOWN) continue;
+    types++;
+
+    uint8_t buf[3 + 16 + 64] = { 0xEF, 0xBE, (uint8_t)t };
+    uint16_t recLen = 3;
+    if (size == ZCL_SIZE_STR8) {
+      buf[recLen++] = 2;                 // 2 bytes of string data
+      recLen += 2;
+    } else if (size == ZCL_SIZE_STR16) {
+      buf[recLen++] = 2;
+      buf[recLen++] = 0;
+      recLen += 2;
+    } else if (size != ZCL_SIZE_NODATA) {
+      recLen += size;
+    }
+
+    for (unsigned i = 0; i < CORPUS_LEN; i++) {
+      const Payload_t *c = &s_corpus[i];
+      memcpy(&buf[recLen], c->p, c->len);
+      Walk_t w;
+      CHECK_EQ(walk(c->cluster, buf, (uint16_t)(recLen + c->len), &w), ZCL_REPORT_OK);
+      CHECK_EQ(w.n, c->records + 1u);
+      CHECK_EQ(w.consumed, recLen + c->len);
+    }
+  }
+  printf("  %u skippable types\n", types);
+}
+
+// every truncation and every single-byte value at every offset: records
+// stay inside the payload, and OK only when it was consumed whole
+static void test_mutations_stay_in_bounds(void)
+{
+  unsigned runs = 0, ok = 0, truncated = 0, badType = 0;
+  for (unsigned i = 0; i < CORPUS_LEN; i++) {
+    const Payload_t *c = &s_corpus[i];
+    uint8_t buf[64];
+    Walk_t w;
+
+    for (uint16_t n = 0; n < c->len; n++) {
+      zcl_report_status_t st = walk(c->cluster, c->p, n, &w);
+      CHECK(w.inside);
+      CHECK(st != ZCL_REPORT_OK || w.consumed == n);
+      runs++;
+    }
+    for (uint16_t off = 0; off < c->len; off++) {
+      for (unsigned v = 0; v < 256u; v++) {
+        memcpy(buf, c->p, c->len);
+        buf[off] = (uint8_t)v;
+        zcl_report_status_t st = walk(c->cluster, buf, c->len, &w);
+        CHECK(w.inside);
+        CHECK(st != ZCL_REPORT_OK || w.consumed == c->len);
+        ok += (st == ZCL_REPORT_OK) ? 1u : 0u;
+        truncated += (st == ZCL_REPORT_TRUNCATED) ? 1u : 0u;
+        badType += (st == ZCL_REPORT_BAD_TYPE) ? 1u : 0u;
+        runs++;
+      }
+    }
+  }
+  printf("  %u payloads: %u ok, %u truncated, %u bad type\n", runs, ok, truncated, badType);
+}
+
+static void onCount(void *ctx, const ZclAttr_t *a)
+{
+  (void)a;
+  (*(unsigned *)ctx)++;
+}
+
+#define DECODE_ROUNDS  20000u
+
+static void test_decode_throughput(void)
+{
+  unsigned records = 0;
+  size_t bytes = 0;
+  uint64_t t0 = hostWallNs();
+  for (unsigned r = 0; r < DECODE_ROUNDS; r++) {
+    for (unsigned i = 0; i < CORPUS_LEN; i++) {
+      const Payload_t *c = &s_corpus[i];
+      (void)zclReportDecode(c->cluster, c->p, c->len, onCount, &records);
+      bytes += c->len;
+    }
+  }
+  uint64_t ns = hostWallNs() - t0;
+  printf("  %.1f MB/s, %.1f ns/record, %.1f ns/payload\n", (double)bytes * 1000.0 / (double)ns,
+         (double)ns / records, (double)ns / (DECODE_ROUNDS * CORPUS_LEN));
+  unsigned perRound = 0;
+  for (unsigned i = 0; i < CORPUS_LEN; i++) perRound += s_corpus[i].records;
+  CHECK_EQ(records, perRound * DECODE_ROUNDS);
+}
+
+int main(void)
+{
+  RUN(test_nodata_is_empty_value);
+  RUN(test_strings_skipped);
+  RUN(test_bad_and_truncated);
+  RUN(test_corpus_decodes);
+  RUN(test_unknown_record_first);
+  RUN(test_mutations_stay_in_bounds);
+  RUN(test_decode_throughput);
+  return hostExit();
+}
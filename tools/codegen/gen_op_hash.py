@@ -0,0 +1,117 @@
+"""
+Generate the @CMD op lookup table in Coordinator_Node/app/cmd_handler.c.
+
+The op names are read from the s_ops[] table in that file, in order. The
+script searches for an FNV-1a offset basis under which every name lands in
+its own slot, then rewrites the block between the GENERATED markers with
+the seed and a slot -> op index table. findOp() then costs one hash and
+one string compare, with no probing and no init at runtime.
+
+Re-run after adding, removing or reordering a row of s_ops[]:
+
+    python tools/codegen/gen_op_hash.py
+
+The firmware refuses to build if the op count no longer matches the table.
+"""
+
+import argparse
+import re
+import sys
+from pathlib import Path
+
+ROOT = Path(__file__).resolve().parents[2]
+SRC = ROOT / "Coordinator_Node" / "app" / "cmd_handler.c"
+
+BEGIN = "// ----- BEGIN GENERATED by tools/codegen/gen_op_hash.py -----"
+END = "// ----- END GENERATED -----"
+
+FNV_BASIS = 2166136261
+FNV_PRIME = 16777619
+
+
+def fnv1a(name: str, basis: int) -> int:
+    h = basis
+    for b in name.encode("ascii"):
+        h ^= b
+        h = (h * FNV_PRIME) & 0xFFFFFFFF
+    return h
+
+
+def op_names(text: str) -> list:
+    m = re.search(r"static const CmdOpDef_t s_ops\[\] = \{(.*?)\n\};", text, re.S)
+    if not m:
+        sys.exit("s_ops[] not found in %s" % SRC)
+    # rows start with `  { "name", opFn,` at two-space indent
+    return re.findall(r'^  \{ "([a-z0-9_]+)", op\w+,', m.group(1), re.M)
+
+
+def find_seed(names: list, slots: int, tries: int):
+    for seed in range(tries):
+        basis = FNV_BASIS ^ seed
+        used = {}
+        for i, n in enumerate(names):
+            s = fnv1a(n, basis) & (slots - 1)
+            if s in used:
+                break
+            used[s] = i
+        else:
+            return basis, used
+    return None, None
+
+
+def render(names: list, slots: int, basis: int, used: dict) -> str:
+    out = [BEGIN]
+    out.append("#define CMD_OP_SLOTS      %uu   // power of 2" % slots)
+    out.append("#define CMD_OP_HASH_BASIS 0x%08Xu" % basis)
+    out.append("#define CMD_OP_HASH_COUNT %uu" % len(names))
+    out.append("")
+    out.append("// slot -> op index + 1, 0 = empty")
+    out.append("static const uint8_t s_opSlot[CMD_OP_SLOTS] = {")
+    for s in range(slots):
+        if s in used:
+            i = used[s]
+            out.append("  %-4s = %-3s // %s" % ("[%u]" % s, "%u," % (i + 1), names[i]))
+    out.append("};")
+    out.append(END)
+    return "\n".join(out)
+
+
+def main() -> None:
+    ap = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    ap.add_argument("--check", action="store_true",
+                    help="exit 1 if cmd_handler.c is out of date, write nothing")
+    args = ap.parse_args()
+
+    text = SRC.read_text(encoding="utf-8")
+    names = op_names(text)
+    if len(set(names)) != len(names):
+        sys.exit("duplicate op name in s_ops[]")
+
+    block = None
+    for slots in (32, 64, 128):
+        if slots <= len(names):
+            continue
+        basis, used = find_seed(names, slots, 1 << 20)
+        if basis is not None:
+            block = render(names, slots, basis, used)
+            break
+    if block is None:
+        sys.exit("no collision-free seed found")
+
+    start = text.find(BEGIN)
+    stop = text.find(END)
+    if start < 0 or stop < 0:
+        sys.exit("GENERATED markers not found in %s" % SRC)
+    new = text[:start] + block + text[stop + len(END):]
+
+    if args.check:
+        if new != text:
+            sys.exit("%s: op table out of date, re-run %s" % (SRC.name, Path(__file__).name))
+        return
+    if new != text:
+        SRC.write_text(new, encoding="utf-8", newline="\n")
+        print("updated %s (%u ops)" % (SRC.relative_to(ROOT), len(names)))
+
+
+if __name__ == "__main__":
+    main()
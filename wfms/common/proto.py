@@ -4,14 +4,25 @@ UART Protocol Parser/Builder for Zigbee Coordinator
 Coordinator Protocol (from coordinator_protocol_spec.md):
 - Baud: 115200, 8N1, LF line ending
 - @INFO {"node_id":"0x0000","eui64":"...","pan_id":"0xBEEF",...}
-- @DATA {"flow":150,"valve":"open","battery":85,"mode":"auto",...}
+- @DATA {"flow":150,"flow_f":148,"valve":"open","battery":85,"mode":"auto",...}
 - @ACK {"id":123,"ok":true,"msg":"..."}
 - @LOG {"tag":"NET","event":"formed",...}
+- @STAT {"id":N,"stage":"send_sent","n":..,"avg_us":..,"max_us":..,"base_us":64,"h":[..]}
+- @HIST {"id":N,"sensor":"0x1234","kind":"raw"|"min","uptime":..,"offset":..,"s"|"b":[..]}
+- @ALRM {"sensor":"0x1234","kind":"deviation"|"min_flow"|"stale","state":"raised"|"cleared",
+         "flow":..,"limit"|"min"|"timeout_s":..,"for_s":..,"uptime":..}
 - @CMD {"id":<uint32>,"op":"<operation>",...params}
 
 Available Operations:
 - info, mode_set, threshold_set, valve_set, valve_path_set,
-- valve_target_set, valve_pair, net_cfg_set, net_form, uart_gateway_set
+- valve_target_set, valve_pair, net_cfg_set, net_form, uart_gateway_set,
+- proto_set ("text" | "binary" framing, see Binary Framed Protocol below)
+- data_cfg_set, data_get (delta @DATA), stats (latency histograms)
+- filter_set (median / EWMA ahead of AUTO control), total_cfg_set (volume checkpoints)
+- sensor_get (per-sensor telemetry), history (flow history backfill)
+- time_set (local time for the leak baseline), leak_cfg_set, leak_clear
+- stale_cfg_set (sensor last-seen deadline, AUTO fail-safe valve state)
+- valve_get (one valve of the valve table; the valve ops take "valve", default 0)
 
 DO NOT BREAK: Parse functions must handle all documented formats.
 """
@@ -29,6 +40,9 @@ PREFIX_ACK = "@ACK"
 PREFIX_CMD = "@CMD"
 PREFIX_LOG = "@LOG"
 PREFIX_INFO = "@INFO"
+PREFIX_STAT = "@STAT"
+PREFIX_HIST = "@HIST"
+PREFIX_ALRM = "@ALRM"
 
 # Line ending for UART TX (CRLF works better with embedded CLI)
 UART_EOL = "\r\n"
@@ -50,6 +64,19 @@ class Operation(str, Enum):
     NET_CFG_SET = "net_cfg_set"
     NET_FORM = "net_form"
     UART_GATEWAY_SET = "uart_gateway_set"
+    PROTO_SET = "proto_set"
+    DATA_CFG_SET = "data_cfg_set"
+    DATA_GET = "data_get"
+    STATS = "stats"
+    SENSOR_GET = "sensor_get"
+    HISTORY = "history"
+    FILTER_SET = "filter_set"
+    TOTAL_CFG_SET = "total_cfg_set"
+    TIME_SET = "time_set"
+    LEAK_CFG_SET = "leak_cfg_set"
+    LEAK_CLEAR = "leak_clear"
+    STALE_CFG_SET = "stale_cfg_set"
+    VALVE_GET = "valve_get"
 
 
 # Valve state mapping: MQTT (ON/OFF) <-> Coordinator (open/closed)
@@ -65,6 +92,13 @@ VALVE_PATH_AUTO = "auto"
 VALVE_PATH_DIRECT = "direct"
 VALVE_PATH_BINDING = "binding"
 
+# Size of the Coordinator valve table (VALVE_TABLE_MAX in app_config.h)
+VALVE_TABLE_MAX = 32
+
+# UART framing (proto_set)
+PROTO_TEXT = "text"
+PROTO_BINARY = "binary"
+
 
 def parse_uart_line(line: str) -> Tuple[str, Dict[str, Any]]:
     """
@@ -100,6 +134,9 @@ def parse_uart_line(line: str) -> Tuple[str, Dict[str, Any]]:
         PREFIX_CMD: "CMD",
         PREFIX_LOG: "LOG",
         PREFIX_INFO: "INFO",
+        PREFIX_STAT: "STAT",
+        PREFIX_HIST: "HIST",
+        PREFIX_ALRM: "ALRM",
     }
     
     msg_type = None
@@ -186,7 +223,10 @@ def make_cmd_line(cmd_dict: Dict[str, Any], operation: Optional[str] = None) ->
         # Copy optional parameters based on operation
         optional_fields = ["value", "close_th", "open_th", "node_id", "dst_ep", 
                           "eui64", "bind_index", "pan_id", "ch", "tx_power", 
-                          "force", "enable"]
+                          "force", "enable", "delta", "full_every", "reset",
+                          "offset", "kind", "median", "ewma_shift", "interval_s", "delta_l",
+                          "dev_window_s", "min_window_s", "close",
+                          "timeout_s", "action", "valve"]
         for field in optional_fields:
             if field in cmd_dict:
                 coord_cmd[field] = cmd_dict[field]
@@ -264,13 +304,28 @@ def make_threshold_set_cmd(close_th: int, open_th: int = 0, cid: Optional[str] =
     })
 
 
-def make_valve_set_cmd(state: str, cid: Optional[str] = None) -> str:
+def _valve_arg(cmd: Dict[str, Any], valve: Optional[int]) -> Dict[str, Any]:
+    """Add the "valve" table index to a valve op (None = default valve 0)."""
+    if valve is not None:
+        if not 0 <= valve < VALVE_TABLE_MAX:
+            raise ValueError(f"Invalid valve: {valve}")
+        cmd["valve"] = valve
+    return cmd
+
+
+def make_valve_set_cmd(state: str, cid: Optional[str] = None,
+                       valve: Optional[int] = None) -> str:
     """
     Create valve_set command.
     
+    While the valve has a command in flight the new one waits in a single
+    pending slot; a newer valve_set replaces it and the replaced id is
+    ACKed "superseded".
+    
     Args:
         state: "open" or "closed" (Coordinator format) or "ON"/"OFF" (MQTT format)
         cid: Optional correlation ID
+        valve: Valve table index, None = default valve (AUTO control's valve)
     """
     # Normalize to Coordinator format
     if state.upper() in VALVE_MQTT_TO_COORD:
@@ -280,31 +335,34 @@ def make_valve_set_cmd(state: str, cid: Optional[str] = None) -> str:
     else:
         state = state.lower()
     
-    return make_cmd_line({
+    return make_cmd_line(_valve_arg({
         "cid": cid or f"valve_{_id_counter}",
         "op": Operation.VALVE_SET.value,
         "value": state
-    })
+    }, valve))
 
 
-def make_valve_path_cmd(path: str, cid: Optional[str] = None) -> str:
+def make_valve_path_cmd(path: str, cid: Optional[str] = None,
+                        valve: Optional[int] = None) -> str:
     """
     Create valve_path_set command.
     
     Args:
         path: "auto", "direct", or "binding"
         cid: Optional correlation ID
+        valve: Valve table index, None = default valve
     """
     if path not in (VALVE_PATH_AUTO, VALVE_PATH_DIRECT, VALVE_PATH_BINDING):
         raise ValueError(f"Invalid path: {path}")
-    return make_cmd_line({
+    return make_cmd_line(_valve_arg({
         "cid": cid or f"path_{_id_counter}",
         "op": Operation.VALVE_PATH_SET.value,
         "value": path
-    })
+    }, valve))
 
 
-def make_valve_target_cmd(node_id: int, dst_ep: int = 1, cid: Optional[str] = None) -> str:
+def make_valve_target_cmd(node_id: int, dst_ep: int = 1, cid: Optional[str] = None,
+                          valve: Optional[int] = None) -> str:
     """
     Create valve_target_set command.
     
@@ -312,13 +370,14 @@ def make_valve_target_cmd(node_id: int, dst_ep: int = 1, cid: Optional[str] = No
         node_id: Short address (decimal)
         dst_ep: Destination endpoint (default: 1)
         cid: Optional correlation ID
+        valve: Valve table index, None = default valve
     """
-    return make_cmd_line({
+    return make_cmd_line(_valve_arg({
         "cid": cid or f"target_{_id_counter}",
         "op": Operation.VALVE_TARGET_SET.value,
         "node_id": node_id,
         "dst_ep": dst_ep
-    })
+    }, valve))
 
 
 def make_valve_pair_cmd(
@@ -326,7 +385,8 @@ def make_valve_pair_cmd(
     node_id: int, 
     bind_index: int = 0, 
     dst_ep: int = 1, 
-    cid: Optional[str] = None
+    cid: Optional[str] = None,
+    valve: Optional[int] = None
 ) -> str:
     """
     Create valve_pair command.
@@ -337,17 +397,46 @@ def make_valve_pair_cmd(
         bind_index: Index in binding table
         dst_ep: Destination endpoint
         cid: Optional correlation ID
+        valve: Valve table index, None = default valve
     """
     if len(eui64) != 16 or not all(c in '0123456789ABCDEFabcdef' for c in eui64):
         raise ValueError(f"Invalid EUI64: {eui64}. Must be 16 hex chars.")
-    return make_cmd_line({
+    return make_cmd_line(_valve_arg({
         "cid": cid or f"pair_{_id_counter}",
         "op": Operation.VALVE_PAIR.value,
         "eui64": eui64.upper(),
         "node_id": node_id,
         "bind_index": bind_index,
         "dst_ep": dst_ep
-    })
+    }, valve))
+
+
+def make_valve_get_cmd(valve: int, cid: Optional[str] = None) -> str:
+    """
+    Create valve_get command (one valve of the valve table).
+    
+    The valve is reported as @DATA {"valve_idx":N,"valve":"open"|"closed",
+    "valve_known":..,"valve_node_id":..,"valve_path":..,"tx_pending":..,
+    "vpath":[direct lat_ms, ok_pct, n, binding lat_ms, ok_pct, n],
+    "conf":..,"conf_ms":..};
+    the same frame follows every completed TX of a valve other than 0,
+    and every change of its reported state or "conf".
+    "vpath" are the delivery statistics behind valve_path "auto".
+    "valve" is the state the valve node reports (OnOff attribute) once it
+    reports, else the last delivered command. "conf" compares it with the
+    last command: "none" (no report yet), "wait" (command sent, report not
+    in yet), "ok", "diverged" (manual button, lost actuation); "conf_ms"
+    is the last command -> report latency.
+    The legacy valve fields of @DATA / @INFO are valve 0.
+    
+    Args:
+        valve: Valve table index (0..VALVE_TABLE_MAX-1)
+        cid: Optional correlation ID
+    """
+    return make_cmd_line(_valve_arg({
+        "cid": cid or f"vget_{_id_counter}",
+        "op": Operation.VALVE_GET.value,
+    }, valve))
 
 
 def make_net_form_cmd(
@@ -401,6 +490,328 @@ def make_uart_gateway_cmd(enable: bool, cid: Optional[str] = None) -> str:
     })
 
 
+def make_proto_set_cmd(mode: str, cid: Optional[str] = None) -> str:
+    """
+    Create proto_set command (switch UART framing).
+    
+    The @ACK for proto_set is still sent in the old framing; everything
+    after it uses the new one.
+    
+    Args:
+        mode: "text" or "binary"
+        cid: Optional correlation ID
+    """
+    if mode not in (PROTO_TEXT, PROTO_BINARY):
+        raise ValueError(f"Invalid proto mode: {mode}")
+    return make_cmd_line({
+        "cid": cid or f"proto_{_id_counter}",
+        "op": Operation.PROTO_SET.value,
+        "value": mode
+    })
+
+
+def make_data_cfg_cmd(delta: bool, full_every: Optional[int] = None,
+                      cid: Optional[str] = None) -> str:
+    """
+    Create data_cfg_set command (delta-encoded @DATA).
+    
+    In delta mode @DATA frames carry "ver" and "delta":true plus only the
+    fields that changed; a full snapshot (no "delta" key) follows every
+    full_every frames. Merge deltas onto cached state (StateCache does).
+    
+    Args:
+        delta: True = changed fields only, False = always full frames
+        full_every: Full snapshot every N frames (1..255), None = keep
+        cid: Optional correlation ID
+    """
+    cmd = {
+        "cid": cid or f"data_cfg_{_id_counter}",
+        "op": Operation.DATA_CFG_SET.value,
+        "delta": 1 if delta else 0,
+    }
+    if full_every is not None:
+        if not 1 <= full_every <= 255:
+            raise ValueError(f"Invalid full_every: {full_every}")
+        cmd["full_every"] = full_every
+    return make_cmd_line(cmd)
+
+
+def make_filter_cmd(median: Optional[int] = None, ewma_shift: Optional[int] = None,
+                    cid: Optional[str] = None) -> str:
+    """
+    Create filter_set command (flow filter ahead of AUTO control).
+    
+    Every report goes through median-of-N, then an EWMA with
+    alpha = 1/2^ewma_shift; AUTO hysteresis uses the result, reported as
+    "flow_f" next to the raw "flow". @INFO "filter" is [median, ewma_shift].
+    
+    Args:
+        median: Odd window 1..7 (1 = off), None = keep
+        ewma_shift: 0..7 (0 = off), None = keep
+        cid: Optional correlation ID
+    """
+    cmd: Dict[str, Any] = {"cid": cid or f"filter_{_id_counter}", "op": Operation.FILTER_SET.value}
+    if median is not None:
+        if median not in (1, 3, 5, 7):
+            raise ValueError(f"Invalid median: {median}")
+        cmd["median"] = median
+    if ewma_shift is not None:
+        if not 0 <= ewma_shift <= 7:
+            raise ValueError(f"Invalid ewma_shift: {ewma_shift}")
+        cmd["ewma_shift"] = ewma_shift
+    return make_cmd_line(cmd)
+
+
+def make_total_cfg_cmd(interval_s: Optional[int] = None, delta_l: Optional[int] = None,
+                       cid: Optional[str] = None) -> str:
+    """
+    Create total_cfg_set command (volume totalizer NVM3 checkpoints).
+    
+    Consumed volume is reported as "vol_ml" (per sensor and primary @DATA;
+    site total in @INFO with "ckpt_writes"). A checkpoint is written every
+    interval_s while volume accrues, or after delta_l litres. Only the first
+    8 sensors are checkpointed; @INFO "tot_unsaved" counts the others.
+    
+    Args:
+        interval_s: 60..86400, None = keep
+        delta_l: 1..65535, None = keep
+        cid: Optional correlation ID
+    """
+    cmd: Dict[str, Any] = {"cid": cid or f"total_{_id_counter}", "op": Operation.TOTAL_CFG_SET.value}
+    if interval_s is not None:
+        if not 60 <= interval_s <= 86400:
+            raise ValueError(f"Invalid interval_s: {interval_s}")
+        cmd["interval_s"] = interval_s
+    if delta_l is not None:
+        if not 1 <= delta_l <= 65535:
+            raise ValueError(f"Invalid delta_l: {delta_l}")
+        cmd["delta_l"] = delta_l
+    return make_cmd_line(cmd)
+
+
+def make_time_set_cmd(local_s: Optional[int] = None, cid: Optional[str] = None) -> str:
+    """
+    Create time_set command (Coordinator local time, for the per-hour
+    leak baseline).
+    
+    Args:
+        local_s: Local time as seconds since the epoch (UTC + zone offset);
+                 default: now, in this host's zone
+        cid: Optional correlation ID
+    """
+    if local_s is None:
+        now = time.time()
+        local_s = int(now + time.localtime(now).tm_gmtoff)
+    if not 0 <= local_s <= 0xFFFFFFFF:
+        raise ValueError(f"Invalid local_s: {local_s}")
+    return make_cmd_line({"cid": cid or f"time_{_id_counter}", "op": Operation.TIME_SET.value,
+                          "value": local_s})
+
+
+def make_leak_cfg_cmd(dev_window_s: Optional[int] = None, min_window_s: Optional[int] = None,
+                      close: Optional[bool] = None, cid: Optional[str] = None) -> str:
+    """
+    Create leak_cfg_set command (on-Coordinator leak detection).
+    
+    Args:
+        dev_window_s: 60..86400, flow above the hour's baseline this long raises "deviation"
+        min_window_s: 600..86400, flow never back to zero this long raises "min_flow"
+        close: close the valve on a leak alarm (AUTO mode) until leak_clear
+        cid: Optional correlation ID
+    """
+    cmd: Dict[str, Any] = {"cid": cid or f"leak_{_id_counter}", "op": Operation.LEAK_CFG_SET.value}
+    if dev_window_s is not None:
+        if not 60 <= dev_window_s <= 86400:
+            raise ValueError(f"Invalid dev_window_s: {dev_window_s}")
+        cmd["dev_window_s"] = dev_window_s
+    if min_window_s is not None:
+        if not 600 <= min_window_s <= 86400:
+            raise ValueError(f"Invalid min_window_s: {min_window_s}")
+        cmd["min_window_s"] = min_window_s
+    if close is not None:
+        cmd["close"] = 1 if close else 0
+    return make_cmd_line(cmd)
+
+
+def make_leak_clear_cmd(cid: Optional[str] = None) -> str:
+    """Create leak_clear command (drop leak alarms, release the valve lock)."""
+    return make_cmd_line({"cid": cid or f"leak_clear_{_id_counter}", "op": Operation.LEAK_CLEAR.value})
+
+
+def make_stale_cfg_cmd(timeout_s: Optional[int] = None, action: Optional[str] = None,
+                       cid: Optional[str] = None) -> str:
+    """
+    Create stale_cfg_set command (stale sensor detection).
+    
+    A sensor not heard from for timeout_s raises @ALRM kind "stale". If it
+    is the primary sensor and the Coordinator is in AUTO mode, the valve is
+    driven to the safe state given by action until the sensor reports again.
+    
+    Args:
+        timeout_s: 30..86400, None = keep
+        action: "none" | "close" | "open", None = keep
+        cid: Optional correlation ID
+    """
+    cmd: Dict[str, Any] = {"cid": cid or f"stale_{_id_counter}", "op": Operation.STALE_CFG_SET.value}
+    if timeout_s is not None:
+        if not 30 <= timeout_s <= 86400:
+            raise ValueError(f"Invalid timeout_s: {timeout_s}")
+        cmd["timeout_s"] = timeout_s
+    if action is not None:
+        if action not in ("none", "close", "open"):
+            raise ValueError(f"Invalid action: {action}")
+        cmd["action"] = action
+    return make_cmd_line(cmd)
+
+
+def make_data_get_cmd(cid: Optional[str] = None) -> str:
+    """Create data_get command (request a full @DATA snapshot)."""
+    return make_cmd_line({
+        "cid": cid or f"data_get_{_id_counter}",
+        "op": Operation.DATA_GET.value,
+    })
+
+
+def make_sensor_get_cmd(node_id: Optional[int] = None, offset: int = 0,
+                        cid: Optional[str] = None) -> str:
+    """
+    Create sensor_get command (per-sensor telemetry).
+    
+    Each sensor is reported as @DATA {"sensor":"0x1234","eui64":..,"flow":..,
+    "battery":..,"lqi":..,"seq":[rx,lost,dup,reord],"age_s":..,"primary":..}.
+    "seq" counts the sensor's ZCL report sequence numbers: accepted,
+    skipped (lost over the mesh), duplicates and late arrivals (both dropped). Without node_id the
+    Coordinator sends one page of sensors starting at offset; the ACK msg
+    is "sensors <n> next <offset>/<total>".
+    
+    Args:
+        node_id: One sensor by node ID, or None for a page of all sensors
+        offset: First table index of the page
+        cid: Optional correlation ID
+    """
+    cmd: Dict[str, Any] = {"cid": cid or f"sensor_{_id_counter}", "op": Operation.SENSOR_GET.value}
+    if node_id is not None:
+        cmd["node_id"] = f"0x{node_id:04X}"
+    elif offset:
+        cmd["offset"] = offset
+    return make_cmd_line(cmd)
+
+
+def make_stats_cmd(reset: bool = False, cid: Optional[str] = None) -> str:
+    """
+    Create stats command (command latency histograms).
+    
+    The Coordinator answers with one @STAT line per stage (line_cmd,
+    cmd_queue, queue_send, send_sent, sent_ack, ack_uart, total, plus
+    rx_cb / rx_pass: telemetry report callback and the coalesced telemetry
+    pass - rx_pass.n / rx_cb.n is @DATA passes per report, valve_tts:
+    valve command first send -> delivered, retries included, and
+    valve_confirm: first send -> OnOff report of the new state), then the
+    @ACK. "h" holds log2 bucket counts: h[0] < base_us, h[k] < base_us << k.
+    
+    Args:
+        reset: Clear the histograms after reporting
+        cid: Optional correlation ID
+    """
+    cmd = {"cid": cid or f"stats_{_id_counter}", "op": Operation.STATS.value}
+    if reset:
+        cmd["reset"] = 1
+    return make_cmd_line(cmd)
+
+
+def make_history_cmd(node_id: Optional[int] = None, kind: str = "min",
+                      offset: int = 0, cid: Optional[str] = None) -> str:
+    """
+    Create history command (flow history backfill, one page per call).
+    
+    The Coordinator answers with one @HIST line, then the ACK with msg
+    "hist <n> next <offset>/<total>"; repeat with offset=next until
+    next == total. Entry times are Coordinator uptime seconds: wall time
+    is now - (payload["uptime"] - t).
+      kind "raw": "s":[[t,flow],..]  (last 10 min)
+      kind "min": "b":[[t,min,max,avg,n],..]  (1-minute buckets, 24 h,
+                  empty minutes omitted)
+    
+    Args:
+        node_id: Sensor node ID, None for the primary sensor
+        kind: "raw" or "min"
+        offset: Position to continue from (0 = oldest)
+        cid: Optional correlation ID
+    """
+    cmd: Dict[str, Any] = {"cid": cid or f"hist_{_id_counter}", "op": Operation.HISTORY.value,
+                           "kind": kind}
+    if node_id is not None:
+        cmd["node_id"] = f"0x{node_id:04X}"
+    if offset:
+        cmd["offset"] = offset
+    return make_cmd_line(cmd)
+
+
+class DataVersionTracker:
+    """
+    Track @DATA "ver" to detect lost frames.
+    
+    ver increases by exactly 1 per @DATA frame. A jump means frames were
+    lost; if the current frame is a delta the merged state may be stale
+    and a full snapshot should be requested (make_data_get_cmd).
+    A smaller ver means the Coordinator restarted.
+    """
+    
+    def __init__(self):
+        self.last_ver: Optional[int] = None
+        self.lost = 0
+    
+    def update(self, data: Dict[str, Any]) -> bool:
+        """Feed one @DATA payload. Returns True if a resync is needed."""
+        ver = data.get("ver")
+        if not isinstance(ver, int):
+            return False
+        prev, self.last_ver = self.last_ver, ver
+        is_delta = bool(data.get("delta"))
+        if prev is None or ver <= prev:
+            return is_delta
+        if ver != prev + 1:
+            self.lost += ver - prev - 1
+            return is_delta
+        return False
+
+
+# Ops whose final @ACK arrives later; the Coordinator refuses them in a batch
+BATCH_REJECTED_OPS = frozenset({"valve_set"})
+
+
+def make_batch_cmd(ops: List[Dict[str, Any]], stop_on_error: bool = True,
+                   cid: Optional[str] = None) -> str:
+    """
+    Create one @CMD that runs several ops in order with a single @ACK.
+    
+    The Coordinator answers with
+    @ACK {"id":N,"ok":...,"msg":"batch 3/4","results":[{"op":..,"ok":..,"msg":..},...]}
+    If the results do not fit one @ACK the last ones are left out and the
+    ACK carries "truncated": true; the summary still counts every op.
+    valve_set is not allowed inside a batch (its delivery ACK would reuse
+    the batch id); send it as its own command.
+    
+    Args:
+        ops: List of op dicts, e.g. [{"op":"valve_path_set","value":"direct"}, ...]
+        stop_on_error: Stop at the first failing op (default) or run all
+        cid: Optional correlation ID
+    
+    Example:
+        >>> make_batch_cmd([{"op": "mode_set", "value": "auto"}, {"op": "info"}])
+        '@CMD {"id":4,"batch":[{"op":"mode_set","value":"auto"},{"op":"info"}],"stop_on_error":1}\\r\\n'
+    """
+    if not ops:
+        raise ValueError("batch must contain at least one op")
+    if any(op.get("op") in BATCH_REJECTED_OPS for op in ops):
+        raise ValueError("valve_set cannot be batched; send it on its own")
+    numeric_id = _cid_to_numeric_id(cid or f"batch_{_id_counter}")
+    batch = [{k: v for k, v in op.items() if k not in ("id", "cid")} for op in ops]
+    coord_cmd = {"id": numeric_id, "batch": batch, "stop_on_error": 1 if stop_on_error else 0}
+    json_str = json.dumps(coord_cmd, separators=(',', ':'))
+    return f"@CMD {json_str}{UART_EOL}"
+
+
 def make_data_line(data_dict: Dict[str, Any]) -> str:
     """
     Create a @DATA line (used by FakeUart).
@@ -491,7 +902,7 @@ def translate_coordinator_ack(coord_ack: Dict[str, Any]) -> Dict[str, Any]:
     }
     
     # Preserve additional fields from Coordinator ACK (valve, mode, etc.)
-    for key in ["valve", "mode", "valve_path", "valve_known", "valve_node_id"]:
+    for key in ["valve", "mode", "valve_path", "valve_known", "valve_node_id", "results", "truncated"]:
         if key in coord_ack:
             mqtt_ack[key] = coord_ack[key]
     
@@ -555,18 +966,340 @@ def validate_cmd_payload(payload: Dict[str, Any]) -> Tuple[bool, str]:
     return (True, "")
 
 
+# ============================================================================
+# Binary Framed Protocol (proto_set "binary")
+# ============================================================================
+#
+# Wire format (mirrors Coordinator_Node/app/bin_proto.h):
+#   0x00 COBS( type | seq | TLV... | crc16 ) 0x00
+#   TLV:   tag(1) len(1) value(len), integers little-endian; a string longer
+#          than 255 bytes is split over consecutive TLVs with the same tag
+#   crc16: CRC-16/CCITT-FALSE over type..last TLV, little-endian
+#
+# A decoded frame yields the same (type, payload) pair as parse_uart_line(),
+# so callers do not care which framing the Coordinator is using.
+
+BIN_T_DATA = 0x01
+BIN_T_INFO = 0x02
+BIN_T_ACK = 0x03
+BIN_T_LOG = 0x04
+BIN_T_STAT = 0x05
+BIN_T_HIST = 0x06
+BIN_T_ALRM = 0x07
+BIN_T_CMD = 0x10
+
+BIN_TYPE_NAMES = {
+    BIN_T_DATA: "DATA",
+    BIN_T_INFO: "INFO",
+    BIN_T_ACK: "ACK",
+    BIN_T_LOG: "LOG",
+    BIN_T_STAT: "STAT",
+    BIN_T_HIST: "HIST",
+    BIN_T_ALRM: "ALRM",
+    BIN_T_CMD: "CMD",
+}
+
+_BIN_MODE = {0: MODE_MANUAL, 1: MODE_AUTO}
+_BIN_VALVE = {0: "closed", 1: "open"}
+_BIN_PATH = {0: VALVE_PATH_AUTO, 1: VALVE_PATH_DIRECT, 2: VALVE_PATH_BINDING}
+_BIN_ALRM_KIND = {0: "deviation", 1: "min_flow", 2: "stale"}
+_BIN_CONF = {0: "none", 1: "ok", 2: "wait", 3: "diverged"}
+
+# tag -> (json key, kind); keep in sync with BIN_TAG_* in bin_proto.h
+BIN_TAGS = {
+    0x01: ("id", "u32"),
+    0x02: ("ok", "bool"),
+    0x03: ("msg", "str"),
+    0x04: ("mode", "mode"),
+    0x05: ("valve", "valve"),
+    0x06: ("zstatus", "hex8"),
+    0x07: ("stage", "str"),
+    0x08: ("flow", "u16"),
+    0x09: ("battery", "u8"),
+    0x0A: ("tx_pending", "bool"),
+    0x0B: ("valve_path", "path"),
+    0x0C: ("valve_node_id", "hex16"),
+    0x0D: ("valve_known", "bool"),
+    0x0E: ("tag", "str"),
+    0x0F: ("event", "str"),
+    0x10: ("extra", "extra"),
+    0x11: ("uptime", "u32"),
+    0x12: ("node_id", "hex16"),
+    0x13: ("eui64", "eui64"),
+    0x14: ("pan_id", "hex16"),
+    0x15: ("ch", "u8"),
+    0x16: ("tx_power", "i8"),
+    0x17: ("net_state", "u8"),
+    0x18: ("uart_gateway", "bool"),
+    0x19: ("valve_eui64", "eui64"),
+    0x1A: ("bind_index", "u8"),
+    0x1B: ("results", "json_array"),
+    0x1C: ("tx_hwm", "u16"),
+    0x1D: ("tx_drop", "u32_list"),  # ack, data, info, log, alrm
+    0x1E: ("ver", "u32"),
+    0x1F: ("delta", "bool"),
+    0x21: ("lat", "u32_list"),
+    0x22: ("stage", "str"),
+    0x23: ("n", "u32"),
+    0x24: ("avg_us", "u32"),
+    0x25: ("max_us", "u32"),
+    0x26: ("h", "u16_list"),
+    0x27: ("sensor", "hex16"),
+    0x28: ("lqi", "u8"),
+    0x29: ("age_s", "u32"),
+    0x2A: ("primary", "bool"),
+    0x2B: ("temp", "i16"),
+    0x2C: ("pressure", "i16"),
+    0x2D: ("level", "u8"),
+    0x2E: ("kind", "hist_kind"),
+    0x2F: ("offset", "u16"),
+    0x30: ("s", "hist_raw"),
+    0x31: ("b", "hist_min"),
+    0x32: ("seq", "u32_list"),
+    0x33: ("flow_f", "u16"),
+    0x34: ("filter", "u8_list"),
+    0x35: ("vol_ml", "u64"),
+    0x36: ("ckpt_writes", "u32"),
+    0x37: ("kind", "alrm_kind"),
+    0x38: ("state", "alrm_state"),
+    0x39: ("limit", "u16"),
+    0x3A: ("min", "u16"),
+    0x3B: ("for_s", "u32"),
+    0x3C: ("leak", "u8_list"),
+    0x3D: ("local_s", "u32"),
+    0x3E: ("timeout_s", "u32"),
+    0x3F: ("stale", "u8_list"),
+    0x40: ("valve_idx", "u8"),
+    0x41: ("valves", "u8_list"),
+    0x42: ("vtx", "u32_list"),
+    0x43: ("vpath", "u16_list"),
+    0x44: ("conf", "conf"),
+    0x45: ("conf_ms", "u16"),
+    0x46: ("vconf", "u32_list"),
+    0x47: ("tot_unsaved", "u16"),
+    0x48: ("truncated", "bool"),
+    0x20: ("cmd", "str"),
+}
+
+
+def crc16_ccitt(data: bytes) -> int:
+    """CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)."""
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if (crc & 0x8000) else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_encode(data: bytes) -> bytes:
+    """COBS-encode data (no trailing delimiter)."""
+    out = bytearray([0])
+    code_idx = 0
+    code = 1
+    for b in data:
+        if b == 0:
+            out[code_idx] = code
+            code_idx = len(out)
+            out.append(0)
+            code = 1
+        else:
+            out.append(b)
+            code += 1
+            if code == 0xFF:
+                out[code_idx] = code
+                code_idx = len(out)
+                out.append(0)
+                code = 1
+    out[code_idx] = code
+    return bytes(out)
+
+
+def cobs_decode(data: bytes) -> bytes:
+    """Decode one COBS segment (delimiters stripped). Raises ValueError."""
+    out = bytearray()
+    i = 0
+    n = len(data)
+    while i < n:
+        code = data[i]
+        i += 1
+        if code == 0 or i + code - 1 > n:
+            raise ValueError("bad cobs")
+        out += data[i:i + code - 1]
+        i += code - 1
+        if code != 0xFF and i < n:
+            out.append(0)
+    return bytes(out)
+
+
+def _decode_tlv_value(kind: str, v: bytes) -> Any:
+    if kind == "str":
+        return v.decode("utf-8", errors="replace")
+    if kind == "bool":
+        return bool(v[0]) if v else False
+    if kind in ("i8", "i16"):
+        return int.from_bytes(v, "little", signed=True)
+    if kind == "hex8":
+        return f"0x{int.from_bytes(v, 'little'):02X}"
+    if kind == "hex16":
+        return f"0x{int.from_bytes(v, 'little'):04X}"
+    if kind == "eui64":
+        return v[::-1].hex().upper()
+    if kind == "mode":
+        return _BIN_MODE.get(v[0], MODE_MANUAL)
+    if kind == "valve":
+        return _BIN_VALVE.get(v[0], "closed")
+    if kind == "path":
+        return _BIN_PATH.get(v[0], VALVE_PATH_AUTO)
+    if kind == "u32_list":
+        return [int.from_bytes(v[i:i + 4], "little") for i in range(0, len(v) - 3, 4)]
+    if kind == "u8_list":
+        return list(v)
+    if kind == "u16_list":
+        return [int.from_bytes(v[i:i + 2], "little") for i in range(0, len(v) - 1, 2)]
+    if kind == "hist_kind":
+        return "raw" if v and v[0] == 0 else "min"
+    if kind == "alrm_kind":
+        return _BIN_ALRM_KIND.get(v[0] if v else 0, "deviation")
+    if kind == "conf":
+        return _BIN_CONF.get(v[0] if v else 0, "none")
+    if kind == "alrm_state":
+        return "raised" if v and v[0] else "cleared"
+    if kind == "hist_raw":
+        return [[int.from_bytes(v[i:i + 4], "little"), int.from_bytes(v[i + 4:i + 6], "little")]
+                for i in range(0, len(v) - 5, 6)]
+    if kind == "hist_min":
+        return [[int.from_bytes(v[i:i + 4], "little"),
+                 int.from_bytes(v[i + 4:i + 6], "little"),
+                 int.from_bytes(v[i + 6:i + 8], "little"),
+                 int.from_bytes(v[i + 8:i + 10], "little"),
+                 v[i + 10]]
+                for i in range(0, len(v) - 10, 11)]
+    if kind == "json_array":
+        try:
+            return json.loads("[" + v.decode("utf-8", errors="replace") + "]")
+        except json.JSONDecodeError:
+            return []
+    return int.from_bytes(v, "little")
+
+
+def parse_binary_frame(segment: bytes) -> Tuple[str, Dict[str, Any]]:
+    """
+    Decode one binary frame (bytes between two 0x00 delimiters).
+    
+    Returns:
+        Same shape as parse_uart_line(): ("DATA", {...}), ("ACK", {...}), ...
+        or ("ERR", {"error": "...", "raw": hex}) on CRC/format errors.
+        The frame sequence number is returned as payload["_seq"].
+    """
+    raw_hex = segment.hex()
+    try:
+        frame = cobs_decode(segment)
+    except ValueError:
+        return ("ERR", {"error": "bad_cobs", "raw": raw_hex})
+    
+    if len(frame) < 4:
+        return ("ERR", {"error": "short_frame", "raw": raw_hex})
+    
+    body, crc = frame[:-2], int.from_bytes(frame[-2:], "little")
+    if crc16_ccitt(body) != crc:
+        return ("ERR", {"error": "bad_crc", "raw": raw_hex})
+    
+    msg_type = BIN_TYPE_NAMES.get(body[0])
+    if msg_type is None:
+        return ("ERR", {"error": "unknown_type", "raw": raw_hex})
+    
+    # consecutive TLVs with the same tag are one value split at 255 bytes
+    tlvs: List[Tuple[int, bytes]] = []
+    i = 2
+    while i + 2 <= len(body):
+        tag, tlen = body[i], body[i + 1]
+        i += 2
+        value = body[i:i + tlen]
+        if len(value) != tlen:
+            return ("ERR", {"error": "bad_tlv", "raw": raw_hex})
+        i += tlen
+        if tlvs and tlvs[-1][0] == tag:
+            tlvs[-1] = (tag, tlvs[-1][1] + value)
+        else:
+            tlvs.append((tag, value))
+    
+    payload: Dict[str, Any] = {"_seq": body[1]}
+    for tag, value in tlvs:
+        name, kind = BIN_TAGS.get(tag, (f"tag_{tag:02x}", "u32"))
+        if kind == "extra":
+            # JSON members without braces, same text as the @LOG line
+            try:
+                extra = json.loads("{" + value.decode("utf-8", errors="replace") + "}")
+                if isinstance(extra, dict):
+                    payload.update(extra)
+            except json.JSONDecodeError:
+                payload["extra"] = value.decode("utf-8", errors="replace")
+            continue
+        payload[name] = _decode_tlv_value(kind, value)
+    
+    return (msg_type, payload)
+
+
+def extract_binary_frames(buf: bytes) -> Tuple[List[bytes], bytes]:
+    """
+    Split a received byte stream on 0x00 delimiters.
+    
+    Returns:
+        (complete_segments, remainder) - feed remainder back in with the
+        next chunk. Empty segments (back-to-back delimiters) are skipped.
+    """
+    parts = buf.split(b"\x00")
+    rest = parts.pop()
+    return ([p for p in parts if p], rest)
+
+
+def make_binary_cmd_frame(cmd_line: str, seq: int = 0) -> bytes:
+    """
+    Wrap a @CMD line (from make_cmd_line & co.) into a binary CMD frame.
+    
+    Example:
+        >>> make_binary_cmd_frame(make_info_cmd())
+        b'\x00...\x00'
+    """
+    json_part = cmd_line.strip()
+    if json_part.startswith(PREFIX_CMD):
+        json_part = json_part[len(PREFIX_CMD):].strip()
+    data = json_part.encode("utf-8")
+    
+    # one CMD_JSON TLV per 255 bytes, joined again by the Coordinator
+    body = bytearray([BIN_T_CMD, seq & 0xFF])
+    for i in range(0, max(len(data), 1), 0xFF):
+        chunk = data[i:i + 0xFF]
+        body += bytes([0x20, len(chunk)]) + chunk
+    body = bytes(body)
+    frame = body + crc16_ccitt(body).to_bytes(2, "little")
+    return b"\x00" + cobs_encode(frame) + b"\x00"
+
+
 # ============================================================================
 # Coordinator Error Messages (for reference)
 # ============================================================================
 
 COORDINATOR_ERRORS = {
     "missing op": "Missing 'op' field in command",
+    "bad json": "Command payload is not a valid JSON object",
     "missing value": "Missing 'value' field for operation that requires it",
-    "debounced": "Command sent too quickly (<500ms debounce)",
+    "debounced": "mode_set sent too quickly (<500ms debounce)",
     "rejected: AUTO mode": "valve_set rejected - Coordinator is in AUTO mode",
     "unknown op": "Unknown operation name",
     "bad channel": "Channel not in valid range (11-26)",
     "open_th must be < close_th": "Invalid threshold values",
+    "superseded": "valve_set replaced by a newer command to the same valve before it was sent",
+    "tx_failed": "Valve command not delivered after all retries",
+    "tx_timeout": "No delivery result from the stack for the last retry of a valve command",
+    "bad valve": "Valve index outside the valve table",
+    "not allowed in batch": "valve_set sent inside a batch; its ACK comes later, send it on its own",
+    "busy": "Every tracked command ID is still awaiting its ACK; retry later (not executed)",
+    "in_flight": "Not a result: a retried ID is still running, its final @ACK follows (ACK_IN_FLIGHT)",
+    "tx busy": "Coordinator DATA output queue full; retry sensor_get later",
+    "no history": "Sensor has no history slot (only the first HIST_SENSORS flow sensors keep one)",
 }
 
 
@@ -575,8 +1308,10 @@ COORDINATOR_ERRORS = {
 # ============================================================================
 
 # Timing constants (from Coordinator)
-DEBOUNCE_MS = 500  # Min time between mode_set/valve_set commands
-DUPLICATE_WINDOW_MS = 2000  # Window to ignore duplicate command IDs
+DEBOUNCE_MS = 500  # Min time between mode_set commands (valve_set: none, superseded per valve)
+DUPLICATE_WINDOW_MS = 10000  # Window after the final ACK in which a retried ID gets it replayed
+ACK_IN_FLIGHT = "in_flight"  # Interim @ACK msg ("ok":false) for a retry of a running ID; keep waiting
+VALVE_CMD_BUDGET_MS = 52000  # Longest valve_set run to its final ACK (app_config.h VALVE_CMD_BUDGET_MS)
 DEFAULT_NETWORK_JOIN_WINDOW_S = 180  # Seconds network accepts joins after form
 
 # Valid channels
@@ -607,6 +1342,29 @@ __all__ = [
     "make_valve_pair_cmd",
     "make_net_form_cmd",
     "make_uart_gateway_cmd",
+    "make_proto_set_cmd",
+    "make_batch_cmd",
+    "make_data_cfg_cmd",
+    "make_data_get_cmd",
+    "make_stats_cmd",
+    "make_sensor_get_cmd",
+    "make_history_cmd",
+    "make_filter_cmd",
+    "make_total_cfg_cmd",
+    "make_time_set_cmd",
+    "make_leak_cfg_cmd",
+    "make_leak_clear_cmd",
+    "make_stale_cfg_cmd",
+    "make_valve_get_cmd",
+    "DataVersionTracker",
+    
+    # Binary framing
+    "parse_binary_frame",
+    "extract_binary_frames",
+    "make_binary_cmd_frame",
+    "cobs_encode",
+    "cobs_decode",
+    "crc16_ccitt",
     
     # Translation
     "translate_coordinator_ack",
@@ -622,11 +1380,18 @@ __all__ = [
     "PREFIX_CMD",
     "PREFIX_LOG",
     "PREFIX_INFO",
+    "PREFIX_STAT",
+    "PREFIX_HIST",
+    "PREFIX_ALRM",
     "Operation",
     "VALVE_MQTT_TO_COORD",
     "VALVE_COORD_TO_MQTT",
     "MODE_AUTO",
     "MODE_MANUAL",
     "DEBOUNCE_MS",
+    "ACK_IN_FLIGHT",
+    "VALVE_CMD_BUDGET_MS",
     "VALID_CHANNELS",
+    "PROTO_TEXT",
+    "PROTO_BINARY",
 ]
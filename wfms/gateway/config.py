@@ -10,6 +10,8 @@ from typing import Optional
 from pydantic import Field, field_validator
 from pydantic_settings import BaseSettings, SettingsConfigDict
 
+from common.proto import VALVE_CMD_BUDGET_MS, PROTO_TEXT, PROTO_BINARY
+
 
 class Config(BaseSettings):
     """
@@ -19,6 +21,7 @@ class Config(BaseSettings):
     # UART Configuration
     uart_port: str = Field(default="COM11", description="Serial port for Zigbee Coordinator")
     uart_baud: int = Field(default=115200, description="Serial baud rate")
+    uart_proto: str = Field(default="text", description="UART framing: text or binary (negotiated with proto_set)")
     
     # MQTT Configuration (read from .env, no default - must be configured)
     mqtt_host: str = Field(description="MQTT broker host")
@@ -35,6 +38,7 @@ class Config(BaseSettings):
     rule_cooldown_global_s: int = Field(default=1, description="Global cooldown in seconds")
     rule_dedupe_ttl_s: int = Field(default=60, description="Deduplication TTL in seconds")
     ack_timeout_s: int = Field(default=3, description="ACK timeout in seconds")
+    cmd_deadline_s: int = Field(default=60, description="Max seconds a command may stay in_flight before it is reported failed (>= VALVE_CMD_BUDGET_MS)")
     
     # TX Pacing Configuration (Fix UART corruption)
     uart_tx_chunk_size: int = Field(default=8, description="Chunk size for TX pacing (0=disabled)")
@@ -71,6 +75,23 @@ class Config(BaseSettings):
             raise ValueError("UART_BAUD must be positive")
         return v
     
+    @field_validator("uart_proto")
+    @classmethod
+    def validate_uart_proto(cls, v: str) -> str:
+        """Only the two proto_set framings."""
+        v = v.lower()
+        if v not in (PROTO_TEXT, PROTO_BINARY):
+            raise ValueError("UART_PROTO must be 'text' or 'binary'")
+        return v
+    
+    @field_validator("cmd_deadline_s")
+    @classmethod
+    def validate_cmd_deadline(cls, v: int) -> int:
+        """A valve_set may run VALVE_CMD_BUDGET_MS on the Coordinator; give up no sooner."""
+        if v * 1000 < VALVE_CMD_BUDGET_MS:
+            raise ValueError(f"CMD_DEADLINE_S must be >= {VALVE_CMD_BUDGET_MS // 1000} (Coordinator valve budget)")
+        return v
+    
     @field_validator("mqtt_port", "api_port")
     @classmethod
     def validate_port(cls, v: int) -> int:
@@ -155,7 +176,7 @@ def load_config(env_path: Optional[str] = None) -> Config:
 if __name__ == "__main__":
     config = load_config()
     print("=== Gateway Configuration ===")
-    print(f"UART: {config.uart_port} @ {config.uart_baud} baud")
+    print(f"UART: {config.uart_port} @ {config.uart_baud} baud, {config.uart_proto}")
     print(f"MQTT: {config.mqtt_host}:{config.mqtt_port}")
     print(f"Site: {config.site}")
     print(f"Lock: {'ENABLED' if config.is_locked else 'DISABLED'}")
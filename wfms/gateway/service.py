@@ -16,6 +16,7 @@ import argparse
 import json
 import logging
 import os
+import re
 import sys
 import threading
 import time
@@ -28,16 +29,17 @@ import paho.mqtt.client as mqtt
 sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
 
 from common.proto import (
-    parse_uart_line, make_cmd_line, now_ts, validate_cmd_payload, 
+    make_cmd_line, now_ts, validate_cmd_payload, 
     translate_coordinator_ack, translate_coordinator_data,
-    VALVE_COORD_TO_MQTT
+    make_data_get_cmd, make_history_cmd, make_time_set_cmd, make_proto_set_cmd,
+    DataVersionTracker, VALVE_COORD_TO_MQTT, ACK_IN_FLIGHT, PROTO_BINARY
 )
 from common.contract import (
     TOPIC_STATE, TOPIC_TELEMETRY, TOPIC_CMD_VALVE, TOPIC_CMD_MODE, TOPIC_ACK, 
     TOPIC_GATEWAY_STATUS, VALVE_ON, VALVE_OFF, update_site
 )
 from gateway.config import load_config, Config
-from gateway.uart import UartBase, RealUart, FakeUart, extract_frames
+from gateway.uart import UartBase, RealUart, FakeUart
 from gateway.rules import Rules, RulesConfig
 from gateway.runtime import RuntimeState
 
@@ -54,6 +56,8 @@ logger = logging.getLogger("gateway")
 class StateCache:
     """Cached state from UART data (Coordinator format)."""
     flow: float = 0.0
+    flow_f: float = 0.0  # filtered flow, drives AUTO control
+    vol_ml: int = 0  # consumed volume (primary sensor totalizer)
     battery: int = 100
     valve: str = "OFF"  # MQTT format (ON/OFF)
     mode: str = "auto"  # auto/manual
@@ -66,6 +70,8 @@ class StateCache:
     def to_dict(self) -> dict:
         return {
             "flow": self.flow,
+            "flowFiltered": self.flow_f,
+            "volumeMl": self.vol_ml,
             "battery": self.battery,
             "valve": self.valve,
             "mode": self.mode,
@@ -85,6 +91,10 @@ class StateCache:
         """
         if "flow" in data:
             self.flow = data["flow"]
+        if "flow_f" in data:
+            self.flow_f = data["flow_f"]
+        if "vol_ml" in data:
+            self.vol_ml = data["vol_ml"]
         if "battery" in data:
             self.battery = data["battery"]
         if "valve" in data:
@@ -246,6 +256,13 @@ class GatewayService:
         # State
         self.state = StateCache()
         self.coordinator_info = CoordinatorInfo()  # @INFO cache
+        self.data_ver = DataVersionTracker()  # @DATA "ver" gap detection
+        self.sensors: Dict[str, dict] = {}  # per-sensor @DATA, keyed by "0x1234"
+        self.valves: Dict[int, dict] = {}   # per-valve @DATA, keyed by valve_idx
+        self.history: Dict[str, Dict[int, list]] = {}  # sensor -> {unix minute ts: [min,max,avg,n]}
+        self.alarms: Dict[tuple, dict] = {}  # (sensor, kind) -> raised @ALRM
+        self._time_sync_busy = False
+        self._uart_binary = False  # last seen framing of a RealUart
         self.ack_router = AckRouter(default_timeout=config.ack_timeout_s)
         
         # Rules engine
@@ -272,7 +289,7 @@ class GatewayService:
         logger.info("=" * 50)
         logger.info(f"Site: {self.config.site}")
         logger.info(f"MQTT: {self.config.mqtt_host}:{self.config.mqtt_port}")
-        logger.info(f"UART: {self.config.uart_port} @ {self.config.uart_baud}")
+        logger.info(f"UART: {self.config.uart_port} @ {self.config.uart_baud} ({self.config.uart_proto})")
         logger.info(f"Admin API: http://{self.config.api_host}:{self.config.api_port}")
         logger.info(f"Lock: {'ENABLED' if self.config.is_locked else 'DISABLED'}")
         logger.info("=" * 50)
@@ -297,6 +314,14 @@ class GatewayService:
         )
         self._uart_thread.start()
         
+        # Negotiate the framing, then backfill the Coordinator's flow history
+        # (dashboards start empty otherwise)
+        threading.Thread(
+            target=self._startup_commands,
+            daemon=True,
+            name="hist-backfill"
+        ).start()
+        
         # Log to runtime
         self.runtime.add_log("INFO", f"Gateway started (site={self.config.site})")
         
@@ -566,39 +591,72 @@ class GatewayService:
         Plus random jitter to avoid sync issues.
         
         Example with defaults: 0.3s -> 0.6s -> 1.2s (+ 0-0.2s jitter)
+        
+        A retry of an ID the Coordinator is still running (valve_set waiting
+        for delivery) is answered with the interim ACK "in_flight", never
+        executed twice. That is not a result: keep waiting for the final
+        ACK, and when it stays quiet for ack_timeout_s resend to ask again.
+        Neither uses up a retry; cmd_deadline_s bounds the whole command.
         """
         import random
         
         base_delay = self.config.cmd_retry_base_delay_s
         max_delay = self.config.cmd_retry_max_delay_s
         jitter = self.config.cmd_retry_jitter_s
-        
-        for attempt in range(max_retries + 1):
-            # Backoff delay BEFORE retry (not before first attempt)
-            if attempt > 0:
-                # Exponential backoff: base * 2^(attempt-1), capped at max
-                delay = min(max_delay, base_delay * (2 ** (attempt - 1)))
-                # Add random jitter
-                delay += random.uniform(0, jitter)
-                logger.info(f"Retry #{attempt} for cid={cid} (backoff {delay:.2f}s)")
-                time.sleep(delay)
-            
-            logger.info(f"TX >>> {cmd_line.strip()}")
-            
-            if not self.uart.write_line(cmd_line):
-                logger.error(f"TX FAILED: uart.write_line() returned False")
-                continue
+        deadline = time.monotonic() + self.config.cmd_deadline_s
+        
+        attempt = 0
+        in_flight = False   # last word from the Coordinator: still running
+        resend = True
+        poll = False        # resend to a command known to be running
+        while attempt <= max_retries:
+            if resend:
+                # Backoff delay BEFORE retry (not before first attempt or a poll)
+                if attempt > 0 and not poll:
+                    # Exponential backoff: base * 2^(attempt-1), capped at max
+                    delay = min(max_delay, base_delay * (2 ** (attempt - 1)))
+                    # Add random jitter
+                    delay += random.uniform(0, jitter)
+                    logger.info(f"Retry #{attempt} for cid={cid} (backoff {delay:.2f}s)")
+                    time.sleep(delay)
+                
+                poll = False
+                logger.info(f"TX >>> {cmd_line.strip()}")
+                
+                if not self.uart.write_line(cmd_line):
+                    logger.error(f"TX FAILED: uart.write_line() returned False")
+                    attempt += 1
+                    continue
             
             logger.info(f"TX OK: Waiting ACK for cid={cid} (timeout={self.config.ack_timeout_s}s)")
             
             # Wait for ACK
             ack = self.ack_router.wait_for_ack(cid, timeout=self.config.ack_timeout_s)
             
-            if ack is not None:
+            if ack is not None and ack.get("reason") != ACK_IN_FLIGHT:
                 logger.info(f"ACK received for cid={cid} on attempt {attempt + 1}")
                 return ack
             
+            if time.monotonic() >= deadline:
+                logger.error(f"cid={cid} still not finished after {self.config.cmd_deadline_s}s")
+                return None
+            
+            if ack is not None:
+                # interim: the Coordinator has it, wait for the final ACK
+                logger.info(f"cid={cid} in flight on the Coordinator, waiting")
+                in_flight = True
+                resend = False
+                continue
+            
+            resend = True
+            if in_flight:
+                # quiet since the last in_flight: ask again, not a new attempt
+                in_flight = False
+                poll = True
+                continue
+            
             logger.warning(f"ACK timeout for cid={cid} (attempt {attempt + 1}/{max_retries + 1})")
+            attempt += 1
         
         logger.error(f"All {max_retries + 1} attempts failed for cid={cid}")
         return None
@@ -608,37 +666,37 @@ class GatewayService:
         logger.info("UART reader thread started")
         
         while self._running:
-            line = self.uart.read_line(timeout=1.0)
-            if line is None:
-                continue
+            # text lines (several frames per line possible) or binary frames,
+            # as negotiated with proto_set; decoded to the same (type, payload)
+            frames = self.uart.read_frames(timeout=1.0)
             
-            # B3: Log RAW xuống DEBUG để tránh spam, chỉ bật khi cần debug sâu
-            logger.debug(f"[UART RX RAW] {line!r}")
-            
-            # Extract multiple frames from single line (handles @ACK/@INFO mid-line)
-            frames = extract_frames(line)
-            if not frames:
-                # No valid protocol frames found
-                logger.debug(f"[UART] No protocol frames in: {line[:60]}")
-                continue
+            # back in text (Coordinator rebooted): negotiate binary again
+            binary = getattr(self.uart, "is_binary", False)
+            if self._uart_binary and not binary and self.config.uart_proto == PROTO_BINARY:
+                threading.Thread(target=self._negotiate_binary, daemon=True, name="proto-set").start()
+            self._uart_binary = binary
             
             # B3: Log valid frames ở INFO level
-            for frame in frames:
-                logger.info(f"[UART RX] {frame[:80]}")
+            for msg_type, payload in frames:
+                logger.info(f"[UART RX] {msg_type} {str(payload)[:80]}")
             
             # Process each extracted frame
-            for frame in frames:
-                msg_type, payload = parse_uart_line(frame)
-                
+            for msg_type, payload in frames:
                 if msg_type == "DATA":
                     self._handle_uart_data(payload)
                 elif msg_type == "ACK":
-                    logger.info(f"RX @ACK frame: {frame}")
+                    logger.info(f"RX @ACK frame: {payload}")
                     self._handle_uart_ack(payload)
                 elif msg_type == "INFO":
                     self._handle_uart_info(payload)
                 elif msg_type == "LOG":
                     self._handle_uart_log(payload)
+                elif msg_type == "STAT":
+                    logger.info(f"RX @STAT: {payload}")
+                elif msg_type == "HIST":
+                    self._handle_uart_hist(payload)
+                elif msg_type == "ALRM":
+                    self._handle_uart_alrm(payload)
                 elif msg_type == "ERR":
                     error = payload.get("error", "")
                     raw = payload.get("raw", "")
@@ -662,6 +720,19 @@ class GatewayService:
         """
         logger.debug(f"RX @DATA: {data}")
         
+        # Per-sensor frames are kept separately; plain @DATA is the primary sensor
+        if "sensor" in data:
+            self.sensors[data["sensor"]] = {**self.sensors.get(data["sensor"], {}), **data}
+            return
+        if "valve_idx" in data:
+            self.valves[data["valve_idx"]] = {**self.valves.get(data["valve_idx"], {}), **data}
+            return
+        
+        # Delta frames only carry changed fields; after a ver gap ask for a snapshot
+        if self.data_ver.update(data):
+            logger.warning(f"@DATA ver gap (lost={self.data_ver.lost}), requesting snapshot")
+            self.uart.write_line(make_data_get_cmd())
+        
         # Update state cache (handles valve translation: open->ON, closed->OFF)
         self.state.update_from_data(data)
         
@@ -690,6 +761,108 @@ class GatewayService:
         # Publish state (retained)
         self._publish_state()
     
+    def _handle_uart_hist(self, hist: dict) -> None:
+        """
+        Handle one @HIST page (reply to the history op).
+        
+        Entry times are Coordinator uptime seconds; "uptime" is the
+        Coordinator clock when the page was sent.
+        """
+        sensor = hist.get("sensor", "?")
+        base = time.time() - hist.get("uptime", 0)
+        buckets = self.history.setdefault(sensor, {})
+        for t, *vals in hist.get("b", []):
+            buckets[int(base + t) // 60 * 60] = vals
+        logger.debug(f"RX @HIST {sensor} offset={hist.get('offset')} entries={len(hist.get('b', []))}")
+    
+    def _handle_uart_alrm(self, alrm: dict) -> None:
+        """
+        Handle @ALRM (Coordinator leak detection, raised or cleared).
+        
+        Coordinator ALRM: {"sensor":"0x1234","kind":"min_flow","state":"raised","flow":8,"min":8,...}
+        kind "deviation" / "min_flow" is a leak; "stale" means the sensor
+        stopped reporting (timeout_s), not that water is flowing.
+        """
+        sensor, kind = alrm.get("sensor", "?"), alrm.get("kind", "?")
+        key = (sensor, kind)
+        raised = alrm.get("state") == "raised"
+        if raised:
+            self.alarms[key] = alrm
+        else:
+            self.alarms.pop(key, None)
+        
+        if kind == "stale":
+            if raised:
+                logger.warning(f"Sensor {sensor} stale: no report for {alrm.get('timeout_s', '?')} s")
+            else:
+                logger.info(f"Sensor {sensor} reporting again")
+        elif kind in ("deviation", "min_flow"):
+            if raised:
+                logger.warning(f"LEAK ALARM {sensor} {kind}: {alrm}")
+            else:
+                logger.info(f"Leak alarm cleared {sensor} {kind}")
+        else:
+            logger.info(f"Unknown @ALRM kind {kind!r}: {alrm}")
+        self.runtime.add_log("ALRM", json.dumps(alrm))
+    
+    def _sync_time(self) -> None:
+        """Give the Coordinator the local time (leak baseline is per hour of day)."""
+        try:
+            cid = f"time_{int(time.time() * 1000)}"
+            self._send_cmd_with_retry(cid, make_time_set_cmd(cid=cid))
+        finally:
+            self._time_sync_busy = False
+    
+    def _startup_commands(self) -> None:
+        """Commands sent once the reader runs: framing first, then history."""
+        if self.config.uart_proto == PROTO_BINARY:
+            self._negotiate_binary()
+        self._backfill_history()
+    
+    def _negotiate_binary(self) -> None:
+        """
+        proto_set "binary": the UART switches framing on the @ACK (sent in
+        text). A Coordinator that reboots answers in text again; the UART
+        follows it and the reader loop negotiates anew.
+        """
+        cid = f"proto_{int(time.time() * 1000)}"
+        ack = self._send_cmd_with_retry(cid, make_proto_set_cmd(PROTO_BINARY, cid=cid))
+        if ack and ack.get("ok"):
+            logger.info("UART framing: binary")
+            self.runtime.add_log("INFO", "UART framing: binary")
+        else:
+            logger.warning(f"UART binary framing refused, staying in text: {ack.get('reason') if ack else 'no ACK'}")
+    
+    def _backfill_history(self) -> None:
+        """Page through the primary sensor's 1-minute history (history op)."""
+        offset = 0
+        stalls = 0
+        while self._running:
+            cid = f"hist_{int(time.time() * 1000)}"
+            ack = self._send_cmd_with_retry(cid, make_history_cmd(offset=offset, cid=cid))
+            if not ack or not ack.get("ok"):
+                logger.info(f"History backfill stopped: {ack.get('reason') if ack else 'no ACK'}")
+                return
+            m = re.match(r"hist (\d+) next (\d+)/(\d+)", ack.get("reason", ""))
+            if not m:
+                return
+            sent, offset, total = int(m.group(1)), int(m.group(2)), int(m.group(3))
+            # "hist 0" before the end: the page was not queued (Coordinator
+            # TX busy), "next" is unchanged; let the UART drain and ask again
+            if sent == 0 and offset < total:
+                stalls += 1
+                if stalls > 10:
+                    logger.warning(f"History backfill stopped: page at {offset} not sent")
+                    return
+                time.sleep(0.2)
+                continue
+            stalls = 0
+            if offset >= total:
+                n = sum(len(v) for v in self.history.values())
+                logger.info(f"History backfill done: {n} minute buckets")
+                self.runtime.add_log("INFO", f"History backfill: {n} minute buckets")
+                return
+    
     def _handle_uart_info(self, info: dict) -> None:
         """
         Handle @INFO from UART (Coordinator heartbeat).
@@ -709,6 +882,14 @@ class GatewayService:
         if "valve_known" in info:
             self.state.valve_known = info["valve_known"]
         
+        # Local time unknown (after a reset) or drifted: set it off the reader thread
+        if "local_s" in info and not self._time_sync_busy:
+            now = time.time()
+            local_now = now + time.localtime(now).tm_gmtoff
+            if info["local_s"] == 0 or abs(info["local_s"] - local_now) > 120:
+                self._time_sync_busy = True
+                threading.Thread(target=self._sync_time, daemon=True, name="time-sync").start()
+        
         # Log important info on first receive or significant changes
         logger.info(f"Coordinator: node={info.get('node_id', '?')}, "
                    f"pan={info.get('pan_id', '?')}, ch={info.get('ch', '?')}, "
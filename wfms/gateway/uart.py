@@ -3,7 +3,8 @@ UART Interface - Real and Fake implementations
 
 Provides:
 - UartBase: Abstract interface
-- RealUart: pyserial-based real UART connection with auto-reconnect
+- RealUart: pyserial-based real UART connection with auto-reconnect and
+  the binary framing negotiated with proto_set
 - FakeUart: Simulated UART for UI development without hardware
 """
 
@@ -14,10 +15,11 @@ import random
 import logging
 import re
 from abc import ABC, abstractmethod
-from typing import Optional, Callable
+from typing import Optional, Callable, List, Tuple, Dict, Any
 
 from common.proto import (
     make_data_line, make_ack_line, make_info_line, parse_uart_line, now_ts,
+    parse_binary_frame, make_binary_cmd_frame, Operation, PROTO_BINARY,
     VALVE_MQTT_TO_COORD, VALVE_COORD_TO_MQTT, MODE_AUTO, MODE_MANUAL
 )
 
@@ -45,9 +47,9 @@ DEBUG_SPAM_PATTERNS = [
 _DEBUG_FILTERS = [re.compile(p) for p in DEBUG_SPAM_PATTERNS]
 
 # Protocol tokens for frame extraction (with space after prefix)
-PROTOCOL_TOKENS = ["@ACK ", "@INFO ", "@DATA ", "@LOG ", "@ERR ", "@CMD "]
+PROTOCOL_TOKENS = ["@ACK ", "@INFO ", "@DATA ", "@LOG ", "@ERR ", "@CMD ", "@STAT ", "@HIST ", "@ALRM "]
 # Also match tokens without space (in case of compact JSON)
-PROTOCOL_TOKENS_COMPACT = ["@ACK{", "@INFO{", "@DATA{", "@LOG{", "@ERR{", "@CMD{"]
+PROTOCOL_TOKENS_COMPACT = ["@ACK{", "@INFO{", "@DATA{", "@LOG{", "@ERR{", "@CMD{", "@STAT{", "@HIST{", "@ALRM{"]
 
 
 def extract_frames(text: str) -> list:
@@ -166,6 +168,18 @@ class UartBase(ABC):
         """
         pass
     
+    def read_frames(self, timeout: float = 1.0) -> List[Tuple[str, Dict[str, Any]]]:
+        """
+        Read the next protocol frames, whatever the framing.
+        
+        Returns:
+            (type, payload) pairs as from parse_uart_line(); empty on timeout
+        """
+        line = self.read_line(timeout=timeout)
+        if line is None:
+            return []
+        return [parse_uart_line(frame) for frame in extract_frames(line)]
+    
     @abstractmethod
     def write_line(self, line: str) -> bool:
         """
@@ -193,8 +207,16 @@ class RealUart(UartBase):
     
     TX Pacing (Fix A): Send data in chunks with delays to prevent
     Coordinator RX buffer overrun and CLI parse errors.
+    
+    Binary framing: write_line() notes a proto_set @CMD; when its @ACK
+    (still in the old framing) comes back ok, both directions switch right
+    after it. In binary mode a text @ line from the Coordinator (reboot)
+    switches back to text.
     """
     
+    # drop undelimited binary-mode input beyond this (noise, no 0x00)
+    BIN_BUFFER_MAX = 8192
+    
     def __init__(self, port: str, baud: int = 115200, reconnect_interval: float = 3.0,
                  tx_chunk_size: int = 8, tx_chunk_delay_ms: int = 10, tx_char_delay_ms: int = 0):
         self.port = port
@@ -215,6 +237,17 @@ class RealUart(UartBase):
         # TICK-sync: track last TICK time for safe TX window
         self._last_tick_time = 0.0
         self._tick_interval = 5.0  # Coordinator sends TICK every 5s
+        
+        # Framing (proto_set): current mode and the switch awaiting its @ACK
+        self._line_buffer = b""
+        self._binary = False
+        self._proto_pending: Optional[Tuple[int, bool]] = None  # (cmd id, binary)
+        self._tx_seq = 0
+    
+    @property
+    def is_binary(self) -> bool:
+        """True while binary frames are exchanged (proto_set "binary")."""
+        return self._binary
     
     def start(self) -> None:
         """Start UART connection."""
@@ -289,10 +322,6 @@ class RealUart(UartBase):
         if not self._connected:
             return None
         
-        # Use instance buffer to persist across calls
-        if not hasattr(self, '_line_buffer'):
-            self._line_buffer = b""
-        
         deadline = time.time() + timeout
         
         while time.time() < deadline:
@@ -380,10 +409,15 @@ class RealUart(UartBase):
                         break
                     time.sleep(0.005)
                 
-                # Encode entire line
-                data = line.encode('utf-8')
-                if not data.endswith(b'\n'):
-                    data += b'\n'
+                # Encode entire line (one CMD frame in binary mode)
+                if self._binary:
+                    data = make_binary_cmd_frame(line, self._tx_seq)
+                    self._tx_seq = (self._tx_seq + 1) & 0xFF
+                else:
+                    data = line.encode('utf-8')
+                    if not data.endswith(b'\n'):
+                        data += b'\n'
+                self._note_proto_set(line)
                 
                 logger.info(f"[UART TX] Sending {len(data)} bytes with pacing: chunk={self.tx_chunk_size}, delay={self.tx_chunk_delay_ms}ms")
                 
@@ -424,6 +458,97 @@ class RealUart(UartBase):
                 self._connected = False
                 return False
     
+    def read_frames(self, timeout: float = 1.0) -> List[Tuple[str, Dict[str, Any]]]:
+        """Read protocol frames in the negotiated framing (see class doc)."""
+        if self._binary:
+            frames = self._read_binary(timeout)
+        else:
+            frames = super().read_frames(timeout)
+        self._check_proto_ack(frames)
+        return frames
+    
+    def _note_proto_set(self, line: str) -> None:
+        """Remember a proto_set @CMD; the framing switches on its @ACK."""
+        msg_type, payload = parse_uart_line(line.strip())
+        if msg_type == "CMD" and payload.get("op") == Operation.PROTO_SET.value:
+            self._proto_pending = (payload.get("id", 0), payload.get("value") == PROTO_BINARY)
+    
+    def _check_proto_ack(self, frames: List[Tuple[str, Dict[str, Any]]]) -> None:
+        pending = self._proto_pending
+        if pending is None:
+            return
+        for msg_type, payload in frames:
+            if msg_type == "ACK" and payload.get("id") == pending[0]:
+                self._proto_pending = None
+                if payload.get("ok"):
+                    self._binary = pending[1]
+                    logger.info(f"[UART] framing switched to {'binary' if self._binary else 'text'}")
+                return
+    
+    def _read_binary(self, timeout: float) -> List[Tuple[str, Dict[str, Any]]]:
+        """Read 0x00-delimited COBS frames (parse_binary_frame)."""
+        if not self._connected:
+            return []
+        
+        deadline = time.time() + timeout
+        while time.time() < deadline:
+            with self._lock:
+                if not self._serial:
+                    return []
+                try:
+                    bytes_available = self._serial.in_waiting
+                    if bytes_available > 0:
+                        chunk = self._serial.read(bytes_available)
+                        if chunk:
+                            self._line_buffer += chunk
+                except Exception as e:
+                    logger.error(f"UART read error: {e}")
+                    self._connected = False
+                    self._line_buffer = b""
+                    return []
+            
+            frames = self._split_binary()
+            if frames or not self._binary:
+                return frames
+            time.sleep(0.002)
+        
+        return []
+    
+    def _split_binary(self) -> List[Tuple[str, Dict[str, Any]]]:
+        """Decode the complete frames in the buffer, keep the partial rest."""
+        frames = []
+        buf = self._line_buffer
+        while buf:
+            # A COBS segment starts with its code byte and then the frame type
+            # (< 0x10), never with "@" + a letter: that is a text line, so the
+            # Coordinator is back in text mode (reset).
+            head = buf.lstrip(b"\r\n")
+            if head[:1] == b"@" and (len(head) < 2 or head[1:2].isalpha()):
+                if b"\n" not in head:
+                    break
+                logger.warning("[UART] text line in binary mode: Coordinator uses text, switching back")
+                self._binary = False
+                self._proto_pending = None
+                self._line_buffer = head
+                return frames
+            if b"\x00" not in buf:
+                if len(buf) > self.BIN_BUFFER_MAX:
+                    logger.warning(f"[UART] {len(buf)} bytes without a frame delimiter dropped")
+                    buf = b""
+                break
+            segment, buf = buf.split(b"\x00", 1)
+            if not segment:
+                continue
+            msg_type, payload = parse_binary_frame(segment)
+            if msg_type == "ERR":
+                # debug text between frames, or a damaged frame
+                logger.debug(f"[UART] not a frame: {payload.get('error')} {segment[:40]!r}")
+                continue
+            logger.info(f"[UART RX BIN] {msg_type} {payload}")
+            frames.append((msg_type, payload))
+        self._line_buffer = buf
+        return frames
+    
     @property
     def is_connected(self) -> bool:
         return self._connected